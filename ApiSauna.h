@@ -29,6 +29,7 @@
 
 #include <Arduino.h>
 #include "Controller.h"
+#include "SensorTrace.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -35,6 +35,7 @@ void setup()
 {
     Serial.begin(CFG_SERIAL_SPEED);
     Serial.println(CFG_VERSION);
+    SENSOR_TRACE(start());
 
     Controller::getInstance()->initialize();
 }
@@ -45,6 +46,7 @@ void setup()
 void loop()
 {
     Controller::getInstance()->process();
+    EepromWriter::process();
 
-    delay(CFG_LOOP_DELAY);
+    SerialBuffer::drainUntil(millis() + CFG_LOOP_DELAY); // send queued output while waiting for the next cycle
 }
@@ -0,0 +1,192 @@
+/*
+ * ButtonInput.cpp
+ *
+ * Interrupt driven debouncing of the buttons. The compare match interrupt of
+ * timer 0 (which also drives millis()) samples the pins at 1kHz. Pin change
+ * interrupts are not used, as the default pins (A1, A2) don't support them
+ * on the ATmega2560.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "ButtonInput.h"
+#include "SensorTrace.h"
+
+CFG_INSTANCE_LOCAL uint8_t ButtonInput::pin[BUTTON_COUNT];
+#ifdef __AVR__
+CFG_INSTANCE_LOCAL volatile uint8_t *ButtonInput::inputRegister[BUTTON_COUNT];
+CFG_INSTANCE_LOCAL uint8_t ButtonInput::bitMask[BUTTON_COUNT];
+#endif
+CFG_INSTANCE_LOCAL uint8_t ButtonInput::pressed = 0;
+CFG_INSTANCE_LOCAL uint8_t ButtonInput::bounceTime[BUTTON_COUNT];
+CFG_INSTANCE_LOCAL uint32_t ButtonInput::releaseTime[BUTTON_COUNT];
+CFG_INSTANCE_LOCAL uint32_t ButtonInput::changeTime = 0;
+CFG_INSTANCE_LOCAL bool ButtonInput::longPressSent = false;
+CFG_INSTANCE_LOCAL bool ButtonInput::holdSent = false;
+CFG_INSTANCE_LOCAL ButtonEvent ButtonInput::events[CFG_BUTTON_QUEUE_SIZE];
+CFG_INSTANCE_LOCAL volatile uint8_t ButtonInput::head = 0;
+CFG_INSTANCE_LOCAL volatile uint8_t ButtonInput::tail = 0;
+
+/**
+ * Configure the pins and start sampling them.
+ */
+void ButtonInput::initialize(uint8_t pinNext, uint8_t pinSelect)
+{
+    pin[0] = pinNext;
+    pin[1] = pinSelect;
+    for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+        pinMode(pin[i], INPUT);
+        bounceTime[i] = 0;
+        releaseTime[i] = 0;
+#ifdef __AVR__
+        inputRegister[i] = portInputRegister(digitalPinToPort(pin[i]));
+        bitMask[i] = digitalPinToBitMask(pin[i]);
+#endif
+    }
+#ifdef __AVR__
+    OCR0A = 0x80; // fire in the middle of the millis() counter cycle
+    TIMSK0 |= _BV(OCIE0A);
+#endif
+}
+
+/**
+ * Get the next event from the queue.
+ *
+ * \return false if the queue is empty
+ */
+bool ButtonInput::getEvent(ButtonEvent *event)
+{
+    bool available = false;
+
+    noInterrupts();
+    if (tail != head) {
+        *event = events[tail];
+        tail = (tail + 1) % CFG_BUTTON_QUEUE_SIZE;
+        available = true;
+    }
+    interrupts();
+    if (available) {
+        SENSOR_TRACE(button(*event));
+    }
+    return available;
+}
+
+/**
+ * Discard all queued events (e.g. presses which happened before a dialog was shown).
+ */
+void ButtonInput::clear()
+{
+    noInterrupts();
+    tail = head;
+    interrupts();
+}
+
+/**
+ * Queue an event which didn't come from the buttons, e.g. when a recorded trace is replayed.
+ */
+void ButtonInput::inject(uint8_t type, uint8_t buttons, uint32_t time)
+{
+    noInterrupts();
+    queue(type, buttons, time);
+    interrupts();
+}
+
+/**
+ * Sample the buttons and queue the events (called every ms by the timer interrupt). A button must
+ * be stable for CFG_BUTTON_DEBOUNCE ms to change its state.
+ */
+void ButtonInput::sample()
+{
+    uint32_t now = millis();
+
+    for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+        uint8_t bit = 1 << i;
+        if (isPressed(i) == ((pressed & bit) != 0)) {
+            bounceTime[i] = 0;
+            continue;
+        }
+        if (++bounceTime[i] < CFG_BUTTON_DEBOUNCE) {
+            continue;
+        }
+        bounceTime[i] = 0;
+        pressed ^= bit;
+        changeTime = now;
+        longPressSent = false;
+        holdSent = false;
+
+        if (pressed & bit) {
+            queue(eventPress, bit, now);
+            if (releaseTime[i] != 0 && now - releaseTime[i] < CFG_BUTTON_DOUBLE_PRESS) {
+                queue(eventDoublePress, bit, now);
+            }
+        } else {
+            queue(eventRelease, bit, now);
+            releaseTime[i] = now;
+        }
+    }
+
+    if (pressed != 0) {
+        if (!longPressSent && now - changeTime >= CFG_BUTTON_LONG_PRESS) {
+            queue(eventLongPress, pressed, now);
+            longPressSent = true;
+        }
+        if (!holdSent && now - changeTime >= CFG_BUTTON_HOLD) {
+            queue(eventHold, pressed, now);
+            holdSent = true;
+        }
+    }
+}
+
+/**
+ * Read the raw state of a button (they're active high)
+ */
+bool ButtonInput::isPressed(uint8_t button)
+{
+#ifdef __AVR__
+    return (*inputRegister[button] & bitMask[button]) != 0;
+#else
+    return digitalRead(pin[button]) != 0;
+#endif
+}
+
+/**
+ * Add an event to the queue, it's dropped if the queue is full.
+ */
+void ButtonInput::queue(uint8_t type, uint8_t buttons, uint32_t time)
+{
+    uint8_t next = (head + 1) % CFG_BUTTON_QUEUE_SIZE;
+    if (next == tail) {
+        return;
+    }
+    events[head].type = type;
+    events[head].buttons = buttons;
+    events[head].time = time;
+    head = next;
+}
+
+#ifdef __AVR__
+ISR(TIMER0_COMPA_vect)
+{
+    ButtonInput::sample();
+}
+#endif
@@ -0,0 +1,93 @@
+/*
+ * ButtonInput.h
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef BUTTONINPUT_H_
+#define BUTTONINPUT_H_
+
+#include <Arduino.h>
+#include "config.h"
+
+#define BUTTON_COUNT 2
+
+/*
+ * A debounced change of the buttons, buttons is a bit mask of ButtonInput::Button
+ */
+class ButtonEvent
+{
+public:
+    uint8_t type; // ButtonInput::EventType
+    uint8_t buttons; // the button which changed (for long-press and hold: all pressed buttons)
+    uint32_t time; // when the event occurred (in millis)
+};
+
+/*
+ * Samples the buttons every millisecond from a timer interrupt, so no press is missed
+ * while the main loop is busy or blocked, and queues the debounced events.
+ */
+class ButtonInput
+{
+public:
+    enum Button
+    {
+        buttonNext = 1 << 0,
+        buttonSelect = 1 << 1
+    };
+    enum EventType
+    {
+        eventPress, // a button was pressed
+        eventRelease, // a button was released
+        eventDoublePress, // a button was pressed again shortly after its release (sent after eventPress)
+        eventLongPress, // the pressed buttons were held for CFG_BUTTON_LONG_PRESS
+        eventHold // the pressed buttons were held for CFG_BUTTON_HOLD
+    };
+
+    static void initialize(uint8_t pinNext, uint8_t pinSelect);
+    static bool getEvent(ButtonEvent *event);
+    static void clear();
+    static void inject(uint8_t type, uint8_t buttons, uint32_t time);
+    static void sample();
+
+private:
+    static bool isPressed(uint8_t button);
+    static void queue(uint8_t type, uint8_t buttons, uint32_t time);
+
+    static CFG_INSTANCE_LOCAL uint8_t pin[BUTTON_COUNT]; // the input pins of the buttons
+#ifdef __AVR__
+    static CFG_INSTANCE_LOCAL volatile uint8_t *inputRegister[BUTTON_COUNT]; // the port input register of the buttons (faster than digitalRead)
+    static CFG_INSTANCE_LOCAL uint8_t bitMask[BUTTON_COUNT]; // the bits of the buttons in the input register
+#endif
+    static CFG_INSTANCE_LOCAL uint8_t pressed; // debounced state of the buttons (bit mask)
+    static CFG_INSTANCE_LOCAL uint8_t bounceTime[BUTTON_COUNT]; // time the raw state of a button differs from the debounced state (in ms)
+    static CFG_INSTANCE_LOCAL uint32_t releaseTime[BUTTON_COUNT]; // when a button was released the last time (in millis, 0 = never)
+    static CFG_INSTANCE_LOCAL uint32_t changeTime; // when the pressed buttons changed the last time (in millis)
+    static CFG_INSTANCE_LOCAL bool longPressSent; // the long-press of the pressed buttons was queued
+    static CFG_INSTANCE_LOCAL bool holdSent; // the hold of the pressed buttons was queued
+    static CFG_INSTANCE_LOCAL ButtonEvent events[CFG_BUTTON_QUEUE_SIZE];
+    static CFG_INSTANCE_LOCAL volatile uint8_t head; // where the interrupt adds the next event
+    static CFG_INSTANCE_LOCAL volatile uint8_t tail; // the next event to be read by the main loop
+};
+
+#endif /* BUTTONINPUT_H_ */
@@ -0,0 +1,117 @@
+/*
+ * Checkpoint.cpp
+ *
+ * Stores the state of the running program periodically in the EEPROM, so
+ * it can be resumed after a power loss. Each checkpoint is written to the
+ * next slot of a ring to spread the write cycles.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "Checkpoint.h"
+#include "Sauna.h"
+
+/**
+ * Constructor
+ */
+Checkpoint::Checkpoint()
+{
+    memset(&record, 0, sizeof(CheckpointRecord));
+    nextSlot = 0;
+}
+
+/**
+ * Destructor
+ */
+Checkpoint::~Checkpoint()
+{
+}
+
+/**
+ * Return the instance of the current sauna
+ */
+Checkpoint *Checkpoint::getInstance()
+{
+    return &Sauna::getCurrent()->checkpoint;
+}
+
+/**
+ * Find the most recent checkpoint in the EEPROM.
+ *
+ * \return true if a program was running when the checkpoint was saved
+ */
+bool Checkpoint::load(CheckpointRecord *checkpoint)
+{
+    CheckpointRecord stored;
+    bool found = false;
+
+    EepromWriter::flush();
+    for (uint8_t slot = 0; slot < CHECKPOINT_NUMBER_OF_SLOTS; slot++) {
+        EEPROM.get(CONFIG_ADDRESS_CHECKPOINT + slot * sizeof(CheckpointRecord), stored);
+        if (stored.crc != calculateCrc(&stored)) {
+            continue;
+        }
+        if (!found || (int16_t) (stored.sequence - record.sequence) > 0) {
+            found = true;
+            record = stored;
+            nextSlot = (slot + 1) % CHECKPOINT_NUMBER_OF_SLOTS;
+        }
+    }
+    *checkpoint = record;
+    return found && record.program != 0;
+}
+
+/**
+ * Queue a checkpoint for writing to the next slot.
+ */
+void Checkpoint::save(CheckpointRecord *checkpoint)
+{
+    uint16_t sequence = record.sequence + 1;
+
+    record = *checkpoint;
+    record.sequence = sequence;
+    memset(record.reserved, 0, sizeof(record.reserved));
+    record.crc = calculateCrc(&record);
+
+    LOG_DEBUG(Logger::moduleSystem, F("saving checkpoint #%u"), record.sequence);
+    if (!EepromWriter::write(CONFIG_ADDRESS_CHECKPOINT + nextSlot * sizeof(CheckpointRecord), &record, sizeof(CheckpointRecord), false)) {
+        LOG_ERROR(Logger::moduleSystem, F("unable to queue checkpoint for saving"));
+    }
+    nextSlot = (nextSlot + 1) % CHECKPOINT_NUMBER_OF_SLOTS;
+}
+
+/**
+ * Save a checkpoint without running program, so it isn't resumed at the next start.
+ */
+void Checkpoint::clear()
+{
+    CheckpointRecord empty;
+
+    memset(&empty, 0, sizeof(CheckpointRecord));
+    save(&empty);
+}
+
+uint16_t Checkpoint::calculateCrc(CheckpointRecord *checkpoint)
+{
+    return Crc::calculate((uint8_t *) checkpoint, sizeof(CheckpointRecord) - 2);
+}
@@ -0,0 +1,82 @@
+/*
+ * Checkpoint.h
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include "config.h"
+#include "Logger.h"
+#include "Crc.h"
+#include "EepromWriter.h"
+#include <EEPROM.h>
+
+#define CONFIG_ADDRESS_CHECKPOINT   3072
+#define CONFIG_SIZE_CHECKPOINT      256
+
+/*
+ * The state of a running program, to resume it after a power loss.
+ */
+class CheckpointRecord
+{
+public:
+    uint16_t sequence; // running number of the checkpoint
+    uint8_t program; // number of the running program (1-based, 0 = no program running)
+    uint8_t state; // Status::SystemState (pre-heat or running)
+    uint32_t timeRunning; // time the segment is running (in s)
+    int16_t plateTargetTemperature; // the dampened target temperature of the plates (in 0.1 deg C)
+    int16_t hivePidOutput; // output of the hive PID (in 0.1 deg C)
+    uint8_t platePidOutput[CFG_MAX_NUMBER_PLATES]; // output of the plate PIDs (0-255)
+    uint8_t segment; // number of the current segment (0-based)
+    int16_t rampStart; // the target temperature at the start of the segment (in 0.1 deg C)
+    uint16_t dose[CFG_MAX_NUMBER_PLATES]; // thermal dose of the hive sensors (in min at CFG_DOSE_TEMPERATURE)
+    uint8_t reserved[2];
+    uint16_t crc; // lower 16 bits of the CRC of the bytes above
+    // 64 bytes used
+};
+
+#define CHECKPOINT_NUMBER_OF_SLOTS  (CONFIG_SIZE_CHECKPOINT / sizeof(CheckpointRecord))
+
+class Checkpoint
+{
+public:
+    static Checkpoint *getInstance();
+    virtual ~Checkpoint();
+    bool load(CheckpointRecord *checkpoint);
+    void save(CheckpointRecord *checkpoint);
+    void clear();
+
+private:
+    friend class Sauna; // owns the instance
+    Checkpoint();
+    Checkpoint(Checkpoint const&); // copy disabled
+    void operator=(Checkpoint const&); // assigment disabled
+    uint16_t calculateCrc(CheckpointRecord *checkpoint);
+
+    CheckpointRecord record; // the last saved checkpoint (must stay valid until written)
+    uint8_t nextSlot; // the slot to which the next checkpoint will be written
+};
+
+#endif /* CHECKPOINT_H_ */
@@ -25,69 +25,121 @@
  */
 
 #include "Configuration.h"
+#include "Sauna.h"
 
 Configuration::Configuration()
 {
+    memset(&params, 0, sizeof(ConfigurationParams));
+    memset(&io, 0, sizeof(ConfigurationIO));
+    memset(&sensor, 0, sizeof(ConfigurationSensor));
 }
 
 Configuration::~Configuration()
 {
+
 }
 
 /**
- * Return the instance of the singleton
+ * Return the instance of the current sauna
  */
 Configuration *Configuration::getInstance()
 {
-    static Configuration instance;
-    return &instance;
+    return &Sauna::getCurrent()->configuration;
 }
 
 /**
  * Load the configuration from EEPROM and verify the CRC values
- * as well as the existance of the ApiSauna token.
+ * as well as the existance of the ApiSauna token. Blocks with an invalid CRC
+ * are restored from their backup copy.
  *
  * If the token is not found, it is assumed that the configuration was never saved on this board and the config is re-set and saved.
+ * A configuration of version 1 (without backups) is moved to the current layout.
  * If a CRC check fails, a error is printed to the log and HID and false is returned - causing the controller to go into error state.
  */
 bool Configuration::load()
 {
-    Logger::info(F("loading configuration"));
-    EEPROM.get(CONFIG_ADDRESS_IO, *getIO());
-    EEPROM.get(CONFIG_ADDRESS_PARAMS, *getParams());
-    EEPROM.get(CONFIG_ADDRESS_SENSOR, *getSensor());
+    Status *status = Status::getInstance();
+    LOG_INFO(Logger::moduleSystem, F("loading configuration"));
+    EepromWriter::flush();
+    bool paramsValid = read(CONFIG_ADDRESS_PARAMS, CONFIG_ADDRESS_PARAMS_BACKUP, getParams(), sizeof(ConfigurationParams));
 
     if (getParams()->token != CFG_EEPROM_CONFIG_TOKEN) {
-        Logger::warn(F("no ApiSauna token found in EEPROM --> resetting configuration and statistics"));
+        LOG_WARN(Logger::moduleSystem, F("no ApiSauna token found in EEPROM --> resetting configuration and statistics"));
         reset();
         save();
         Statistics::getInstance()->reset();
         Statistics::getInstance()->save();
+        return true;
     }
-
-    if (getParams()->crc != Crc::calculate((uint8_t *) getParams() + 4, sizeof(ConfigurationParams) - 4)) {
-        Logger::error(F("invalid crc detected in parameter configuration"));
-        status.errorCode = Status::crcParam;
+    if (!paramsValid) {
+        LOG_ERROR(Logger::moduleSystem, F("invalid crc detected in parameter configuration"));
+        status->errorCode = Status::crcParam;
         return false;
     }
-    if (getIO()->crc != Crc::calculate((uint8_t *) getIO() + 4, sizeof(ConfigurationIO) - 4)) {
-        Logger::error(F("invalid crc detected in I/O configuration"));
-        status.errorCode = Status::crcIo;
+
+    bool version1 = (getParams()->version < CONFIG_VERSION);
+    if (!(version1 ? read(CONFIG_ADDRESS_IO_VERSION1, CONFIG_ADDRESS_IO_VERSION1, getIO(), sizeof(ConfigurationIO)) :
+            read(CONFIG_ADDRESS_IO, CONFIG_ADDRESS_IO_BACKUP, getIO(), sizeof(ConfigurationIO)))) {
+        LOG_ERROR(Logger::moduleSystem, F("invalid crc detected in I/O configuration"));
+        status->errorCode = Status::crcIo;
         return false;
     }
-    if (getSensor()->crc != Crc::calculate((uint8_t *) getSensor() + 4, sizeof(ConfigurationSensor) - 4)) {
-        Logger::error(F("invalid crc detected in sensor configuration"));
-        status.errorCode = Status::crcSensor;
+    if (!read(CONFIG_ADDRESS_SENSOR, (version1 ? CONFIG_ADDRESS_SENSOR : CONFIG_ADDRESS_SENSOR_BACKUP), getSensor(),
+            sizeof(ConfigurationSensor))) {
+        LOG_ERROR(Logger::moduleSystem, F("invalid crc detected in sensor configuration"));
+        status->errorCode = Status::crcSensor;
         return false;
     }
 
     if (getParams()->numberOfPlates > CFG_MAX_NUMBER_PLATES) {
         getParams()->numberOfPlates = CFG_MAX_NUMBER_PLATES;
     }
+    if (version1) {
+        LOG_INFO(Logger::moduleSystem, F("moving configuration to version %d"), CONFIG_VERSION);
+        getParams()->version = CONFIG_VERSION;
+        save();
+    }
 
     return true;
 }
 
+/**
+ * Read a configuration block, its backup copy is used if the CRC of the block is invalid.
+ *
+ * \return false if neither of the copies is valid
+ */
+bool Configuration::read(uint16_t address, uint16_t backup, void *data, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; i++) {
+        ((uint8_t *) data)[i] = EEPROM.read(address + i);
+    }
+    if (isValid(data, length)) {
+        return true;
+    }
+    if (backup == address) {
+        return false; // no backup (version 1)
+    }
+
+    for (uint16_t i = 0; i < length; i++) {
+        ((uint8_t *) data)[i] = EEPROM.read(backup + i);
+    }
+    if (!isValid(data, length)) {
+        return false;
+    }
+    LOG_WARN(Logger::moduleSystem, F("configuration at %d restored from its backup"), address);
+    return true;
+}
+
+/**
+ * Check the CRC of a block which starts with the CRC32 of the remaining bytes.
+ */
+bool Configuration::isValid(void *data, uint16_t length)
+{
+    uint32_t crc;
+    memcpy(&crc, data, 4);
+    return crc == Crc::calculate((uint8_t *) data + 4, length - 4);
+}
+
 /**
  * Calculate and set the CRC values of all configurations.
  */
@@ -99,18 +151,32 @@ void Configuration::updateCrc()
 }
 
 /**
- * Re-calc the CRC values and store all configuration blocks to EEPROM.
+ * Re-calc the CRC values and store all configuration blocks to EEPROM. The backup of a block
+ * is written before the block, so one of them is always valid. The I/O configuration is written
+ * before the parameters which hold the version and the sensor backup only after them, it overwrites
+ * the I/O configuration of version 1.
  */
 void Configuration::save()
 {
-    Logger::info(F("saving configuration to EEPROM"));
+    LOG_INFO(Logger::moduleSystem, F("saving configuration to EEPROM"));
 
     updateCrc();
-    EEPROM.put(CONFIG_ADDRESS_IO, *getIO());
-    EEPROM.put(CONFIG_ADDRESS_PARAMS, *getParams());
-    EEPROM.put(CONFIG_ADDRESS_SENSOR, *getSensor());
+    if (!EepromWriter::write(CONFIG_ADDRESS_IO_BACKUP, getIO(), sizeof(ConfigurationIO), true)
+            || !EepromWriter::write(CONFIG_ADDRESS_IO, getIO(), sizeof(ConfigurationIO), true)
+            || !EepromWriter::write(CONFIG_ADDRESS_PARAMS_BACKUP, getParams(), sizeof(ConfigurationParams), true)
+            || !EepromWriter::write(CONFIG_ADDRESS_PARAMS, getParams(), sizeof(ConfigurationParams), true)
+            || !EepromWriter::write(CONFIG_ADDRESS_SENSOR_BACKUP, getSensor(), sizeof(ConfigurationSensor), true)
+            || !EepromWriter::write(CONFIG_ADDRESS_SENSOR, getSensor(), sizeof(ConfigurationSensor), true, saved)) {
+        LOG_ERROR(Logger::moduleSystem, F("unable to queue configuration for saving"));
+    }
+}
 
-    Logger::info(F("done"));
+/**
+ * Called by the EepromWriter when the configuration is written
+ */
+void Configuration::saved()
+{
+    LOG_INFO(Logger::moduleSystem, F("configuration saved"));
 }
 
 /**
@@ -118,14 +184,14 @@ void Configuration::save()
  */
 void Configuration::reset()
 {
-    Logger::info(F("resetting configuration to default values"));
+    LOG_INFO(Logger::moduleSystem, F("resetting configuration to default values"));
 
     ConfigurationIO *configIO = getIO();
     ConfigurationParams *configParams = getParams();
     ConfigurationSensor *configSensor = getSensor();
 
     configParams->token = CFG_EEPROM_CONFIG_TOKEN;
-    configParams->version = 1;
+    configParams->version = CONFIG_VERSION;
 
     for (int i = 0; i < CFG_MAX_NUMBER_PLATES; i++) {
         configIO->heater[i] = 0;
@@ -183,28 +249,25 @@ void Configuration::reset()
 }
 
 /*
- * Returns the singleton instance of the I/O configuration.
+ * Returns the I/O configuration of the current sauna.
  */
 ConfigurationIO *Configuration::getIO()
 {
-    static ConfigurationIO configIO;
-    return &configIO;
+    return &Sauna::getCurrent()->configuration.io;
 }
 
 /*
- * Returns the singleton instance of the parameter configuration.
+ * Returns the parameter configuration of the current sauna.
  */
 ConfigurationParams *Configuration::getParams()
 {
-    static ConfigurationParams configParams;
-    return &configParams;
+    return &Sauna::getCurrent()->configuration.params;
 }
 
 /*
- * Returns the singleton instance of the sensor configuration.
+ * Returns the sensor configuration of the current sauna.
  */
 ConfigurationSensor *Configuration::getSensor()
 {
-    static ConfigurationSensor configSensor;
-    return &configSensor;
+    return &Sauna::getCurrent()->configuration.sensor;
 }
@@ -36,17 +36,35 @@
 #include "Crc.h"
 #include "Status.h"
 #include "Statistics.h"
+#include "EepromWriter.h"
 #include <EEPROM.h>
 
+/*
+ * Each configuration block has a backup copy which is written before the block itself,
+ * so a block which is torn by a power loss is restored from the backup when loading.
+ * The parameters and the I/O configuration share the first 256 bytes (max 64 bytes each),
+ * the sensor configuration uses a 256 byte block for each copy.
+ */
 #define CONFIG_ADDRESS_PARAMS       0
-#define CONFIG_ADDRESS_IO           256
+#define CONFIG_ADDRESS_PARAMS_BACKUP 64
+#define CONFIG_ADDRESS_IO           128
+#define CONFIG_ADDRESS_IO_BACKUP    192
+#define CONFIG_ADDRESS_SENSOR_BACKUP 256
 #define CONFIG_ADDRESS_SENSOR       512
 #define CONFIG_ADDRESS_STATISTICS   768
+#define CONFIG_ADDRESS_IO_VERSION1  256 // the I/O configuration of version 1 had no backup
 #define CFG_EEPROM_CONFIG_TOKEN     0xbee
+#define CONFIG_VERSION              2
+
+#ifdef __AVR__
+typedef uint64_t SensorAddressValue;
+#else
+typedef uint64_t SensorAddressValue __attribute__((aligned(4))); // gives the configuration the board's layout on the host
+#endif
 
 typedef union
 {
-    uint64_t value;
+    SensorAddressValue value;
     struct
     {
         uint32_t low;
@@ -82,7 +100,7 @@ public:
     // 20 bytes used
 };
 
-class ConfigurationIO
+class __attribute__((packed)) ConfigurationIO
 {
 public:
     uint32_t crc; // CRC of this config block
@@ -105,7 +123,7 @@ public:
     uint8_t lcdD5; // pin which controls the lcd's D1 pin (default: 25)
     uint8_t lcdD6; // pin which controls the lcd's D2 pin (default: 26)
     uint8_t lcdD7; // pin which controls the lcd's D3 pin (default: 27)
-    // 22 bytes used
+    // 50 bytes used
 };
 
 class ConfigurationSensor
@@ -115,9 +133,13 @@ public:
 
     SensorAddress addressPlate[CFG_MAX_NUMBER_PLATES]; // the addresses of the temperature sensors assigned to the heater plates (0=disabled)
     SensorAddress addressHive[CFG_MAX_NUMBER_PLATES]; // the addresses of the temperature sensors assigned to the hive (0=disabled)
-    // 246 bytes used
+    // 244 bytes used
 };
 
+static_assert(sizeof(ConfigurationParams) == 20, "the configuration must have the same layout on the board and the host");
+static_assert(sizeof(ConfigurationIO) == 50, "the configuration must have the same layout on the board and the host");
+static_assert(sizeof(ConfigurationSensor) == 244, "the configuration must have the same layout on the board and the host");
+
 class Configuration
 {
 public:
@@ -131,10 +153,18 @@ public:
     void reset();
 
 private:
+    friend class Sauna; // owns the instance
     Configuration();
     Configuration(Configuration const&); // copy disabled
     void operator=(Configuration const&); // assigment disabled
     void updateCrc();
+    bool read(uint16_t address, uint16_t backup, void *data, uint16_t length);
+    bool isValid(void *data, uint16_t length);
+    static void saved();
+
+    ConfigurationParams params;
+    ConfigurationIO io;
+    ConfigurationSensor sensor;
 };
 
 #endif /* CONFIGURATION_H_ */
@@ -0,0 +1,77 @@
+/*
+ * ConsoleProtocol.h
+ *
+ * Definition of the batch requests of the serial console. This file is shared
+ * between the firmware and the host client, so it must only depend on standard headers.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef CONSOLEPROTOCOL_H_
+#define CONSOLEPROTOCOL_H_
+
+#include <stdint.h>
+
+/*
+ * A batch request is a single line of the form
+ *
+ *   $<sequence>;<item>;<item>...*<crc>
+ *
+ * where an item is either "NAME=value" (write) or "NAME" (read), NAME being any
+ * console command, optionally with an index (e.g. "PIN_FAN[2]=7"). The crc is the
+ * CRC32 (see Crc.h) of all characters between '$' and '*' as 8 hex digits.
+ *
+ * All items are validated before the first one is applied, a request is either
+ * executed completely or not at all. This includes the preconditions of actions
+ * (e.g. START is refused while a program is active), evaluated in the order of
+ * the items. Only if an action still fails while it is applied, the items before
+ * it remain applied and the reply is consoleErrorAction. Actions which print
+ * listings (PROGRAMS, STATS=1) aren't accepted in a batch. The reply has the
+ * same framing:
+ *
+ *   $<sequence>;OK;NAME=value...*<crc>   with the value of every read item
+ *   $<sequence>;ERR=<code>;<item>*<crc>   with the position of the item (1-based, 0=frame)
+ *
+ * A request is refused with consoleErrorBusy if the output buffer has no room
+ * for its reply, it can be repeated later. Other lines on the serial port (log
+ * messages, telemetry) are to be ignored.
+ */
+#define CONSOLE_BATCH_START         '$'
+#define CONSOLE_BATCH_SEPARATOR     ';'
+#define CONSOLE_BATCH_CHECKSUM      '*'
+
+enum ConsoleError
+{
+    consoleOk = 0,
+    consoleErrorFrame = 1, // malformed request or wrong crc
+    consoleErrorUnknown = 2, // unknown command
+    consoleErrorIndex = 3, // missing or invalid index of an array command
+    consoleErrorNoProgram = 4, // program value but no program is running
+    consoleErrorValue = 5, // invalid or out of range value
+    consoleErrorSize = 6, // too many items or the reply would be too long
+    consoleErrorState = 7, // the action isn't possible in the current state (e.g. START while a program is active)
+    consoleErrorBusy = 8, // no room for the reply in the output buffer
+    consoleErrorAction = 9 // the action failed while being applied
+};
+
+#endif /* CONSOLEPROTOCOL_H_ */
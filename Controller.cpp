@@ -28,6 +28,8 @@
  */
 
 #include "Controller.h"
+#include "Sauna.h"
+#include "SensorTrace.h"
 
 Controller::Controller()
 {
@@ -37,6 +39,7 @@ Controller::Controller()
     plateTargetTemperature = 0;
 
     tickCounter = 0;
+    lastCheckpoint = 0;
     pid = NULL;
 }
 
@@ -49,12 +52,11 @@ Controller::~Controller()
 }
 
 /**
- * Return the instance of the singleton
+ * Return the instance of the current sauna
  */
 Controller *Controller::getInstance()
 {
-    static Controller instance;
-    return &instance;
+    return &Sauna::getCurrent()->controller;
 }
 
 /**
@@ -62,10 +64,11 @@ Controller *Controller::getInstance()
  */
 void Controller::initialize()
 {
-    Logger::info(F("initializing controller"));
+    Status *status = Status::getInstance();
+    LOG_INFO(Logger::moduleController, F("initializing controller"));
 
     if (!Configuration::getInstance()->load() || !Statistics::getInstance()->load()) {
-        status.setSystemState(Status::error);
+        status->setSystemState(Status::error);
         return;
     }
     Logger::setLoglevel((Logger::LogLevel)Configuration::getInstance()->getParams()->loglevel);
@@ -75,21 +78,24 @@ void Controller::initialize()
 
     ProgramHandler::getInstance()->initPrograms();
     ProgramHandler::getInstance()->attach(this);
+    History::getInstance()->load();
+    ProgramHandler::getInstance()->attach(History::getInstance());
     hid.initialize();
     humidifier.initialize();
 
     SimpleList<SensorAddress> addressList = detectTemperatureSensors();
     if (!assignPlateSensors(addressList) || !assignHiveSensors(addressList)) {
         for (SimpleList<SensorAddress>::iterator itr = addressList.begin(); itr != addressList.end(); ++itr) {
-            Logger::info(F("  found sensor: %#08lx%08lx"), itr->high, itr->low);
+            LOG_INFO(Logger::moduleController, F("  found sensor: %#08lx%08lx"), itr->high, itr->low);
         }
-        status.setSystemState(Status::error);
+        status->setSystemState(Status::error);
         return;
     }
 
     initPid();
-    status.setSystemState(Status::ready);
+    status->setSystemState(Status::ready);
     serialConsole.printMenu();
+    resumeFromCheckpoint();
 }
 
 /**
@@ -97,7 +103,7 @@ void Controller::initialize()
  */
 void Controller::initOutput()
 {
-    Logger::info(F("initializing output"));
+    LOG_INFO(Logger::moduleController, F("initializing output"));
 
     ConfigurationIO *configIo = Configuration::getIO();
     pinMode(configIo->heaterRelay, OUTPUT);
@@ -149,14 +155,14 @@ void Controller::powerDownDevices()
 SimpleList<SensorAddress> Controller::detectTemperatureSensors()
 {
     SimpleList<SensorAddress> addressList;
-    Logger::info(F("detecting temperature sensors"));
+    LOG_INFO(Logger::moduleController, F("detecting temperature sensors"));
     TemperatureSensor::resetSearch();
 
     while (true) {
         SensorAddress address = TemperatureSensor::search();
         if (address.value == 0)
             break;
-        Logger::info(F("  found sensor: %#08lx%08lx"), address.high, address.low);
+        LOG_INFO(Logger::moduleController, F("  found sensor: %#08lx%08lx"), address.high, address.low);
         addressList.push_back(address);
     }
     TemperatureSensor::prepareData(); // kick the sensors to prepare data
@@ -185,7 +191,7 @@ bool Controller::assignPlateSensors(SimpleList<SensorAddress> &addressList)
     for (int i = 0; i < Configuration::getParams()->numberOfPlates; i++) {
         if (configSensor->addressPlate[i].value != 0 && containsSensorAddress(addressList, configSensor->addressPlate[i]) && configIO->fan[i] != 0
                 && configIO->heater[i] != 0) {
-            Logger::info(F("attaching sensor %#08lx%08lx, heater pin %d, fan pin %d to plate #%d"), configSensor->addressPlate[i].high,
+            LOG_INFO(Logger::moduleController, F("attaching sensor %#08lx%08lx, heater pin %d, fan pin %d to plate #%d"), configSensor->addressPlate[i].high,
                     configSensor->addressPlate[i].low, configIO->heater[i], configIO->fan[i], i + 1);
             Plate plate = Plate();
             plates.push_back(plate);
@@ -199,8 +205,8 @@ bool Controller::assignPlateSensors(SimpleList<SensorAddress> &addressList)
     }
 
     if (Configuration::getParams()->numberOfPlates != plates.size()) {
-        Logger::error(F("unable to locate all configured plate sensors (%d of %d) !!"), plates.size(), Configuration::getParams()->numberOfPlates);
-        status.errorCode = Status::plateSensorsNotFound;
+        LOG_ERROR(Logger::moduleController, F("unable to locate all configured plate sensors (%d of %d) !!"), plates.size(), Configuration::getParams()->numberOfPlates);
+        Status::getInstance()->errorCode = Status::plateSensorsNotFound;
         return false;
     }
     return true;
@@ -215,14 +221,14 @@ bool Controller::assignHiveSensors(SimpleList<SensorAddress> &addressList)
 
     for (int i = 0; configSensor->addressHive[i].value != 0 && i < CFG_MAX_NUMBER_PLATES; i++) {
         if (containsSensorAddress(addressList, configSensor->addressHive[i])) {
-            Logger::info(F("attaching sensor %#08lx%08lx as hive sensor #%d"), configSensor->addressHive[i].high, configSensor->addressHive[i].low,
+            LOG_INFO(Logger::moduleController, F("attaching sensor %#08lx%08lx as hive sensor #%d"), configSensor->addressHive[i].high, configSensor->addressHive[i].low,
                     i + 1);
             TemperatureSensor sensor = TemperatureSensor(i, false);
             hiveTempSensors.push_back(sensor);
         } else {
-            Logger::error(F("unable to locate all configured hive sensors (%#l08x%08lx missing) !!"), configSensor->addressHive[i].high,
+            LOG_ERROR(Logger::moduleController, F("unable to locate all configured hive sensors (%#l08x%08lx missing) !!"), configSensor->addressHive[i].high,
                     configSensor->addressHive[i].low);
-            status.errorCode = Status::hiveSensorsNotFound;
+            Status::getInstance()->errorCode = Status::hiveSensorsNotFound;
             return false;
         }
     }
@@ -238,25 +244,27 @@ bool Controller::assignHiveSensors(SimpleList<SensorAddress> &addressList)
  */
 int16_t Controller::retrieveHiveTemperatures()
 {
+    Status *status = Status::getInstance();
     int16_t max = -999, secondMax = -999;
 
     int i = 0;
     for (SimpleList<TemperatureSensor>::iterator itr = hiveTempSensors.begin(); itr != hiveTempSensors.end(); ++itr) {
         itr->retrieveData();
+        int16_t temperature = itr->getTemperatureCelsius();
         if (i < CFG_MAX_NUMBER_PLATES)
-            status.temperatureHive[i++] = itr->getTemperatureCelsius();
-        max = max(max, itr->getTemperatureCelsius());
-    }
-
-    for (i = 0; i < CFG_MAX_NUMBER_PLATES; i++) {
-        if (status.temperatureHive[i] != max) {
-            secondMax = max(secondMax, status.temperatureHive[i]);
+            status->temperatureHive[i++] = temperature;
+        if (temperature > max) {
+            secondMax = max;
+            max = temperature;
+        } else if (temperature > secondMax) {
+            secondMax = temperature;
         }
     }
+
     if (secondMax == -999) {
         secondMax = max;
     }
-    status.temperatureActualHive = secondMax;
+    status->temperatureActualHive = secondMax;
     return secondMax;
 }
 
@@ -265,17 +273,13 @@ int16_t Controller::retrieveHiveTemperatures()
  */
 int16_t Controller::calculatePlateTargetTemperature()
 {
+    Status *status = Status::getInstance();
     Program *runningProgram = ProgramHandler::getInstance()->getRunningProgram();
     if (actualTemperature == -999 || runningProgram == NULL) {
         return 0;
     }
 
-    if (status.getSystemState() == Status::preHeat) {
-        targetTemperature = runningProgram->temperaturePreHeat;
-    } else {
-        targetTemperature = runningProgram->temperatureHive;
-    }
-
+    targetTemperature = ProgramHandler::getInstance()->getTargetTemperature();
     pid->Compute();
 
     // don't set directly as plateTemperature tends to jump. Dampen with 0.1 deg per second
@@ -285,8 +289,8 @@ int16_t Controller::calculatePlateTargetTemperature()
         plateTargetTemperature--;
 
     plateTargetTemperature = constrain(plateTargetTemperature, 0, runningProgram->temperaturePlate);
-    status.temperatureTargetHive = targetTemperature;
-    status.temperatureTargetPlate = plateTargetTemperature;
+    status->temperatureTargetHive = targetTemperature;
+    status->temperatureTargetPlate = plateTargetTemperature;
 
     return plateTargetTemperature;
 }
@@ -297,34 +301,30 @@ int16_t Controller::calculatePlateTargetTemperature()
 void Controller::updateProgramState()
 {
     ProgramHandler *programHandler = ProgramHandler::getInstance();
-    Program *runningProgram = programHandler->getRunningProgram();
-    uint32_t timeRemaining = programHandler->calculateTimeRemaining();
+    Status *status = Status::getInstance();
 
     if (actualTemperature > Configuration::getParams()->hiveOverTemp) {
-        Logger::error(F("ALERT - OVER-TEMPERATURE IN HIVE ! Trying to recover, please open the cover to help cool down the hive!"));
-        status.setSystemState(Status::overtemp);
-        status.errorCode = Status::overtempHive;
+        LOG_ERROR(Logger::moduleController, F("ALERT - OVER-TEMPERATURE IN HIVE ! Trying to recover, please open the cover to help cool down the hive!"));
+        status->setSystemState(Status::overtemp);
+        status->errorCode = Status::overtempHive;
     }
-    if (status.getSystemState() == Status::overtemp && actualTemperature < Configuration::getParams()->hiveOverTempRecover) {
-        Logger::info(F("recovered from over-temperature, shutting down."));
-        programHandler->stop();
+    if (status->getSystemState() == Status::overtemp && actualTemperature < Configuration::getParams()->hiveOverTempRecover) {
+        LOG_INFO(Logger::moduleController, F("recovered from over-temperature, shutting down."));
+        programHandler->stop(programOvertemp);
     }
 
-    if (status.getSystemState() == Status::running && timeRemaining < 2) {
-        Logger::info(F("program finished."));
-        programHandler->stop();
+    if (status->getSystemState() == Status::preHeat || status->getSystemState() == Status::running) {
+        ThermalDose::getInstance()->process();
+        programHandler->process(actualTemperature);
     }
-
-    if (status.getSystemState() == Status::preHeat && runningProgram
-            && (timeRemaining == 0 || (actualTemperature >= runningProgram->temperaturePreHeat &&
-                    timeRemaining < programHandler->calculateTimeRunning()))) {
-        programHandler->switchToRunning();
+    if (status->getSystemState() == Status::shutdown) {
+        programHandler->processQueue(actualTemperature);
     }
 }
 
 void Controller::handleEvent(ProgramEvent event, Program *program)
 {
-    Logger::debug(F("controller: incoming event %d, program: %s"), event, (program ? program->name : "n/a"));
+    LOG_DEBUG(Logger::moduleController, F("controller: incoming event %d, program: %s"), event, (program ? program->name : "n/a"));
 
     switch (event) {
     case startProgram:
@@ -333,6 +333,7 @@ void Controller::handleEvent(ProgramEvent event, Program *program)
         break;
     case stopProgram:
         powerDownDevices();
+        Checkpoint::getInstance()->clear();
         break;
     case pauseProgram:
         for (SimpleList<Plate>::iterator itr = plates.begin(); itr != plates.end(); ++itr) {
@@ -352,6 +353,8 @@ void Controller::handleEvent(ProgramEvent event, Program *program)
  */
 void Controller::process()
 {
+    Status *status = Status::getInstance();
+    SENSOR_TRACE(startCycle());
     hid.process();
     serialConsole.process();
 
@@ -360,8 +363,11 @@ void Controller::process()
         humidifier.process();
         actualTemperature = retrieveHiveTemperatures();
         updateProgramState();
+        History::getInstance()->process();
+        Statistics::getInstance()->process();
+        saveCheckpoint();
 
-        switch (status.getSystemState()) {
+        switch (status->getSystemState()) {
         case Status::init:
             break;
         case Status::ready:
@@ -372,11 +378,11 @@ void Controller::process()
 int i = 0;
             for (SimpleList<Plate>::iterator itr = plates.begin(); itr != plates.end(); ++itr) {
 if (i == 2 || i == 3) {
-	if (status.temperatureHive[2] <390 && status.temperatureHive[3] < 390)
+	if (status->temperatureHive[2] <390 && status->temperatureHive[3] < 390)
 		plateTemp = 750;
-	else if (status.temperatureHive[2] <400 && status.temperatureHive[3] < 400)
+	else if (status->temperatureHive[2] <400 && status->temperatureHive[3] < 400)
 		plateTemp = 700;
-	else if (status.temperatureHive[2] <410 && status.temperatureHive[3] < 410)
+	else if (status->temperatureHive[2] <410 && status->temperatureHive[3] < 410)
 		plateTemp = 650;
 }
 i++;
@@ -411,37 +417,122 @@ i++;
         }
         TemperatureSensor::prepareData();
     }
+    Telemetry::getInstance()->process();
+    SENSOR_TRACE(endCycle());
 }
 
 void Controller::handleProgramChange(Program *program)
 {
-    Status::SystemState state = status.getSystemState();
+    Status::SystemState state = Status::getInstance()->getSystemState();
     bool preHeat = (state == Status::preHeat);
     bool running = (state == Status::running);
+    ProgramHandler *programHandler = ProgramHandler::getInstance();
+    ProgramSegment *segment = programHandler->getSegment();
+    bool cool = (segment->type == segmentCool);
+    double pidScale = (segment->pidScale == 0 ? 1.0 : segment->pidScale / 100.0);
+    uint8_t fanSpeed = (segment->type == segmentPreHeat ? program->fanSpeedPreHeat : program->fanSpeed);
+    if (segment->fanSpeed != SEGMENT_FAN_SPEED_PROGRAM) {
+        fanSpeed = segment->fanSpeed;
+    }
 
-    Logger::info(F("Updating devices with new program settings"));
+    LOG_INFO(Logger::moduleController, F("Updating devices with new program settings"));
 
     // adjust the PID which defines the target temperature of the plates based on the hive temp
-    pid->SetOutputLimits((preHeat ? program->temperaturePreHeat : program->temperatureHive), program->temperaturePlate);
-    pid->SetTunings(program->hiveKp, program->hiveKi, program->hiveKd);
+    pid->SetOutputLimits((cool ? 0 : min(programHandler->getTargetTemperature(), segment->temperature)), program->temperaturePlate);
+    pid->SetTunings(program->hiveKp * pidScale, program->hiveKi * pidScale, program->hiveKd * pidScale);
     plateTargetTemperature = program->temperaturePlate;
 
     // adjust the parameters of the plates
     for (SimpleList<Plate>::iterator itr = plates.begin(); itr != plates.end(); ++itr) {
         itr->setPIDTuning(program->plateKp, program->plateKi, program->plateKd);
-        itr->setMaximumPower(Configuration::getParams()->maxHeaterPower);
-        itr->setFanSpeed(preHeat ? program->fanSpeedPreHeat : program->fanSpeed);
+        itr->setMaximumPower(cool ? 0 : Configuration::getParams()->maxHeaterPower);
+        itr->setFanSpeed(fanSpeed);
     }
 
-    // adjust the parameters of the humidifier
+    // adjust the parameters of the humidifier, a segment's humidity moves the program's range
     humidifier.setFanSpeed(program->fanSpeedHumidifier);
-    humidifier.setMinHumidity(program->humidityMinimum);
-    humidifier.setMaxHumidity(program->humidityMaximum);
+    if (segment->humidity != 0) {
+        humidifier.setMinHumidity(segment->humidity);
+        humidifier.setMaxHumidity(min(segment->humidity + program->humidityMaximum - program->humidityMinimum, 100));
+    } else {
+        humidifier.setMinHumidity(program->humidityMinimum);
+        humidifier.setMaxHumidity(program->humidityMaximum);
+    }
 
     digitalWrite(Configuration::getIO()->heaterRelay, (running || preHeat ? HIGH : LOW));
     delay(200); // allow the relay to open/close
 }
 
+/**
+ * Periodically save the state of a running program, so it can be resumed after a power loss.
+ */
+void Controller::saveCheckpoint()
+{
+    Status::SystemState state = Status::getInstance()->getSystemState();
+    uint32_t now = millis();
+    if (state != Status::preHeat && state != Status::running) {
+        lastCheckpoint = now; // the first checkpoint is saved one interval after the start
+        return;
+    }
+    if (now - lastCheckpoint < CFG_CHECKPOINT_INTERVAL * 1000UL) {
+        return;
+    }
+    lastCheckpoint = now;
+
+    CheckpointRecord checkpoint;
+    checkpoint.program = ProgramHandler::getInstance()->getRunningProgramNumber();
+    checkpoint.state = state;
+    checkpoint.segment = ProgramHandler::getInstance()->getSegmentNumber();
+    checkpoint.timeRunning = ProgramHandler::getInstance()->calculateTimeRunning();
+    checkpoint.rampStart = ProgramHandler::getInstance()->getRampStart();
+    for (uint8_t i = 0; i < CFG_MAX_NUMBER_PLATES; i++) {
+        checkpoint.dose[i] = ThermalDose::getInstance()->getDose(i);
+    }
+    checkpoint.plateTargetTemperature = plateTargetTemperature;
+    checkpoint.hivePidOutput = plateTemperature;
+    uint8_t i = 0;
+    for (SimpleList<Plate>::iterator itr = plates.begin(); itr != plates.end() && i < CFG_MAX_NUMBER_PLATES; ++itr) {
+        checkpoint.platePidOutput[i++] = itr->getPidOutput();
+    }
+    while (i < CFG_MAX_NUMBER_PLATES) {
+        checkpoint.platePidOutput[i++] = 0;
+    }
+    Checkpoint::getInstance()->save(&checkpoint);
+}
+
+/**
+ * If a program was running when the power was lost, resume it unless the user cancels it.
+ */
+void Controller::resumeFromCheckpoint()
+{
+    CheckpointRecord checkpoint;
+    if (!Checkpoint::getInstance()->load(&checkpoint)) {
+        return;
+    }
+    LOG_WARN(Logger::moduleController, F("program #%d was interrupted in segment %d after %lus (state %d)"), checkpoint.program,
+            checkpoint.segment + 1, checkpoint.timeRunning, checkpoint.state);
+    if (hid.cancelResume(checkpoint.program)
+            || !ProgramHandler::getInstance()->restore(checkpoint.program, (Status::SystemState) checkpoint.state, checkpoint.segment,
+                    checkpoint.timeRunning, checkpoint.rampStart)) {
+        LOG_INFO(Logger::moduleController, F("not resuming the program"));
+        Checkpoint::getInstance()->clear();
+        return;
+    }
+
+    // continue the controllers where they were interrupted (handleProgramChange() reset them)
+    plateTargetTemperature = checkpoint.plateTargetTemperature;
+    plateTemperature = checkpoint.hivePidOutput;
+    pid->SetMode(MANUAL);
+    pid->SetMode(AUTOMATIC); // initializes the integral term with the output
+    for (uint8_t i = 0; i < CFG_MAX_NUMBER_PLATES; i++) {
+        ThermalDose::getInstance()->setDose(i, checkpoint.dose[i]);
+    }
+    uint8_t i = 0;
+    for (SimpleList<Plate>::iterator itr = plates.begin(); itr != plates.end() && i < CFG_MAX_NUMBER_PLATES; ++itr) {
+        itr->setPidOutput(checkpoint.platePidOutput[i++]);
+    }
+}
+
 int16_t Controller::getHiveTargetTemperature()
 {
     return targetTemperature;
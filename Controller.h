@@ -37,6 +37,10 @@
 #include "SerialConsole.h"
 #include "HID.h"
 #include "ProgramHandler.h"
+#include "Telemetry.h"
+#include "History.h"
+#include "Checkpoint.h"
+#include "ThermalDose.h"
 
 class Controller: public ProgramObserver
 {
@@ -50,6 +54,7 @@ public:
     int16_t getHiveTargetTemperature();
 
 private:
+    friend class Sauna; // owns the instance
     Controller();
     Controller(Controller const&); // copy disabled
     void operator=(Controller const&); // assigment disabled
@@ -64,6 +69,8 @@ private:
     int16_t calculatePlateTargetTemperature();
     void updateProgramState();
     void initPid();
+    void saveCheckpoint();
+    void resumeFromCheckpoint();
 
     SimpleList<Plate> plates;
     SimpleList<TemperatureSensor> hiveTempSensors;
@@ -74,6 +81,7 @@ private:
     int16_t plateTargetTemperature;
     PID *pid; // pointer to PID controller
     uint8_t tickCounter;
+    uint32_t lastCheckpoint; // time of the last checkpoint or since when no program runs (in millis)
 };
 
 #endif /* CONTROLLER_H_ */
@@ -0,0 +1,190 @@
+/*
+ * EepromWriter.cpp
+ *
+ * Writes blocks to the EEPROM in the background. On the AVR each byte
+ * takes ~3.3ms, so the writes are driven by the EEPROM ready interrupt
+ * (or one byte per loop cycle on other platforms) instead of blocking
+ * the control loop. Bytes which didn't change are skipped. For blocks
+ * starting with a CRC, the CRC is written last, so an interrupted write
+ * is detected when loading the block. This alone doesn't make a write
+ * atomic, the owner of a block has to keep a second copy to fall back to
+ * (see Configuration::save()). The blocks are written in the order they
+ * were queued.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "EepromWriter.h"
+
+CFG_INSTANCE_LOCAL EepromWriter::Job EepromWriter::jobs[CFG_EEPROM_QUEUE_SIZE];
+CFG_INSTANCE_LOCAL uint8_t EepromWriter::numberOfJobs = 0;
+CFG_INSTANCE_LOCAL uint8_t EepromWriter::staging[CFG_EEPROM_STAGING_SIZE];
+CFG_INSTANCE_LOCAL volatile uint16_t EepromWriter::position = 0;
+CFG_INSTANCE_LOCAL volatile bool EepromWriter::writing = false;
+CFG_INSTANCE_LOCAL volatile bool EepromWriter::done = false;
+
+/**
+ * Queue a block to be written. The data is copied when the write starts, so it
+ * must stay valid until then. If a write to the same address is still waiting,
+ * it is replaced.
+ *
+ * \return false if the queue is full or the block is too large
+ */
+bool EepromWriter::write(uint16_t address, const void *data, uint16_t length, bool updateCrc, EepromCallback callback)
+{
+    if (length > CFG_EEPROM_STAGING_SIZE) {
+        return false;
+    }
+    uint8_t i = (writing ? 1 : 0);
+    while (i < numberOfJobs && jobs[i].address != address) {
+        i++;
+    }
+    if (i == CFG_EEPROM_QUEUE_SIZE) {
+        return false;
+    }
+    jobs[i].address = address;
+    jobs[i].data = (const uint8_t *) data;
+    jobs[i].length = length;
+    jobs[i].updateCrc = updateCrc;
+    jobs[i].callback = callback;
+    if (i == numberOfJobs) {
+        numberOfJobs++;
+    }
+    if (!writing) {
+        start();
+    }
+    return true;
+}
+
+/**
+ * Called in every loop cycle to report completed blocks and start the next one.
+ */
+void EepromWriter::process()
+{
+#ifndef __AVR__
+    if (writing && !done) {
+        writeNext();
+    }
+#endif
+    if (done) {
+        finish();
+    }
+}
+
+/**
+ * Block until all queued data is written (e.g. before reading from the EEPROM).
+ */
+void EepromWriter::flush()
+{
+    while (numberOfJobs > 0) {
+#ifndef __AVR__
+        writeNext();
+#endif
+        process();
+    }
+}
+
+bool EepromWriter::isIdle()
+{
+    return numberOfJobs == 0;
+}
+
+/**
+ * Take a snapshot of the first queued job and start writing it.
+ */
+void EepromWriter::start()
+{
+    Job *job = &jobs[0];
+
+    memcpy(staging, job->data, job->length);
+    if (job->updateCrc) {
+        uint32_t crc = Crc::calculate(staging + 4, job->length - 4);
+        memcpy(staging, &crc, 4);
+    }
+    position = (job->updateCrc ? 4 : 0);
+    done = false;
+    writing = true;
+#ifdef __AVR__
+    EECR |= _BV(EERIE); // the interrupt fires as soon as the EEPROM is ready
+#endif
+}
+
+/**
+ * Remove the completed job from the queue, notify the owner and start the next one.
+ */
+void EepromWriter::finish()
+{
+    EepromCallback callback = jobs[0].callback;
+
+    writing = false;
+    done = false;
+    numberOfJobs--;
+    memmove(jobs, jobs + 1, numberOfJobs * sizeof(Job));
+    if (numberOfJobs > 0) {
+        start();
+    }
+    if (callback != NULL) {
+        callback();
+    }
+}
+
+/**
+ * Write the next changed byte of the active job. The CRC (first 4 bytes) is written
+ * after all other bytes. Called by the interrupt (AVR) or by process().
+ */
+void EepromWriter::writeNext()
+{
+    Job *job = &jobs[0];
+    uint16_t end = job->length + (job->updateCrc ? 4 : 0);
+
+    while (position < end) {
+        uint16_t offset = (position < job->length ? position : position - job->length);
+        position++;
+#ifdef __AVR__
+        EEAR = job->address + offset;
+        EECR |= _BV(EERE);
+        if (EEDR != staging[offset]) {
+            EEDR = staging[offset];
+            EECR |= _BV(EEMPE);
+            EECR |= _BV(EEPE);
+            return;
+        }
+#else
+        if (EEPROM.read(job->address + offset) != staging[offset]) {
+            EEPROM.write(job->address + offset, staging[offset]);
+            return;
+        }
+#endif
+    }
+#ifdef __AVR__
+    EECR &= ~_BV(EERIE);
+#endif
+    done = true;
+}
+
+#ifdef __AVR__
+ISR(EE_READY_vect)
+{
+    EepromWriter::writeNext();
+}
+#endif
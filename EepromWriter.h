@@ -0,0 +1,67 @@
+/*
+ * EepromWriter.h
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef EEPROMWRITER_H_
+#define EEPROMWRITER_H_
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "config.h"
+#include "Crc.h"
+
+typedef void (*EepromCallback)();
+
+class EepromWriter
+{
+public:
+    static bool write(uint16_t address, const void *data, uint16_t length, bool updateCrc, EepromCallback callback = NULL);
+    static void process();
+    static void flush();
+    static bool isIdle();
+    static void writeNext();
+
+private:
+    struct Job
+    {
+        uint16_t address; // EEPROM address of the block
+        const uint8_t *data; // the block in RAM, copied to the staging buffer when the job starts
+        uint16_t length;
+        bool updateCrc; // the block starts with a CRC32 of the remaining bytes which is re-calculated
+        EepromCallback callback; // called from process() when the block is written
+    };
+
+    static void start();
+    static void finish();
+
+    static CFG_INSTANCE_LOCAL Job jobs[CFG_EEPROM_QUEUE_SIZE];
+    static CFG_INSTANCE_LOCAL uint8_t numberOfJobs; // number of queued jobs, jobs[0] is the active one
+    static CFG_INSTANCE_LOCAL uint8_t staging[CFG_EEPROM_STAGING_SIZE]; // snapshot of the block being written
+    static CFG_INSTANCE_LOCAL volatile uint16_t position; // next byte of the staging buffer to be compared / written
+    static CFG_INSTANCE_LOCAL volatile bool writing; // a job is being written
+    static CFG_INSTANCE_LOCAL volatile bool done; // the active job is complete, process() has to finish it
+};
+
+#endif /* EEPROMWRITER_H_ */
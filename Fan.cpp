@@ -28,7 +28,7 @@
 
 #include "Fan.h"
 
-bool Fan::pwmInitialized = false;
+CFG_INSTANCE_LOCAL bool Fan::pwmInitialized = false;
 
 /**
  * Constructor.
@@ -79,12 +79,14 @@ void Fan::setControlPin(uint8_t controlPin)
  */
 void Fan::initializePWM()
 {
+#ifdef __AVR__
     // set timer 4 to 31kHz for controlling PWM fans
     TCCR4B &= ~7;
     TCCR4B |= 1;
     // set timer 5 to 31kHz for controlling PWM fans
     TCCR5B &= ~7;
     TCCR5B |= 1;
+#endif
 
     pwmInitialized = true;
 }
@@ -44,6 +44,6 @@ private:
     void initializePWM();
     uint8_t controlPin;
     uint8_t speed;
-    static bool pwmInitialized;
+    static CFG_INSTANCE_LOCAL bool pwmInitialized;
 };
 #endif /* FAN_H_ */
@@ -34,57 +34,37 @@ HID::HID() :
 {
     lastSystemState = Status::init;
     tickCounter = 0;
-    lastButtons = 0;
-    resetStamp = 0;
+    modalButtons = 0;
     statusLed = false;
-    selectedProgram = NULL;
+    selectedProgram = 0;
 }
 
 void HID::initialize()
 {
-    Logger::info(F("initializing HID"));
+    LOG_INFO(Logger::moduleHID, F("initializing HID"));
     Device::initialize();
     ConfigurationIO *io = Configuration::getIO();
-    lcd.init(1, io->lcdRs, 255, io->lcdEnable, io->lcdD4, io->lcdD5, io->lcdD6, io->lcdD7, 0, 0, 0, 0);
-    lcd.begin(20, 4);
+    display.init(1, io->lcdRs, 255, io->lcdEnable, io->lcdD4, io->lcdD5, io->lcdD6, io->lcdD7, 0, 0, 0, 0);
+    display.begin(LCD_COLUMNS, LCD_ROWS);
 
-    pinMode(io->buttonNext, INPUT);
-    pinMode(io->buttonSelect, INPUT);
+    ButtonInput::initialize(io->buttonNext, io->buttonSelect);
 
     beeper.initialize();
 
-    selectedProgram = ProgramHandler::getInstance()->getPrograms()->begin();
+    selectedProgram = ProgramStore::getInstance()->getNext(0);
 }
 
-void HID::handleProgramMenu()
+void HID::handleProgramMenu(uint8_t buttons)
 {
-    uint8_t buttons = readButtons();
-    if (lastButtons == buttons) {
-        return;
-    }
-    lastButtons = buttons;
-
-    SimpleList<Program> *programs = ProgramHandler::getInstance()->getPrograms();
-
     if (buttons & NEXT) {
         beeper.click();
-        if (selectedProgram + 1 != programs->end()) {
-            selectedProgram++;
-        } else {
-            selectedProgram = programs->begin();
-        }
+        selectedProgram = ProgramStore::getInstance()->getNext(selectedProgram);
         displayProgramMenu();
     }
     if (buttons & SELECT) {
         beeper.click();
-        int i = 1;
-        for (SimpleList<Program>::iterator itr = programs->begin(); itr != programs->end(); ++itr && ++i) {
-            if (itr == selectedProgram) {
-                lcd.clear();
-                ProgramHandler::getInstance()->start(i);
-                break;
-            }
-        }
+        lcd.clear();
+        ProgramHandler::getInstance()->start(selectedProgram);
     }
 }
 
@@ -96,7 +76,9 @@ void HID::displayProgramMenu()
     lcd.setCursor(0, 1);
     lcd.print(F("Select Program:"));
     lcd.setCursor(1, 2);
-    lcd.print(selectedProgram->name);
+    if (ProgramStore::getInstance()->getName(selectedProgram, lcdBuffer)) {
+        lcd.print(lcdBuffer);
+    }
     lcd.setCursor(0, 3);
     lcd.print(F("next           start"));
 }
@@ -112,37 +94,42 @@ bool HID::modal(String request, String negative, String positive, uint8_t timeou
     lcd.print(negative);
     lcd.setCursor(20 - positive.length(), 3);
     lcd.print(positive);
-
-    // wait for button release or timeout
-    uint16_t countdown = timeout * 10;
-    while (countdown-- > 0 && readButtons() != 0) {
-        delay(100);
-    }
-    // wait for button press or timeout
-    while (countdown-- > 0 && readButtons() == 0) {
-        delay(100);
+    lcd.flush(&display); // the main loop is blocked while waiting
+
+    // wait for a button press or timeout, presses before the dialog was shown are ignored
+    ButtonInput::clear();
+    uint32_t start = millis();
+    modalButtons = 0;
+    while (modalButtons == 0 && millis() - start < timeout * 1000UL) {
+        SerialBuffer::drainUntil(millis() + 100);
+        modalButtons = readButtons();
     }
     lcd.clear();
     beeper.click();
 
     ProgramHandler::getInstance()->resume();
-    return readButtons() & SELECT;
+    return modalButtons & SELECT;
 }
 
-void HID::handleProgramInput()
+/**
+ * Offer to cancel the resume of a program after a power loss. Without
+ * user interaction, the program is resumed.
+ */
+bool HID::cancelResume(uint8_t programNumber)
 {
-    uint8_t buttons = readButtons();
-    if (lastButtons == buttons) {
-        return;
-    }
-    lastButtons = buttons;
+    beeper.beep(3);
+    snprintf_P(lcdBuffer, 21, PSTR("Resume program #%d ?"), programNumber);
+    return modal(lcdBuffer, F("resume"), F("cancel"), 15);
+}
 
-    Status::SystemState state = status.getSystemState();
+void HID::handleProgramInput(uint8_t buttons)
+{
+    Status::SystemState state = Status::getInstance()->getSystemState();
     if (buttons & NEXT) {
         beeper.click();
         if (state == Status::preHeat) {
             if (modal(F("Skip pre-heating?"), F("no"), F("yes"))) {
-                ProgramHandler::getInstance()->switchToRunning();
+                ProgramHandler::getInstance()->nextSegment();
             }
         }
         if (state == Status::running) {
@@ -151,16 +138,41 @@ void HID::handleProgramInput()
             }
         }
     }
+    if (buttons & SELECT) {
+        beeper.click();
+        queueProgram();
+    }
 }
 
-void HID::handleFinishedInput()
+/**
+ * Let the user pick a program which is started after the current one.
+ */
+void HID::queueProgram()
 {
-    uint8_t buttons = readButtons();
-    if (lastButtons == buttons) {
-        return;
+    uint8_t number = ProgramStore::getInstance()->getNext(0);
+
+    char name[17];
+
+    for (uint8_t i = 0; i < PROGRAM_STORE_NUMBER_OF_SLOTS && number != 0; i++) {
+        if (!ProgramStore::getInstance()->getName(number, name)) {
+            name[0] = 0;
+        }
+        snprintf_P(lcdBuffer, sizeof(lcdBuffer), PSTR("Queue: %.13s"), name);
+        if (modal(lcdBuffer, F("next"), F("queue"), 5)) {
+            if (!ProgramHandler::getInstance()->enqueue(number)) {
+                modal(F("Queue is full"), F(""), F("ok"), 3);
+            }
+            return;
+        }
+        if (!(modalButtons & NEXT)) {
+            return; // timeout
+        }
+        number = ProgramStore::getInstance()->getNext(number);
     }
-    lastButtons = buttons;
+}
 
+void HID::handleFinishedInput(uint8_t buttons)
+{
     if (buttons & NEXT) {
         beeper.click();
         if (modal(F("Extend program?"), F("no"), F("yes"))) {
@@ -171,36 +183,30 @@ void HID::handleFinishedInput()
     }
     if (buttons & SELECT) {
         beeper.click();
-        status.setSystemState(Status::ready);
+        ProgramHandler::getInstance()->clearQueue(); // the user takes over
+        Status::getInstance()->setSystemState(Status::ready);
     }
 }
 
 
-void HID::checkReset()
+void HID::displayFinishedMenu()
 {
-    uint8_t buttons = readButtons();
-    if ((buttons & NEXT) && (buttons & SELECT)) {
-        if (resetStamp == 0) {
-            resetStamp = millis();
-        } else if (millis() - resetStamp > 3000) {
-            softReset();
-        } else {
-            beeper.click();
-        }
+    QueueItem *next = ProgramHandler::getInstance()->getQueueItem(0);
+    char name[17];
+    if (next != NULL && ProgramHandler::getInstance()->getStopReason() == programCompleted
+            && ProgramStore::getInstance()->getName(next->program, name)) {
+        snprintf_P(lcdBuffer, sizeof(lcdBuffer), PSTR("Next: %.14s"), name);
+        lcd.print(lcdBuffer);
     } else {
-        resetStamp = 0;
+        lcd.print(F("Program finished"));
     }
-}
-
-void HID::displayFinishedMenu()
-{
-    lcd.print(F("Program finished"));
     lcd.setCursor(0, 3);
     lcd.print(F("+30min          menu"));
 }
 
 void HID::stateSwitch(Status::SystemState fromState, Status::SystemState toState)
 {
+    Status *status = Status::getInstance();
     lcd.clear();
     switch (toState) {
     case Status::ready:
@@ -216,10 +222,10 @@ void HID::stateSwitch(Status::SystemState fromState, Status::SystemState toState
         break;
     case Status::error:
         beeper.beep(20);
-        snprintf(lcdBuffer, 21, "ERROR: %03d", status.errorCode);
+        snprintf(lcdBuffer, 21, "ERROR: %03d", status->errorCode);
         lcd.print(lcdBuffer);
         lcd.setCursor(0, 1);
-        lcd.print(status.getError());
+        lcd.print(status->getError());
         break;
     default:
         beeper.beep(2);
@@ -229,9 +235,9 @@ void HID::stateSwitch(Status::SystemState fromState, Status::SystemState toState
 void HID::process()
 {
     Device::process();
-    checkReset();
+    uint8_t buttons = readButtons();
 
-    Status::SystemState state = status.getSystemState();
+    Status::SystemState state = Status::getInstance()->getSystemState();
 
     if (state != lastSystemState) {
         stateSwitch(lastSystemState, state);
@@ -242,19 +248,19 @@ void HID::process()
     case Status::init:
         break;
     case Status::ready:
-        handleProgramMenu();
+        handleProgramMenu(buttons);
         break;
     case Status::preHeat:
     case Status::running:
         displayProgramInfo();
-        handleProgramInput();
+        handleProgramInput(buttons);
         break;
     case Status::overtemp:
         displayHiveTemperatures(1, true);
         break;
     case Status::shutdown:
         displayHiveTemperatures(1, true);
-        handleFinishedInput();
+        handleFinishedInput(buttons);
         break;
     case Status::error:
         displayHiveTemperatures(3, true);
@@ -263,6 +269,7 @@ void HID::process()
 
     beeper.process();
     logData();
+    lcd.update(&display, CFG_LCD_BYTES_PER_TICK);
 
     statusLed = !statusLed;
     digitalWrite(Configuration::getIO()->heartbeat, statusLed); // some kind of heart-beat
@@ -279,7 +286,7 @@ void HID::displayHiveTemperatures(uint8_t row, bool displayAll)
     lcd.setCursor(0, row);
     for (int i = 0; i < (displayAll ? CFG_MAX_NUMBER_PLATES : 4); i++) {
         if (Configuration::getSensor()->addressHive[i].value != 0) {
-            snprintf(lcdBuffer, 4, "%02d\xdf", (status.temperatureHive[i] + 5) / 10);
+            snprintf(lcdBuffer, 4, "%02d\xdf", (Status::getInstance()->temperatureHive[i] + 5) / 10);
             lcd.print(lcdBuffer);
         }
     }
@@ -294,42 +301,42 @@ void HID::displayProgramInfo()
         return;
 
     ProgramHandler *programHandler = ProgramHandler::getInstance();
+    Status *status = Status::getInstance();
 
     // program name and time running
     lcd.setCursor(0, 0);
-    snprintf(lcdBuffer, 14, "%-13s", (status.getSystemState() == Status::preHeat ? "pre-heating" : programHandler->getRunningProgram()->name));
+    snprintf(lcdBuffer, 14, "%-13s", (status->getSystemState() == Status::preHeat ? "pre-heating" : programHandler->getRunningProgram()->name));
     lcd.print(lcdBuffer);
-    String timeRunning = convertTime(programHandler->calculateTimeRunning());
-    lcd.setCursor(timeRunning.length() == 7 ? 13 : 12, 0);
-    snprintf(lcdBuffer, 9, "%s", timeRunning.c_str());
+    uint8_t length = strlen(convertTime(programHandler->calculateTimeRunning(), lcdBuffer));
+    lcd.setCursor(length == 7 ? 13 : 12, 0);
     lcd.print(lcdBuffer);
 
     // actual+target hive temperature and humidity with humidifier/fan status
     displayHiveTemperatures(1, false);
     lcd.setCursor(12, 1);
-    snprintf(lcdBuffer, 21, "\x7e%02d\xdf%s%02d%%  ", (status.temperatureTargetHive + 5) / 10,
-            (status.vaporizerEnabled ? "*" : status.fanSpeedHumidifier > 0 ? "x" : " "), status.humidity);
+    snprintf(lcdBuffer, 21, "\x7e%02d\xdf%s%02d%%  ", (status->temperatureTargetHive + 5) / 10,
+            (status->vaporizerEnabled ? "*" : status->fanSpeedHumidifier > 0 ? "x" : " "), status->humidity);
     lcd.print(lcdBuffer);
 
     // actual and target plate temperatures
     lcd.setCursor(0, 2);
     for (int i = 0; (i < Configuration::getParams()->numberOfPlates) && (i < 4); i++) {
-        snprintf(lcdBuffer, 4, "%02d%c", (status.temperaturePlate[i] + 5) / 10, (status.powerPlate[i] > 0 ? 0xeb : 0xdf));
+        snprintf(lcdBuffer, 4, "%02d%c", (status->temperaturePlate[i] + 5) / 10, (status->powerPlate[i] > 0 ? 0xeb : 0xdf));
         lcd.print(lcdBuffer);
     }
     lcd.setCursor(12, 2);
-    snprintf(lcdBuffer, 9, "\x7e%02d\xdf %02d\xdf", (status.temperatureTargetPlate + 5) / 10, (status.temperatureHumidifier + 5) / 10);
+    snprintf(lcdBuffer, 9, "\x7e%02d\xdf %02d\xdf", (status->temperatureTargetPlate + 5) / 10, (status->temperatureHumidifier + 5) / 10);
     lcd.print(lcdBuffer);
 
     // fan speed, time remaining
     lcd.setCursor(0, 3);
     for (int i = 0; i < Configuration::getParams()->numberOfPlates && i < 4; i++) {
-        snprintf(lcdBuffer, 4, "%02ld ", map(status.fanSpeedPlate[i], Configuration::getParams()->minFanSpeed, 255, 0, 99));
+        snprintf(lcdBuffer, 4, "%02ld ", map(status->fanSpeedPlate[i], Configuration::getParams()->minFanSpeed, 255, 0, 99));
         lcd.print(lcdBuffer);
     }
-    String timeRemaining = convertTime(programHandler->calculateTimeRemaining());
-    lcd.setCursor(timeRemaining.length() == 7 ? 12 : 11, 3);
-    snprintf(lcdBuffer, 10, " %s", timeRemaining.c_str());
+    lcdBuffer[0] = ' ';
+    length = strlen(convertTime(programHandler->calculateTimeRemaining(), lcdBuffer + 1));
+    lcd.setCursor(length == 7 ? 12 : 11, 3);
     lcd.print(lcdBuffer);
 }
 
@@ -339,69 +346,90 @@ void HID::displayProgramInfo()
  */
 void HID::logData()
 {
-    if (tickCounter != 3)
+    if (tickCounter != 3 || Telemetry::getInstance()->isEnabled())
         return;
 
     ProgramHandler *programHandler = ProgramHandler::getInstance();
+    Status *status = Status::getInstance();
+    char value1[10], value2[10];
 
-    Logger::info(F("time: %s, remaining: %s, status: %s"), convertTime(programHandler->calculateTimeRunning()).c_str(),
-            convertTime(programHandler->calculateTimeRemaining()).c_str(), status.systemStateToStr(status.getSystemState()).c_str());
+    LOG_INFO(Logger::moduleHID, F("time: %s, remaining: %s, status: %S"), convertTime(programHandler->calculateTimeRunning(), value1),
+            convertTime(programHandler->calculateTimeRemaining(), value2), status->systemStateToStr(status->getSystemState()));
 
     for (int i = 0; (Configuration::getSensor()->addressHive[i].value != 0) && (i < CFG_MAX_NUMBER_PLATES); i++) {
-        Logger::debug(F("sensor %d: %s C"), i + 1, toDecimal(status.temperatureHive[i], 10).c_str());
+        LOG_DEBUG(Logger::moduleHID, F("sensor %d: %s C, dose: %umin"), i + 1, toDecimal(status->temperatureHive[i], 10, value1),
+                ThermalDose::getInstance()->getDose(i));
     }
-    Logger::info(F("hive: %sC -> %sC"), toDecimal(status.temperatureActualHive, 10).c_str(), toDecimal(status.temperatureTargetHive, 10).c_str());
+    LOG_INFO(Logger::moduleHID, F("hive: %sC -> %sC"), toDecimal(status->temperatureActualHive, 10, value1), toDecimal(status->temperatureTargetHive, 10, value2));
 
     for (int i = 0; i < Configuration::getParams()->numberOfPlates; i++) {
-        Logger::info(F("plate %d: %sC -> %sC, power=%d/%d, fan=%d"), i + 1, toDecimal(status.temperaturePlate[i], 10).c_str(),
-                toDecimal(status.temperatureTargetPlate, 10).c_str(), status.powerPlate[i], Configuration::getParams()->maxHeaterPower,
-                status.fanSpeedPlate[i]);
+        LOG_INFO(Logger::moduleHID, F("plate %d: %sC -> %sC, power=%d/%d, fan=%d"), i + 1, toDecimal(status->temperaturePlate[i], 10, value1),
+                toDecimal(status->temperatureTargetPlate, 10, value2), status->powerPlate[i], Configuration::getParams()->maxHeaterPower,
+                status->fanSpeedPlate[i]);
     }
 
-    Logger::info(F("humidity: relHumidity=%d (%d-%d), vapor=%d, fan=%d, temp=%s C"), status.humidity,
-            programHandler->getRunningProgram()->humidityMinimum, programHandler->getRunningProgram()->humidityMaximum, status.vaporizerEnabled,
-            status.fanSpeedHumidifier, toDecimal(status.temperatureHumidifier, 10).c_str());
+    Program *program = programHandler->getRunningProgram();
+    LOG_INFO(Logger::moduleHID, F("humidity: relHumidity=%d (%d-%d), vapor=%d, fan=%d, temp=%s C"), status->humidity,
+            (program ? program->humidityMinimum : 0), (program ? program->humidityMaximum : 0), status->vaporizerEnabled,
+            status->fanSpeedHumidifier, toDecimal(status->temperatureHumidifier, 10, value1));
 }
 
 /**
- * \brief Read which buttons are pressed.
+ * \brief Process the queued button events.
+ *
+ * Holding both buttons for CFG_BUTTON_HOLD resets the controller.
  *
- * \return the pressed button in a bitmask
+ * \return the buttons pressed since the last call in a bitmask
  */
 uint8_t HID::readButtons()
 {
-    ConfigurationIO *io = Configuration::getIO();
+    ButtonEvent event;
     uint8_t buttons = 0;
-    buttons |= digitalRead(io->buttonNext) ? NEXT : 0;
-    buttons |= digitalRead(io->buttonSelect) ? SELECT : 0;
+
+    while (ButtonInput::getEvent(&event)) {
+        if (event.type == ButtonInput::eventPress) {
+            buttons |= event.buttons;
+        }
+        if (event.buttons == (NEXT | SELECT)) {
+            if (event.type == ButtonInput::eventLongPress) {
+                beeper.click(); // feedback that a reset is coming
+            } else if (event.type == ButtonInput::eventHold) {
+                softReset();
+            }
+        }
+    }
     return buttons;
 }
 
 /**
- * \brief Convert milliseconds to in hh:mm:ss
+ * \brief Convert seconds to hh:mm:ss
  *
- * \return the time in hh:mm:ss
+ * \param buffer the destination, must hold at least 10 characters
+ * \return the time in hh:mm:ss (the provided buffer)
  */
-String HID::convertTime(uint32_t seconds)
+char *HID::convertTime(uint32_t seconds, char *buffer)
 {
-    char buffer[10];
     int8_t hours = (seconds / 3600) % 24;
     int8_t minutes = (seconds / 60) % 60;
-    sprintf(buffer, "%d:%02d:%02d", hours, minutes, (int) (seconds % 60));
-    return String(buffer);
+    snprintf_P(buffer, 10, PSTR("%d:%02d:%02d"), hours, minutes, (int) (seconds % 60));
+    return buffer;
 }
 
 /**
  * Convert integer to decimal
+ *
+ * \param buffer the destination, must hold at least 10 characters
+ * \return the decimal representation (the provided buffer)
  */
-String HID::toDecimal(int16_t number, uint8_t divisor)
+char *HID::toDecimal(int16_t number, uint8_t divisor, char *buffer)
 {
-    char buffer[10];
-    snprintf(buffer, 9, "%d.%d", number / divisor, abs(number % divisor));
-    return String(buffer);
+    snprintf_P(buffer, 10, PSTR("%d.%d"), number / divisor, abs(number % divisor));
+    return buffer;
 }
 
 void HID::softReset()
 {
+#ifdef __AVR__
     asm volatile ("  jmp 0");
+#endif
 }
@@ -32,10 +32,15 @@
 
 #include <Arduino.h>
 #include <LiquidCrystal.h>
+#include "LcdFrameBuffer.h"
+#include "ButtonInput.h"
 #include "SimpleList.h"
 #include "Device.h"
 #include "ProgramHandler.h"
+#include "ProgramStore.h"
+#include "ThermalDose.h"
 #include "Beeper.h"
+#include "Telemetry.h"
 
 class HID: Device
 {
@@ -43,36 +48,37 @@ public:
     HID();
     void initialize();
     void process();
+    bool cancelResume(uint8_t programNumber);
 
 private:
     enum Button
     {
-        NEXT    = 1 << 0,
-        SELECT  = 1 << 1
+        NEXT    = ButtonInput::buttonNext,
+        SELECT  = ButtonInput::buttonSelect
     };
 
     void displayProgramInfo();
     void logData();
-    String convertTime(uint32_t millis);
-    String toDecimal(int16_t number, uint8_t divisor);
+    char *convertTime(uint32_t seconds, char *buffer);
+    char *toDecimal(int16_t number, uint8_t divisor, char *buffer);
     uint8_t readButtons();
-    void handleProgramMenu();
+    void handleProgramMenu(uint8_t buttons);
     void displayProgramMenu();
-    void handleProgramInput();
-    void handleFinishedInput();
-    void checkReset();
+    void handleProgramInput(uint8_t buttons);
+    void handleFinishedInput(uint8_t buttons);
+    void queueProgram();
     void displayHiveTemperatures(uint8_t row, bool displayAll);
     bool modal(String request, String negative, String positive, uint8_t timeout);
     void stateSwitch(Status::SystemState fromState, Status::SystemState toState);
     void softReset();
     void displayFinishedMenu();
 
-    LiquidCrystal lcd = LiquidCrystal(0, 0, 0, 0, 0, 0); // will be properly initialized later
+    LiquidCrystal display = LiquidCrystal(0, 0, 0, 0, 0, 0); // will be properly initialized later
+    LcdFrameBuffer lcd; // the screens are rendered here and transferred to the display in the background
     Status::SystemState lastSystemState;
-    SimpleList<Program>::iterator selectedProgram;
+    uint8_t selectedProgram; // number of the program selected in the menu
     uint8_t tickCounter;
-    uint8_t lastButtons;
-    uint32_t resetStamp;
+    uint8_t modalButtons; // the buttons which closed the last modal dialog (0 = timeout)
     char lcdBuffer[21];
     bool statusLed;
     Beeper beeper;
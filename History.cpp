@@ -0,0 +1,233 @@
+/*
+ * History.cpp
+ *
+ * Keeps a log of the treatments in a ring buffer in the EEPROM. Every
+ * treatment is written to the next slot, so the write cycles are spread
+ * evenly over the whole area.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "History.h"
+#include "Sauna.h"
+
+/**
+ * Add a number of seconds to a duration of a record, it stops at the maximum.
+ */
+static void addSeconds(uint16_t *duration, uint32_t seconds)
+{
+    *duration = min(*duration + seconds, 0xffffUL);
+}
+
+/**
+ * Constructor
+ */
+History::History()
+{
+    recording = false;
+    lastState = Status::init;
+    powerSum = 0;
+    lastUpdate = 0;
+    millisRemainder = 0;
+    nextSlot = 0;
+    numberOfRecords = 0;
+    nextSequence = 0;
+}
+
+/**
+ * Destructor
+ */
+History::~History()
+{
+
+}
+
+/**
+ * Return the instance of the current sauna
+ */
+History *History::getInstance()
+{
+    return &Sauna::getCurrent()->history;
+}
+
+/**
+ * Scan the EEPROM for the most recent record to find the slot for the next one.
+ */
+void History::load()
+{
+    HistoryRecord stored;
+    bool found = false;
+
+    numberOfRecords = 0;
+    EepromWriter::flush();
+    for (uint8_t slot = 0; slot < HISTORY_NUMBER_OF_RECORDS; slot++) {
+        EEPROM.get(getAddress(slot), stored);
+        if (stored.crc != calculateCrc(&stored)) {
+            continue;
+        }
+        numberOfRecords++;
+        if (!found || (int16_t) (stored.sequence - nextSequence) >= 0) {
+            found = true;
+            nextSequence = stored.sequence + 1;
+            nextSlot = (slot + 1) % HISTORY_NUMBER_OF_RECORDS;
+        }
+    }
+    LOG_INFO(Logger::moduleSystem, F("found %d treatments in history"), numberOfRecords);
+}
+
+/**
+ * Called about once per second, accumulates the data of the running treatment. The durations
+ * advance by the whole seconds measured since the previous call (the rest is carried to the next call).
+ */
+void History::process()
+{
+    Status *status = Status::getInstance();
+    Status::SystemState state = status->getSystemState();
+    uint32_t now = millis();
+    uint32_t elapsed = now - lastUpdate + millisRemainder;
+    uint32_t seconds = elapsed / 1000;
+
+    lastUpdate = now;
+    millisRemainder = elapsed % 1000;
+    if (recording) {
+        if (state == Status::error) {
+            finish(programFailed);
+            return;
+        }
+        if (state == Status::preHeat) {
+            addSeconds(&record.durationPreHeat, seconds);
+        }
+        if (state == Status::running) {
+            addSeconds(&record.durationRunning, seconds);
+            if (abs(status->temperatureActualHive - status->temperatureTargetHive) <= CFG_HISTORY_TARGET_TOLERANCE) {
+                addSeconds(&record.timeAtTarget, seconds);
+            }
+        }
+        if (state == Status::overtemp && lastState != Status::overtemp && record.overtempEvents < 0xff) {
+            record.overtempEvents++;
+        }
+        record.maxHiveTemperature = max(record.maxHiveTemperature, status->temperatureActualHive);
+        for (uint8_t i = 0; i < Configuration::getParams()->numberOfPlates; i++) {
+            record.maxPlateTemperature = max(record.maxPlateTemperature, status->temperaturePlate[i]);
+            powerSum += (uint32_t) status->powerPlate[i] * seconds;
+        }
+    }
+    lastState = state;
+}
+
+void History::handleEvent(ProgramEvent event, Program *)
+{
+    switch (event) {
+    case startProgram:
+        if (!recording) {
+            EepromWriter::flush(); // the previous record might still be queued
+            memset(&record, 0, sizeof(HistoryRecord));
+            record.program = ProgramHandler::getInstance()->getRunningProgramNumber();
+            record.maxHiveTemperature = -999;
+            record.maxPlateTemperature = -999;
+            powerSum = 0;
+            lastUpdate = millis();
+            millisRemainder = 0;
+            recording = true;
+        }
+        break;
+    case stopProgram:
+        if (recording) {
+            finish(ProgramHandler::getInstance()->getStopReason());
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Complete the record of the running treatment and write it to the EEPROM.
+ */
+void History::finish(ProgramStopReason reason)
+{
+    recording = false;
+    record.sequence = nextSequence++;
+    record.stopReason = reason;
+    record.energy = powerSum / 255 * CFG_HEATER_POWER_WATTS / 3600;
+    record.crc = calculateCrc(&record);
+
+    LOG_INFO(Logger::moduleSystem, F("saving treatment #%u to history"), record.sequence);
+    if (!EepromWriter::write(getAddress(nextSlot), &record, sizeof(HistoryRecord), false)) {
+        LOG_ERROR(Logger::moduleSystem, F("unable to queue treatment for saving"));
+    }
+    nextSlot = (nextSlot + 1) % HISTORY_NUMBER_OF_RECORDS;
+    if (numberOfRecords < HISTORY_NUMBER_OF_RECORDS) {
+        numberOfRecords++;
+    }
+}
+
+/**
+ * Return the number of valid records in the history.
+ */
+uint8_t History::getNumberOfRecords()
+{
+    return numberOfRecords;
+}
+
+/**
+ * Read a record from the EEPROM (age 0 = most recent treatment).
+ * Returns false if the record doesn't exist or is corrupt.
+ */
+bool History::getRecord(uint8_t age, HistoryRecord *record)
+{
+    if (age >= numberOfRecords) {
+        return false;
+    }
+    EepromWriter::flush();
+    EEPROM.get(getAddress((nextSlot + HISTORY_NUMBER_OF_RECORDS - 1 - age) % HISTORY_NUMBER_OF_RECORDS), *record);
+    return record->crc == calculateCrc(record);
+}
+
+/*
+ * Convert the stop reason into a string (located in flash memory).
+ */
+const __FlashStringHelper *History::stopReasonToStr(uint8_t reason)
+{
+    switch (reason) {
+    case programAborted:
+        return F("aborted");
+    case programCompleted:
+        return F("completed");
+    case programOvertemp:
+        return F("over-temperature");
+    case programFailed:
+        return F("error");
+    }
+    return F("invalid");
+}
+
+uint16_t History::calculateCrc(HistoryRecord *record)
+{
+    return Crc::calculate((uint8_t *) record, sizeof(HistoryRecord) - 2);
+}
+
+uint16_t History::getAddress(uint8_t slot)
+{
+    return CONFIG_ADDRESS_HISTORY + slot * sizeof(HistoryRecord);
+}
@@ -0,0 +1,102 @@
+/*
+ * History.h
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include "config.h"
+#include "Logger.h"
+#include "Crc.h"
+#include "Status.h"
+#include "ProgramHandler.h"
+#include "EepromWriter.h"
+#include <EEPROM.h>
+
+/*
+ * The history takes 2 KB of the 3 KB behind the configuration (102 records). The last
+ * 1 KB is reserved for the resume checkpoint (3072, see Checkpoint.h) and the table
+ * of user defined programs (3328, see ProgramStore.h).
+ */
+#define CONFIG_ADDRESS_HISTORY      1024
+#define CONFIG_SIZE_HISTORY         2048
+
+/*
+ * One record per treatment. There is no real-time clock, so a treatment is identified
+ * by its sequence number and described by the durations of its phases.
+ */
+class HistoryRecord
+{
+public:
+    uint16_t sequence; // running number of the treatment
+    uint8_t program; // number of the program (1-based)
+    uint8_t stopReason; // ProgramStopReason
+    uint16_t durationPreHeat; // duration of the pre-heat phase (in s)
+    uint16_t durationRunning; // duration of the running phase (in s)
+    uint16_t timeAtTarget; // time the hive was within CFG_HISTORY_TARGET_TOLERANCE of the target while running (in s)
+    int16_t maxHiveTemperature; // maximum relevant hive temperature (in 0.1 deg C)
+    int16_t maxPlateTemperature; // maximum temperature of all plates (in 0.1 deg C)
+    uint8_t overtempEvents; // number of times the system went into over-temperature
+    uint8_t reserved;
+    uint16_t energy; // energy consumed by the heaters (in Wh)
+    uint16_t crc; // lower 16 bits of the CRC of the bytes above
+    // 20 bytes used
+};
+
+#define HISTORY_NUMBER_OF_RECORDS   (CONFIG_SIZE_HISTORY / sizeof(HistoryRecord))
+
+class History: public ProgramObserver
+{
+public:
+    static History *getInstance();
+    virtual ~History();
+    void load();
+    void process();
+    void handleEvent(ProgramEvent event, Program *program);
+    uint8_t getNumberOfRecords();
+    bool getRecord(uint8_t age, HistoryRecord *record);
+    static const __FlashStringHelper *stopReasonToStr(uint8_t reason);
+
+private:
+    friend class Sauna; // owns the instance
+    History();
+    History(History const&); // copy disabled
+    void operator=(History const&); // assigment disabled
+    void finish(ProgramStopReason reason);
+    uint16_t calculateCrc(HistoryRecord *record);
+    uint16_t getAddress(uint8_t slot);
+
+    HistoryRecord record; // the record of the running treatment
+    bool recording; // is a treatment being recorded
+    Status::SystemState lastState; // the state at the last call of process()
+    uint32_t powerSum; // sum of the power levels of all plates (0-255 per plate and second)
+    uint32_t lastUpdate; // time of the previous call of process() (in ms)
+    uint16_t millisRemainder; // time not yet counted in whole seconds (in ms)
+    uint8_t nextSlot; // the slot to which the next record will be written
+    uint8_t numberOfRecords; // number of valid records in the EEPROM
+    uint16_t nextSequence; // sequence number of the next record
+};
+
+#endif /* HISTORY_H_ */
@@ -95,6 +95,7 @@ void Humidifier::initialize()
  */
 void Humidifier::process()
 {
+    Status *status = Status::getInstance();
     Device::process();
     humidity = sensor.getRelativeHumidity();
     temperature = sensor.getTemperature();
@@ -102,26 +103,26 @@ void Humidifier::process()
     if (humidity != 0 && humidity < minimumHumidity) {
         fan.setSpeed(fanSpeed);
         enableVaporizer(true);
-        status.fanSpeedHumidifier = fanSpeed;
-        status.fanTimeHumidifier = 0;
+        status->fanSpeedHumidifier = fanSpeed;
+        status->fanTimeHumidifier = 0;
     }
 
     if (humidity >= maximumHumidity) {
         enableVaporizer(false);
 
-        if (status.fanTimeHumidifier == 0) {
-            status.fanTimeHumidifier = millis();
+        if (status->fanTimeHumidifier == 0) {
+            status->fanTimeHumidifier = millis();
         }
     }
 
     // let the fan run longer than the vaporizer to let it dry
-    if (status.fanTimeHumidifier != 0 && (millis() - status.fanTimeHumidifier) > 60000 * Configuration::getParams()->humidifierFanDryTime) {
+    if (status->fanTimeHumidifier != 0 && (millis() - status->fanTimeHumidifier) > 60000 * Configuration::getParams()->humidifierFanDryTime) {
         fan.setSpeed(0);
-        status.fanSpeedHumidifier = 0;
+        status->fanSpeedHumidifier = 0;
     }
 
-    status.humidity = humidity;
-    status.temperatureHumidifier = temperature;
+    status->humidity = humidity;
+    status->temperatureHumidifier = temperature;
 }
 
 void Humidifier::enableVaporizer(bool enable)
@@ -129,5 +130,5 @@ void Humidifier::enableVaporizer(bool enable)
     if (Configuration::getIO()->vaporizer != 0) {
         digitalWrite(Configuration::getIO()->vaporizer, enable);
     }
-    status.vaporizerEnabled = enable;
+    Status::getInstance()->vaporizerEnabled = enable;
 }
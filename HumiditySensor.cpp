@@ -27,6 +27,7 @@
  */
 
 #include "HumiditySensor.h"
+#include "SensorTrace.h"
 
 HumiditySensor::HumiditySensor()
 {
@@ -58,7 +59,13 @@ uint8_t HumiditySensor::getRelativeHumidity()
     if (dht == NULL || millis() < 10000) {
         return 99;
     }
-    return (int) dht->readHumidity();
+    float humidity = dht->readHumidity();
+    SENSOR_TRACE(humidity(humidity));
+    if (isnan(humidity)) {
+        Status::getInstance()->sensorErrorsHumidity++;
+        return 0;
+    }
+    return (int) humidity;
 }
 
 /**
@@ -69,5 +76,7 @@ int16_t HumiditySensor::getTemperature()
     if (dht == NULL) {
         return 0;
     }
-    return dht->readTemperature() * 10;
+    float temperature = dht->readTemperature();
+    SENSOR_TRACE(humidityTemperature(temperature));
+    return temperature * 10;
 }
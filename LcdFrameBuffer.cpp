@@ -0,0 +1,115 @@
+/*
+ * LcdFrameBuffer.cpp
+ *
+ * Renders the screens into RAM and transfers only the differences to the
+ * HD44780, spread over several loops, to avoid flicker and long blocking
+ * writes in the control loop.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "LcdFrameBuffer.h"
+
+/**
+ * Constructor, the display is expected to be empty (after begin())
+ */
+LcdFrameBuffer::LcdFrameBuffer()
+{
+    memset(frame, ' ', LCD_SIZE);
+    memset(shown, ' ', LCD_SIZE);
+    position = 0;
+    displayPosition = LCD_SIZE;
+    scanPosition = 0;
+}
+
+/**
+ * Clear the frame and move the cursor home (the display is not touched)
+ */
+void LcdFrameBuffer::clear()
+{
+    memset(frame, ' ', LCD_SIZE);
+    position = 0;
+}
+
+/**
+ * Move the position where the next character is written to
+ */
+void LcdFrameBuffer::setCursor(uint8_t column, uint8_t row)
+{
+    position = (row < LCD_ROWS && column < LCD_COLUMNS ? row * LCD_COLUMNS + column : LCD_SIZE);
+}
+
+/**
+ * Write a character to the frame. Like on the HD44780, text continues from the end
+ * of the first row in the third and from the second in the fourth, the rest is cut off.
+ */
+size_t LcdFrameBuffer::write(uint8_t character)
+{
+    if (position >= LCD_SIZE) {
+        return 0;
+    }
+    frame[position++] = character;
+    if (position == LCD_COLUMNS || position == 2 * LCD_COLUMNS) {
+        position += LCD_COLUMNS; // continue in row 3 or 4
+    } else if (position == 3 * LCD_COLUMNS) {
+        position = LCD_SIZE;
+    }
+    return 1;
+}
+
+/**
+ * Transfer changed characters to the display, moving the cursor counts as one byte.
+ * The scan continues where the last call stopped, so all rows get their turn.
+ */
+void LcdFrameBuffer::update(LiquidCrystal *display, uint8_t budget)
+{
+    for (uint8_t i = 0; i < LCD_SIZE && budget > 0; i++) {
+        uint8_t index = scanPosition;
+        scanPosition = (scanPosition + 1) % LCD_SIZE;
+
+        if (frame[index] == shown[index]) {
+            continue;
+        }
+        if (index != displayPosition) {
+            display->setCursor(index % LCD_COLUMNS, index / LCD_COLUMNS);
+            if (--budget == 0) {
+                displayPosition = index;
+                scanPosition = index; // the character is written with the next call
+                return;
+            }
+        }
+        display->write(frame[index]);
+        shown[index] = frame[index];
+        budget--;
+        // the display's cursor moves to the next cell of the row
+        displayPosition = ((index + 1) % LCD_COLUMNS == 0 ? LCD_SIZE : index + 1);
+    }
+}
+
+/**
+ * Transfer all changes to the display at once (e.g. before blocking for user input)
+ */
+void LcdFrameBuffer::flush(LiquidCrystal *display)
+{
+    update(display, 2 * LCD_SIZE);
+}
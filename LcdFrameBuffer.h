@@ -0,0 +1,61 @@
+/*
+ * LcdFrameBuffer.h
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef LCDFRAMEBUFFER_H_
+#define LCDFRAMEBUFFER_H_
+
+#include <Arduino.h>
+#include <LiquidCrystal.h>
+#include "config.h"
+
+#define LCD_COLUMNS 20
+#define LCD_ROWS    4
+#define LCD_SIZE    (LCD_COLUMNS * LCD_ROWS)
+
+/*
+ * A shadow copy of the LCD which screens print into (with the same interface as LiquidCrystal).
+ * update() transfers only the changed characters to the display, limited to a number of bytes per call.
+ */
+class LcdFrameBuffer: public Print
+{
+public:
+    LcdFrameBuffer();
+    void clear();
+    void setCursor(uint8_t column, uint8_t row);
+    virtual size_t write(uint8_t character);
+    using Print::write;
+    void update(LiquidCrystal *display, uint8_t budget);
+    void flush(LiquidCrystal *display);
+
+private:
+    char frame[LCD_SIZE]; // the content the screens rendered
+    char shown[LCD_SIZE]; // the content of the display
+    uint8_t position; // the position of the next character written to the frame
+    uint8_t displayPosition; // the cursor position of the display (LCD_SIZE if unknown)
+    uint8_t scanPosition; // where the next update starts to look for changes
+};
+
+#endif /* LCDFRAMEBUFFER_H_ */
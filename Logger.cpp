@@ -28,105 +28,103 @@
 
 #include "Logger.h"
 
-Logger::LogLevel Logger::logLevel = CFG_DEFAULT_LOGLEVEL;
-uint32_t Logger::lastLogTime = 0;
-bool Logger::debugging = (Logger::logLevel == Debug);
-char *Logger::msgBuffer = new char[CFG_LOG_BUFFER_SIZE];
+CFG_INSTANCE_LOCAL Logger::LogLevel Logger::moduleLoglevel[] = { CFG_DEFAULT_LOGLEVEL, CFG_DEFAULT_LOGLEVEL, CFG_DEFAULT_LOGLEVEL, CFG_DEFAULT_LOGLEVEL,
+        CFG_DEFAULT_LOGLEVEL, CFG_DEFAULT_LOGLEVEL, CFG_DEFAULT_LOGLEVEL };
+CFG_INSTANCE_LOCAL uint32_t Logger::lastLogTime = 0;
+CFG_INSTANCE_LOCAL char Logger::msgBuffer[CFG_LOG_BUFFER_SIZE];
+
+// names of the log levels, kept in flash and indexed by LogLevel
+static const char levelNameDebug[] PROGMEM = "DEBUG";
+static const char levelNameInfo[] PROGMEM = "INFO";
+static const char levelNameWarn[] PROGMEM = "WARNING";
+static const char levelNameError[] PROGMEM = "ERROR";
+static const char * const levelNames[] PROGMEM = { levelNameDebug, levelNameInfo, levelNameWarn, levelNameError };
+
+// names of the modules as used in console commands, indexed by Module
+static const char moduleNameSystem[] PROGMEM = "SYSTEM";
+static const char moduleNameController[] PROGMEM = "CONTROLLER";
+static const char moduleNamePlate[] PROGMEM = "PLATE";
+static const char moduleNameHumidifier[] PROGMEM = "HUMIDIFIER";
+static const char moduleNameHID[] PROGMEM = "HID";
+static const char moduleNameSerialConsole[] PROGMEM = "CONSOLE";
+static const char moduleNameOneWire[] PROGMEM = "ONEWIRE";
+static const char * const moduleNames[] PROGMEM = { moduleNameSystem, moduleNameController, moduleNamePlate, moduleNameHumidifier,
+        moduleNameHID, moduleNameSerialConsole, moduleNameOneWire };
 
 /*
- * Output a debug message with a variable amount of parameters.
- * printf() style, see Logger::log()
+ * Output a log message with a variable amount of parameters.
+ * Use the LOG_DEBUG(), LOG_INFO(), LOG_WARN() and LOG_ERROR() macros instead
+ * of calling this directly, they verify the log level of the module before
+ * evaluating the arguments.
  *
+ * Supports printf() syntax. The format string is read directly from flash and
+ * the whole line (timestamp, level and message) is formatted into the static
+ * message buffer, so no heap allocation takes place.
  */
-void Logger::debug(String message, ...)
+void Logger::log(LogLevel level, const __FlashStringHelper *format, ...)
 {
-    if (logLevel > Debug) {
-        return;
-    }
-
-    va_list args;
-    va_start(args, message);
-    Logger::log(Debug, message, args);
-    va_end(args);
-}
+    lastLogTime = millis();
 
-/*
- * Output a info message with a variable amount of parameters
- * printf() style, see Logger::log()
- */
-void Logger::info(String message, ...)
-{
-    if (logLevel > Info) {
-        return;
+    int length = snprintf_P(msgBuffer, CFG_LOG_BUFFER_SIZE, PSTR("%lu - %S: "), lastLogTime,
+            (PGM_P) pgm_read_ptr(&levelNames[constrain(level, Debug, Error)]));
+    if (length > 0 && length < CFG_LOG_BUFFER_SIZE) {
+        va_list args;
+        va_start(args, format);
+        vsnprintf_P(msgBuffer + length, CFG_LOG_BUFFER_SIZE - length, (PGM_P) format, args);
+        va_end(args);
     }
 
-    va_list args;
-    va_start(args, message);
-    Logger::log(Info, message, args);
-    va_end(args);
+    // queue for output to serial USB, debug and info messages are dropped first if the link is congested
+    SerialBuffer::write(level >= Warn ? SerialBuffer::high : SerialBuffer::low, msgBuffer);
 }
 
 /*
- * Output a warning message with a variable amount of parameters
+ * Output a comnsole message with a variable amount of parameters
  * printf() style, see Logger::log()
  */
-void Logger::warn(String message, ...)
+void Logger::console(const __FlashStringHelper *message, ...)
 {
-    if (logLevel > Warn) {
-        return;
-    }
-
     va_list args;
     va_start(args, message);
-    Logger::log(Warn, message, args);
+    vsnprintf_P(msgBuffer, CFG_LOG_BUFFER_SIZE, (PGM_P) message, args);
+    SerialBuffer::write(SerialBuffer::high, msgBuffer);
     va_end(args);
 }
 
 /*
- * Output a error message with a variable amount of parameters
- * printf() style, see Logger::log()
+ * Set the log level of all modules. Any output below the specified log level will be omitted.
  */
-void Logger::error(String message, ...)
+void Logger::setLoglevel(LogLevel level)
 {
-    if (logLevel > Error) {
-        return;
+    for (uint8_t i = 0; i < numberOfModules; i++) {
+        moduleLoglevel[i] = level;
     }
-
-    va_list args;
-    va_start(args, message);
-    Logger::log(Error, message, args);
-    va_end(args);
 }
 
 /*
- * Output a comnsole message with a variable amount of parameters
- * printf() style, see Logger::logMessage()
+ * Set the log level of a single module.
  */
-void Logger::console(String message, ...)
+void Logger::setLoglevel(Module module, LogLevel level)
 {
-    va_list args;
-    va_start(args, message);
-    vsnprintf(msgBuffer, CFG_LOG_BUFFER_SIZE, message.c_str(), args);
-    Serial.println(msgBuffer);
-    va_end(args);
+    if (module < numberOfModules) {
+        moduleLoglevel[module] = level;
+    }
 }
 
 /*
- * Set the log level. Any output below the specified log level will be omitted.
- * Also set the debugging flag for faster evaluation in isDebug().
+ * Retrieve the current log level of a module.
  */
-void Logger::setLoglevel(LogLevel level)
+Logger::LogLevel Logger::getLogLevel(Module module)
 {
-    logLevel = level;
-    debugging = (level == Debug);
+    return moduleLoglevel[module];
 }
 
 /*
- * Retrieve the current log level.
+ * Retrieve the name of a module (located in flash memory).
  */
-Logger::LogLevel Logger::getLogLevel()
+const __FlashStringHelper *Logger::getModuleName(Module module)
 {
-    return logLevel;
+    return (const __FlashStringHelper *) pgm_read_ptr(&moduleNames[module]);
 }
 
 /*
@@ -136,49 +134,3 @@ uint32_t Logger::getLastLogTime()
 {
     return lastLogTime;
 }
-
-/*
- * Returns if debug log level is enabled. This can be used in time critical
- * situations to prevent unnecessary string concatenation (if the message won't
- * be logged in the end).
- *
- * Example:
- * if (Logger::isDebug()) {
- *    Logger::debug("current time: %d", millis());
- * }
- */
-boolean Logger::isDebug()
-{
-    return debugging;
-}
-
-/*
- * Output a log message (called by debug(), info(), warn(), error(), console())
- *
- * Supports printf() syntax
- */
-void Logger::log(LogLevel level, String format, va_list args)
-{
-    String logLevel = F("DEBUG");
-    lastLogTime = millis();
-
-    switch (level) {
-    case Info:
-        logLevel = F("INFO");
-        break;
-    case Warn:
-        logLevel = F("WARNING");
-        break;
-    case Error:
-        logLevel = F("ERROR");
-        break;
-    }
-    vsnprintf(msgBuffer, CFG_LOG_BUFFER_SIZE, format.c_str(), args);
-
-    // print to serial USB
-    Serial.print(lastLogTime);
-    Serial.print(F(" - "));
-    Serial.print(logLevel);
-    Serial.print(F(": "));
-    Serial.println(msgBuffer);
-}
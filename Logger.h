@@ -29,8 +29,23 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "SerialBuffer.h"
 
-class Device;
+/*
+ * Log macros which should be used instead of calling Logger::log() directly.
+ *
+ * Messages below CFG_LOG_MIN_LEVEL are removed by the compiler. The other
+ * messages are only formatted if the module's log level allows it - in that
+ * case the arguments (e.g. calls to format numbers) aren't even evaluated.
+ */
+#define LOG_MESSAGE(module, level, ...) do { \
+        if (CFG_LOG_MIN_LEVEL <= level && Logger::isEnabled(module, level)) \
+            Logger::log(level, __VA_ARGS__); \
+    } while (0)
+#define LOG_DEBUG(module, ...) LOG_MESSAGE(module, Logger::Debug, __VA_ARGS__)
+#define LOG_INFO(module, ...) LOG_MESSAGE(module, Logger::Info, __VA_ARGS__)
+#define LOG_WARN(module, ...) LOG_MESSAGE(module, Logger::Warn, __VA_ARGS__)
+#define LOG_ERROR(module, ...) LOG_MESSAGE(module, Logger::Error, __VA_ARGS__)
 
 class Logger
 {
@@ -43,23 +58,37 @@ public:
         Error = 3,
         Off = 4
     };
-    static void debug(String, ...);
-    static void info(String, ...);
-    static void warn(String, ...);
-    static void error(String, ...);
-    static void console(String, ...);
+    enum Module
+    {
+        moduleSystem = 0, // configuration, statistics, status and programs
+        moduleController = 1,
+        modulePlate = 2,
+        moduleHumidifier = 3,
+        moduleHID = 4,
+        moduleSerialConsole = 5,
+        moduleOneWire = 6,
+        numberOfModules = 7
+    };
+    static void log(LogLevel, const __FlashStringHelper *, ...);
+    static void console(const __FlashStringHelper *, ...);
     static void setLoglevel(LogLevel);
-    static LogLevel getLogLevel();
+    static void setLoglevel(Module, LogLevel);
+    static LogLevel getLogLevel(Module);
+    static const __FlashStringHelper *getModuleName(Module);
     static uint32_t getLastLogTime();
-    static boolean isDebug();
-private:
-    static LogLevel logLevel;
-    static uint32_t lastLogTime;
-    static bool debugging;
-    static LogLevel *deviceLoglevel;
-    static char *msgBuffer;
 
-    static void log(LogLevel, String format, va_list);
+    /*
+     * Returns if a message of a module with the given level will be logged.
+     */
+    static inline bool isEnabled(Module module, LogLevel level)
+    {
+        return level >= moduleLoglevel[module];
+    }
+
+private:
+    static CFG_INSTANCE_LOCAL LogLevel moduleLoglevel[numberOfModules];
+    static CFG_INSTANCE_LOCAL uint32_t lastLogTime;
+    static CFG_INSTANCE_LOCAL char msgBuffer[CFG_LOG_BUFFER_SIZE];
 };
 
 #endif /* LOGGER_H_ */
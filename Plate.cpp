@@ -28,8 +28,7 @@
  */
 
 #include "Plate.h"
-
-uint8_t Plate::activeHeaters = 0;
+#include "Sauna.h"
 
 Plate::Plate() :
         Device()
@@ -61,7 +60,7 @@ void Plate::initialize()
 
 void Plate::initialize(uint8_t index)
 {
-    Logger::debug(F("initializing plate %d"), index + 1);
+    LOG_DEBUG(Logger::modulePlate, F("initializing plate %d"), index + 1);
 
     initialize();
     this->index = index;
@@ -73,6 +72,7 @@ void Plate::initialize(uint8_t index)
 
 Plate::~Plate()
 {
+
 }
 
 /**
@@ -108,7 +108,7 @@ uint8_t Plate::getMaximumPower()
 void Plate::setFanSpeed(uint8_t speed)
 {
     fan->setSpeed(speed);
-    status.fanSpeedPlate[index] = speed;
+    Status::getInstance()->fanSpeedPlate[index] = speed;
 }
 
 /**
@@ -168,6 +168,24 @@ void Plate::resume()
     paused = false;
 }
 
+/**
+ * Get the output of the PID (the power before applying the non-PWM logic, 0-255)
+ */
+uint8_t Plate::getPidOutput()
+{
+    return power;
+}
+
+/**
+ * Set the output of the PID and re-initialize it, so it continues from this value (e.g. after a power loss)
+ */
+void Plate::setPidOutput(uint8_t output)
+{
+    power = output;
+    pid->SetMode(MANUAL);
+    pid->SetMode(AUTOMATIC); // initializes the integral term with the output
+}
+
 /**
  * Update the plat's PID data and derive the power level to command (0-255 for PWM, 0 / 255 for non-PWM).
  * In non-PWM mode, the number of concurrently active plates is also limited to the configured amount.
@@ -176,22 +194,22 @@ void Plate::resume()
 uint8_t Plate::calculateHeaterPower()
 {
     ConfigurationParams *params = Configuration::getParams();
+    Status *status = Status::getInstance();
 
     pid->Compute(); // updates power
-    if (Logger::isDebug()) {
-        Logger::debug(F("Calculated power for plate %d: %d"), index, power);
-    }
+    LOG_DEBUG(Logger::modulePlate, F("Calculated power for plate %d: %d"), index + 1, (int) power);
 
     if (currentTemperature > params->plateOverTemp) {
-        Logger::error(F("ALERT !!! Plate %d is over-heating !!!"), index + 1);
-        status.setSystemState(Status::overtemp);
-        status.errorCode = Status::overtempPlate;
+        LOG_ERROR(Logger::modulePlate, F("ALERT !!! Plate %d is over-heating !!!"), index + 1);
+        status->setSystemState(Status::overtemp);
+        status->errorCode = Status::overtempPlate;
         power = 0;
     }
 
     if (params->usePWM) {
         return constrain(power, (double )0, maxPower);
     } else {
+        uint8_t &activeHeaters = Sauna::getCurrent()->activeHeaters; // shared by all plates of the sauna
         if ((power > params->maxHeaterPower / 2) && (activeHeaters < params->maxConcurrentHeaters)) {
             if (!on) {
                 on = true;
@@ -215,12 +233,13 @@ uint8_t Plate::calculateHeaterPower()
  */
 void Plate::process()
 {
+    Status *status = Status::getInstance();
     Device::process();
     sensorHeater->retrieveData();
     currentTemperature = sensorHeater->getTemperatureCelsius();
-    status.temperaturePlate[index] = currentTemperature;
+    status->temperaturePlate[index] = currentTemperature;
 
     uint8_t power = (paused ? 0 : calculateHeaterPower());
-    status.powerPlate[index] = power;
+    status->powerPlate[index] = power;
     heater->setPower(power);
 }
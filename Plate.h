@@ -56,6 +56,8 @@ public:
     void setPIDTuning(double kp, double ki, double kd);
     void pause();
     void resume();
+    uint8_t getPidOutput();
+    void setPidOutput(uint8_t output);
     int16_t getTemperature();
     uint8_t getPower();
     uint8_t getFanSpeed();
@@ -66,7 +68,6 @@ protected:
 private:
     uint8_t calculateHeaterPower();
 
-    static uint8_t activeHeaters; // a static counter to establish how many heaters are active in non-PWM mode
     TemperatureSensor *sensorHeater;
     Heater *heater;
     Fan *fan;
@@ -25,112 +25,92 @@
  */
 
 #include "ProgramHandler.h"
+#include "Sauna.h"
+#include "ProgramStore.h"
+#include "ThermalDose.h"
 
 ProgramHandler::ProgramHandler()
 {
+    memset(&program, 0, sizeof(Program));
+    programNumber = 0;
     runningProgram = NULL;
+    runningProgramNumber = 0;
+    stopReason = programAborted;
     startTime = 0;
+    memset(&segment, 0, sizeof(ProgramSegment));
+    segmentNumber = 0;
+    rampStart = 0;
+    queueLength = 0;
+    finishTime = 0;
 }
 
 ProgramHandler::~ProgramHandler()
 {
+
 }
 
 /**
- * Get singleton instance
+ * Return the instance of the current sauna
  */
 ProgramHandler *ProgramHandler::getInstance()
 {
-    static ProgramHandler instance;
-    return &instance;
+    return &Sauna::getCurrent()->programHandler;
 }
 
 /**
- * Initialize all programs
+ * Load the first available program, so there's always a program to display and edit
  */
 void ProgramHandler::initPrograms()
 {
-    Logger::info(F("Loading program data"));
-
-    Program programVarroaSummer;
-    snprintf(programVarroaSummer.name, 16, "Varroa Killer");
-    programVarroaSummer.temperaturePreHeat = 400; // 40 deg C
-    programVarroaSummer.fanSpeedPreHeat = 250;
-    programVarroaSummer.durationPreHeat = 60; // 60min
-    programVarroaSummer.temperatureHive = 410; // 41 deg C
-    programVarroaSummer.hiveKp = 4.0;
-    programVarroaSummer.hiveKi = 0.2;
-    programVarroaSummer.hiveKd = 7.0;
-    programVarroaSummer.temperaturePlate = 700; // 70 deg C
-    programVarroaSummer.plateKp = 1.0;
-    programVarroaSummer.plateKi = 0.10;
-    programVarroaSummer.plateKd = 7.0;
-    programVarroaSummer.fanSpeed = 200; // minimum is 10
-    programVarroaSummer.humidityMinimum = 30;
-    programVarroaSummer.humidityMaximum = 35;
-    programVarroaSummer.fanSpeedHumidifier = 240; // only works from 230 to 255
-    programVarroaSummer.duration = 210; // 3.5 hours
-    programs.push_back(programVarroaSummer);
-
-    Program programVarroaWinter;
-    snprintf(programVarroaWinter.name, 16, "Winter Treat");
-    programVarroaWinter.temperaturePreHeat = 400; // 40 deg C
-    programVarroaWinter.fanSpeedPreHeat = 255;
-    programVarroaWinter.durationPreHeat = 60; // 60min
-    programVarroaWinter.temperatureHive = 420; // 41.0 deg C
-    programVarroaWinter.hiveKp = 8.0;
-    programVarroaWinter.hiveKi = 0.2;
-    programVarroaWinter.hiveKd = 5.0;
-    programVarroaWinter.temperaturePlate = 750; // 75 deg C
-    programVarroaWinter.plateKp = 4.0;
-    programVarroaWinter.plateKi = 0.09;
-    programVarroaWinter.plateKd = 50.0;
-    programVarroaWinter.fanSpeed = 255; // minimum is 10
-    programVarroaWinter.humidityMinimum = 30;
-    programVarroaWinter.humidityMaximum = 35;
-    programVarroaWinter.fanSpeedHumidifier = 240; // only works from 230 to 255
-    programVarroaWinter.duration = 180; // 3 hours
-    programs.push_back(programVarroaWinter);
-
-    Program programCleaning;
-    snprintf(programCleaning.name, 16, "Cleaning");
-    programCleaning.temperaturePreHeat = 380; // 38 deg C
-    programCleaning.fanSpeedPreHeat = 10;
-    programCleaning.durationPreHeat = 0;
-    programCleaning.temperatureHive = 425; // 42.5 deg C
-    programCleaning.hiveKp = 8.0;
-    programCleaning.hiveKi = 0.2;
-    programCleaning.hiveKd = 5.0;
-    programCleaning.temperaturePlate = 600; // 60 deg C
-    programCleaning.plateKp = 4.0;
-    programCleaning.plateKi = 0.09;
-    programCleaning.plateKd = 50.0;
-    programCleaning.fanSpeed = 10; // minimum is 10
-    programCleaning.humidityMinimum = 1;
-    programCleaning.humidityMaximum = 2;
-    programCleaning.fanSpeedHumidifier = 0; // only works from 230 to 255
-    programCleaning.duration = 15; // 15min
-    programs.push_back(programCleaning);
-
-    Program programMeltHoney;
-    snprintf(programMeltHoney.name, 16, "Melt Honey");
-    programMeltHoney.temperaturePreHeat = 300;
-    programMeltHoney.fanSpeedPreHeat = 10;
-    programMeltHoney.durationPreHeat = 0;
-    programMeltHoney.temperatureHive = 300;
-    programMeltHoney.hiveKp = 8.0;
-    programMeltHoney.hiveKi = 0.2;
-    programMeltHoney.hiveKd = 5.0;
-    programMeltHoney.temperaturePlate = 500;
-    programMeltHoney.plateKp = 4.0;
-    programMeltHoney.plateKi = 0.09;
-    programMeltHoney.plateKd = 50.0;
-    programMeltHoney.fanSpeed = 10;
-    programMeltHoney.humidityMinimum = 1;
-    programMeltHoney.humidityMaximum = 2;
-    programMeltHoney.fanSpeedHumidifier = 0; // only works from 230 to 255
-    programMeltHoney.duration = 720; // 12 hours
-    programs.push_back(programMeltHoney);
+    LOG_INFO(Logger::moduleSystem, F("Loading program data"));
+    uint8_t first = ProgramStore::getInstance()->getNext(0);
+    if (first == 0 || !ProgramStore::getInstance()->load(first, &program)) {
+        LOG_ERROR(Logger::moduleSystem, F("no programs available"));
+        return;
+    }
+    programNumber = first;
+}
+
+/**
+ * Load a program into RAM (e.g. to edit it), not possible while a program is active
+ */
+bool ProgramHandler::load(uint8_t number)
+{
+    if (isActive()) {
+        LOG_WARN(Logger::moduleSystem, F("unable to load program while a program is active"));
+        return false;
+    }
+    if (!ProgramStore::getInstance()->load(number, &program)) {
+        LOG_WARN(Logger::moduleSystem, F("program #%d not found"), number);
+        return false;
+    }
+    programNumber = number;
+    return true;
+}
+
+/**
+ * Check if a program is active (running or shutting down), the loaded program is in use then
+ */
+bool ProgramHandler::isActive()
+{
+    Status::SystemState state = Status::getInstance()->getSystemState();
+    return state == Status::preHeat || state == Status::running || state == Status::overtemp || state == Status::shutdown;
+}
+
+/**
+ * Returns the address of the loaded program (which might not be running, NULL if none is loaded)
+ */
+Program *ProgramHandler::getProgram()
+{
+    return (programNumber == 0 ? NULL : &program);
+}
+
+/**
+ * Returns the number of the loaded program (1-based, 0 = none)
+ */
+uint8_t ProgramHandler::getProgramNumber()
+{
+    return programNumber;
 }
 
 /**
@@ -142,42 +122,89 @@ Program* ProgramHandler::getRunningProgram()
 }
 
 /**
- * Returns the list of all defined programs
+ * Returns the number of the currently running program (1-based, also after it was extended)
+ */
+uint8_t ProgramHandler::getRunningProgramNumber()
+{
+    return runningProgramNumber;
+}
+
+/**
+ * Returns the reason why the last program was stopped
  */
-SimpleList<Program>* ProgramHandler::getPrograms()
+ProgramStopReason ProgramHandler::getStopReason()
 {
-    return &programs;
+    return stopReason;
 }
 
 /**
  * Start a specific program
+ *
+ * \return false if the program doesn't exist or has no segments
  */
-void ProgramHandler::start(uint8_t programNumber)
-{
-    int i = 1;
-    for (SimpleList<Program>::iterator itr = programs.begin(); itr != programs.end(); ++itr) {
-        if (i == programNumber) {
-            Logger::info(F("Starting program #%d"), i);
-            runningProgram = itr;
-            runningProgram->changed = false;
-            startTime = millis();
-            status.setSystemState(runningProgram->durationPreHeat == 0 ? Status::running : Status::preHeat);
-            sendEvent(startProgram, runningProgram);
-            return;
-        }
-        i++;
+bool ProgramHandler::start(uint8_t programNumber)
+{
+    Status *status = Status::getInstance();
+    if (!ProgramStore::getInstance()->load(programNumber, &program)) {
+        LOG_WARN(Logger::moduleSystem, F("program #%d not found"), programNumber);
+        return false;
     }
-    Logger::warn(F("program #%d not found"), programNumber);
+    this->programNumber = programNumber;
+    ProgramSegment first;
+    if (!getSegment(0, &first)) {
+        LOG_WARN(Logger::moduleSystem, F("program #%d has no segments"), programNumber);
+        return false;
+    }
+    LOG_INFO(Logger::moduleSystem, F("Starting program #%d"), programNumber);
+    runningProgram = &program;
+    runningProgramNumber = programNumber;
+    runningProgram->changed = false;
+    ThermalDose::getInstance()->reset();
+    status->setSystemState(first.type == segmentSoak || first.type == segmentCool ? Status::running : Status::preHeat);
+    startSegment(0, (status->temperatureActualHive == -999 ? first.temperature : status->temperatureActualHive));
+    sendEvent(startProgram, runningProgram);
+    return true;
+}
+
+/**
+ * Continue a program in the given phase and segment, e.g. after a power loss
+ */
+bool ProgramHandler::restore(uint8_t programNumber, Status::SystemState state, uint8_t segmentNumber, uint32_t timeRunning,
+        int16_t rampStart)
+{
+    if ((state != Status::preHeat && state != Status::running) || !ProgramStore::getInstance()->load(programNumber, &program)) {
+        return false;
+    }
+    this->programNumber = programNumber;
+    if (!getSegment(segmentNumber, &segment)) {
+        return false;
+    }
+    LOG_INFO(Logger::moduleSystem, F("Resuming program #%d in segment %d at %lus"), programNumber, segmentNumber + 1, timeRunning);
+    runningProgram = &program;
+    runningProgramNumber = programNumber;
+    runningProgram->changed = false;
+    this->segmentNumber = segmentNumber;
+    this->rampStart = rampStart;
+    startTime = millis() - timeRunning * 1000;
+    Status::getInstance()->setSystemState(state);
+    sendEvent(startProgram, runningProgram);
+    return true;
 }
 
 /**
  * Stop the currently running program
  */
-void ProgramHandler::stop()
+void ProgramHandler::stop(ProgramStopReason reason)
 {
-    Logger::info(F("stopping program"));
+    LOG_INFO(Logger::moduleSystem, F("stopping program"));
+    stopReason = reason;
     startTime = 0;
-    status.setSystemState(Status::shutdown);
+    finishTime = millis();
+    if (reason != programCompleted && queueLength > 0) {
+        LOG_WARN(Logger::moduleSystem, F("program did not complete, clearing the queue"));
+        clearQueue();
+    }
+    Status::getInstance()->setSystemState(Status::shutdown);
     sendEvent(stopProgram, runningProgram);
 }
 
@@ -186,7 +213,7 @@ void ProgramHandler::stop()
  */
 void ProgramHandler::pause()
 {
-    Logger::info(F("pausing program"));
+    LOG_INFO(Logger::moduleSystem, F("pausing program"));
     sendEvent(pauseProgram, runningProgram);
 }
 
@@ -195,46 +222,305 @@ void ProgramHandler::pause()
  */
 void ProgramHandler::resume()
 {
-    Logger::info(F("resuming program"));
+    LOG_INFO(Logger::moduleSystem, F("resuming program"));
     sendEvent(resumeProgram, runningProgram);
 }
 
+/**
+ * Run the finished program for some more minutes. An additional soak segment is appended at the temperature
+ * of the last segment (or the program's temperature if it ended with a cool-down).
+ */
 void ProgramHandler::addTime(uint16_t duration) {
-    Program *clone = new Program();
-    clone->duration = duration;
-    clone->fanSpeed = runningProgram->fanSpeed;
-    clone->fanSpeedHumidifier = runningProgram->fanSpeedHumidifier;
-    clone->hiveKp = runningProgram->hiveKp;
-    clone->hiveKi = runningProgram->hiveKi;
-    clone->hiveKd = runningProgram->hiveKd;
-    clone->humidityMinimum = runningProgram->humidityMinimum;
-    clone->humidityMaximum = runningProgram->humidityMaximum;
-    strcpy(clone->name, runningProgram->name);
-    clone->plateKp = runningProgram->plateKp;
-    clone->plateKi = runningProgram->plateKi;
-    clone->plateKd = runningProgram->plateKd;
-    clone->temperatureHive = runningProgram->temperatureHive;
-    clone->temperaturePlate = runningProgram->temperaturePlate;
-    runningProgram = clone;
-
-    Logger::info(F("extending program %s by %dmin"), runningProgram->name, duration);
+    LOG_INFO(Logger::moduleSystem, F("extending program %s by %dmin"), runningProgram->name, duration);
+    if (segment.type == segmentCool) {
+        segment.temperature = runningProgram->temperatureHive;
+        segment.fanSpeed = SEGMENT_FAN_SPEED_PROGRAM;
+    }
+    segment.type = segmentSoak;
+    segment.parameter = duration;
+    segmentNumber = CFG_MAX_PROGRAM_SEGMENTS; // the extension is always the last segment
+    rampStart = segment.temperature;
     startTime = millis();
-    status.setSystemState(Status::ready);
-    status.setSystemState(Status::running);
-    sendEvent(startProgram, runningProgram);
+    Status *status = Status::getInstance();
+    status->setSystemState(Status::ready);
+    status->setSystemState(Status::running);
+    sendEvent(updateProgram, runningProgram); // it's the same treatment, not a new one
 }
 
 /**
- * When switching from pre-heat to running, we need to reset the start time. (to start with time running == 0)
+ * Add a program to the queue, it will be started automatically after the previous one completed.
  */
-void ProgramHandler::switchToRunning() {
-    startTime = millis();
-    status.setSystemState(Status::running);
+bool ProgramHandler::enqueue(uint8_t programNumber)
+{
+    if (queueLength >= CFG_PROGRAM_QUEUE_SIZE || !ProgramStore::getInstance()->exists(programNumber)) {
+        return false;
+    }
+    LOG_INFO(Logger::moduleSystem, F("queueing program #%d"), programNumber);
+    queue[queueLength].program = programNumber;
+    queue[queueLength].condition = queueImmediately;
+    queue[queueLength].parameter = 0;
+    queueLength++;
+    return true;
+}
+
+/**
+ * Define the condition to wait for before the last queued program is started.
+ */
+bool ProgramHandler::setQueueCondition(QueueCondition condition, uint16_t parameter)
+{
+    if (queueLength == 0) {
+        return false;
+    }
+    queue[queueLength - 1].condition = condition;
+    queue[queueLength - 1].parameter = parameter;
+    return true;
+}
+
+/**
+ * Remove all programs from the queue
+ */
+void ProgramHandler::clearQueue()
+{
+    queueLength = 0;
+}
+
+/**
+ * Returns the number of queued programs
+ */
+uint8_t ProgramHandler::getQueueLength()
+{
+    return queueLength;
+}
+
+/**
+ * Returns a queued program (0 = the next one to start, NULL if there's none)
+ */
+QueueItem *ProgramHandler::getQueueItem(uint8_t index)
+{
+    return (index < queueLength ? &queue[index] : NULL);
+}
+
+/**
+ * Start the next queued program once the previous one completed and its condition is met (called once per second).
+ */
+void ProgramHandler::processQueue(int16_t actualTemperature)
+{
+    Status *status = Status::getInstance();
+    if (queueLength == 0 || status->getSystemState() != Status::shutdown || stopReason != programCompleted) {
+        return;
+    }
+
+    QueueItem *item = &queue[0];
+    if (item->condition == queueDelay && millis() - finishTime < item->parameter * 60000UL) {
+        return;
+    }
+    if (item->condition == queueCooled && (actualTemperature == -999 || actualTemperature > (int16_t) item->parameter)) {
+        return;
+    }
+
+    uint8_t number = item->program;
+    queueLength--;
+    memmove(queue, queue + 1, queueLength * sizeof(QueueItem));
+    LOG_INFO(Logger::moduleSystem, F("starting queued program #%d"), number);
+    status->setSystemState(Status::ready);
+    start(number);
+}
+
+/**
+ * Check if the current segment is completed and advance to the next one (called once per second).
+ */
+void ProgramHandler::process(int16_t actualTemperature)
+{
+    if (runningProgram == NULL) {
+        return;
+    }
+    if (runningProgram->changed) {
+        refreshSegment();
+    }
+
+    bool sensorOk = (actualTemperature != -999);
+    uint32_t timeRemaining = calculateTimeRemaining();
+    bool timeout = (segment.parameter != 0 && timeRemaining == 0);
+    bool completed = true;
+
+    switch (segment.type) {
+    case segmentRamp:
+        completed = (getTargetTemperature() == segment.temperature);
+        break;
+    case segmentSoak:
+        if (isDoseControlled()) {
+            // end as soon as the coldest spot is treated, extend if it's not treated in time
+            uint16_t dose = ThermalDose::getInstance()->getMinimumDose();
+            if (dose >= runningProgram->dose) {
+                LOG_INFO(Logger::moduleSystem, F("thermal dose of %umin reached"), dose);
+                completed = true;
+            } else if (calculateTimeRunning() >= (uint32_t) segment.parameter * 60 * (100 + CFG_DOSE_MAX_EXTENSION) / 100) {
+                LOG_WARN(Logger::moduleSystem, F("thermal dose not reached (%umin)"), dose);
+                completed = true;
+            } else {
+                completed = false;
+            }
+        } else {
+            completed = (timeRemaining < 2);
+        }
+        break;
+    case segmentHold:
+        completed = timeout || (sensorOk && actualTemperature >= segment.temperature);
+        break;
+    case segmentCool:
+        completed = timeout || (sensorOk && actualTemperature <= segment.temperature);
+        break;
+    case segmentPreHeat:
+        completed = (timeRemaining == 0 || (sensorOk && actualTemperature >= segment.temperature && timeRemaining < calculateTimeRunning()));
+        break;
+    }
+    if (completed) {
+        nextSegment();
+    }
+}
+
+/**
+ * Advance to the next segment of the running program, finish the program after the last segment.
+ */
+void ProgramHandler::nextSegment()
+{
+    ProgramSegment next;
+    if (segmentNumber >= CFG_MAX_PROGRAM_SEGMENTS - 1 || !getSegment(segmentNumber + 1, &next)) {
+        LOG_INFO(Logger::moduleSystem, F("program finished."));
+        stop(programCompleted);
+        return;
+    }
+    startSegment(segmentNumber + 1, getTargetTemperature());
     sendEvent(updateProgram, runningProgram);
 }
 
 /**
- * Calculate the time the pre-heat or running phase is running (in seconds)
+ * Make a segment the current one and reset the time (so time running starts with 0). Once the program reaches
+ * a soak or cool-down segment, it is running (it never returns to pre-heat).
+ */
+void ProgramHandler::startSegment(uint8_t number, int16_t rampStart)
+{
+    Status *status = Status::getInstance();
+    getSegment(number, &segment);
+    segmentNumber = number;
+    this->rampStart = rampStart;
+    startTime = millis();
+    LOG_INFO(Logger::moduleSystem, F("segment %d: type %d, %d, %u"), number + 1, segment.type, segment.temperature, segment.parameter);
+    if ((segment.type == segmentSoak || segment.type == segmentCool) && status->getSystemState() == Status::preHeat) {
+        status->setSystemState(Status::running);
+    }
+}
+
+/**
+ * Take over the edited settings of the running program into the current segment. A classic program stays
+ * in its phase even if its pre-heat was added or removed, without pre-heat it continues with the soak segment.
+ */
+void ProgramHandler::refreshSegment()
+{
+    if (segmentNumber >= CFG_MAX_PROGRAM_SEGMENTS) {
+        return; // the extension of a finished program keeps its settings
+    }
+    if (program.segments[0].type == segmentEnd) {
+        uint8_t soakSegment = (program.durationPreHeat > 0 ? 1 : 0);
+        if (segment.type != segmentPreHeat) {
+            segmentNumber = soakSegment;
+        } else if (soakSegment == 0) {
+            startSegment(0, getTargetTemperature());
+            return;
+        }
+    }
+    ProgramSegment updated;
+    if (getSegment(segmentNumber, &updated)) {
+        segment = updated;
+    }
+}
+
+/**
+ * Get a segment of the loaded program. A program without segments consists of a pre-heat segment
+ * (if it has a pre-heat duration) followed by a soak segment with the program's temperature and duration.
+ */
+bool ProgramHandler::getSegment(uint8_t number, ProgramSegment *segment)
+{
+    if (program.segments[0].type != segmentEnd) {
+        if (number >= CFG_MAX_PROGRAM_SEGMENTS || program.segments[number].type == segmentEnd) {
+            return false;
+        }
+        *segment = program.segments[number];
+        return true;
+    }
+
+    memset(segment, 0, sizeof(ProgramSegment));
+    if (program.durationPreHeat > 0) {
+        if (number == 0) {
+            segment->type = segmentPreHeat;
+            segment->temperature = program.temperaturePreHeat;
+            segment->parameter = program.durationPreHeat;
+            segment->fanSpeed = SEGMENT_FAN_SPEED_PROGRAM;
+            return true;
+        }
+        number--;
+    }
+    if (number == 0) {
+        segment->type = segmentSoak;
+        segment->temperature = program.temperatureHive;
+        segment->parameter = program.duration;
+        segment->fanSpeed = SEGMENT_FAN_SPEED_PROGRAM;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Check if the current segment ends by thermal dose instead of time (soak segments of programs with a dose,
+ * except the extension of a finished program).
+ */
+bool ProgramHandler::isDoseControlled()
+{
+    return runningProgram != NULL && runningProgram->dose != 0 && segment.type == segmentSoak && segmentNumber < CFG_MAX_PROGRAM_SEGMENTS;
+}
+
+/**
+ * Returns the current segment of the running program
+ */
+ProgramSegment *ProgramHandler::getSegment()
+{
+    return &segment;
+}
+
+/**
+ * Returns the number of the current segment (0-based, CFG_MAX_PROGRAM_SEGMENTS if the program was extended)
+ */
+uint8_t ProgramHandler::getSegmentNumber()
+{
+    return segmentNumber;
+}
+
+/**
+ * Returns the target temperature at the start of the current segment (in 0.1 deg C)
+ */
+int16_t ProgramHandler::getRampStart()
+{
+    return rampStart;
+}
+
+/**
+ * Calculate the current target temperature of the hive (in 0.1 deg C). During a ramp, it moves from the
+ * previous target towards the segment's temperature at the given rate.
+ */
+int16_t ProgramHandler::getTargetTemperature()
+{
+    if (segment.type != segmentRamp || segment.parameter == 0) {
+        return segment.temperature;
+    }
+    int32_t delta = (int32_t) segment.parameter * calculateTimeRunning() / 60;
+    if (segment.temperature > rampStart) {
+        return min((int32_t) rampStart + delta, (int32_t) segment.temperature);
+    }
+    return max((int32_t) rampStart - delta, (int32_t) segment.temperature);
+}
+
+/**
+ * Calculate the time the current segment is running (in seconds)
  */
 uint32_t ProgramHandler::calculateTimeRunning()
 {
@@ -245,16 +531,27 @@ uint32_t ProgramHandler::calculateTimeRunning()
 }
 
 /**
- * Calculate the time the current program stage is running (in seconds).
+ * Calculate the time remaining in the current segment (in seconds). For ramps it's the time until the
+ * target temperature is reached, for hold and cool-down segments the time until the timeout.
  */
 uint32_t ProgramHandler::calculateTimeRemaining()
 {
-    if (runningProgram != NULL) {
-        uint32_t timeRunning = calculateTimeRunning();
-        uint32_t duration = (status.getSystemState() == Status::preHeat ? runningProgram->durationPreHeat : runningProgram->duration) * 60;
-        if (timeRunning < duration) { // prevent under-flow
-            return duration - timeRunning;
+    if (runningProgram == NULL) {
+        return 0;
+    }
+    if (segment.type == segmentRamp) {
+        if (segment.parameter == 0) {
+            return 0;
         }
+        return (uint32_t) abs(segment.temperature - getTargetTemperature()) * 60 / segment.parameter;
+    }
+    uint32_t timeRunning = calculateTimeRunning();
+    uint32_t duration = (uint32_t) segment.parameter * 60;
+    if (isDoseControlled() && timeRunning >= duration) {
+        duration = duration * (100 + CFG_DOSE_MAX_EXTENSION) / 100;
+    }
+    if (timeRunning < duration) { // prevent under-flow
+        return duration - timeRunning;
     }
     return 0;
 }
@@ -270,7 +567,7 @@ void ProgramHandler::attach(ProgramObserver *observer) {
  * Send an event to all attached/subscribed listeners
  */
 void ProgramHandler::sendEvent(ProgramEvent event, Program *program) {
-    Logger::debug(F("sending event %d to observers of ProgramHandler"), event);
+    LOG_DEBUG(Logger::moduleSystem, F("sending event %d to observers of ProgramHandler"), event);
     for (SimpleList<ProgramObserver *>::iterator itr = observers.begin(); itr != observers.end(); ++itr) {
         ((ProgramObserver *)*itr)->handleEvent(event, program);
     }
@@ -30,8 +30,35 @@
 #include <Arduino.h>
 #include "Logger.h"
 #include "SimpleList.h"
+#include "config.h"
 #include "Status.h"
 
+enum SegmentType
+{
+    segmentEnd = 0, // marks the end of the segment list
+    segmentRamp = 1, // move the target temperature to the segment's temperature at a given rate
+    segmentSoak = 2, // keep the temperature for the given duration
+    segmentHold = 3, // heat until the hive reaches the temperature
+    segmentCool = 4, // heaters off, blow with the fans until the hive is below the temperature
+    segmentPreHeat = 5 // heat until the temperature is reached and at least half of the time elapsed (classic pre-heat)
+};
+
+#define SEGMENT_FAN_SPEED_PROGRAM 255 // fan speed of a segment which takes the program's fan speed (of pre-heat in pre-heat segments)
+
+/*
+ * One step of a program. Settings which are 0 (the fan speed: SEGMENT_FAN_SPEED_PROGRAM) are taken from the program.
+ */
+class ProgramSegment
+{
+public:
+    uint8_t type; // SegmentType
+    uint8_t fanSpeed; // the fan speed of the plates (0-254)
+    int16_t temperature; // the target hive temperature (in 0.1 deg C)
+    uint16_t parameter; // ramp: rate (in 0.1 deg C per min), soak: duration (in min), others: timeout (in min, 0 = none)
+    uint8_t humidity; // the minimum relative humidity in % (the range of the program is kept)
+    uint8_t pidScale; // factor for the gains of the hive PID (in %)
+};
+
 class Program
 {
 public:
@@ -48,6 +75,8 @@ public:
     uint8_t fanSpeedHumidifier; // the fan speed of the humidifier fan (when active (0-255)
     uint8_t humidityMinimum; // the minimum relative humidity in %
     uint8_t humidityMaximum; // the maximum relative humidity in %
+    uint16_t dose; // thermal dose of the coldest hive sensor which ends soak segments (in min at CFG_DOSE_TEMPERATURE, 0 = by time)
+    ProgramSegment segments[CFG_MAX_PROGRAM_SEGMENTS]; // the steps of the program (if empty, pre-heat and duration are used)
 //TODO send an event instead of using the changed flag
     bool changed; // the program's values were changed indicating a required update
 };
@@ -61,10 +90,36 @@ enum ProgramEvent
     updateProgram
 };
 
+enum ProgramStopReason
+{
+    programAborted = 0, // stopped by the user
+    programCompleted = 1, // the program ran for its full duration
+    programOvertemp = 2, // stopped after recovering from an over-temperature
+    programFailed = 3 // the system went into error state
+};
+
+enum QueueCondition
+{
+    queueImmediately = 0, // start as soon as the previous program completed
+    queueDelay = 1, // wait a number of minutes after the previous program completed
+    queueCooled = 2 // wait until the hive is below a temperature
+};
+
+/*
+ * A program waiting in the queue to be started after the previous one completed.
+ */
+class QueueItem
+{
+public:
+    uint8_t program; // number of the program (1-based)
+    uint8_t condition; // QueueCondition
+    uint16_t parameter; // delay: time (in min), cooled: hive temperature (in 0.1 deg C)
+};
+
 class ProgramObserver
 {
 public:
-    virtual void handleEvent(ProgramEvent event, Program *program);
+    virtual void handleEvent(ProgramEvent event, Program *program) = 0;
 };
 
 class ProgramHandler
@@ -73,28 +128,59 @@ public:
     static ProgramHandler *getInstance();
     virtual ~ProgramHandler();
     void initPrograms();
-    SimpleList<Program> *getPrograms();
-    void start(uint8_t programNumber);
-    void stop();
+    bool load(uint8_t programNumber);
+    bool isActive();
+    Program *getProgram();
+    uint8_t getProgramNumber();
+    bool start(uint8_t programNumber);
+    void stop(ProgramStopReason reason = programAborted);
     void pause();
     void resume();
     void addTime(uint16_t seconds);
     Program *getRunningProgram();
+    uint8_t getRunningProgramNumber();
+    ProgramStopReason getStopReason();
     uint32_t calculateTimeRunning();
     uint32_t calculateTimeRemaining();
     void attach(ProgramObserver *observer);
-    void switchToRunning();
+    void process(int16_t actualTemperature);
+    void nextSegment();
+    ProgramSegment *getSegment();
+    uint8_t getSegmentNumber();
+    int16_t getRampStart();
+    int16_t getTargetTemperature();
+    bool restore(uint8_t programNumber, Status::SystemState state, uint8_t segmentNumber, uint32_t timeRunning, int16_t rampStart);
+    bool enqueue(uint8_t programNumber);
+    bool setQueueCondition(QueueCondition condition, uint16_t parameter);
+    void clearQueue();
+    uint8_t getQueueLength();
+    QueueItem *getQueueItem(uint8_t index);
+    void processQueue(int16_t actualTemperature);
 
 private:
+    friend class Sauna; // owns the instance
     ProgramHandler();
     ProgramHandler(ProgramHandler const&); // copy disabled
-    void operator=(ProgramHandler const&); // assigment disabled    SimpleList<Program> programs;
+    void operator=(ProgramHandler const&); // assigment disabled
     void sendEvent(ProgramEvent event, Program *program);
+    bool getSegment(uint8_t number, ProgramSegment *segment);
+    void startSegment(uint8_t number, int16_t rampStart);
+    void refreshSegment();
+    bool isDoseControlled();
 
+    Program program; // the loaded program, the only one kept in RAM
+    uint8_t programNumber; // the number of the loaded program (1-based, 0 = none)
     Program *runningProgram;
-    SimpleList<Program> programs;
+    uint8_t runningProgramNumber; // the number of the running program (1-based)
+    ProgramStopReason stopReason; // why the last program was stopped
     SimpleList<ProgramObserver *> observers;
-    uint32_t startTime; // timestamp when the program started (in millis)
+    uint32_t startTime; // timestamp when the current segment started (in millis)
+    ProgramSegment segment; // the current segment
+    uint8_t segmentNumber; // the number of the current segment (0-based)
+    int16_t rampStart; // the target temperature at the start of the segment (in 0.1 deg C)
+    QueueItem queue[CFG_PROGRAM_QUEUE_SIZE]; // the programs to run after the current one
+    uint8_t queueLength; // number of queued programs
+    uint32_t finishTime; // timestamp when the last program stopped (in millis)
 
 };
 
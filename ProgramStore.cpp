@@ -0,0 +1,238 @@
+/*
+ * ProgramStore.cpp
+ *
+ * Stores user defined programs in a table in the EEPROM. Program numbers
+ * without a valid entry in the table fall back to the built-in presets
+ * in flash, so deleting a modified preset restores the original.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "ProgramStore.h"
+#include "Sauna.h"
+#include "ProgramHandler.h"
+
+#define NUMBER_OF_PRESETS (sizeof(presets) / sizeof(ProgramRecord))
+
+/*
+ * The built-in programs
+ */
+static const ProgramRecord presets[] PROGMEM = {
+    // name, temperature pre-heat/hive/plate, hive Kp/Ki/Kd, plate Kp/Ki/Kd, duration pre-heat/program,
+    // fan speed pre-heat/program/humidifier, humidity min/max
+    { "Varroa Killer", 400, 410, 700, 400, 20, 700, 100, 10, 700, 60, 210, 250, 200, 240, 30, 35, 0, 0, { }, 0 },
+    { "Winter Treat", 400, 420, 750, 800, 20, 500, 400, 9, 5000, 60, 180, 255, 255, 240, 30, 35, 0, 0, { }, 0 },
+    { "Cleaning", 380, 425, 600, 800, 20, 500, 400, 9, 5000, 0, 15, 10, 10, 0, 1, 2, 0, 0, { }, 0 },
+    { "Melt Honey", 300, 300, 500, 800, 20, 500, 400, 9, 5000, 0, 720, 10, 10, 0, 1, 2, 0, 0, { }, 0 }
+};
+
+/**
+ * Constructor
+ */
+ProgramStore::ProgramStore()
+{
+    memset(&record, 0, sizeof(ProgramRecord));
+}
+
+/**
+ * Destructor
+ */
+ProgramStore::~ProgramStore()
+{
+}
+
+/**
+ * Return the instance of the current sauna
+ */
+ProgramStore *ProgramStore::getInstance()
+{
+    return &Sauna::getCurrent()->programStore;
+}
+
+/**
+ * Load a program (1-based number) from the EEPROM or the presets.
+ *
+ * \return false if the program doesn't exist
+ */
+bool ProgramStore::load(uint8_t number, Program *program)
+{
+    ProgramRecord stored;
+
+    if (!read(number, &stored)) {
+        return false;
+    }
+    memset(program, 0, sizeof(Program));
+    memcpy(program->name, stored.name, sizeof(stored.name));
+    program->temperaturePreHeat = stored.temperaturePreHeat;
+    program->temperatureHive = stored.temperatureHive;
+    program->temperaturePlate = stored.temperaturePlate;
+    program->hiveKp = stored.hiveKp / 100.0;
+    program->hiveKi = stored.hiveKi / 100.0;
+    program->hiveKd = stored.hiveKd / 100.0;
+    program->plateKp = stored.plateKp / 100.0;
+    program->plateKi = stored.plateKi / 100.0;
+    program->plateKd = stored.plateKd / 100.0;
+    program->durationPreHeat = stored.durationPreHeat;
+    program->duration = stored.duration;
+    program->fanSpeedPreHeat = stored.fanSpeedPreHeat;
+    program->fanSpeed = stored.fanSpeed;
+    program->fanSpeedHumidifier = stored.fanSpeedHumidifier;
+    program->humidityMinimum = stored.humidityMinimum;
+    program->humidityMaximum = stored.humidityMaximum;
+    program->dose = stored.dose;
+    memcpy(program->segments, stored.segments, sizeof(stored.segments));
+    for (uint8_t i = 0; i < CFG_MAX_PROGRAM_SEGMENTS; i++) {
+        if (program->segments[i].type == segmentEnd) {
+            program->segments[i].fanSpeed = SEGMENT_FAN_SPEED_PROGRAM; // a segment added on the console takes the program's fan speed
+        }
+    }
+    return true;
+}
+
+/**
+ * Queue a program for writing to the EEPROM table.
+ */
+bool ProgramStore::save(uint8_t number, Program *program)
+{
+    if (number < 1 || number > PROGRAM_STORE_NUMBER_OF_SLOTS) {
+        return false;
+    }
+
+    EepromWriter::flush(); // the previous record might not be written yet
+    memset(&record, 0, sizeof(ProgramRecord));
+    memcpy(record.name, program->name, sizeof(record.name));
+    record.temperaturePreHeat = program->temperaturePreHeat;
+    record.temperatureHive = program->temperatureHive;
+    record.temperaturePlate = program->temperaturePlate;
+    record.hiveKp = constrain(program->hiveKp * 100.0 + 0.5, 0, 0xffff);
+    record.hiveKi = constrain(program->hiveKi * 100.0 + 0.5, 0, 0xffff);
+    record.hiveKd = constrain(program->hiveKd * 100.0 + 0.5, 0, 0xffff);
+    record.plateKp = constrain(program->plateKp * 100.0 + 0.5, 0, 0xffff);
+    record.plateKi = constrain(program->plateKi * 100.0 + 0.5, 0, 0xffff);
+    record.plateKd = constrain(program->plateKd * 100.0 + 0.5, 0, 0xffff);
+    record.durationPreHeat = program->durationPreHeat;
+    record.duration = program->duration;
+    record.fanSpeedPreHeat = program->fanSpeedPreHeat;
+    record.fanSpeed = program->fanSpeed;
+    record.fanSpeedHumidifier = program->fanSpeedHumidifier;
+    record.humidityMinimum = program->humidityMinimum;
+    record.humidityMaximum = program->humidityMaximum;
+    record.dose = program->dose;
+    memcpy(record.segments, program->segments, sizeof(record.segments));
+    record.crc = calculateCrc(&record);
+
+    LOG_INFO(Logger::moduleSystem, F("saving program #%d"), number);
+    return EepromWriter::write(CONFIG_ADDRESS_PROGRAMS + (number - 1) * sizeof(ProgramRecord), &record, sizeof(ProgramRecord), false);
+}
+
+/**
+ * Invalidate the table entry of a program, presets fall back to their original values.
+ *
+ * \return false if there was no entry in the table
+ */
+bool ProgramStore::remove(uint8_t number)
+{
+    if (!isStored(number)) {
+        return false;
+    }
+
+    EepromWriter::flush();
+    memset(&record, 0, sizeof(ProgramRecord));
+    record.crc = ~calculateCrc(&record);
+
+    LOG_INFO(Logger::moduleSystem, F("deleting program #%d"), number);
+    return EepromWriter::write(CONFIG_ADDRESS_PROGRAMS + (number - 1) * sizeof(ProgramRecord), &record, sizeof(ProgramRecord), false);
+}
+
+/**
+ * Check if a program exists in the table or as preset.
+ */
+bool ProgramStore::exists(uint8_t number)
+{
+    return isStored(number) || (number >= 1 && number <= NUMBER_OF_PRESETS);
+}
+
+/**
+ * Check if a program has a valid entry in the EEPROM table.
+ */
+bool ProgramStore::isStored(uint8_t number)
+{
+    ProgramRecord stored;
+
+    if (number < 1 || number > PROGRAM_STORE_NUMBER_OF_SLOTS) {
+        return false;
+    }
+    EepromWriter::flush();
+    EEPROM.get(CONFIG_ADDRESS_PROGRAMS + (number - 1) * sizeof(ProgramRecord), stored);
+    return stored.crc == calculateCrc(&stored);
+}
+
+/**
+ * Get the name of a program (name must have space for 17 characters).
+ */
+bool ProgramStore::getName(uint8_t number, char *name)
+{
+    ProgramRecord stored;
+
+    if (!read(number, &stored)) {
+        return false;
+    }
+    memcpy(name, stored.name, sizeof(stored.name));
+    name[sizeof(stored.name)] = 0;
+    return true;
+}
+
+/**
+ * Get the number of the next existing program (wraps around, 0 = there are no programs).
+ */
+uint8_t ProgramStore::getNext(uint8_t number)
+{
+    for (uint8_t i = 1; i <= PROGRAM_STORE_NUMBER_OF_SLOTS; i++) {
+        uint8_t next = (number + i - 1) % PROGRAM_STORE_NUMBER_OF_SLOTS + 1;
+        if (exists(next)) {
+            return next;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Read a program from the EEPROM table or the presets.
+ */
+bool ProgramStore::read(uint8_t number, ProgramRecord *program)
+{
+    if (isStored(number)) {
+        EEPROM.get(CONFIG_ADDRESS_PROGRAMS + (number - 1) * sizeof(ProgramRecord), *program);
+        return true;
+    }
+    if (number >= 1 && number <= NUMBER_OF_PRESETS) {
+        memcpy_P(program, &presets[number - 1], sizeof(ProgramRecord));
+        return true;
+    }
+    return false;
+}
+
+uint16_t ProgramStore::calculateCrc(ProgramRecord *program)
+{
+    return Crc::calculate((uint8_t *) program, sizeof(ProgramRecord) - 2);
+}
@@ -0,0 +1,94 @@
+/*
+ * ProgramStore.h
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef PROGRAMSTORE_H_
+#define PROGRAMSTORE_H_
+
+#include "config.h"
+#include "Logger.h"
+#include "Crc.h"
+#include "EepromWriter.h"
+#include "ProgramHandler.h"
+#include <EEPROM.h>
+
+#define CONFIG_ADDRESS_PROGRAMS     3328
+#define CONFIG_SIZE_PROGRAMS        768
+
+/*
+ * The compact form of a program as it is stored in the EEPROM and in flash.
+ */
+class ProgramRecord
+{
+public:
+    char name[16]; // name to be displayed in menu (not terminated if all 16 characters are used)
+    int16_t temperaturePreHeat; // the target hive temperature during pre-heat (in 0.1 deg C)
+    int16_t temperatureHive; // the target hive temperature (in 0.1 deg C)
+    int16_t temperaturePlate; // the target temperature of the heater plates (in 0.1 deg C)
+    uint16_t hiveKp, hiveKi, hiveKd; // hive temperature PID configuration (multiplied by 100)
+    uint16_t plateKp, plateKi, plateKd; // plate temperature PID configuration (multiplied by 100)
+    uint16_t durationPreHeat; // the duration of the pre-heating cycle (in min)
+    uint16_t duration; // the duration of the program (in min)
+    uint8_t fanSpeedPreHeat; // the fan speed during pre-heat (0-255)
+    uint8_t fanSpeed; // the fan speed (0-255)
+    uint8_t fanSpeedHumidifier; // the fan speed of the humidifier fan (0-255)
+    uint8_t humidityMinimum; // the minimum relative humidity in %
+    uint8_t humidityMaximum; // the maximum relative humidity in %
+    uint8_t reserved; // keeps the following 16-bit fields aligned on the host
+    uint16_t dose; // thermal dose which ends soak segments (in min at CFG_DOSE_TEMPERATURE, 0 = by time)
+    ProgramSegment segments[CFG_MAX_PROGRAM_SEGMENTS]; // the steps of the program (empty for a classic program)
+    uint16_t crc; // lower 16 bits of the CRC of the bytes above
+    // 96 bytes used
+};
+
+static_assert(sizeof(ProgramRecord) == 96, "the program records must have the same layout on the board and the host");
+
+#define PROGRAM_STORE_NUMBER_OF_SLOTS (CONFIG_SIZE_PROGRAMS / sizeof(ProgramRecord))
+
+class ProgramStore
+{
+public:
+    static ProgramStore *getInstance();
+    virtual ~ProgramStore();
+    bool load(uint8_t number, Program *program);
+    bool save(uint8_t number, Program *program);
+    bool remove(uint8_t number);
+    bool exists(uint8_t number);
+    bool isStored(uint8_t number);
+    bool getName(uint8_t number, char *name);
+    uint8_t getNext(uint8_t number);
+
+private:
+    friend class Sauna; // owns the instance
+    ProgramStore();
+    ProgramStore(ProgramStore const&); // copy disabled
+    void operator=(ProgramStore const&); // assigment disabled
+    bool read(uint8_t number, ProgramRecord *program);
+    uint16_t calculateCrc(ProgramRecord *program);
+
+    ProgramRecord record; // the last saved program (must stay valid until written)
+};
+
+#endif /* PROGRAMSTORE_H_ */
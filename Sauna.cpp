@@ -0,0 +1,66 @@
+/*
+ * Sauna.cpp
+ *
+ * The context of one sauna, see Sauna.h.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "Sauna.h"
+
+#ifdef CFG_MULTIPLE_SAUNAS
+thread_local Sauna *Sauna::current = NULL;
+#endif
+
+/**
+ * Constructor. Modules which access other modules must not do this before initialize().
+ */
+Sauna::Sauna()
+{
+    activeHeaters = 0;
+    oneWire = NULL;
+}
+
+Sauna::~Sauna()
+{
+#ifdef CFG_MULTIPLE_SAUNAS
+    if (current == this) {
+        current = NULL;
+    }
+#endif
+    if (oneWire) {
+        delete oneWire;
+        oneWire = NULL;
+    }
+}
+
+#ifdef CFG_MULTIPLE_SAUNAS
+/**
+ * Make this the sauna which is processed by the current thread: all calls of getInstance(),
+ * Configuration::getParams() etc. refer to it until another one is selected.
+ */
+void Sauna::select()
+{
+    current = this;
+}
+#endif
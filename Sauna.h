@@ -0,0 +1,98 @@
+/*
+ * Sauna.h
+ *
+ * The context of one sauna: its configuration, status, programs, statistics
+ * and the controller with its devices. The modules access their sauna through
+ * Sauna::getCurrent() (wrapped by their getInstance() methods). The board runs
+ * a single sauna which is constructed on first use, host simulations create
+ * as many as they need and select the one to be processed.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SAUNA_H_
+#define SAUNA_H_
+
+#include "config.h"
+#include "Status.h"
+#include "Configuration.h"
+#include "Statistics.h"
+#include "ProgramStore.h"
+#include "ProgramHandler.h"
+#include "ThermalDose.h"
+#include "History.h"
+#include "Checkpoint.h"
+#include "Telemetry.h"
+#include "Controller.h"
+#include <OneWire.h>
+
+class Sauna
+{
+public:
+    Sauna();
+    virtual ~Sauna();
+    static inline Sauna *getCurrent();
+#ifdef CFG_MULTIPLE_SAUNAS
+    void select();
+#endif
+
+    Status status;
+    Configuration configuration;
+    Statistics statistics;
+    ProgramStore programStore;
+    ProgramHandler programHandler;
+    ThermalDose thermalDose;
+    History history;
+    Checkpoint checkpoint;
+    Telemetry telemetry;
+    Controller controller;
+    uint8_t activeHeaters; // the number of heaters which are active in non-PWM mode
+    OneWire *oneWire; // the bus of the temperature sensors, created by the first sensor
+
+private:
+    Sauna(Sauna const&); // copy disabled
+    void operator=(Sauna const&); // assigment disabled
+#ifdef CFG_MULTIPLE_SAUNAS
+    static thread_local Sauna *current; // the selected sauna
+#endif
+};
+
+/**
+ * Return the sauna which is being processed. On the board this is the only one, the address
+ * is resolved when linking - there is no overhead compared to individual singletons.
+ */
+Sauna *Sauna::getCurrent()
+{
+#ifdef CFG_MULTIPLE_SAUNAS
+    if (current == NULL) {
+        static thread_local Sauna sauna; // the default for code which doesn't select a sauna
+        current = &sauna;
+    }
+    return current;
+#else
+    static Sauna sauna; // constructed on first use, i.e. in setup() after the hardware is initialized
+    return &sauna;
+#endif
+}
+
+#endif /* SAUNA_H_ */
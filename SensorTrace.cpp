@@ -0,0 +1,348 @@
+/*
+ * SensorTrace.cpp
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "SensorTrace.h"
+#include "ButtonInput.h"
+#include "TelemetryFormat.h"
+#include "Statistics.h"
+#include "History.h"
+#include "Checkpoint.h"
+#include "ProgramStore.h"
+#include <OneWire.h>
+
+CFG_INSTANCE_LOCAL bool SensorTrace::recording = false;
+CFG_INSTANCE_LOCAL uint8_t SensorTrace::frame[CFG_SENSOR_TRACE_FRAME_SIZE];
+CFG_INSTANCE_LOCAL uint8_t SensorTrace::length = SENSOR_TRACE_HEADER_SIZE;
+CFG_INSTANCE_LOCAL uint8_t SensorTrace::sequence = 0;
+CFG_INSTANCE_LOCAL uint8_t SensorTrace::consoleRecord = 0;
+CFG_INSTANCE_LOCAL uint8_t SensorTrace::cyclesSinceFlush = 0;
+CFG_INSTANCE_LOCAL uint32_t SensorTrace::lastTime = 0;
+CFG_INSTANCE_LOCAL uint8_t SensorTrace::numberOfSensors = 0;
+CFG_INSTANCE_LOCAL uint8_t SensorTrace::sensorAddress[SENSOR_TRACE_MAX_SENSORS][8];
+CFG_INSTANCE_LOCAL uint8_t SensorTrace::lastScratchpad[SENSOR_TRACE_MAX_SENSORS][9];
+CFG_INSTANCE_LOCAL uint8_t SensorTrace::outputs[traceFixedOutputs + 2 * CFG_MAX_NUMBER_PLATES];
+CFG_INSTANCE_LOCAL uint8_t SensorTrace::numberOfOutputs = 0;
+
+/**
+ * Start recording, must be called before the controller is initialized. The trace starts
+ * with the layout and the content of the EEPROM (configuration, programs, checkpoint), so a
+ * replay starts from the same state.
+ */
+void SensorTrace::start()
+{
+    recording = true;
+    length = SENSOR_TRACE_HEADER_SIZE;
+    sequence = 0;
+    consoleRecord = 0;
+    cyclesSinceFlush = 0;
+    lastTime = 0;
+    numberOfSensors = 0;
+    numberOfOutputs = 0;
+
+    uint8_t layout[SENSOR_TRACE_LAYOUT_SIZE];
+    getLayout(layout);
+    beginRecord(traceStart, sizeof(layout));
+    put(layout, sizeof(layout));
+
+    uint8_t chunk[SENSOR_TRACE_EEPROM_CHUNK];
+    for (uint16_t address = 0; address < EEPROM.length(); address += SENSOR_TRACE_EEPROM_CHUNK) {
+        bool erased = true;
+        for (uint8_t i = 0; i < SENSOR_TRACE_EEPROM_CHUNK; i++) {
+            chunk[i] = EEPROM.read(address + i);
+            erased &= (chunk[i] == 0xff);
+        }
+        if (!erased) {
+            uint8_t header[] = { (uint8_t) (address & 0xff), (uint8_t) (address >> 8), SENSOR_TRACE_EEPROM_CHUNK };
+            beginRecord(traceEeprom, sizeof(header) + SENSOR_TRACE_EEPROM_CHUNK);
+            put(header, sizeof(header));
+            put(chunk, SENSOR_TRACE_EEPROM_CHUNK);
+        }
+    }
+    flush();
+}
+
+/**
+ * Send the rest of the recorded data and stop recording.
+ */
+void SensorTrace::stop()
+{
+    flush();
+    recording = false;
+}
+
+bool SensorTrace::isRecording()
+{
+    return recording;
+}
+
+/**
+ * Record a temperature sensor found by the search, only sensors recorded here can be read.
+ */
+void SensorTrace::sensorFound(const uint8_t address[8])
+{
+    if (!recording || numberOfSensors >= SENSOR_TRACE_MAX_SENSORS) {
+        return;
+    }
+    for (uint8_t i = 0; i < numberOfSensors; i++) {
+        if (memcmp(sensorAddress[i], address, 8) == 0) {
+            return; // the search runs whenever the controller is initialized
+        }
+    }
+    memcpy(sensorAddress[numberOfSensors], address, 8);
+    memset(lastScratchpad[numberOfSensors], 0, 9); // never matches a real scratchpad, the configuration register has reserved bits set
+    numberOfSensors++;
+
+    beginRecord(traceSensorFound, 8);
+    put(address, 8);
+}
+
+/**
+ * Record the scratchpad read from a temperature sensor. If only the temperature changed since the
+ * last read (and both reads are valid), only the temperature is recorded.
+ */
+void SensorTrace::scratchpad(const uint8_t address[8], const uint8_t data[9])
+{
+    uint8_t sensor = 0;
+    while (sensor < numberOfSensors && memcmp(sensorAddress[sensor], address, 8) != 0) {
+        sensor++;
+    }
+    if (!recording || sensor == numberOfSensors) {
+        return;
+    }
+
+    uint8_t *last = lastScratchpad[sensor];
+    if (OneWire::crc8(data, 8) == data[8] && OneWire::crc8(last, 8) == last[8] && memcmp(data + 2, last + 2, 6) == 0) {
+        beginRecord(traceTemperature, 3);
+        put(&sensor, 1);
+        put(data, 2);
+    } else {
+        beginRecord(traceScratchpad, 10);
+        put(&sensor, 1);
+        put(data, 9);
+    }
+    memcpy(last, data, 9);
+}
+
+/**
+ * Record the relative humidity read from the humidity sensor (in %).
+ */
+void SensorTrace::humidity(float humidity)
+{
+    uint8_t data[4];
+    if (beginRecord(traceHumidity, sizeof(data))) {
+        put(data, sensorTracePutFloat(data, humidity));
+    }
+}
+
+/**
+ * Record the temperature read from the humidity sensor (in deg C).
+ */
+void SensorTrace::humidityTemperature(float temperature)
+{
+    uint8_t data[4];
+    if (beginRecord(traceHumidityTemperature, sizeof(data))) {
+        put(data, sensorTracePutFloat(data, temperature));
+    }
+}
+
+/**
+ * Record a button event which was taken from the queue.
+ */
+void SensorTrace::button(const ButtonEvent &event)
+{
+    uint8_t data[7];
+    uint8_t size = 0;
+
+    data[size++] = event.type;
+    data[size++] = event.buttons;
+    size += sensorTracePutVarint(data + size, millis() - event.time);
+    if (beginRecord(traceButton, size)) {
+        put(data, size);
+    }
+}
+
+/**
+ * Record a character received by the serial console. Consecutive characters are combined into one record.
+ */
+void SensorTrace::console(char character)
+{
+    if (!recording) {
+        return;
+    }
+    if (consoleRecord == 0 || frame[consoleRecord] == 0xff || length + 1 + SENSOR_TRACE_CRC_SIZE > CFG_SENSOR_TRACE_FRAME_SIZE) {
+        beginRecord(traceConsole, 2);
+        consoleRecord = length;
+        frame[length++] = 0;
+    }
+    frame[length++] = character;
+    frame[consoleRecord]++;
+}
+
+/**
+ * Mark the start of a loop cycle, all inputs up to the next cycle were read in this cycle.
+ */
+void SensorTrace::startCycle()
+{
+    beginRecord(traceCycle, 0);
+}
+
+/**
+ * Record the outputs which changed during the cycle and send the recorded data once in a while.
+ */
+void SensorTrace::endCycle()
+{
+    if (!recording) {
+        return;
+    }
+
+    uint8_t values[sizeof(outputs)];
+    uint8_t changed[(sizeof(outputs) + 7) / 8];
+    uint8_t count = getOutputs(values);
+    bool anyChanged = false;
+
+    memset(changed, 0, sizeof(changed));
+    for (uint8_t i = 0; i < count; i++) {
+        if (count != numberOfOutputs || values[i] != outputs[i]) {
+            changed[i / 8] |= 1 << (i % 8);
+            anyChanged = true;
+        }
+    }
+    if (anyChanged) {
+        beginRecord(traceOutputs, 1 + (count + 7) / 8 + count);
+        put(&count, 1);
+        put(changed, (count + 7) / 8);
+        for (uint8_t i = 0; i < count; i++) {
+            if (changed[i / 8] & (1 << (i % 8))) {
+                put(values + i, 1);
+            }
+        }
+        memcpy(outputs, values, count);
+        numberOfOutputs = count;
+    }
+
+    if (++cyclesSinceFlush >= CFG_SENSOR_TRACE_INTERVAL || length > CFG_SENSOR_TRACE_FRAME_SIZE / 2) {
+        flush();
+    }
+}
+
+/**
+ * Get the current outputs of the controller (see SensorTraceOutput), returns the number of outputs.
+ */
+uint8_t SensorTrace::getOutputs(uint8_t *values)
+{
+    Status *status = Status::getInstance();
+    uint8_t plates = min(Configuration::getParams()->numberOfPlates, CFG_MAX_NUMBER_PLATES);
+
+    values[traceOutputState] = status->getSystemState();
+    values[traceOutputRelay] = digitalRead(Configuration::getIO()->heaterRelay);
+    values[traceOutputVaporizer] = status->vaporizerEnabled;
+    values[traceOutputHumidifierFan] = status->fanSpeedHumidifier;
+    for (uint8_t i = 0; i < plates; i++) {
+        values[traceFixedOutputs + 2 * i] = status->powerPlate[i];
+        values[traceFixedOutputs + 2 * i + 1] = status->fanSpeedPlate[i];
+    }
+    return sensorTraceOutputs(plates);
+}
+
+/**
+ * Get the layout of the EEPROM content (see SensorTraceLayout), fills SENSOR_TRACE_LAYOUT_SIZE bytes.
+ */
+void SensorTrace::getLayout(uint8_t *payload)
+{
+    uint16_t layout[traceLayoutValues];
+
+    layout[traceLayoutConfigVersion] = CONFIG_VERSION;
+    layout[traceLayoutStatisticsVersion] = STATISTICS_VERSION;
+    layout[traceLayoutParams] = sizeof(ConfigurationParams);
+    layout[traceLayoutIO] = sizeof(ConfigurationIO);
+    layout[traceLayoutSensor] = sizeof(ConfigurationSensor);
+    layout[traceLayoutStatistics] = sizeof(StatisticValues);
+    layout[traceLayoutHistory] = sizeof(HistoryRecord);
+    layout[traceLayoutCheckpoint] = sizeof(CheckpointRecord);
+    layout[traceLayoutProgram] = sizeof(ProgramRecord);
+    for (uint8_t i = 0; i < traceLayoutValues; i++) {
+        payload[2 * i] = layout[i] & 0xff;
+        payload[2 * i + 1] = layout[i] >> 8;
+    }
+}
+
+/**
+ * Add the type and time of a record to the frame, the frame is sent first if the record doesn't fit.
+ * Returns false if no trace is being recorded.
+ */
+bool SensorTrace::beginRecord(uint8_t type, uint8_t payloadLength)
+{
+    if (!recording) {
+        return false;
+    }
+    if (length + 6 + payloadLength + SENSOR_TRACE_CRC_SIZE > CFG_SENSOR_TRACE_FRAME_SIZE) {
+        flush();
+    }
+
+    uint32_t now = millis();
+    frame[length++] = type;
+    length += sensorTracePutVarint(frame + length, now - lastTime);
+    lastTime = now;
+    consoleRecord = 0;
+    return true;
+}
+
+void SensorTrace::put(const uint8_t *data, uint8_t size)
+{
+    memcpy(frame + length, data, size);
+    length += size;
+}
+
+/**
+ * Complete the frame with the header and CRC and queue it for output (COBS encoded and delimited by 0x00
+ * like the telemetry). Rather than losing a part of the trace, wait until the output buffer has room.
+ */
+void SensorTrace::flush()
+{
+    if (length <= SENSOR_TRACE_HEADER_SIZE) {
+        return;
+    }
+    frame[0] = SENSOR_TRACE_MAGIC;
+    frame[1] = SENSOR_TRACE_VERSION;
+    frame[2] = sequence++;
+    uint32_t crc = Crc::calculate(frame, length);
+    for (uint8_t i = 0; i < SENSOR_TRACE_CRC_SIZE; i++) {
+        frame[length++] = crc >> (8 * i);
+    }
+
+    uint8_t encoded[CFG_SENSOR_TRACE_FRAME_SIZE + CFG_SENSOR_TRACE_FRAME_SIZE / 254 + 3];
+    encoded[0] = 0;
+    uint16_t encodedLength = telemetryCobsEncode(frame, length, encoded + 1) + 1;
+    encoded[encodedLength++] = 0;
+    if (SerialBuffer::getFree(SerialBuffer::low) < encodedLength) {
+        SerialBuffer::flush();
+    }
+    SerialBuffer::write(SerialBuffer::low, encoded, encodedLength);
+
+    length = SENSOR_TRACE_HEADER_SIZE;
+    consoleRecord = 0;
+    cyclesSinceFlush = 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * SensorTrace.h
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SENSORTRACE_H_
+#define SENSORTRACE_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "SensorTraceFormat.h"
+#include "SerialBuffer.h"
+#include "Configuration.h"
+#include "Status.h"
+#include "Crc.h"
+
+#define SENSOR_TRACE_MAX_SENSORS    (2 * CFG_MAX_NUMBER_PLATES) // number of temperature sensors which can be recorded
+
+/*
+ * The calls to the recorder are only compiled into the firmware with CFG_SENSOR_TRACE, e.g.
+ * SENSOR_TRACE(humidity(value));
+ */
+#ifdef CFG_SENSOR_TRACE
+#define SENSOR_TRACE(call) SensorTrace::call
+#else
+#define SENSOR_TRACE(call)
+#endif
+
+class ButtonEvent;
+
+/*
+ * Records the inputs of the controller together with the outputs of every loop cycle and
+ * sends them as binary frames to the serial port (see SensorTraceFormat.h). The frames are
+ * never dropped, if the output buffer is full, the recorder waits until they fit.
+ */
+class SensorTrace
+{
+public:
+    static void start();
+    static void stop();
+    static bool isRecording();
+    static void sensorFound(const uint8_t address[8]);
+    static void scratchpad(const uint8_t address[8], const uint8_t data[9]);
+    static void humidity(float humidity);
+    static void humidityTemperature(float temperature);
+    static void button(const ButtonEvent &event);
+    static void console(char character);
+    static void startCycle();
+    static void endCycle();
+    static uint8_t getOutputs(uint8_t *values);
+    static void getLayout(uint8_t *payload);
+
+private:
+    static bool beginRecord(uint8_t type, uint8_t payloadLength);
+    static void put(const uint8_t *data, uint8_t length);
+    static void flush();
+
+    static CFG_INSTANCE_LOCAL bool recording;
+    static CFG_INSTANCE_LOCAL uint8_t frame[CFG_SENSOR_TRACE_FRAME_SIZE]; // the raw frame which is being filled
+    static CFG_INSTANCE_LOCAL uint8_t length; // bytes used in the frame
+    static CFG_INSTANCE_LOCAL uint8_t sequence;
+    static CFG_INSTANCE_LOCAL uint8_t consoleRecord; // position of the length of the last record if it's console input, 0 = none
+    static CFG_INSTANCE_LOCAL uint8_t cyclesSinceFlush;
+    static CFG_INSTANCE_LOCAL uint32_t lastTime; // time of the previous record (in millis)
+    static CFG_INSTANCE_LOCAL uint8_t numberOfSensors;
+    static CFG_INSTANCE_LOCAL uint8_t sensorAddress[SENSOR_TRACE_MAX_SENSORS][8];
+    static CFG_INSTANCE_LOCAL uint8_t lastScratchpad[SENSOR_TRACE_MAX_SENSORS][9]; // the previous read of each sensor (to record only the temperature)
+    static CFG_INSTANCE_LOCAL uint8_t outputs[traceFixedOutputs + 2 * CFG_MAX_NUMBER_PLATES]; // the outputs at the end of the previous cycle
+    static CFG_INSTANCE_LOCAL uint8_t numberOfOutputs;
+};
+
+#endif /* SENSORTRACE_H_ */
@@ -0,0 +1,226 @@
+/*
+ * SensorTraceFormat.h
+ *
+ * Definition of the binary sensor traces. This file is shared between the
+ * firmware and the host tools, so it must only depend on standard headers.
+ *
+ * A trace records every input of the controller (temperature sensors, humidity
+ * sensor, buttons and console) together with the outputs at the end of each
+ * loop cycle, so a run can be replayed on the host (see tools/TraceReplay.cpp).
+ * The frames are sent on the serial port like the telemetry frames: COBS encoded
+ * and delimited by 0x00 on both sides (see TelemetryFormat.h).
+ *
+ * Frame layout (before COBS encoding, little endian):
+ *   magic (1 byte, SENSOR_TRACE_MAGIC), version (1 byte), sequence (1 byte),
+ *   records,
+ *   CRC32 of all preceding bytes (4 bytes, see Crc::calculate()).
+ *
+ * Record layout:
+ *   type (1 byte, SensorTraceRecord),
+ *   time since the previous record (unsigned varint, in ms),
+ *   payload (see SensorTraceRecord).
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SENSORTRACEFORMAT_H_
+#define SENSORTRACEFORMAT_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define SENSOR_TRACE_MAGIC          0xa5 // distinguishes trace frames from telemetry frames
+#define SENSOR_TRACE_VERSION        2
+#define SENSOR_TRACE_HEADER_SIZE    3
+#define SENSOR_TRACE_CRC_SIZE       4
+#define SENSOR_TRACE_EEPROM_CHUNK   64 // maximum number of bytes in a traceEeprom record
+
+enum SensorTraceRecord
+{
+    traceStart = 0, // the recording started (the time is the time since power-up): layout of the EEPROM (see SensorTraceLayout)
+    traceEeprom = 1, // content of the EEPROM at the start, erased blocks are skipped: address (2 bytes), length (1 byte), data
+    traceSensorFound = 2, // the search found a temperature sensor: address (8 bytes), the sensors are numbered in the order they're found
+    traceScratchpad = 3, // a temperature sensor was read: sensor number (1 byte), scratchpad (9 bytes)
+    traceTemperature = 4, // like traceScratchpad if only the temperature changed: sensor number (1 byte), temperature (2 bytes), the CRC is re-calculated
+    traceHumidity = 5, // the humidity sensor was read: relative humidity (float, 4 bytes, NAN = no response)
+    traceHumidityTemperature = 6, // the temperature of the humidity sensor was read: in deg C (float, 4 bytes)
+    traceButton = 7, // a button event was read: type (1 byte), buttons (1 byte), age of the event (varint, in ms)
+    traceConsole = 8, // input from the serial console: length (1 byte), characters
+    traceCycle = 9, // start of a loop cycle, no payload
+    traceOutputs = 10 // the outputs changed during the cycle: number of outputs (1 byte), bitmask of the changed outputs, one byte per changed output
+};
+
+/*
+ * The layout of the EEPROM content as the recording board stores it, in the payload of traceStart
+ * (2 bytes each). A trace is only replayed if the host stores the blocks the same way.
+ */
+enum SensorTraceLayout
+{
+    traceLayoutConfigVersion = 0, // CONFIG_VERSION
+    traceLayoutStatisticsVersion = 1, // STATISTICS_VERSION
+    traceLayoutParams = 2, // sizeof(ConfigurationParams)
+    traceLayoutIO = 3, // sizeof(ConfigurationIO)
+    traceLayoutSensor = 4, // sizeof(ConfigurationSensor)
+    traceLayoutStatistics = 5, // sizeof(StatisticValues)
+    traceLayoutHistory = 6, // sizeof(HistoryRecord)
+    traceLayoutCheckpoint = 7, // sizeof(CheckpointRecord)
+    traceLayoutProgram = 8, // sizeof(ProgramRecord)
+    traceLayoutValues = 9
+};
+
+#define SENSOR_TRACE_LAYOUT_SIZE    (2 * traceLayoutValues) // size of the payload of traceStart
+
+/*
+ * The outputs with a fixed position, they are followed by the power and the fan speed of each plate.
+ */
+enum SensorTraceOutput
+{
+    traceOutputState = 0, // Status::SystemState
+    traceOutputRelay = 1, // main heater relay on (1) or off (0)
+    traceOutputVaporizer = 2, // vaporizer on (1) or off (0)
+    traceOutputHumidifierFan = 3, // speed of the humidifier fan (0-255)
+    traceFixedOutputs = 4
+};
+
+/*
+ * Return the number of outputs of a sauna.
+ */
+inline uint8_t sensorTraceOutputs(uint8_t plates)
+{
+    return traceFixedOutputs + 2 * plates;
+}
+
+/*
+ * Write an unsigned varint, returns the number of bytes written (1-5).
+ */
+inline uint8_t sensorTracePutVarint(uint8_t *buffer, uint32_t value)
+{
+    uint8_t length = 0;
+
+    while (value >= 0x80) {
+        buffer[length++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    buffer[length++] = value;
+    return length;
+}
+
+/*
+ * Read an unsigned varint, returns the number of bytes consumed or 0 if the data is invalid.
+ */
+inline uint8_t sensorTraceGetVarint(const uint8_t *buffer, uint32_t available, uint32_t *value)
+{
+    uint32_t result = 0;
+
+    for (uint8_t i = 0; i < 5 && i < available; i++) {
+        result |= (uint32_t) (buffer[i] & 0x7f) << (7 * i);
+        if ((buffer[i] & 0x80) == 0) {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Write a float (IEEE 754 single precision, like on the AVR), returns the number of bytes written.
+ */
+inline uint8_t sensorTracePutFloat(uint8_t *buffer, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (uint8_t i = 0; i < 4; i++) {
+        buffer[i] = bits >> (8 * i);
+    }
+    return 4;
+}
+
+inline float sensorTraceGetFloat(const uint8_t *buffer)
+{
+    uint32_t bits = 0;
+    float value;
+    for (uint8_t i = 0; i < 4; i++) {
+        bits |= (uint32_t) buffer[i] << (8 * i);
+    }
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/*
+ * Return the size of a record's payload (see SensorTraceRecord) or -1 if the record is invalid or incomplete.
+ */
+inline int16_t sensorTracePayloadSize(uint8_t type, const uint8_t *payload, uint16_t available)
+{
+    uint32_t value;
+    int16_t size;
+
+    switch (type) {
+    case traceStart:
+        size = SENSOR_TRACE_LAYOUT_SIZE;
+        break;
+    case traceCycle:
+        size = 0;
+        break;
+    case traceEeprom:
+        size = (available < 3 ? -1 : 3 + payload[2]);
+        break;
+    case traceSensorFound:
+        size = 8;
+        break;
+    case traceScratchpad:
+        size = 10;
+        break;
+    case traceTemperature:
+        size = 3;
+        break;
+    case traceHumidity:
+    case traceHumidityTemperature:
+        size = 4;
+        break;
+    case traceButton:
+        if (available < 3 || (size = sensorTraceGetVarint(payload + 2, available - 2, &value)) == 0) {
+            return -1;
+        }
+        size += 2;
+        break;
+    case traceConsole:
+        size = (available < 1 ? -1 : 1 + payload[0]);
+        break;
+    case traceOutputs:
+        if (available < 1 || available < 1 + (payload[0] + 7) / 8) {
+            return -1;
+        }
+        size = 1 + (payload[0] + 7) / 8;
+        for (uint8_t i = 0; i < payload[0]; i++) {
+            if (payload[1 + i / 8] & (1 << (i % 8))) {
+                size++;
+            }
+        }
+        break;
+    default:
+        return -1;
+    }
+    return (size > (int16_t) available ? -1 : size);
+}
+
+#endif /* SENSORTRACEFORMAT_H_ */
@@ -0,0 +1,188 @@
+/*
+ * SerialBuffer.cpp
+ *
+ * Non-blocking output buffer for the serial port.
+ *
+ * Serial.print() blocks as soon as the 64 byte transmit buffer of the
+ * HardwareSerial is full, which stalls the control loop while a menu or the
+ * periodic data log is sent. All output is therefore queued in two ring
+ * buffers (one for console output/warnings/errors and one for debug/info
+ * messages) and handed over to the HardwareSerial only as far as its transmit
+ * buffer has free space. The HardwareSerial's TX-empty interrupt then sends
+ * the data in the background.
+ *
+ * Messages are queued as a whole or dropped (and counted) if they don't fit,
+ * high priority messages are sent first but never in the middle of a low
+ * priority message (the buffers are switched only between two messages, so
+ * a high priority message waits for at most one low priority message).
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "SerialBuffer.h"
+
+CFG_INSTANCE_LOCAL uint8_t SerialBuffer::dataLow[CFG_SERIAL_TX_BUFFER_SIZE_LOW];
+CFG_INSTANCE_LOCAL uint8_t SerialBuffer::dataHigh[CFG_SERIAL_TX_BUFFER_SIZE_HIGH];
+CFG_INSTANCE_LOCAL SerialBuffer::Ring SerialBuffer::rings[2] = { { dataLow, CFG_SERIAL_TX_BUFFER_SIZE_LOW, 0, 0, 0 }, { dataHigh, CFG_SERIAL_TX_BUFFER_SIZE_HIGH,
+        0, 0, 0 } };
+CFG_INSTANCE_LOCAL SerialBuffer::Ring *SerialBuffer::active = NULL;
+CFG_INSTANCE_LOCAL uint16_t SerialBuffer::activeRemaining = 0;
+
+/**
+ * Queue a line of text, a line-feed is appended.
+ *
+ * \return false if the line was dropped because the buffer is full
+ */
+bool SerialBuffer::write(Priority priority, const char *line)
+{
+    return append(rings[priority], (const uint8_t *) line, strlen(line), true);
+}
+
+/**
+ * Queue a block of binary data (e.g. a complete frame), it is sent as a whole or dropped.
+ *
+ * \return false if the data was dropped because the buffer is full
+ */
+bool SerialBuffer::write(Priority priority, const uint8_t *data, uint16_t length)
+{
+    return append(rings[priority], data, length, false);
+}
+
+/**
+ * Copy a message into a ring buffer, preceded by its length. The message is only added if it fits completely.
+ */
+bool SerialBuffer::append(Ring &ring, const uint8_t *data, uint16_t length, bool endOfLine)
+{
+    uint16_t total = length + (endOfLine ? 2 : 0);
+    if (total == 0) {
+        return true;
+    }
+    if (total + SERIAL_BUFFER_LENGTH_SIZE >= ring.size - used(ring)) { // one byte always stays empty to distinguish full from empty
+        ring.dropped++;
+        return false;
+    }
+
+    put(ring, total & 0xff);
+    put(ring, total >> 8);
+    for (uint16_t i = 0; i < total; i++) {
+        put(ring, (i < length ? data[i] : (i == length ? '\r' : '\n')));
+    }
+    return true;
+}
+
+void SerialBuffer::put(Ring &ring, uint8_t value)
+{
+    ring.data[ring.head] = value;
+    ring.head = (ring.head + 1 == ring.size ? 0 : ring.head + 1);
+}
+
+uint8_t SerialBuffer::get(Ring &ring)
+{
+    uint8_t value = ring.data[ring.tail];
+    ring.tail = (ring.tail + 1 == ring.size ? 0 : ring.tail + 1);
+    return value;
+}
+
+/**
+ * Hand over as many queued bytes to the HardwareSerial as fit into its
+ * transmit buffer without blocking. The priority is re-evaluated after
+ * every message.
+ */
+void SerialBuffer::drain()
+{
+    int space = Serial.availableForWrite();
+
+    while (space > 0) {
+        if (active == NULL) { // between two messages: high priority first
+            if (rings[high].head != rings[high].tail) {
+                active = &rings[high];
+            } else if (rings[low].head != rings[low].tail) {
+                active = &rings[low];
+            } else {
+                return;
+            }
+            activeRemaining = get(*active);
+            activeRemaining |= get(*active) << 8;
+        }
+
+        Serial.write(get(*active));
+        space--;
+
+        if (--activeRemaining == 0) {
+            active = NULL;
+        }
+    }
+}
+
+/**
+ * Keep on draining the buffers until the specified time (in millis) is reached.
+ * This is used in the main loop instead of delay() to send data in the idle time.
+ */
+void SerialBuffer::drainUntil(uint32_t time)
+{
+    do {
+        drain();
+    } while ((int32_t) (time - millis()) > 0);
+}
+
+/**
+ * Send all queued data, blocks until everything is handed over to the HardwareSerial.
+ * Only to be used in situations where the control loop isn't running (e.g. before a reset).
+ */
+void SerialBuffer::flush()
+{
+    while (!isEmpty()) {
+        drain();
+    }
+    Serial.flush();
+}
+
+/**
+ * Get the number of bytes which can still be queued with the given priority.
+ */
+uint16_t SerialBuffer::getFree(Priority priority)
+{
+    uint16_t free = rings[priority].size - used(rings[priority]) - 1;
+    return (free > SERIAL_BUFFER_LENGTH_SIZE ? free - SERIAL_BUFFER_LENGTH_SIZE : 0);
+}
+
+/**
+ * Returns true if no data is waiting to be sent.
+ */
+bool SerialBuffer::isEmpty()
+{
+    return rings[high].head == rings[high].tail && rings[low].head == rings[low].tail;
+}
+
+/**
+ * Get the number of messages with the given priority which were dropped because the buffer was full.
+ */
+uint16_t SerialBuffer::getDropped(Priority priority)
+{
+    return rings[priority].dropped;
+}
+
+uint16_t SerialBuffer::used(Ring &ring)
+{
+    return (ring.head >= ring.tail ? ring.head - ring.tail : ring.size - ring.tail + ring.head);
+}
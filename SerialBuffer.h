@@ -0,0 +1,75 @@
+/*
+ * SerialBuffer.h
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SERIALBUFFER_H_
+#define SERIALBUFFER_H_
+
+#include <Arduino.h>
+#include "config.h"
+
+#define SERIAL_BUFFER_LENGTH_SIZE   2 // every message is preceded by its length in the ring buffer (not sent)
+
+class SerialBuffer
+{
+public:
+    enum Priority
+    {
+        low = 0, // debug and info messages
+        high = 1 // console output, warnings and errors
+    };
+
+    static bool write(Priority priority, const char *line);
+    static bool write(Priority priority, const uint8_t *data, uint16_t length);
+    static void drain();
+    static void drainUntil(uint32_t time);
+    static void flush();
+    static uint16_t getFree(Priority priority);
+    static bool isEmpty();
+    static uint16_t getDropped(Priority priority);
+
+private:
+    struct Ring
+    {
+        uint8_t *data;
+        uint16_t size;
+        uint16_t head; // position where the next byte is written to
+        uint16_t tail; // position where the next byte is read from
+        uint16_t dropped; // number of messages which didn't fit into the buffer
+    };
+
+    static bool append(Ring &ring, const uint8_t *data, uint16_t length, bool endOfLine);
+    static void put(Ring &ring, uint8_t value);
+    static uint8_t get(Ring &ring);
+    static uint16_t used(Ring &ring);
+
+    static CFG_INSTANCE_LOCAL uint8_t dataLow[CFG_SERIAL_TX_BUFFER_SIZE_LOW];
+    static CFG_INSTANCE_LOCAL uint8_t dataHigh[CFG_SERIAL_TX_BUFFER_SIZE_HIGH];
+    static CFG_INSTANCE_LOCAL Ring rings[2];
+    static CFG_INSTANCE_LOCAL Ring *active; // the ring from which a message is being sent, NULL between messages
+    static CFG_INSTANCE_LOCAL uint16_t activeRemaining; // the number of bytes of the message which are still to be sent
+};
+
+#endif /* SERIALBUFFER_H_ */
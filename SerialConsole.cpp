@@ -28,16 +28,175 @@
  */
 
 #include "SerialConsole.h"
+#include "SensorTrace.h"
+
+/*
+ * The help texts of the commands (also used to print the menu)
+ */
+static const char helpStart[] PROGMEM = "start program number";
+static const char helpHistory[] PROGMEM = "print the last n treatments (0=all, temperatures in 0.1 deg C)";
+static const char helpStats[] PROGMEM = "reset (0) or print (1) the statistics";
+static const char helpLoglevel[] PROGMEM = "log level of all modules (0=debug, 1=info, 2=warn, 3=error, 4=off)";
+static const char helpModuleLogLevel[] PROGMEM = "log level of module (not saved)";
+static const char helpTelemetry[] PROGMEM = "send binary telemetry every x * 0.1s instead of the data log (0=off, not saved)";
+static const char helpPrograms[] PROGMEM = "list the programs";
+static const char helpProgramEdit[] PROGMEM = "load program number to edit it (not while a program is active)";
+static const char helpProgramSave[] PROGMEM = "save the loaded program as program number (1-8)";
+static const char helpProgramDelete[] PROGMEM = "delete program number (built-in programs are restored)";
+static const char helpQueue[] PROGMEM = "queue program number to start after the current one (0=clear)";
+static const char helpQueueCool[] PROGMEM = "start the last queued program when the hive is below (in 0.1 deg C)";
+static const char helpQueueDelay[] PROGMEM = "start the last queued program x min after the previous one";
+static const char helpName[] PROGMEM = "name of the program (max. 16 characters)";
+static const char helpNumPlates[] PROGMEM = "number of installed plates (0-15, default: 4)";
+static const char helpHiveOt[] PROGMEM = "hive over-temp (in 0.1 deg C, default: 460)";
+static const char helpHiveOtr[] PROGMEM = "hive over-temp recover (in 0.1 deg C, default: 350)";
+static const char helpPlateOt[] PROGMEM = "plate over-temp (in 0.1 deg C, default: 850)";
+static const char helpMaxHeatCc[] PROGMEM = "max number of concurrent active heaters if PWM disabled (default: 2)";
+static const char helpMaxHeatPwr[] PROGMEM = "maximum heater power in PWM mode (0-255, default: 170)";
+static const char helpMinFanSpeed[] PROGMEM = "minimum fan speed level (0-255, default: 10)";
+static const char helpPwm[] PROGMEM = "enable/disable PWM (0=off, 1=on, default: 0)";
+static const char helpHumidDry[] PROGMEM = "extended run time to allow humidifier fan to dry (0-255 min, default: 2)";
+static const char helpAddrHive[] PROGMEM = "address of the hive temperature sensor";
+static const char helpAddrPlate[] PROGMEM = "address of the plate temperature sensor";
+static const char helpPinBeep[] PROGMEM = "output pin for beeper (default: 10)";
+static const char helpPinNext[] PROGMEM = "input pin for button next (default: 55 = A1)";
+static const char helpPinSelect[] PROGMEM = "input pin for button select (default: 56 = A2)";
+static const char helpPinFan[] PROGMEM = "output pin for fan (default: 7, 8, 44, 45)";
+static const char helpPinHeater[] PROGMEM = "output pin for heater (default: 2, 3, 11, 12)";
+static const char helpPinHb[] PROGMEM = "output pin for heartbeat signal (default: 13)";
+static const char helpPinRelay[] PROGMEM = "output pin for heater main relay (default: 54 = A0)";
+static const char helpPinFanHumid[] PROGMEM = "output pin for humidifier fan (default: 6)";
+static const char helpPinHumid[] PROGMEM = "input pin for humdity sensor (default: 9)";
+static const char helpHumidType[] PROGMEM = "humidity sensor type (11, 21, 22, default: 22)";
+static const char helpPinLcdD4[] PROGMEM = "output pin LCD D4 (default: 24)";
+static const char helpPinLcdD5[] PROGMEM = "output pin LCD D5 (default: 25)";
+static const char helpPinLcdD6[] PROGMEM = "output pin LCD D6 (default: 26)";
+static const char helpPinLcdD7[] PROGMEM = "output pin LCD D7 (default: 27)";
+static const char helpPinLcdEn[] PROGMEM = "output pin LCD enable (default: 23)";
+static const char helpPinLcdRs[] PROGMEM = "output pin LCD RS (default: 22)";
+static const char helpPinTemp[] PROGMEM = "input pin temperature sensors (default: 4)";
+static const char helpPinVapor[] PROGMEM = "output pin for vaporizer (default: 5)";
+static const char helpTempPreheat[] PROGMEM = "pre-heat hive temperature (in 0.1 deg C, 0-600)";
+static const char helpTemp[] PROGMEM = "hive temperature (in 0.1 deg C, 0-600)";
+static const char helpTempPlate[] PROGMEM = "max plate temperature (in 0.1 deg C, 0-1000)";
+static const char helpFanspeedPreheat[] PROGMEM = "fan speed during pre-heat (0-255)";
+static const char helpFanspeed[] PROGMEM = "fan speed (0-255)";
+static const char helpFanspeedHumid[] PROGMEM = "fan speed of humidifier (0-255)";
+static const char helpHumidityMin[] PROGMEM = "relative humidity minimum (0-100)";
+static const char helpHumidityMax[] PROGMEM = "relative humidity maximum (0-100)";
+static const char helpDurationPreheat[] PROGMEM = "duration of pre-heat cycle (in min)";
+static const char helpDuration[] PROGMEM = "duration of program (in min)";
+static const char helpDose[] PROGMEM = "thermal dose of the coldest sensor to end soak segments (in min at 40 deg C, 0=by time)";
+static const char helpSegType[] PROGMEM = "type of segment (0=end, 1=ramp, 2=soak, 3=hold, 4=cool, 5=pre-heat)";
+static const char helpSegTemp[] PROGMEM = "target hive temperature of segment (in 0.1 deg C, 0-600)";
+static const char helpSegParam[] PROGMEM = "ramp: rate (in 0.1 deg C/min), soak: duration, others: timeout (in min, 0=none)";
+static const char helpSegFan[] PROGMEM = "fan speed of segment (0-254, 255=program setting)";
+static const char helpSegHumid[] PROGMEM = "relative humidity minimum of segment (0-100, 0=program setting)";
+static const char helpSegPid[] PROGMEM = "scale of hive PID gains in segment (in %, 0=100)";
+static const char helpHiveKp[] PROGMEM = "Kp parameter for hive temperature PID (x 100)";
+static const char helpHiveKi[] PROGMEM = "Ki parameter for hive temperature PID (x 100)";
+static const char helpHiveKd[] PROGMEM = "Kd parameter for hive temperature PID (x 100)";
+static const char helpPlateKp[] PROGMEM = "Kp parameter for plate temperature PID (x 100)";
+static const char helpPlateKi[] PROGMEM = "Ki parameter for plate temperature PID (x 100)";
+static const char helpPlateKd[] PROGMEM = "Kd parameter for plate temperature PID (x 100)";
+
+/*
+ * The console commands, sorted by name (in ASCII order) to allow a binary search.
+ */
+static const ConsoleCommand commands[] PROGMEM = {
+    { "ADDR_HIVE", ConsoleCommand::typeAddress, ConsoleCommand::targetSensor, offsetof(ConfigurationSensor, addressHive), 0, ConsoleCommand::flagHiveSensors, 0, 0, helpAddrHive },
+    { "ADDR_PLATE", ConsoleCommand::typeAddress, ConsoleCommand::targetSensor, offsetof(ConfigurationSensor, addressPlate), 0, ConsoleCommand::flagPlates, 0, 0, helpAddrPlate },
+    { "DOSE", ConsoleCommand::typeUint16, ConsoleCommand::targetProgram, offsetof(Program, dose), 0, ConsoleCommand::flagChanged, 0, 65535, helpDose },
+    { "DURATION", ConsoleCommand::typeUint16, ConsoleCommand::targetProgram, offsetof(Program, duration), 0, ConsoleCommand::flagChanged, 0, 65535, helpDuration },
+    { "DURATION-PREHEAT", ConsoleCommand::typeUint16, ConsoleCommand::targetProgram, offsetof(Program, durationPreHeat), 0, ConsoleCommand::flagChanged, 0, 65535, helpDurationPreheat },
+    { "FANSPEED", ConsoleCommand::typeUint8, ConsoleCommand::targetProgram, offsetof(Program, fanSpeed), 0, ConsoleCommand::flagChanged, 0, 255, helpFanspeed },
+    { "FANSPEED-HUMID", ConsoleCommand::typeUint8, ConsoleCommand::targetProgram, offsetof(Program, fanSpeedHumidifier), 0, ConsoleCommand::flagChanged, 0, 255, helpFanspeedHumid },
+    { "FANSPEED-PREHEAT", ConsoleCommand::typeUint8, ConsoleCommand::targetProgram, offsetof(Program, fanSpeedPreHeat), 0, ConsoleCommand::flagChanged, 0, 255, helpFanspeedPreheat },
+    { "HISTORY", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionHistory, 0, 0, 0, 255, helpHistory },
+    { "HIVE-KD", ConsoleCommand::typeDouble, ConsoleCommand::targetProgram, offsetof(Program, hiveKd), 0, ConsoleCommand::flagChanged, 0, 65535, helpHiveKd },
+    { "HIVE-KI", ConsoleCommand::typeDouble, ConsoleCommand::targetProgram, offsetof(Program, hiveKi), 0, ConsoleCommand::flagChanged, 0, 65535, helpHiveKi },
+    { "HIVE-KP", ConsoleCommand::typeDouble, ConsoleCommand::targetProgram, offsetof(Program, hiveKp), 0, ConsoleCommand::flagChanged, 0, 65535, helpHiveKp },
+    { "HIVE_OT", ConsoleCommand::typeUint16, ConsoleCommand::targetParams, offsetof(ConfigurationParams, hiveOverTemp), 0, 0, 0, 700, helpHiveOt },
+    { "HIVE_OTR", ConsoleCommand::typeUint16, ConsoleCommand::targetParams, offsetof(ConfigurationParams, hiveOverTempRecover), 0, 0, 0, 700, helpHiveOtr },
+    { "HUMIDITY-MAX", ConsoleCommand::typeUint8, ConsoleCommand::targetProgram, offsetof(Program, humidityMaximum), 0, ConsoleCommand::flagChanged, 0, 100, helpHumidityMax },
+    { "HUMIDITY-MIN", ConsoleCommand::typeUint8, ConsoleCommand::targetProgram, offsetof(Program, humidityMinimum), 0, ConsoleCommand::flagChanged, 0, 100, helpHumidityMin },
+    { "HUMID_DRY", ConsoleCommand::typeUint8, ConsoleCommand::targetParams, offsetof(ConfigurationParams, humidifierFanDryTime), 0, 0, 0, 255, helpHumidDry },
+    { "HUMID_TYPE", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, humiditySensorType), 0, ConsoleCommand::flagHumidityType, 0, 255, helpHumidType },
+    { "LOGLEVEL", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionLogLevel, 0, 0, 0, 4, helpLoglevel },
+    { "LOGLEVEL_CONSOLE", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionModuleLogLevel, Logger::moduleSerialConsole, 0, 0, 4, helpModuleLogLevel },
+    { "LOGLEVEL_CONTROLLER", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionModuleLogLevel, Logger::moduleController, 0, 0, 4, helpModuleLogLevel },
+    { "LOGLEVEL_HID", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionModuleLogLevel, Logger::moduleHID, 0, 0, 4, helpModuleLogLevel },
+    { "LOGLEVEL_HUMIDIFIER", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionModuleLogLevel, Logger::moduleHumidifier, 0, 0, 4, helpModuleLogLevel },
+    { "LOGLEVEL_ONEWIRE", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionModuleLogLevel, Logger::moduleOneWire, 0, 0, 4, helpModuleLogLevel },
+    { "LOGLEVEL_PLATE", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionModuleLogLevel, Logger::modulePlate, 0, 0, 4, helpModuleLogLevel },
+    { "LOGLEVEL_SYSTEM", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionModuleLogLevel, Logger::moduleSystem, 0, 0, 4, helpModuleLogLevel },
+    { "MAX_HEAT_CC", ConsoleCommand::typeUint8, ConsoleCommand::targetParams, offsetof(ConfigurationParams, maxConcurrentHeaters), 0, 0, 0, CFG_MAX_NUMBER_PLATES, helpMaxHeatCc },
+    { "MAX_HEAT_PWR", ConsoleCommand::typeUint8, ConsoleCommand::targetParams, offsetof(ConfigurationParams, maxHeaterPower), 0, 0, 0, 255, helpMaxHeatPwr },
+    { "MIN_FAN_SPEED", ConsoleCommand::typeUint8, ConsoleCommand::targetParams, offsetof(ConfigurationParams, minFanSpeed), 0, 0, 0, 255, helpMinFanSpeed },
+    { "NAME", ConsoleCommand::typeString, ConsoleCommand::targetProgram, offsetof(Program, name), 0, 0, 0, 16, helpName },
+    { "NUM_PLATES", ConsoleCommand::typeUint8, ConsoleCommand::targetParams, offsetof(ConfigurationParams, numberOfPlates), 0, 0, 0, CFG_MAX_NUMBER_PLATES, helpNumPlates },
+    { "PIN_BEEP", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, beeper), 0, 0, 0, 255, helpPinBeep },
+    { "PIN_FAN", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, fan), 0, ConsoleCommand::flagPlates, 0, 255, helpPinFan },
+    { "PIN_FAN_HUMID", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, humidifierFan), 0, 0, 0, 255, helpPinFanHumid },
+    { "PIN_HB", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, heartbeat), 0, 0, 0, 255, helpPinHb },
+    { "PIN_HEATER", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, heater), 0, ConsoleCommand::flagPlates, 0, 255, helpPinHeater },
+    { "PIN_HUMID", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, humiditySensor), 0, 0, 0, 255, helpPinHumid },
+    { "PIN_LCD_D4", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, lcdD4), 0, 0, 0, 255, helpPinLcdD4 },
+    { "PIN_LCD_D5", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, lcdD5), 0, 0, 0, 255, helpPinLcdD5 },
+    { "PIN_LCD_D6", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, lcdD6), 0, 0, 0, 255, helpPinLcdD6 },
+    { "PIN_LCD_D7", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, lcdD7), 0, 0, 0, 255, helpPinLcdD7 },
+    { "PIN_LCD_EN", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, lcdEnable), 0, 0, 0, 255, helpPinLcdEn },
+    { "PIN_LCD_RS", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, lcdRs), 0, 0, 0, 255, helpPinLcdRs },
+    { "PIN_NEXT", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, buttonNext), 0, 0, 0, 255, helpPinNext },
+    { "PIN_RELAY", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, heaterRelay), 0, 0, 0, 255, helpPinRelay },
+    { "PIN_SELECT", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, buttonSelect), 0, 0, 0, 255, helpPinSelect },
+    { "PIN_TEMP", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, temperatureSensor), 0, 0, 0, 255, helpPinTemp },
+    { "PIN_VAPOR", ConsoleCommand::typeUint8, ConsoleCommand::targetIO, offsetof(ConfigurationIO, vaporizer), 0, 0, 0, 255, helpPinVapor },
+    { "PLATE-KD", ConsoleCommand::typeDouble, ConsoleCommand::targetProgram, offsetof(Program, plateKd), 0, ConsoleCommand::flagChanged, 0, 65535, helpPlateKd },
+    { "PLATE-KI", ConsoleCommand::typeDouble, ConsoleCommand::targetProgram, offsetof(Program, plateKi), 0, ConsoleCommand::flagChanged, 0, 65535, helpPlateKi },
+    { "PLATE-KP", ConsoleCommand::typeDouble, ConsoleCommand::targetProgram, offsetof(Program, plateKp), 0, ConsoleCommand::flagChanged, 0, 65535, helpPlateKp },
+    { "PLATE_OT", ConsoleCommand::typeUint16, ConsoleCommand::targetParams, offsetof(ConfigurationParams, plateOverTemp), 0, 0, 0, 999, helpPlateOt },
+    { "PROGRAMS", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionListPrograms, 0, 0, 0, 1, helpPrograms },
+    { "PROGRAM_DELETE", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionDeleteProgram, 0, 0, 1, PROGRAM_STORE_NUMBER_OF_SLOTS, helpProgramDelete },
+    { "PROGRAM_EDIT", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionEditProgram, 0, 0, 1, PROGRAM_STORE_NUMBER_OF_SLOTS, helpProgramEdit },
+    { "PROGRAM_SAVE", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionSaveProgram, 0, 0, 1, PROGRAM_STORE_NUMBER_OF_SLOTS, helpProgramSave },
+    { "PWM", ConsoleCommand::typeUint8, ConsoleCommand::targetParams, offsetof(ConfigurationParams, usePWM), 0, 0, 0, 1, helpPwm },
+    { "QUEUE", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionQueue, 0, 0, 0, PROGRAM_STORE_NUMBER_OF_SLOTS, helpQueue },
+    { "QUEUE_COOL", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionQueueCool, 0, 0, 0, 600, helpQueueCool },
+    { "QUEUE_DELAY", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionQueueDelay, 0, 0, 0, 1440, helpQueueDelay },
+    { "SEG-FAN", ConsoleCommand::typeUint8, ConsoleCommand::targetProgram, offsetof(Program, segments) + offsetof(ProgramSegment, fanSpeed), 0, ConsoleCommand::flagSegments | ConsoleCommand::flagChanged, 0, 255, helpSegFan },
+    { "SEG-HUMID", ConsoleCommand::typeUint8, ConsoleCommand::targetProgram, offsetof(Program, segments) + offsetof(ProgramSegment, humidity), 0, ConsoleCommand::flagSegments | ConsoleCommand::flagChanged, 0, 100, helpSegHumid },
+    { "SEG-PARAM", ConsoleCommand::typeUint16, ConsoleCommand::targetProgram, offsetof(Program, segments) + offsetof(ProgramSegment, parameter), 0, ConsoleCommand::flagSegments | ConsoleCommand::flagChanged, 0, 65535, helpSegParam },
+    { "SEG-PID", ConsoleCommand::typeUint8, ConsoleCommand::targetProgram, offsetof(Program, segments) + offsetof(ProgramSegment, pidScale), 0, ConsoleCommand::flagSegments | ConsoleCommand::flagChanged, 0, 255, helpSegPid },
+    { "SEG-TEMP", ConsoleCommand::typeInt16, ConsoleCommand::targetProgram, offsetof(Program, segments) + offsetof(ProgramSegment, temperature), 0, ConsoleCommand::flagSegments | ConsoleCommand::flagChanged, 0, 600, helpSegTemp },
+    { "SEG-TYPE", ConsoleCommand::typeUint8, ConsoleCommand::targetProgram, offsetof(Program, segments) + offsetof(ProgramSegment, type), 0, ConsoleCommand::flagSegments | ConsoleCommand::flagChanged, 0, 5, helpSegType },
+    { "START", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionStart, 0, 0, 0, 255, helpStart },
+    { "STATS", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionStatistics, 0, 0, 0, 1, helpStats },
+    { "TELEMETRY", ConsoleCommand::typeAction, ConsoleCommand::targetSystem, ConsoleCommand::actionTelemetry, 0, 0, 0, 255, helpTelemetry },
+    { "TEMP", ConsoleCommand::typeInt16, ConsoleCommand::targetProgram, offsetof(Program, temperatureHive), 0, ConsoleCommand::flagChanged, 0, 600, helpTemp },
+    { "TEMP-PLATE", ConsoleCommand::typeInt16, ConsoleCommand::targetProgram, offsetof(Program, temperaturePlate), 0, ConsoleCommand::flagChanged, 0, 1000, helpTempPlate },
+    { "TEMP-PREHEAT", ConsoleCommand::typeInt16, ConsoleCommand::targetProgram, offsetof(Program, temperaturePreHeat), 0, ConsoleCommand::flagChanged, 0, 600, helpTempPreheat },
+};
+
+#define NUMBER_OF_COMMANDS (sizeof(commands) / sizeof(ConsoleCommand))
 
 SerialConsole::SerialConsole() :
         Device()
 {
     ptrBuffer = 0;
+    menuSection = ConsoleCommand::numberOfTargets;
+    menuIndex = 0;
+    menuElement = 0;
+    menuHeader = false;
+    historyAge = 0;
+    historyEnd = 0;
 }
 
 void SerialConsole::process()
 {
     Device::process();
+    printPendingMenu();
+    printPendingHistory();
 
     while (Serial.available()) {
         int incoming = Serial.read();
@@ -45,11 +204,15 @@ void SerialConsole::process()
         if (incoming == -1) { //false alarm....
             return;
         }
+        SENSOR_TRACE(console(incoming));
 
         if (incoming == 10 || incoming == 13) { //command done. Parse it.
-            if (ptrBuffer == 1) {
+            cmdBuffer[ptrBuffer] = 0; //make sure to null terminate
+            if (cmdBuffer[0] == CONSOLE_BATCH_START) {
+                handleBatch();
+            } else if (ptrBuffer == 1) {
                 handleShortCmd();
-            } else {
+            } else if (ptrBuffer > 1) {
                 handleCmd();
             }
             ptrBuffer = 0; //reset line counter once the line has been processed
@@ -64,415 +227,838 @@ void SerialConsole::process()
 }
 
 /**
- * Print the menu to the serial interface
+ * Print the menu to the serial interface.
+ *
+ * The menu is too large for the output buffer, so it is generated line by line
+ * from the command table by printPendingMenu() as soon as the buffer has space.
  */
 void SerialConsole::printMenu()
 {
-    //Show build # here as well in case people are using the native port and don't get to see the start up messages
-    Logger::console(F("\n%s"), CFG_VERSION);
-    Logger::console(F("System State: %s"), status.systemStateToStr(status.getSystemState()).c_str());
-    Logger::console(F("System Menu:\n"));
-    Logger::console(F("Enable line endings of some sort (LF, CR, CRLF)\n"));
-    Logger::console(F("Commands:"));
-    Logger::console(F("h = help (displays this message)"));
-    Logger::console(F("r = reset configuration"));
-    Logger::console(F("s = save configuration to EEPROM"));
-    Logger::console(F("l = load configuration from EEPROM"));
-    Logger::console(F("x = stop program"));
-    Logger::console(F("start=<program #> - start program number"));
-
-    Logger::console(F("\nConfig Commands (enter command=newvalue)\n"));
-    Logger::console(F("LOGLEVEL=%d - set log level (0=debug, 1=info, 2=warn, 3=error, 4=off)"), Logger::getLogLevel());
-
-    printMenuParams();
-    printMenuSensors();
-    printMenuIO();
-    printMenuProgram();
+    menuSection = ConsoleCommand::targetSystem;
+    menuIndex = 0;
+    menuElement = 0;
+    menuHeader = true;
+    printPendingMenu();
 }
 
-void SerialConsole::printMenuParams()
+/**
+ * Queue the next lines of the menu as long as the output buffer has space.
+ */
+void SerialConsole::printPendingMenu()
 {
-    ConfigurationParams* configParams = Configuration::getParams();
-    Logger::console(F("NUM_PLATES=%d - number of installed plates (0-15, default: 4)"), configParams->numberOfPlates);
-    Logger::console(F("HIVE_OT=%d - hive over-temp (in 0.1 deg C, default: 460)"), configParams->hiveOverTemp);
-    Logger::console(F("HIVE_OTR=%d - hive over-temp recover (in 0.1 deg C, default: 350)"), configParams->hiveOverTempRecover);
-    Logger::console(F("PLATE_OT=%d - plate over-temp (in 0.1 deg C, default: 850)"), configParams->plateOverTemp);
-    Logger::console(F("MAX_HEAT_CC=%d - max number of concurrent active heaters if PWM disabled (default: 2)"), configParams->maxConcurrentHeaters);
-    Logger::console(F("MAX_HEAT_PWR=%d - maximum heater power in PWM mode (0-255, default: 170)"), configParams->maxHeaterPower);
-    Logger::console(F("MIN_FAN_SPEED=%d - minimum fan speed level (0-255, default: 10)"), configParams->minFanSpeed);
-    Logger::console(F("PWM=%d - enable/disable PWM (0=off, 1=on, default: 0)"), configParams->usePWM);
-    Logger::console(F("HUMID_DRY=%d - extended run time to allow humidifier fan to dry (0-255 min, default: 2)"), configParams->humidifierFanDryTime);
-}
+    ConsoleCommand command;
 
-void SerialConsole::printMenuSensors()
-{
-    ConfigurationSensor* configSensor = Configuration::getSensor();
-    for (int i = 0; configSensor->addressHive[i].value != 0 && i < CFG_MAX_NUMBER_PLATES; i++) {
-        Logger::console(F("ADDR_HIVE[%d]=%#08lx%08lx - address of the hive temperature sensor"), i + 1, configSensor->addressHive[i].high,
-                configSensor->addressHive[i].low);
-    }
-    if (configSensor->addressHive[0].value == 0) {
-        Logger::console(F("ADDR_HIVE[0]=0x0000000000000000 - address of the hive temperature sensor"));
-    }
-    for (int i = 0; i < Configuration::getParams()->numberOfPlates; i++) {
-        Logger::console(F("ADDR_PLATE[%d]=%#08lx%08lx - address of the plate temperature sensor"), i + 1, configSensor->addressPlate[i].high,
-                configSensor->addressPlate[i].low);
+    while (menuSection < ConsoleCommand::numberOfTargets) {
+        if (menuHeader) {
+            if (SerialBuffer::getFree(SerialBuffer::high) < 520) { // the system header has ~390 bytes, 128 bytes stay free
+                return;
+            }
+            menuHeader = false;
+            if (!printMenuHeader()) {
+                menuIndex = NUMBER_OF_COMMANDS; // skip the whole section
+            }
+        }
+        if (menuIndex >= NUMBER_OF_COMMANDS) {
+            menuSection++;
+            menuIndex = 0;
+            menuElement = 0;
+            menuHeader = true;
+            continue;
+        }
+        if (SerialBuffer::getFree(SerialBuffer::high) < 128) {
+            return;
+        }
+
+        memcpy_P(&command, &commands[menuIndex], sizeof(ConsoleCommand));
+        if (command.target == menuSection && printMenuEntry(&command, menuElement)) {
+            menuElement++;
+        } else {
+            menuIndex++;
+            menuElement = 0;
+        }
     }
 }
 
-void SerialConsole::printMenuIO()
+#ifdef __AVR__
+/**
+ * Get the number of bytes between the heap and the stack.
+ */
+static int freeMemory()
 {
-    ConfigurationIO* configIO = Configuration::getIO();
-    Logger::console(F("PIN_BEEP=%d - output pin for beeper (default: 10)"), configIO->beeper);
-    Logger::console(F("PIN_NEXT=%d - input pin for button next (default: 55 = A1)"), configIO->buttonNext);
-    Logger::console(F("PIN_SELECT=%d - input pin for button select (default: 56 = A2)"), configIO->buttonSelect);
-    for (int i = 0; i < Configuration::getParams()->numberOfPlates; i++) {
-        Logger::console(F("PIN_FAN[%d]=%d - output pin for fan (default: 7, 8, 44, 45)"), i + 1, configIO->fan[i]);
-    }
-    for (int i = 0; i < Configuration::getParams()->numberOfPlates; i++) {
-        Logger::console(F("PIN_HEATER[%d]=%d - output for for heater (default: 11, 12, 2, 3)"), i + 1, configIO->heater[i]);
-    }
-    Logger::console(F("PIN_HB=%d - output pin for heartbeat signal (default: 13)"), configIO->heartbeat);
-    Logger::console(F("PIN_RELAY=%d - output pin for heater main relay (default: 54 = A0)"), configIO->heaterRelay);
-    Logger::console(F("PIN_FAN_HUMID=%d - output pin for humidifier fan (default: 6)"), configIO->humidifierFan);
-    Logger::console(F("PIN_HUMID=%d - input pin for humdity sensor (default: 9)"), configIO->humiditySensor);
-    Logger::console(F("HUMID_TYPE=%d - humidity sensor type (11, 21, 22, default: 22)"), configIO->humiditySensorType);
-    Logger::console(F("PIN_LCD_D4=%d - output pin LCD D4 (default: 24)"), configIO->lcdD4);
-    Logger::console(F("PIN_LCD_D5=%d - output pin LCD D5 (default: 25)"), configIO->lcdD5);
-    Logger::console(F("PIN_LCD_D6=%d - output pin LCD D6 (default: 26)"), configIO->lcdD6);
-    Logger::console(F("PIN_LCD_D7=%d - output pin LCD D7 (default: 27)"), configIO->lcdD7);
-    Logger::console(F("PIN_LCD_EN=%d - output pin LCD enable (default: 23)"), configIO->lcdEnable);
-    Logger::console(F("PIN_LCD_RS=%d - output pin LCD RS (default: 22)"), configIO->lcdRs);
-    Logger::console(F("PIN_TEMP=%d - input pin temperature sensors (default: 4)"), configIO->temperatureSensor);
-    Logger::console(F("PIN_VAPOR=%d - output pin for vaporizer (default: 5)"), configIO->vaporizer);
+    extern char __heap_start, *__brkval;
+    char top;
+    return &top - (__brkval == NULL ? &__heap_start : __brkval);
 }
+#endif
 
-void SerialConsole::printMenuProgram()
+/**
+ * Print the header of the current menu section.
+ * Returns false if the section is not available.
+ */
+bool SerialConsole::printMenuHeader()
 {
-    Program* program = ProgramHandler::getInstance()->getRunningProgram();
-    if (program) {
-        Logger::console(F("\nPROGRAM\n"));
-        Logger::console(F("TEMP-PREHEAT=%d - pre-heat hive temperature (in 0.1 deg C, 0-600)"), program->temperaturePreHeat);
-        Logger::console(F("TEMP=%d - hive temperature (in 0.1 deg C, 0-600)"), program->temperatureHive);
-        Logger::console(F("TEMP-PLATE=%d - max plate temperature (in 0.1 deg C, 0-1000)"), program->temperaturePlate);
-        Logger::console(F("FANSPEED-PREHEAT=%d - fan speed during pre-heat (0-255)"), program->fanSpeedPreHeat);
-        Logger::console(F("FANSPEED=%d - fan speed (0-255)"), program->fanSpeed);
-        Logger::console(F("FANSPEED-HUMID=%d - fan speed of humidifier (0-255)"), program->fanSpeedHumidifier);
-        Logger::console(F("HUMIDITY-MIN=%d - relative humidity minimum (0-100)"), program->humidityMinimum);
-        Logger::console(F("HUMIDITY-MAX=%d - relative humidity maximum (0-100)"), program->humidityMaximum);
-        Logger::console(F("DURATION-PREHEAT=%d - duration of pre-heat cycle (in min)"), program->durationPreHeat);
-        Logger::console(F("DURATION=%d - duration of program (in min)"), program->duration);
-        Logger::console(F("enter the following values multiplied by 100 (e.g. 25 for 0.25) :"));
-        Logger::console(F("HIVE-KP=%s - Kp parameter for hive temperature PID"), String(program->hiveKp).c_str());
-        Logger::console(F("HIVE-KI=%s - Ki parameter for hive temperature PID"), String(program->hiveKi).c_str());
-        Logger::console(F("HIVE-KD=%s - Kd parameter for hive temperature PID"), String(program->hiveKd).c_str());
-        Logger::console(F("PLATE-KP=%s - Kp parameter for plate temperature PID"), String(program->plateKp).c_str());
-        Logger::console(F("PLATE-KI=%s - Ki parameter for plate temperature PID"), String(program->plateKi).c_str());
-        Logger::console(F("PLATE-KD=%s - Kd parameter for plate temperature PID"), String(program->plateKd).c_str());
-        Logger::console(F(""));
+    Status *status = Status::getInstance();
+    switch (menuSection) {
+    case ConsoleCommand::targetSystem:
+        //Show build # here as well in case people are using the native port and don't get to see the start up messages
+        Logger::console(F("\n%s"), CFG_VERSION);
+        Logger::console(F("System State: %S"), status->systemStateToStr(status->getSystemState()));
+        Logger::console(F("Dropped output messages: %u low / %u high priority"), SerialBuffer::getDropped(SerialBuffer::low),
+                SerialBuffer::getDropped(SerialBuffer::high));
+#ifdef __AVR__
+        Logger::console(F("Free RAM: %d bytes"), freeMemory());
+#endif
+        Logger::console(F("System Menu:\n"));
+        Logger::console(F("Enable line endings of some sort (LF, CR, CRLF)\n"));
+        Logger::console(F("Commands:"));
+        Logger::console(F("h = help (displays this message)"));
+        Logger::console(F("r = reset configuration"));
+        Logger::console(F("s = save configuration to EEPROM"));
+        Logger::console(F("l = load configuration from EEPROM"));
+        Logger::console(F("x = stop program"));
+        Logger::console(F("\nConfig Commands (enter command=newvalue)\n"));
+        break;
+    case ConsoleCommand::targetProgram:
+        if (ProgramHandler::getInstance()->getProgram() == NULL) {
+            return false;
+        }
+        Logger::console(F("\nPROGRAM #%d (%S)\n"), ProgramHandler::getInstance()->getProgramNumber(),
+                ProgramHandler::getInstance()->isActive() ? PSTR("active") : PSTR("loaded"));
+        break;
     }
+    return true;
 }
 
-bool SerialConsole::handleCmd()
+/**
+ * Print one element of a command with its current value and help text.
+ * Returns false if the command has no (further) element to print.
+ */
+bool SerialConsole::printMenuEntry(ConsoleCommand *command, uint8_t element)
 {
-    int i = 0;
+    uint8_t elements = getNumberOfElements(command, true);
+    if (element >= (elements == 0 ? 1 : elements)) {
+        return false;
+    }
+
+    char index[6] = "";
+    if (elements > 0) {
+        snprintf_P(index, sizeof(index), PSTR("[%d]"), element + 1);
+    }
 
-    if (ptrBuffer < 1) {
+    if (command->type == ConsoleCommand::typeAction) {
+        int32_t value = getValue(command, 0);
+        if (value < 0) {
+            Logger::console(F("%s=<n> - %S"), command->name, command->help);
+        } else {
+            Logger::console(F("%s=%ld - %S"), command->name, value, command->help);
+        }
+    } else if (getTarget(command->target) == NULL) {
         return false;
+    } else if (command->type == ConsoleCommand::typeString) {
+        Logger::console(F("%s=%s - %S"), command->name, (char *) getField(command, element), command->help);
+    } else if (command->type == ConsoleCommand::typeAddress) {
+        SensorAddress *address = (SensorAddress *) getField(command, element);
+        Logger::console(F("%s%s=%#08lx%08lx - %S"), command->name, index, address->high, address->low, command->help);
+    } else {
+        Logger::console(F("%s%s=%ld - %S"), command->name, index, getValue(command, element), command->help);
     }
+    return true;
+}
 
-    cmdBuffer[ptrBuffer] = 0; //make sure to null terminate
-    String command = String();
+/**
+ * Queue the requested history records as long as the output buffer has space.
+ * The records are printed from the oldest to the most recent one.
+ */
+void SerialConsole::printPendingHistory()
+{
+    HistoryRecord record;
 
-    while (cmdBuffer[i] != '=' && i < ptrBuffer) {
-        command.concat(String(cmdBuffer[i++]));
+    while (historyAge < historyEnd && SerialBuffer::getFree(SerialBuffer::high) >= 128) {
+        uint8_t age = historyEnd - ++historyAge;
+        if (!History::getInstance()->getRecord(age, &record)) {
+            Logger::console(F("treatment record %d is corrupt"), age);
+            continue;
+        }
+        Logger::console(F("#%u program %d %S: pre-heat %us, running %us, at target %us, max hive %d, max plate %d, over-temp %d, %uWh"),
+                record.sequence, record.program, History::stopReasonToStr(record.stopReason), record.durationPreHeat,
+                record.durationRunning, record.timeAtTarget, record.maxHiveTemperature, record.maxPlateTemperature,
+                record.overtempEvents, record.energy);
     }
-    i++;
+}
 
-    if (i >= ptrBuffer) {
+/**
+ * Parse and execute a command of the form "NAME=value" or "NAME[index]=value".
+ *
+ * The command is split in place in cmdBuffer and looked up in the command table,
+ * no memory is allocated.
+ */
+bool SerialConsole::handleCmd()
+{
+    char *parameter = strchr(cmdBuffer, '=');
+    if (parameter == NULL || parameter[1] == 0) {
         Logger::console(F("Command needs a value..ie TEMP=420\n"));
         return false;
     }
+    *parameter++ = 0;
 
-    int32_t value = strtol((char *) (cmdBuffer + i), NULL, 0);
-    command.toUpperCase();
+    ConsoleCommand command;
+    uint8_t index;
+    ConsoleError error = parseCommand(cmdBuffer, &command, &index);
 
-    if (!handleCmdSystem(command, value) && !handleCmdParams(command, value) && !handleCmdSensor(command, (cmdBuffer + i))
-            && !handleCmdIO(command, value) && !handleCmdProgram(command, value)) {
-        Logger::warn("unknown command: %s", command.c_str());
-        return false;
-    } else {
+    if (error == consoleOk && command.type == ConsoleCommand::typeAddress) {
+        SensorAddress address;
+        error = parseAddress(parameter, &address);
+        if (error == consoleOk) {
+            *(SensorAddress *) getField(&command, index) = address;
+            Logger::console(F("setting %s[%d] to %#08lx%08lx"), command.name, index + 1, address.high, address.low);
+        }
+    } else if (error == consoleOk) {
+        int32_t value;
+        error = parseValue(&command, parameter, &value, false);
+        if (error == consoleOk) {
+            if (command.type == ConsoleCommand::typeAction) {
+                return handleAction(&command, value);
+            }
+            if (command.type == ConsoleCommand::typeString) {
+                setText(&command, parameter);
+                Logger::console(F("setting %s to %s"), command.name, parameter);
+                return true;
+            }
+            if (getNumberOfElements(&command, false) > 0) {
+                Logger::console(F("setting %s[%d] to %ld"), command.name, index + 1, value);
+            } else {
+                Logger::console(F("setting %s to %ld"), command.name, value);
+            }
+            setValue(&command, index, value);
+        }
+    }
+
+    switch (error) {
+    case consoleOk:
         return true;
+    case consoleErrorUnknown:
+        LOG_WARN(Logger::moduleSerialConsole, F("unknown command: %s"), cmdBuffer);
+        break;
+    case consoleErrorIndex:
+        Logger::console(F("index of %s must be between 1 and %d"), command.name, getNumberOfElements(&command, false));
+        break;
+    case consoleErrorNoProgram:
+        Logger::console(F("no program loaded"));
+        break;
+    default:
+        Logger::console(F("invalid value: %s"), parameter);
+        break;
     }
+    return false;
 }
 
-bool SerialConsole::handleCmdSystem(String &command, int32_t value)
+/**
+ * Handle a batch request "$<sequence>;<item>;...*<crc>" (see ConsoleProtocol.h).
+ *
+ * The request is parsed in place in cmdBuffer. In a first pass all items are
+ * validated, only if all of them are valid, the writes are applied in a second pass.
+ * Like this, a batch of program changes results in a single update of the devices.
+ * The request is refused if the reply (plus the console lines of the actions)
+ * doesn't fit into the output buffer, a dropped reply would leave the client waiting.
+ */
+void SerialConsole::handleBatch()
 {
-    if (command == String(F("START"))) {
-        if (ProgramHandler::getInstance()->getRunningProgram() == NULL) {
-            Logger::info(F("starting program #%d"), value);
-            ProgramHandler::getInstance()->start(value);
+    char *items[CFG_BATCH_MAX_ITEMS];
+    char *parameters[CFG_BATCH_MAX_ITEMS];
+    uint8_t indexes[CFG_BATCH_MAX_ITEMS];
+    ConsoleCommand command;
+    BatchState state;
+    uint8_t count = 0, actions = 0;
+    char *end;
+
+    uint32_t sequence = strtoul(cmdBuffer + 1, &end, 10);
+    char *checksum = strrchr(cmdBuffer, CONSOLE_BATCH_CHECKSUM);
+    if (end == cmdBuffer + 1 || checksum == NULL || (end != checksum && *end != CONSOLE_BATCH_SEPARATOR)
+            || strtoul(checksum + 1, NULL, 16) != Crc::calculate((uint8_t *) cmdBuffer + 1, checksum - cmdBuffer - 1)) {
+        sendBatchReply(sequence, consoleErrorFrame, 0);
+        return;
+    }
+    *checksum = 0;
+
+    // split the items and validate them
+    ProgramHandler *programHandler = ProgramHandler::getInstance();
+    state.active = programHandler->isActive();
+    state.loaded = programHandler->getProgram() != NULL;
+    state.queueLength = programHandler->getQueueLength();
+    state.saved = 0;
+    state.removed = 0;
+    uint16_t replyLength = 23; // "$<sequence>;OK" and checksum
+    char *next = (end == checksum ? NULL : end + 1);
+    while (next != NULL) {
+        if (count == CFG_BATCH_MAX_ITEMS) {
+            sendBatchReply(sequence, consoleErrorSize, count + 1);
+            return;
+        }
+        items[count] = next;
+        next = strchr(next, CONSOLE_BATCH_SEPARATOR);
+        if (next != NULL) {
+            *next++ = 0;
+        }
+        parameters[count] = strchr(items[count], '=');
+        if (parameters[count] != NULL) {
+            *parameters[count]++ = 0;
+        }
+
+        ConsoleError error = parseCommand(items[count], &command, &indexes[count]);
+        if (error == consoleOk && parameters[count] != NULL) {
+            SensorAddress address;
+            int32_t value;
+            error = (command.type == ConsoleCommand::typeAddress ? parseAddress(parameters[count], &address) :
+                    parseValue(&command, parameters[count], &value, true));
+            if (error == consoleOk && command.type == ConsoleCommand::typeAction) {
+                error = checkAction(&command, value, &state);
+                actions++;
+            }
+        }
+        if (error == consoleOk && parameters[count] == NULL) {
+            replyLength += strlen(command.name) + (getNumberOfElements(&command, false) > 0 ? 6 : 2)
+                    + (command.type == ConsoleCommand::typeAddress ? 16 : command.type == ConsoleCommand::typeString ? command.maximum : 11);
+            if (replyLength > CFG_BATCH_REPLY_SIZE) {
+                error = consoleErrorSize;
+            }
+        }
+        if (error != consoleOk) {
+            sendBatchReply(sequence, error, count + 1);
+            return;
+        }
+        count++;
+    }
+    if (SerialBuffer::getFree(SerialBuffer::high) < replyLength + 2 + actions * CFG_BATCH_ACTION_OUTPUT) {
+        sendBatchReply(sequence, consoleErrorBusy, 0);
+        return;
+    }
+
+    // apply the writes
+    for (uint8_t i = 0; i < count; i++) {
+        if (parameters[i] == NULL) {
+            continue;
+        }
+        findCommand(items[i], &command);
+        if (command.type == ConsoleCommand::typeAddress) {
+            parseAddress(parameters[i], (SensorAddress *) getField(&command, indexes[i]));
         } else {
+            int32_t value;
+            parseValue(&command, parameters[i], &value, true);
+            if (command.type == ConsoleCommand::typeAction) {
+                if (!handleAction(&command, value)) {
+                    sendBatchReply(sequence, consoleErrorAction, i + 1);
+                    return;
+                }
+            } else if (command.type == ConsoleCommand::typeString) {
+                setText(&command, parameters[i]);
+            } else {
+                setValue(&command, indexes[i], value);
+            }
+        }
+    }
+
+    // reply with the values of the read items
+    char reply[CFG_BATCH_REPLY_SIZE + 1];
+    int length = snprintf_P(reply, sizeof(reply), PSTR("$%lu;OK"), sequence);
+    for (uint8_t i = 0; i < count; i++) {
+        if (parameters[i] == NULL) {
+            findCommand(items[i], &command);
+            length += printValue(reply + length, sizeof(reply) - length, &command, indexes[i]);
+        }
+    }
+    sendBatchReply(reply, length);
+}
+
+/**
+ * Send an error reply to a batch request.
+ */
+void SerialConsole::sendBatchReply(uint32_t sequence, ConsoleError error, uint8_t item)
+{
+    char reply[30];
+    sendBatchReply(reply, snprintf_P(reply, sizeof(reply), PSTR("$%lu;ERR=%d;%d"), sequence, error, item));
+}
+
+/**
+ * Append the checksum to a batch reply and send it.
+ */
+void SerialConsole::sendBatchReply(char *reply, int length)
+{
+    snprintf_P(reply + length, 10, PSTR("*%08lx"), Crc::calculate((uint8_t *) reply + 1, length - 1));
+    SerialBuffer::write(SerialBuffer::high, reply);
+}
+
+/**
+ * Print ";NAME[index]=value" of a command to a buffer, returns the number of characters written.
+ */
+int SerialConsole::printValue(char *buffer, int size, ConsoleCommand *command, uint8_t index)
+{
+    int length = snprintf_P(buffer, size, PSTR(";%s"), command->name);
+    if (getNumberOfElements(command, false) > 0) {
+        length += snprintf_P(buffer + length, size - length, PSTR("[%d]"), index + 1);
+    }
+    if (command->type == ConsoleCommand::typeString) {
+        length += snprintf_P(buffer + length, size - length, PSTR("=%s"), (char *) getField(command, index));
+    } else if (command->type == ConsoleCommand::typeAddress) {
+        SensorAddress *address = (SensorAddress *) getField(command, index);
+        length += snprintf_P(buffer + length, size - length, PSTR("=%08lx%08lx"), address->high, address->low);
+    } else {
+        length += snprintf_P(buffer + length, size - length, PSTR("=%ld"), getValue(command, index));
+    }
+    return length;
+}
+
+/**
+ * Execute a command which does not modify a field.
+ */
+bool SerialConsole::handleAction(ConsoleCommand *command, int32_t value)
+{
+    switch (command->offset) {
+    case ConsoleCommand::actionStart:
+        if (ProgramHandler::getInstance()->isActive()) {
             Logger::console(F("a program is already running"));
+            return false;
         }
-    } else if (command == String(F("STATS"))) {
+        LOG_INFO(Logger::moduleSerialConsole, F("starting program #%d"), value);
+        return ProgramHandler::getInstance()->start(value);
+    case ConsoleCommand::actionHistory: {
+        uint8_t available = History::getInstance()->getNumberOfRecords();
+        Logger::console(F("treatment history (%d records):"), available);
+        historyAge = 0;
+        historyEnd = (value <= 0 || value > available ? available : value);
+        break;
+    }
+    case ConsoleCommand::actionStatistics:
         if (value == 0) {
             Logger::console(F("resetting statistics"));
             Statistics::getInstance()->reset();
             Statistics::getInstance()->save();
+        } else {
+            Statistics::getInstance()->print();
         }
-    } else {
+        break;
+    case ConsoleCommand::actionLogLevel:
+        Logger::console(F("setting loglevel to %d"), value);
+        Logger::setLoglevel((Logger::LogLevel) value);
+        Configuration::getParams()->loglevel = value;
+        break;
+    case ConsoleCommand::actionModuleLogLevel:
+        Logger::console(F("setting loglevel of %S to %d"), Logger::getModuleName((Logger::Module) command->argument), value);
+        Logger::setLoglevel((Logger::Module) command->argument, (Logger::LogLevel) value);
+        break;
+    case ConsoleCommand::actionTelemetry:
+        Logger::console(F("setting telemetry interval to %d"), value);
+        Telemetry::getInstance()->setInterval(value);
+        break;
+    case ConsoleCommand::actionListPrograms: {
+        char name[17];
+        for (uint8_t number = 1; number <= PROGRAM_STORE_NUMBER_OF_SLOTS; number++) {
+            if (ProgramStore::getInstance()->getName(number, name)) {
+                Logger::console(F("#%d %s (%S)"), number, name, ProgramStore::getInstance()->isStored(number) ? PSTR("eeprom") : PSTR("built-in"));
+            }
+        }
+        printQueue();
+        break;
+    }
+    case ConsoleCommand::actionEditProgram:
+        if (!ProgramHandler::getInstance()->load(value)) {
+            Logger::console(F("unable to load program #%d"), value);
+            return false;
+        }
+        Logger::console(F("loaded program #%d"), value);
+        break;
+    case ConsoleCommand::actionSaveProgram:
+        if (ProgramHandler::getInstance()->getProgram() == NULL
+                || !ProgramStore::getInstance()->save(value, ProgramHandler::getInstance()->getProgram())) {
+            Logger::console(F("unable to save program #%d"), value);
+            return false;
+        }
+        break;
+    case ConsoleCommand::actionDeleteProgram:
+        if (!ProgramStore::getInstance()->remove(value)) {
+            Logger::console(F("program #%d is not stored in the eeprom"), value);
+            return false;
+        }
+        break;
+    case ConsoleCommand::actionQueue:
+        if (value == 0) {
+            Logger::console(F("clearing the queue"));
+            ProgramHandler::getInstance()->clearQueue();
+        } else if (!ProgramHandler::getInstance()->enqueue(value)) {
+            Logger::console(F("unable to queue program #%d"), value);
+            return false;
+        }
+        break;
+    case ConsoleCommand::actionQueueCool:
+    case ConsoleCommand::actionQueueDelay:
+        if (!ProgramHandler::getInstance()->setQueueCondition(
+                (command->offset == ConsoleCommand::actionQueueCool ? queueCooled : queueDelay), value)) {
+            Logger::console(F("no program queued"));
+            return false;
+        }
+        break;
+    default:
         return false;
     }
     return true;
 }
 
-bool SerialConsole::handleCmdParams(String &command, int32_t value)
+/**
+ * Check if an action of a batch request can be executed in the state left by the
+ * previous items and update the state accordingly.
+ */
+ConsoleError SerialConsole::checkAction(ConsoleCommand *command, int32_t value, BatchState *state)
 {
-    ConfigurationParams *configParams = Configuration::getParams();
-    if (command == String(F("NUM_PLATES"))) {
-        value = constrain(value, 0, 15);
-        Logger::console(F("setting number of installed plates to %d"), value);
-        configParams->numberOfPlates = value;
-    } else if (command == String(F("HIVE_OT"))) {
-        value = constrain(value, 0, 700);
-        Logger::console(F("setting hive over-temp to %d.%d"), value / 10, value % 10);
-        configParams->hiveOverTemp = value;
-    } else if (command == String(F("HIVE_OTR"))) {
-        value = constrain(value, 0, 700);
-        Logger::console(F("setting hive over-temp recover %d.%d"), value / 10, value % 10);
-        configParams->hiveOverTempRecover = value;
-    } else if (command == String(F("PLATE_OT"))) {
-        value = constrain(value, 0, 999);
-        Logger::console(F("setting plate over-temp %d.%d"), value / 10, value % 10);
-        configParams->plateOverTemp = value;
-    } else if (command == String(F("MAX_HEAT_CC"))) {
-        value = constrain(value, 0, CFG_MAX_NUMBER_PLATES);
-        Logger::console(F("setting max number of concurrent active heaters to %d"), value);
-        configParams->maxConcurrentHeaters = value;
-    } else if (command == String(F("MAX_HEAT_PWR"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting maximum heater power to %d"), value);
-        configParams->maxHeaterPower = value;
-    } else if (command == String(F("MIN_FAN_SPEED"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting minimum fan speed level to %d"), value);
-        configParams->minFanSpeed = value;
-    } else if (command == String(F("PWM"))) {
-        value = constrain(value, 0, CFG_MAX_NUMBER_PLATES);
-        Logger::console(F("setting PWM to %d"), value);
-        configParams->usePWM = value;
-    } else if (command == String(F("HUMID_DRY"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting dry time of humidifier fan to %d min"), value);
-        configParams->humidifierFanDryTime = value;
-    } else if (command == String(F("LOGLEVEL"))) {
-        value = constrain(value, 0, 4);
-        Logger::console(F("setting loglevel to %d"), value);
-        Logger::setLoglevel((Logger::LogLevel) value);
-        configParams->loglevel = value;
-    } else {
-        return false;
+    uint16_t slot = (value >= 1 && value <= (int32_t) PROGRAM_STORE_NUMBER_OF_SLOTS ? 1 << (value - 1) : 0);
+
+    switch (command->offset) {
+    case ConsoleCommand::actionStart:
+        if (state->active || !programExists(value, state)) {
+            return consoleErrorState;
+        }
+        state->active = true;
+        state->loaded = true;
+        break;
+    case ConsoleCommand::actionStatistics:
+        return (value == 0 ? consoleOk : consoleErrorValue);
+    case ConsoleCommand::actionListPrograms:
+        return consoleErrorValue; // the listing would crowd the reply out of the output buffer
+    case ConsoleCommand::actionEditProgram:
+        if (state->active || !programExists(value, state)) {
+            return consoleErrorState;
+        }
+        state->loaded = true;
+        break;
+    case ConsoleCommand::actionSaveProgram:
+        if (!state->loaded) {
+            return consoleErrorState;
+        }
+        state->saved |= slot;
+        state->removed &= ~slot;
+        break;
+    case ConsoleCommand::actionDeleteProgram:
+        if (!(state->saved & slot) && ((state->removed & slot) || !ProgramStore::getInstance()->isStored(value))) {
+            return consoleErrorState;
+        }
+        state->saved &= ~slot;
+        state->removed |= slot;
+        break;
+    case ConsoleCommand::actionQueue:
+        if (value == 0) {
+            state->queueLength = 0;
+        } else if (state->queueLength >= CFG_PROGRAM_QUEUE_SIZE || !programExists(value, state)) {
+            return consoleErrorState;
+        } else {
+            state->queueLength++;
+        }
+        break;
+    case ConsoleCommand::actionQueueCool:
+    case ConsoleCommand::actionQueueDelay:
+        if (state->queueLength == 0) {
+            return consoleErrorState;
+        }
+        break;
     }
-    return true;
+    return consoleOk;
+}
+
+/**
+ * Check if a program exists after the previous items of a batch request. A program deleted
+ * by a previous item is treated as missing even if a preset takes its place.
+ */
+bool SerialConsole::programExists(uint8_t number, BatchState *state)
+{
+    uint16_t slot = (number >= 1 && number <= PROGRAM_STORE_NUMBER_OF_SLOTS ? 1 << (number - 1) : 0);
+
+    if (state->saved & slot) {
+        return true;
+    }
+    return !(state->removed & slot) && ProgramStore::getInstance()->exists(number);
 }
 
-bool SerialConsole::handleCmdSensor(String &command, char *parameter)
+/**
+ * Print the queued programs and the conditions to start them.
+ */
+void SerialConsole::printQueue()
 {
-    ConfigurationSensor *configSensor = Configuration::getSensor();
-    if (command.startsWith(String(F("ADDR_HIVE")))) {
-        uint8_t index = getIndex(command);
-        if (index-- <= CFG_MAX_NUMBER_PLATES) {
-            String lowStr = String("0x") + (char *) (parameter + 10);
-            configSensor->addressHive[index].low = strtoul(lowStr.c_str(), NULL, 0);
-            String highStr = String(parameter).substring(0, 10);
-            configSensor->addressHive[index].high = strtoul(highStr.c_str(), NULL, 0);
-            Logger::console(F("setting address of hive sensor[%d] to %#08lx%08lx"), index + 1, configSensor->addressHive[index].high,
-                    configSensor->addressHive[index].low);
-        }
-    } else if (command.startsWith(String(F("ADDR_PLATE")))) {
-        uint8_t index = getIndex(command);
-        if (index-- <= Configuration::getParams()->numberOfPlates) {
-            String lowStr = String("0x") + (char *) (parameter + 10);
-            configSensor->addressPlate[index].low = strtoul(lowStr.c_str(), NULL, 0);
-            String highStr = String(parameter).substring(0, 10);
-            configSensor->addressPlate[index].high = strtoul(highStr.c_str(), NULL, 0);
-            Logger::console(F("setting address of plate sensor[%d] to %#08lx%08lx"), index + 1, configSensor->addressPlate[index].high,
-                    configSensor->addressPlate[index].low);
+    ProgramHandler *programHandler = ProgramHandler::getInstance();
+    char name[17];
+
+    for (uint8_t i = 0; i < programHandler->getQueueLength(); i++) {
+        QueueItem *item = programHandler->getQueueItem(i);
+        if (!ProgramStore::getInstance()->getName(item->program, name)) {
+            name[0] = 0;
+        }
+        switch (item->condition) {
+        case queueDelay:
+            Logger::console(F("queue %d: #%d %s, %umin after the previous program"), i + 1, item->program, name, item->parameter);
+            break;
+        case queueCooled:
+            Logger::console(F("queue %d: #%d %s, when the hive is below %u"), i + 1, item->program, name, item->parameter);
+            break;
+        default:
+            Logger::console(F("queue %d: #%d %s"), i + 1, item->program, name);
         }
-    } else {
-        return false;
     }
-    return true;
 }
 
-bool SerialConsole::handleCmdIO(String &command, int32_t value)
+/**
+ * Parse the name of a command with an optional index ("NAME" or "NAME[index]"),
+ * look it up in the command table and validate the index (which is converted to 0-based).
+ * The name is converted to upper case and terminated before the index in place.
+ */
+ConsoleError SerialConsole::parseCommand(char *name, ConsoleCommand *command, uint8_t *index)
 {
-    ConfigurationIO *configIO = Configuration::getIO();
-    if (command == String(F("PIN_BEEP"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting output pin for beeper to %d"), value);
-        configIO->beeper = value;
-    } else if (command == String(F("PIN_NEXT"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting input pin for button next to %d"), value);
-        configIO->buttonNext = value;
-    } else if (command == String(F("PIN_SELECT"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting input pin for button select to %d"), value);
-        configIO->buttonSelect = value;
-    } else if (command.startsWith(String(F("PIN_FAN")))) {
-        value = constrain(value, 0, 255);
-        uint8_t index = getIndex(command);
-        if (index <= Configuration::getParams()->numberOfPlates) {
-            Logger::console(F("setting output pin for fan[%d] to %d"), index, value);
-            configIO->fan[index - 1] = value;
-        }
-    } else if (command.startsWith(String(F("PIN_HEATER")))) {
-        value = constrain(value, 0, 255);
-        uint8_t index = getIndex(command);
-        if (index <= Configuration::getParams()->numberOfPlates) {
-            Logger::console(F("setting output pin for heater[%d] to %d"), index, value);
-            configIO->heater[index - 1] = value;
-        }
-    } else if (command == String(F("PIN_HB"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting output pin for heartbeat signal to %d"), value);
-        configIO->heartbeat = value;
-    } else if (command == String(F("PIN_RELAY"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting output pin for heater main relay to %d"), value);
-        configIO->heaterRelay = value;
-    } else if (command == String(F("PIN_FAN_HUMID"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting output pin for humidifier fan to %d"), value);
-        configIO->humidifierFan = value;
-    } else if (command == String(F("PIN_HUMID"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting input pin for humdity sensor to %d"), value);
-        configIO->humiditySensor = value;
-    } else if (command == String(F("HUMID_TYPE"))) {
-        if (value != 11 && value != 21 && value != 22)
-            value = 22;
-        Logger::console(F("setting humidity sensor type to %d"), value);
-        configIO->humiditySensorType = value;
-    } else if (command == String(F("PIN_LCD_D4"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting output pin LCD D4 to %d"), value);
-        configIO->lcdD4 = value;
-    } else if (command == String(F("PIN_LCD_D5"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting output pin LCD D5 to %d"), value);
-        configIO->lcdD5 = value;
-    } else if (command == String(F("PIN_LCD_D6"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting output pin LCD D6 to %d"), value);
-        configIO->lcdD6 = value;
-    } else if (command == String(F("PIN_LCD_D7"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting output pin LCD D7 to %d"), value);
-        configIO->lcdD7 = value;
-    } else if (command == String(F("PIN_LCD_EN"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting output pin LCD enable to %d"), value);
-        configIO->lcdEnable = value;
-    } else if (command == String(F("PIN_LCD_RS"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting output pin LCD RS to %d"), value);
-        configIO->lcdRs = value;
-    } else if (command == String(F("PIN_TEMP"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting input pin temperature sensors to %d"), value);
-        configIO->temperatureSensor = value;
-    } else if (command == String(F("PIN_VAPOR"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("setting output pin for vaporizer to %d"), value);
-        configIO->vaporizer = value;
-    } else {
-        return false;
+    *index = 0;
+    char *bracket = strchr(name, '[');
+    if (bracket != NULL) {
+        *bracket = 0;
+        *index = atoi(bracket + 1);
     }
-    return true;
+    for (char *c = name; *c; c++) {
+        *c = toupper(*c);
+    }
+
+    if (!findCommand(name, command)) {
+        return consoleErrorUnknown;
+    }
+    uint8_t elements = getNumberOfElements(command, false);
+    if (elements > 0) {
+        if (*index < 1 || *index > elements) {
+            return consoleErrorIndex;
+        }
+        (*index)--;
+    }
+    if (command->type != ConsoleCommand::typeAction && getTarget(command->target) == NULL) {
+        return consoleErrorNoProgram;
+    }
+    return consoleOk;
 }
 
-bool SerialConsole::handleCmdProgram(String &command, int32_t value)
+/**
+ * Parse the value of a command. In strict mode values out of range are rejected,
+ * otherwise they are limited to the range of the command.
+ */
+ConsoleError SerialConsole::parseValue(ConsoleCommand *command, char *parameter, int32_t *value, bool strict)
 {
-    Program *program = ProgramHandler::getInstance()->getRunningProgram();
-    if (!program) {
-        return false;
+    char *end;
+
+    if (command->type == ConsoleCommand::typeString) {
+        *value = 0;
+        return (strict && strlen(parameter) > (size_t) command->maximum ? consoleErrorValue : consoleOk);
     }
-    if (command == String(F("TEMP-PREHEAT"))) {
-        value = constrain(value, 0, 600);
-        Logger::console(F("Setting pre-heat hive temperature to %d.%d deg C"), value / 10, value % 10);
-        program->temperaturePreHeat = value;
-    } else if (command == String(F("TEMP"))) {
-        value = constrain(value, 0, 600);
-        Logger::console(F("Setting hive temperature to %d.%d deg C"), value / 10, value % 10);
-        program->temperatureHive = value;
-    } else if (command == String(F("TEMP-PLATE"))) {
-        value = constrain(value, 0, 1000);
-        Logger::console(F("Setting max. plate temperature to %d.%d deg C"), value / 10, value % 10);
-        program->temperaturePlate = value;
-    } else if (command == String(F("FANSPEED-PREHEAT"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("Setting pre-heat fan speed to %d"), value);
-        program->fanSpeedPreHeat = value;
-        program->changed = true;
-    } else if (command == String(F("FANSPEED"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("Setting fan speed to %d"), value);
-        program->fanSpeed = value;
-        program->changed = true;
-    } else if (command == String(F("FANSPEED-HUMID"))) {
-        value = constrain(value, 0, 255);
-        Logger::console(F("Setting speed of humidifier fan to %d"), value);
-        program->fanSpeedHumidifier = value;
-        program->changed = true;
-    } else if (command == String(F("HUMIDITY-MIN"))) {
-        value = constrain(value, 0, 100);
-        Logger::console(F("Setting relative humidity minimum to %d %%"), value);
-        program->humidityMinimum = value;
-        program->changed = true;
-    } else if (command == String(F("HUMIDITY-MAX"))) {
-        value = constrain(value, 0, 100);
-        Logger::console(F("Setting relative humidity maximum to %d %%"), value);
-        program->humidityMaximum = value;
-        program->changed = true;
-    } else if (command == String(F("DURATION-PREHEAT"))) {
-        value = constrain(value, 0, 0xffff);
-        Logger::console(F("Setting duration of pre-heat cycle to %d min"), value);
-        program->durationPreHeat = value;
-    } else if (command == String(F("DURATION"))) {
-        value = constrain(value, 0, 0xffff);
-        Logger::console(F("Setting duration of program to %d min"), value);
-        program->duration = value;
-    } else if (command == String(F("HIVE-KP"))) {
-        program->hiveKp = (double) value / (double) 100.0;
-        Logger::console(F("Setting hive temperature Kp to %s"), String(program->hiveKp).c_str());
-        program->changed = true;
-    } else if (command == String(F("HIVE-KI"))) {
-        program->hiveKi = (double) value / (double) 100.0;
-        Logger::console(F("Setting hive temperature Ki to %s"), String(program->hiveKi).c_str());
-        program->changed = true;
-    } else if (command == String(F("HIVE-KD"))) {
-        program->hiveKd = (double) value / (double) 100.0;
-        Logger::console(F("Setting hive temperature Kd to %s"), String(program->hiveKd).c_str());
-        program->changed = true;
-    } else if (command == String(F("PLATE-KP"))) {
-        program->plateKp = (double) value / (double) 100.0;
-        Logger::console(F("Setting plate temperature Kp to %s"), String(program->plateKp).c_str());
-        program->changed = true;
-    } else if (command == String(F("PLATE-KI"))) {
-        program->plateKi = (double) value / (double) 100.0;
-        Logger::console(F("Setting plate temperature Ki to %s"), String(program->plateKi).c_str());
-        program->changed = true;
-    } else if (command == String(F("PLATE-KD"))) {
-        program->plateKd = (double) value / (double) 100.0;
-        Logger::console(F("Setting plate temperature Kd to %s"), String(program->plateKd).c_str());
-        program->changed = true;
-    } else {
-        return false;
+    *value = strtol(parameter, &end, 0);
+    if (strict && (end == parameter || *end != 0)) {
+        return consoleErrorValue;
     }
-    return true;
+    if (*value < command->minimum || *value > command->maximum) {
+        if (strict) {
+            return consoleErrorValue;
+        }
+        *value = constrain(*value, command->minimum, command->maximum);
+    }
+    if ((command->flags & ConsoleCommand::flagHumidityType) && *value != 11 && *value != 21 && *value != 22) {
+        if (strict) {
+            return consoleErrorValue;
+        }
+        *value = 22;
+    }
+    return consoleOk;
+}
+
+/**
+ * Parse a sensor address of up to 16 hex digits (with optional "0x" prefix).
+ */
+ConsoleError SerialConsole::parseAddress(char *parameter, SensorAddress *address)
+{
+    uint32_t high = 0, low = 0;
+
+    if (parameter[0] == '0' && (parameter[1] == 'x' || parameter[1] == 'X')) {
+        parameter += 2;
+    }
+    for (uint8_t i = 0; parameter[i]; i++) {
+        if (!isxdigit(parameter[i]) || i >= 16) {
+            return consoleErrorValue;
+        }
+        uint8_t digit = (parameter[i] <= '9' ? parameter[i] - '0' : (parameter[i] | 0x20) - 'a' + 10);
+        high = (high << 4) | (low >> 28);
+        low = (low << 4) | digit;
+    }
+    address->high = high;
+    address->low = low;
+    return consoleOk;
+}
+
+/**
+ * Look up a command by its (upper case) name with a binary search in the command table.
+ * If found, the descriptor is copied from flash to command.
+ */
+bool SerialConsole::findCommand(const char *name, ConsoleCommand *command)
+{
+    uint8_t low = 0, high = NUMBER_OF_COMMANDS;
+
+    while (low < high) {
+        uint8_t middle = (low + high) / 2;
+        int result = strcmp_P(name, commands[middle].name);
+        if (result == 0) {
+            memcpy_P(command, &commands[middle], sizeof(ConsoleCommand));
+            return true;
+        }
+        if (result < 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return false;
+}
+
+/**
+ * Get the base address of the object which contains the fields of a target
+ * (NULL if no program is running for program commands).
+ */
+uint8_t *SerialConsole::getTarget(uint8_t target)
+{
+    switch (target) {
+    case ConsoleCommand::targetParams:
+        return (uint8_t *) Configuration::getParams();
+    case ConsoleCommand::targetSensor:
+        return (uint8_t *) Configuration::getSensor();
+    case ConsoleCommand::targetIO:
+        return (uint8_t *) Configuration::getIO();
+    case ConsoleCommand::targetProgram:
+        return (uint8_t *) ProgramHandler::getInstance()->getProgram();
+    }
+    return NULL;
+}
+
+/**
+ * Get the address of an element of the field of a command.
+ */
+uint8_t *SerialConsole::getField(ConsoleCommand *command, uint8_t index)
+{
+    uint8_t size = 1;
+
+    switch (command->type) {
+    case ConsoleCommand::typeUint16:
+    case ConsoleCommand::typeInt16:
+        size = 2;
+        break;
+    case ConsoleCommand::typeDouble:
+        size = sizeof(double);
+        break;
+    case ConsoleCommand::typeAddress:
+        size = sizeof(SensorAddress);
+        break;
+    }
+    if (command->flags & ConsoleCommand::flagSegments) {
+        size = sizeof(ProgramSegment);
+    }
+    return getTarget(command->target) + command->offset + index * size;
+}
+
+/**
+ * Get the number of elements of an array command (0 if it's not an array).
+ * In the menu only the configured hive sensors (at least one) and the used segments plus an empty one are listed.
+ */
+uint8_t SerialConsole::getNumberOfElements(ConsoleCommand *command, bool menu)
+{
+    if (command->flags & ConsoleCommand::flagPlates) {
+        return Configuration::getParams()->numberOfPlates;
+    }
+    if (command->flags & ConsoleCommand::flagHiveSensors) {
+        if (!menu) {
+            return CFG_MAX_NUMBER_PLATES;
+        }
+        uint8_t count = 1;
+        while (count < CFG_MAX_NUMBER_PLATES && Configuration::getSensor()->addressHive[count].value != 0) {
+            count++;
+        }
+        return count;
+    }
+    if (command->flags & ConsoleCommand::flagSegments) {
+        Program *program = ProgramHandler::getInstance()->getProgram();
+        if (!menu || program == NULL) {
+            return CFG_MAX_PROGRAM_SEGMENTS;
+        }
+        uint8_t count = 0;
+        while (count < CFG_MAX_PROGRAM_SEGMENTS && program->segments[count].type != segmentEnd) {
+            count++;
+        }
+        return min(count + 1, CFG_MAX_PROGRAM_SEGMENTS);
+    }
+    return 0;
+}
+
+/**
+ * Get the current value of a field (or of the setting an action modifies, -1 if none).
+ */
+int32_t SerialConsole::getValue(ConsoleCommand *command, uint8_t index)
+{
+    if (command->type == ConsoleCommand::typeAction) {
+        switch (command->offset) {
+        case ConsoleCommand::actionLogLevel:
+            return Configuration::getParams()->loglevel;
+        case ConsoleCommand::actionModuleLogLevel:
+            return Logger::getLogLevel((Logger::Module) command->argument);
+        case ConsoleCommand::actionTelemetry:
+            return Telemetry::getInstance()->getInterval();
+        case ConsoleCommand::actionEditProgram:
+            return ProgramHandler::getInstance()->getProgramNumber();
+        case ConsoleCommand::actionQueue:
+            return ProgramHandler::getInstance()->getQueueLength();
+        }
+        return -1;
+    }
+
+    uint8_t *field = getField(command, index);
+    switch (command->type) {
+    case ConsoleCommand::typeUint8:
+        return *field;
+    case ConsoleCommand::typeUint16:
+        return *(uint16_t *) field;
+    case ConsoleCommand::typeInt16:
+        return *(int16_t *) field;
+    case ConsoleCommand::typeDouble:
+        return (int32_t) (*(double *) field * 100.0 + 0.5);
+    }
+    return -1;
+}
+
+/**
+ * Store a value in a field according to the type of the command.
+ */
+void SerialConsole::setValue(ConsoleCommand *command, uint8_t index, int32_t value)
+{
+    uint8_t *field = getField(command, index);
+
+    switch (command->type) {
+    case ConsoleCommand::typeUint8:
+        *field = value;
+        break;
+    case ConsoleCommand::typeUint16:
+        *(uint16_t *) field = value;
+        break;
+    case ConsoleCommand::typeInt16:
+        *(int16_t *) field = value;
+        break;
+    case ConsoleCommand::typeDouble:
+        *(double *) field = (double) value / (double) 100.0;
+        break;
+    }
+    if (command->flags & ConsoleCommand::flagChanged) {
+        ((Program *) getTarget(command->target))->changed = true;
+    }
+}
+
+/**
+ * Store a text in a field, it is truncated to the maximum length of the command.
+ */
+void SerialConsole::setText(ConsoleCommand *command, char *text)
+{
+    char *field = (char *) getField(command, 0);
+
+    strncpy(field, text, command->maximum);
+    field[command->maximum] = 0;
 }
 
 bool SerialConsole::handleShortCmd()
@@ -485,7 +1071,7 @@ bool SerialConsole::handleShortCmd()
         break;
 
     case 'x':
-        Logger::info(F("Stopping program"));
+        LOG_INFO(Logger::moduleSerialConsole, F("Stopping program"));
         ProgramHandler::getInstance()->stop();
         break;
 
@@ -508,14 +1094,3 @@ bool SerialConsole::handleShortCmd()
     return true;
 }
 
-/**
- * Extract the index of an parameter with array notation
- */
-uint8_t SerialConsole::getIndex(String command)
-{
-    String indexStr = command.substring(command.indexOf('[') + 1, command.indexOf(']'));
-    if (indexStr.length() > 0) {
-        return indexStr.toInt();
-    }
-    return 255;
-}
@@ -31,6 +31,84 @@
 #include "Logger.h"
 #include "Device.h"
 #include "ProgramHandler.h"
+#include "ProgramStore.h"
+#include "Telemetry.h"
+#include "History.h"
+#include "ConsoleProtocol.h"
+
+/*
+ * Descriptor of a console command, stored in a sorted table in flash
+ */
+class ConsoleCommand
+{
+public:
+    enum Type
+    {
+        typeUint8,
+        typeUint16,
+        typeInt16,
+        typeDouble, // entered and displayed multiplied by 100
+        typeAddress, // 64 bit sensor address entered in hex
+        typeString, // text, the maximum defines the length
+        typeAction // no field, the offset selects the action to execute
+    };
+    enum Target
+    {
+        targetSystem,
+        targetParams,
+        targetSensor,
+        targetIO,
+        targetProgram, // the loaded program (running or to be edited)
+        numberOfTargets
+    };
+    enum Flag
+    {
+        flagPlates = 1, // array with one element per installed plate
+        flagHiveSensors = 2, // array with one element per hive sensor
+        flagChanged = 4, // mark the program as changed after modification
+        flagHumidityType = 8, // only 11, 21 and 22 are valid values
+        flagSegments = 16 // array with one element per program segment
+    };
+    enum Action
+    {
+        actionStart,
+        actionHistory,
+        actionStatistics,
+        actionLogLevel,
+        actionModuleLogLevel, // the argument defines the module
+        actionTelemetry,
+        actionListPrograms,
+        actionEditProgram,
+        actionSaveProgram,
+        actionDeleteProgram,
+        actionQueue,
+        actionQueueCool,
+        actionQueueDelay
+    };
+
+    char name[20]; // name of the command in upper case
+    uint8_t type; // the Type of the field
+    uint8_t target; // the Target which contains the field, also defines the menu section
+    uint8_t offset; // offset of the field within the target or the Action
+    uint8_t argument; // additional argument of an action
+    uint8_t flags; // combination of Flag values
+    int32_t minimum; // the minimum value
+    int32_t maximum; // the maximum value
+    const char *help; // description in flash
+};
+
+/*
+ * The state which the actions of a batch request depend on, updated by each
+ * validated action to check the preconditions of the following ones.
+ */
+struct BatchState
+{
+    bool active; // a program is active
+    bool loaded; // a program is loaded for editing
+    uint8_t queueLength; // number of queued programs
+    uint16_t saved; // bit mask of the programs saved by previous items
+    uint16_t removed; // bit mask of the programs deleted by previous items
+};
 
 class SerialConsole: Device
 {
@@ -42,19 +120,37 @@ public:
 private:
     char cmdBuffer[CFG_SERIAL_BUFFER_SIZE + 1];
     int ptrBuffer;
+    uint8_t menuSection; // the section of the menu to be printed (a ConsoleCommand::Target)
+    uint8_t menuIndex; // index of the next command to be printed
+    uint8_t menuElement; // the next element of an array command to be printed
+    bool menuHeader; // is the header of the section still to be printed
+    uint8_t historyAge; // age of the next history record to be printed
+    uint8_t historyEnd; // age up to which history records are printed
 
     bool handleShortCmd();
     bool handleCmd();
-    bool handleCmdSystem(String &command, int32_t value);
-    bool handleCmdParams(String &command, int32_t value);
-    bool handleCmdSensor(String &command, char *cmdBuffer);
-    bool handleCmdIO(String &command, int32_t value);
-    bool handleCmdProgram(String &command, int32_t value);
-    uint8_t getIndex(String command);
-    void printMenuParams();
-    void printMenuSensors();
-    void printMenuIO();
-    void printMenuProgram();
+    void handleBatch();
+    bool handleAction(ConsoleCommand *command, int32_t value);
+    ConsoleError checkAction(ConsoleCommand *command, int32_t value, BatchState *state);
+    bool programExists(uint8_t number, BatchState *state);
+    void printQueue();
+    void sendBatchReply(uint32_t sequence, ConsoleError error, uint8_t item);
+    void sendBatchReply(char *reply, int length);
+    int printValue(char *buffer, int size, ConsoleCommand *command, uint8_t index);
+    ConsoleError parseCommand(char *name, ConsoleCommand *command, uint8_t *index);
+    ConsoleError parseValue(ConsoleCommand *command, char *parameter, int32_t *value, bool strict);
+    ConsoleError parseAddress(char *parameter, SensorAddress *address);
+    bool findCommand(const char *name, ConsoleCommand *command);
+    uint8_t *getTarget(uint8_t target);
+    uint8_t *getField(ConsoleCommand *command, uint8_t index);
+    uint8_t getNumberOfElements(ConsoleCommand *command, bool menu);
+    int32_t getValue(ConsoleCommand *command, uint8_t index);
+    void setValue(ConsoleCommand *command, uint8_t index, int32_t value);
+    void setText(ConsoleCommand *command, char *text);
+    void printPendingMenu();
+    void printPendingHistory();
+    bool printMenuHeader();
+    bool printMenuEntry(ConsoleCommand *command, uint8_t element);
 };
 
 #endif /* SERIALCONSOLE_H_ */
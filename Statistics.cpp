@@ -25,12 +25,55 @@
  */
 
 #include "Statistics.h"
+#include "Sauna.h"
+
+/**
+ * Map the system state to an index in StatisticValues::timeInState
+ */
+static uint8_t stateToIndex(Status::SystemState state)
+{
+    switch (state) {
+    case Status::init:
+        return 0;
+    case Status::ready:
+        return 1;
+    case Status::preHeat:
+        return 2;
+    case Status::running:
+        return 3;
+    case Status::overtemp:
+        return 4;
+    case Status::shutdown:
+        return 5;
+    case Status::error:
+        return 6;
+    }
+    return 6;
+}
+
+/**
+ * Is a program active in the given state
+ */
+static bool isActive(Status::SystemState state)
+{
+    return state == Status::preHeat || state == Status::running || state == Status::overtemp;
+}
 
 /**
  * Constructor
  */
 Statistics::Statistics()
 {
+    memset(&values, 0, sizeof(StatisticValues));
+    for (int i = 0; i < CFG_MAX_NUMBER_PLATES; i++) {
+        powerRemainder[i] = 0;
+    }
+    sensorErrorsTemperature = 0;
+    sensorErrorsHumidity = 0;
+    secondsSinceSave = 0;
+    lastUpdate = 0;
+    millisRemainder = 0;
+    active = false;
 }
 
 /**
@@ -38,30 +81,38 @@ Statistics::Statistics()
  */
 Statistics::~Statistics()
 {
+
 }
 
 /**
- * Return the singleton
+ * Return the instance of the current sauna
  */
 Statistics *Statistics::getInstance()
 {
-    static Statistics instance;
-    return &instance;
+    return &Sauna::getCurrent()->statistics;
 }
 
 /**
- * Load the statistic data from EEPROM and verify the CRC
+ * Load the statistic data from EEPROM and verify the CRC.
+ * Statistics of a different layout version are reset.
  */
 bool Statistics::load()
 {
-    Logger::info(F("loading statistics"));
+    LOG_INFO(Logger::moduleSystem, F("loading statistics"));
+    EepromWriter::flush();
     EEPROM.get(CONFIG_ADDRESS_STATISTICS, *getStatistics());
 
+    if (getStatistics()->version != STATISTICS_VERSION) {
+        LOG_WARN(Logger::moduleSystem, F("statistics of version %d found --> resetting statistics"), getStatistics()->version);
+        reset();
+        save();
+    }
     if (getStatistics()->crc != Crc::calculate((uint8_t *) getStatistics() + 4, sizeof(StatisticValues) - 4)) {
-        status.errorCode = Status::crcStatistics;
-        Logger::error(F("invalid crc detected in stored statistics"));
+        Status::getInstance()->errorCode = Status::crcStatistics;
+        LOG_ERROR(Logger::moduleSystem, F("invalid crc detected in stored statistics"));
         return false;
     }
+    lastUpdate = millis();
     return true;
 }
 
@@ -71,8 +122,11 @@ bool Statistics::load()
 void Statistics::save()
 {
     getStatistics()->crc = Crc::calculate((uint8_t*) (getStatistics()) + 4, sizeof(StatisticValues) - 4);
-    Logger::info(F("saving statistics"));
-    EEPROM.put(CONFIG_ADDRESS_STATISTICS, *getStatistics());
+    LOG_INFO(Logger::moduleSystem, F("saving statistics"));
+    if (!EepromWriter::write(CONFIG_ADDRESS_STATISTICS, getStatistics(), sizeof(StatisticValues), true)) {
+        LOG_ERROR(Logger::moduleSystem, F("unable to queue statistics for saving"));
+    }
+    secondsSinceSave = 0;
 }
 
 /**
@@ -80,16 +134,126 @@ void Statistics::save()
  */
 void Statistics::reset()
 {
-    Logger::info(F("resetting statistics"));
+    LOG_INFO(Logger::moduleSystem, F("resetting statistics"));
+    StatisticValues *stats = getStatistics();
+    memset(stats, 0, sizeof(StatisticValues));
+    stats->version = STATISTICS_VERSION;
+    stats->minHiveTemperature = 999;
+    stats->maxHiveTemperature = -999;
+    stats->minPlateTemperature = 999;
+    stats->maxPlateTemperature = -999;
+}
+
+/**
+ * Called about once per second to update the counters, the values are weighted with the
+ * whole seconds measured since the previous call (the rest is carried to the next call).
+ * The statistics are saved every CFG_STATISTICS_SAVE_INTERVAL while a program is active
+ * and when it ends. While idle, only the time in state is counted and saved with the next program.
+ */
+void Statistics::process()
+{
+    Status *status = Status::getInstance();
+    StatisticValues *stats = getStatistics();
+    Status::SystemState state = status->getSystemState();
+    bool wasActive = active;
+    active = isActive(state);
+
+    uint32_t now = millis();
+    uint32_t elapsed = now - lastUpdate + millisRemainder;
+    uint32_t seconds = elapsed / 1000;
+    lastUpdate = now;
+    millisRemainder = elapsed % 1000;
+
+    stats->timeInState[stateToIndex(state)] += seconds;
+    stats->sensorErrorsTemperature += status->sensorErrorsTemperature - sensorErrorsTemperature;
+    stats->sensorErrorsHumidity += status->sensorErrorsHumidity - sensorErrorsHumidity;
+    sensorErrorsTemperature = status->sensorErrorsTemperature;
+    sensorErrorsHumidity = status->sensorErrorsHumidity;
+
+    if (active) {
+        uint8_t plates = Configuration::getParams()->numberOfPlates, validPlates = 0;
+        int32_t plateSum = 0;
+
+        if (!wasActive && ProgramHandler::getInstance()->getSegmentNumber() < CFG_MAX_PROGRAM_SEGMENTS) {
+            stats->treatments++; // an extended program isn't a new treatment
+        }
+        stats->timeActive += seconds;
+
+        for (uint8_t i = 0; i < plates; i++) {
+            uint32_t power = powerRemainder[i] + (uint32_t) status->powerPlate[i] * seconds;
+            stats->timeFullPower[i] += power / 255;
+            powerRemainder[i] = power % 255;
+            if (status->temperaturePlate[i] == -999) { // sensor error
+                continue;
+            }
+            plateSum += status->temperaturePlate[i];
+            validPlates++;
+            stats->minPlateTemperature = min(stats->minPlateTemperature, status->temperaturePlate[i]);
+            stats->maxPlateTemperature = max(stats->maxPlateTemperature, status->temperaturePlate[i]);
+        }
+        if (validPlates > 0) {
+            stats->sumPlateTemperature += (int64_t) (plateSum / validPlates) * seconds;
+        }
+
+        for (int i = 0; (Configuration::getSensor()->addressHive[i].value != 0) && (i < CFG_MAX_NUMBER_PLATES); i++) {
+            if (status->temperatureTargetHive > 0 && status->temperatureHive[i] > status->temperatureTargetHive) {
+                stats->aboveTarget[i] += (uint32_t) (status->temperatureHive[i] - status->temperatureTargetHive) * seconds;
+            }
+        }
+        if (status->temperatureActualHive != -999) {
+            stats->sumHiveTemperature += (int64_t) status->temperatureActualHive * seconds;
+            stats->minHiveTemperature = min(stats->minHiveTemperature, status->temperatureActualHive);
+            stats->maxHiveTemperature = max(stats->maxHiveTemperature, status->temperatureActualHive);
+        }
+    }
+
+    if (wasActive && !active) {
+        save();
+    } else if (active && (secondsSinceSave += seconds) >= CFG_STATISTICS_SAVE_INTERVAL) {
+        save();
+    }
+}
+
+/**
+ * Print the statistics to the serial console.
+ */
+void Statistics::print()
+{
     StatisticValues *stats = getStatistics();
-    stats->unused = 0;
+    uint32_t timeActive = max(stats->timeActive, (uint32_t) 1);
+
+    Logger::console(F("\nStatistics:"));
+    Logger::console(F("treatments: %u, sensor errors: %u temperature / %u humidity"), stats->treatments,
+            stats->sensorErrorsTemperature, stats->sensorErrorsHumidity);
+    Logger::console(F("time in state (in min): ready %lu, pre-heat %lu, running %lu, over-temp %lu, shut-down %lu, error %lu"),
+            stats->timeInState[stateToIndex(Status::ready)] / 60, stats->timeInState[stateToIndex(Status::preHeat)] / 60,
+            stats->timeInState[stateToIndex(Status::running)] / 60, stats->timeInState[stateToIndex(Status::overtemp)] / 60,
+            stats->timeInState[stateToIndex(Status::shutdown)] / 60, stats->timeInState[stateToIndex(Status::error)] / 60);
+    Logger::console(F("hive (in 0.1 deg C): min %d, max %d, mean %d"), stats->minHiveTemperature, stats->maxHiveTemperature,
+            (int16_t) (stats->sumHiveTemperature / timeActive));
+    Logger::console(F("plates (in 0.1 deg C): min %d, max %d, mean %d"), stats->minPlateTemperature, stats->maxPlateTemperature,
+            (int16_t) (stats->sumPlateTemperature / timeActive));
+    for (uint8_t i = 0; i < Configuration::getParams()->numberOfPlates; i++) {
+        Logger::console(F("plate %d: duty %lu%%, full power %lu min, %lu Wh"), i + 1, stats->timeFullPower[i] * 100 / timeActive,
+                stats->timeFullPower[i] / 60, getEnergy(i));
+    }
+    for (int i = 0; (Configuration::getSensor()->addressHive[i].value != 0) && (i < CFG_MAX_NUMBER_PLATES); i++) {
+        Logger::console(F("hive sensor %d: %lu deg C * min above target"), i + 1, stats->aboveTarget[i] / 600);
+    }
+}
+
+/**
+ * Return the estimated energy consumed by a plate (in Wh)
+ */
+uint32_t Statistics::getEnergy(uint8_t plate)
+{
+    return getStatistics()->timeFullPower[plate] / 60 * CFG_HEATER_POWER_WATTS / 60;
 }
 
 /**
- * Return the singleton instance of the statistical values
+ * Return the statistical values of the current sauna
  */
 StatisticValues *Statistics::getStatistics()
 {
-    static StatisticValues stats;
-    return &stats;
+    return &Sauna::getCurrent()->statistics.values;
 }
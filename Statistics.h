@@ -33,19 +33,42 @@
 #include "Logger.h"
 #include "Crc.h"
 #include "Status.h"
+#include "EepromWriter.h"
 #include <EEPROM.h>
 
 #define CONFIG_ADDRESS_STATISTICS   768
+#define STATISTICS_VERSION          2 // increase when changing StatisticValues, stored values with a different version are reset
+#define STATISTICS_NUMBER_OF_STATES 7 // number of Status::SystemState values
 
+/*
+ * Lifetime counters, temperatures are in 0.1 deg C. The temperature values are only
+ * accumulated while a program is active (pre-heat, running, over-temp), failed sensor reads are skipped.
+ */
 class StatisticValues
 {
 public:
     uint32_t crc; // 0-3
+    uint16_t version; // 4-5 layout version of this block
 
-    uint8_t unused;
-    // 5 bytes used
+    uint16_t treatments; // 6-7 number of started programs
+    int64_t sumHiveTemperature; // 8-15 sum of the relevant hive temperature per second (for the mean)
+    int64_t sumPlateTemperature; // 16-23 sum of the average plate temperature per second (for the mean)
+    uint32_t timeInState[STATISTICS_NUMBER_OF_STATES]; // 24-51 time spent in each system state (in s)
+    uint32_t timeFullPower[CFG_MAX_NUMBER_PLATES]; // 52-111 heater duty of each plate as time at full power (in s)
+    uint32_t aboveTarget[CFG_MAX_NUMBER_PLATES]; // 112-171 temperature above target per hive sensor (in 0.1 deg C * s)
+    uint32_t timeActive; // 172-175 time a program was active (in s)
+    uint16_t sensorErrorsTemperature; // 176-177 number of failed temperature sensor reads
+    uint16_t sensorErrorsHumidity; // 178-179 number of failed humidity sensor reads
+    int16_t minHiveTemperature; // 180-181 minimum relevant hive temperature
+    int16_t maxHiveTemperature; // 182-183 maximum relevant hive temperature
+    int16_t minPlateTemperature; // 184-185 minimum temperature of all plates
+    int16_t maxPlateTemperature; // 186-187 maximum temperature of all plates
+    uint32_t reserved; // 188-191 pads the block to a multiple of 8 bytes, like the host does
+    // 192 bytes used
 };
 
+static_assert(sizeof(StatisticValues) == 192, "the statistics must have the same layout on the board and the host");
+
 class Statistics
 {
 public:
@@ -55,11 +78,24 @@ public:
     bool load();
     void save();
     void reset();
+    void process();
+    void print();
+    uint32_t getEnergy(uint8_t plate);
 
 private:
+    friend class Sauna; // owns the instance
     Statistics();
     Statistics(Statistics const&); // copy disabled
     void operator=(Statistics const&); // assigment disabled
+
+    StatisticValues values;
+    uint8_t powerRemainder[CFG_MAX_NUMBER_PLATES]; // heater power (0-255 per second) not yet added to timeFullPower
+    uint16_t sensorErrorsTemperature; // last seen value of Status::sensorErrorsTemperature
+    uint16_t sensorErrorsHumidity; // last seen value of Status::sensorErrorsHumidity
+    uint16_t secondsSinceSave;
+    uint32_t lastUpdate; // time of the previous call of process() (in ms)
+    uint16_t millisRemainder; // time not yet counted in whole seconds (in ms)
+    bool active; // was a program active at the last call of process()
 };
 
 #endif /* STATISTICS_H_ */
@@ -28,6 +28,7 @@
  */
 
 #include "Status.h"
+#include "Sauna.h"
 
 /*
  * Constructor
@@ -50,9 +51,19 @@ Status::Status()
     fanTimeHumidifier = 0;
     vaporizerEnabled = false;
     humidity = 0;
+    sensorErrorsTemperature = 0;
+    sensorErrorsHumidity = 0;
 
 }
 
+/*
+ * Returns the status of the current sauna.
+ */
+Status *Status::getInstance()
+{
+    return &Sauna::getCurrent()->status;
+}
+
 /*
  * Returns the current system state.
  */
@@ -110,9 +121,9 @@ Status::SystemState Status::setSystemState(SystemState newSystemState)
         }
     }
     if (systemState == newSystemState) {
-        Logger::info(F("switching to state '%s'"), systemStateToStr(systemState).c_str());
+        LOG_INFO(Logger::moduleSystem, F("switching to state '%S'"), systemStateToStr(systemState));
     } else {
-        Logger::error(F("switching from state '%s' to '%s' is not allowed"), systemStateToStr(systemState).c_str(), systemStateToStr(newSystemState).c_str());
+        LOG_ERROR(Logger::moduleSystem, F("switching from state '%S' to '%S' is not allowed"), systemStateToStr(systemState), systemStateToStr(newSystemState));
         systemState = error;
         errorCode = invalidState;
     }
@@ -121,9 +132,9 @@ Status::SystemState Status::setSystemState(SystemState newSystemState)
 }
 
 /*
- * Convert the state into a string.
+ * Convert the state into a string (located in flash memory).
  */
-String Status::systemStateToStr(SystemState state)
+const __FlashStringHelper *Status::systemStateToStr(SystemState state)
 {
     switch (state) {
     case init:
@@ -145,9 +156,9 @@ String Status::systemStateToStr(SystemState state)
 }
 
 /*
- * Convert the error code into a string.
+ * Convert the error code into a string (located in flash memory).
  */
-String Status::getError()
+const __FlashStringHelper *Status::getError()
 {
     switch (errorCode) {
     case none:
@@ -174,5 +185,3 @@ String Status::getError()
     return F("n/a");
 }
 
-Status status;
-
@@ -60,10 +60,11 @@ public:
     };
 
     Status();
+    static Status *getInstance();
     SystemState getSystemState();
     SystemState setSystemState(SystemState);
-    String systemStateToStr(SystemState);
-    String getError();
+    const __FlashStringHelper *systemStateToStr(SystemState);
+    const __FlashStringHelper *getError();
 
     ErrorCode errorCode;
     int16_t temperatureHive[CFG_MAX_NUMBER_PLATES];
@@ -78,11 +79,11 @@ public:
     uint32_t fanTimeHumidifier;
     bool vaporizerEnabled;
     uint8_t humidity;
+    uint16_t sensorErrorsTemperature; // number of failed temperature sensor reads since start-up
+    uint16_t sensorErrorsHumidity; // number of failed humidity sensor reads since start-up
 
 private:
     SystemState systemState; // the current state of the system, to be modified by the state machine of this class only
 };
 
-extern Status status;
-
 #endif /* STATUS_H_ */
@@ -0,0 +1,182 @@
+/*
+ * Telemetry.cpp
+ *
+ * Sends the values of the Status as compact binary frames over the serial
+ * port (see TelemetryFormat.h). Use tools/TelemetryDecoder.cpp to convert the
+ * stream into CSV.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "Telemetry.h"
+#include "Sauna.h"
+
+Telemetry::Telemetry()
+{
+    lastChannels = 0;
+    interval = 0;
+    tickCounter = 0;
+    sequence = 0;
+    framesSinceKeyFrame = 0;
+}
+
+Telemetry::~Telemetry()
+{
+
+}
+
+/**
+ * Return the instance of the current sauna
+ */
+Telemetry *Telemetry::getInstance()
+{
+    return &Sauna::getCurrent()->telemetry;
+}
+
+/**
+ * Set the number of loop cycles between two frames (0 = telemetry disabled).
+ * Enabling the telemetry always starts with a key frame.
+ */
+void Telemetry::setInterval(uint8_t interval)
+{
+    this->interval = interval;
+    tickCounter = 0;
+    lastChannels = 0;
+}
+
+uint8_t Telemetry::getInterval()
+{
+    return interval;
+}
+
+bool Telemetry::isEnabled()
+{
+    return interval != 0;
+}
+
+/**
+ * Called in every loop cycle, sends a frame if the interval has passed.
+ */
+void Telemetry::process()
+{
+    if (interval == 0 || ++tickCounter < interval) {
+        return;
+    }
+    tickCounter = 0;
+
+    int32_t values[TELEMETRY_MAX_CHANNELS];
+    uint8_t channels = collect(values);
+    bool keyFrame = (channels != lastChannels || framesSinceKeyFrame >= CFG_TELEMETRY_KEYFRAME_INTERVAL);
+
+    if (send(encode(values, channels, keyFrame))) {
+        memcpy(lastValues, values, channels * sizeof(int32_t));
+        lastChannels = channels;
+        framesSinceKeyFrame = (keyFrame ? 0 : framesSinceKeyFrame + 1);
+    } else {
+        lastChannels = 0; // the decoder would lose track of the deltas, force a key frame
+    }
+    sequence++;
+}
+
+/**
+ * Gather the values of all channels, returns the number of channels.
+ */
+uint8_t Telemetry::collect(int32_t *values)
+{
+    ProgramHandler *programHandler = ProgramHandler::getInstance();
+    Status *status = Status::getInstance();
+    uint8_t plates = Configuration::getParams()->numberOfPlates;
+    uint8_t channel = telemetryFixedChannels;
+
+    values[telemetryState] = status->getSystemState();
+    values[telemetryErrorCode] = status->errorCode;
+    values[telemetryTimeRunning] = programHandler->calculateTimeRunning();
+    values[telemetryTimeRemaining] = programHandler->calculateTimeRemaining();
+    values[telemetryHiveActual] = status->temperatureActualHive;
+    values[telemetryHiveTarget] = status->temperatureTargetHive;
+    values[telemetryPlateTarget] = status->temperatureTargetPlate;
+    values[telemetryHumidity] = status->humidity;
+    values[telemetryHumidifierTemperature] = status->temperatureHumidifier;
+    values[telemetryHumidifierFan] = status->fanSpeedHumidifier;
+    values[telemetryVaporizer] = status->vaporizerEnabled;
+
+    for (int i = 0; (Configuration::getSensor()->addressHive[i].value != 0) && (i < CFG_MAX_NUMBER_PLATES); i++) {
+        values[channel++] = status->temperatureHive[i];
+    }
+    for (int i = 0; i < plates; i++) {
+        values[channel++] = status->temperaturePlate[i];
+    }
+    for (int i = 0; i < plates; i++) {
+        values[channel++] = status->powerPlate[i];
+    }
+    for (int i = 0; i < plates; i++) {
+        values[channel++] = status->fanSpeedPlate[i];
+    }
+    return channel;
+}
+
+/**
+ * Build a key or delta frame of the given values, returns the size of the frame.
+ */
+uint16_t Telemetry::encode(int32_t *values, uint8_t channels, bool keyFrame)
+{
+    uint8_t hiveSensors = channels - telemetryFixedChannels - 3 * Configuration::getParams()->numberOfPlates;
+    uint8_t maskSize = (channels + 7) / 8;
+    uint8_t *mask = frame + TELEMETRY_HEADER_SIZE;
+    uint16_t length = TELEMETRY_HEADER_SIZE + maskSize;
+
+    frame[0] = TELEMETRY_VERSION;
+    frame[1] = (keyFrame ? TELEMETRY_FLAG_KEYFRAME : 0);
+    frame[2] = sequence;
+    frame[3] = Configuration::getParams()->numberOfPlates;
+    frame[4] = hiveSensors;
+    memset(mask, 0, maskSize);
+
+    for (uint8_t i = 0; i < channels; i++) {
+        if (keyFrame || values[i] != lastValues[i]) {
+            mask[i / 8] |= 1 << (i % 8);
+            length += telemetryPutVarint(frame + length, (keyFrame ? values[i] : values[i] - lastValues[i]));
+        }
+    }
+
+    uint32_t crc = Crc::calculate(frame, length);
+    for (uint8_t i = 0; i < TELEMETRY_CRC_SIZE; i++) {
+        frame[length++] = crc >> (8 * i);
+    }
+    return length;
+}
+
+/**
+ * COBS encode the frame and queue it for output, delimited by 0x00 on both sides.
+ * Returns false if the frame was dropped because the buffer was full.
+ */
+bool Telemetry::send(uint16_t length)
+{
+    uint8_t encoded[TELEMETRY_MAX_FRAME_SIZE + TELEMETRY_MAX_FRAME_SIZE / 254 + 3];
+
+    encoded[0] = 0;
+    uint16_t encodedLength = telemetryCobsEncode(frame, length, encoded + 1) + 1;
+    encoded[encodedLength++] = 0;
+
+    return SerialBuffer::write(SerialBuffer::low, encoded, encodedLength);
+}
@@ -0,0 +1,70 @@
+/*
+ * Telemetry.h
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <Arduino.h>
+#include "config.h"
+#include "TelemetryFormat.h"
+#include "Configuration.h"
+#include "Status.h"
+#include "ProgramHandler.h"
+#include "SerialBuffer.h"
+#include "Crc.h"
+
+#define TELEMETRY_MAX_CHANNELS      (telemetryFixedChannels + 4 * CFG_MAX_NUMBER_PLATES)
+#define TELEMETRY_MAX_FRAME_SIZE    (TELEMETRY_HEADER_SIZE + (TELEMETRY_MAX_CHANNELS + 7) / 8 + 5 * TELEMETRY_MAX_CHANNELS + TELEMETRY_CRC_SIZE)
+
+class Telemetry
+{
+public:
+    static Telemetry *getInstance();
+    virtual ~Telemetry();
+    void process();
+    void setInterval(uint8_t interval);
+    uint8_t getInterval();
+    bool isEnabled();
+
+private:
+    friend class Sauna; // owns the instance
+    Telemetry();
+    Telemetry(Telemetry const&); // copy disabled
+    void operator=(Telemetry const&); // assigment disabled
+    uint8_t collect(int32_t *values);
+    uint16_t encode(int32_t *values, uint8_t channels, bool keyFrame);
+    bool send(uint16_t length);
+
+    int32_t lastValues[TELEMETRY_MAX_CHANNELS]; // values of the previous frame (for delta encoding)
+    uint8_t frame[TELEMETRY_MAX_FRAME_SIZE]; // the raw frame
+    uint8_t lastChannels; // number of channels in the previous frame
+    uint8_t interval; // number of loop cycles between two frames (0 = disabled)
+    uint8_t tickCounter;
+    uint8_t sequence;
+    uint8_t framesSinceKeyFrame;
+};
+
+#endif /* TELEMETRY_H_ */
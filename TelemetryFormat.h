@@ -0,0 +1,165 @@
+/*
+ * TelemetryFormat.h
+ *
+ * Definition of the binary telemetry frames. This file is shared between the
+ * firmware and the host decoder, so it must only depend on standard headers.
+ *
+ * Frame layout (before COBS encoding, little endian):
+ *   version (1 byte), flags (1 byte), sequence (1 byte),
+ *   number of plates (1 byte), number of hive sensors (1 byte),
+ *   bitmask of contained channels (1 bit per channel, (channels + 7) / 8 bytes),
+ *   one zig-zag encoded varint per contained channel,
+ *   CRC32 of all preceding bytes (4 bytes, see Crc::calculate()).
+ *
+ * Key frames contain all channels with absolute values. Delta frames contain
+ * only the channels which changed since the previous frame, encoded as the
+ * difference to the previous value.
+ *
+ * On the wire, each frame is COBS encoded and framed by 0x00 delimiters on
+ * both sides, so text output in between frames can be recognized and skipped.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef TELEMETRYFORMAT_H_
+#define TELEMETRYFORMAT_H_
+
+#include <stdint.h>
+
+#define TELEMETRY_VERSION           1
+#define TELEMETRY_FLAG_KEYFRAME     0x01
+#define TELEMETRY_HEADER_SIZE       5
+#define TELEMETRY_CRC_SIZE          4
+
+/*
+ * The channels with a fixed position, they are followed by the temperature of each
+ * hive sensor and the temperature, power and fan speed of each plate.
+ */
+enum TelemetryChannel
+{
+    telemetryState = 0, // Status::SystemState
+    telemetryErrorCode = 1, // Status::ErrorCode
+    telemetryTimeRunning = 2, // time the current phase is running (in s)
+    telemetryTimeRemaining = 3, // time remaining of the current phase (in s)
+    telemetryHiveActual = 4, // relevant hive temperature (in 0.1 deg C)
+    telemetryHiveTarget = 5, // target hive temperature (in 0.1 deg C)
+    telemetryPlateTarget = 6, // target plate temperature (in 0.1 deg C)
+    telemetryHumidity = 7, // relative humidity (in %)
+    telemetryHumidifierTemperature = 8, // temperature at the humidity sensor (in 0.1 deg C)
+    telemetryHumidifierFan = 9, // speed of the humidifier fan (0-255)
+    telemetryVaporizer = 10, // vaporizer on (1) or off (0)
+    telemetryFixedChannels = 11
+};
+
+/*
+ * Return the number of channels in a frame.
+ */
+inline uint8_t telemetryChannels(uint8_t plates, uint8_t hiveSensors)
+{
+    return telemetryFixedChannels + hiveSensors + 3 * plates;
+}
+
+/*
+ * Write a signed value as zig-zag encoded varint, returns the number of bytes written (1-5).
+ */
+inline uint8_t telemetryPutVarint(uint8_t *buffer, int32_t value)
+{
+    uint32_t zigzag = ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+    uint8_t length = 0;
+
+    while (zigzag >= 0x80) {
+        buffer[length++] = (zigzag & 0x7f) | 0x80;
+        zigzag >>= 7;
+    }
+    buffer[length++] = zigzag;
+    return length;
+}
+
+/*
+ * Read a zig-zag encoded varint, returns the number of bytes consumed or 0 if the data is invalid.
+ */
+inline uint8_t telemetryGetVarint(const uint8_t *buffer, uint16_t available, int32_t *value)
+{
+    uint32_t zigzag = 0;
+
+    for (uint8_t i = 0; i < 5 && i < available; i++) {
+        zigzag |= (uint32_t) (buffer[i] & 0x7f) << (7 * i);
+        if ((buffer[i] & 0x80) == 0) {
+            *value = (int32_t) (zigzag >> 1) ^ -(int32_t) (zigzag & 1);
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * COBS encode a block of data (without delimiter). The output must provide
+ * space for length + length / 254 + 1 bytes. Returns the encoded length.
+ */
+inline uint16_t telemetryCobsEncode(const uint8_t *input, uint16_t length, uint8_t *output)
+{
+    uint16_t write = 1, codePosition = 0;
+    uint8_t code = 1;
+
+    for (uint16_t read = 0; read < length; read++) {
+        if (input[read] == 0) {
+            output[codePosition] = code;
+            code = 1;
+            codePosition = write++;
+        } else {
+            output[write++] = input[read];
+            if (++code == 0xff) {
+                output[codePosition] = code;
+                code = 1;
+                codePosition = write++;
+            }
+        }
+    }
+    output[codePosition] = code;
+    return write;
+}
+
+/*
+ * Decode a COBS encoded block (without delimiter). Returns the decoded length or -1 if the data is invalid.
+ */
+inline int32_t telemetryCobsDecode(const uint8_t *input, uint16_t length, uint8_t *output)
+{
+    uint16_t read = 0, write = 0;
+
+    while (read < length) {
+        uint8_t code = input[read];
+        if (code == 0 || read + code > length) {
+            return -1;
+        }
+        read++;
+        for (uint8_t i = 1; i < code; i++) {
+            output[write++] = input[read++];
+        }
+        if (code != 0xff && read != length) {
+            output[write++] = 0;
+        }
+    }
+    return write;
+}
+
+#endif /* TELEMETRYFORMAT_H_ */
@@ -27,8 +27,8 @@
  */
 
 #include "TemperatureSensor.h"
-
-OneWire *TemperatureSensor::ds = NULL;
+#include "Sauna.h"
+#include "SensorTrace.h"
 
 /**
  * Constructor
@@ -47,9 +47,7 @@ TemperatureSensor::TemperatureSensor(uint8_t index, bool plate)
 {
     temperature = 0;
     setAddress((plate ? Configuration::getSensor()->addressPlate[index] : Configuration::getSensor()->addressHive[index]));
-    if (ds == NULL) {
-        ds = new OneWire(Configuration::getIO()->temperatureSensor);
-    }
+    getBus();
 }
 
 /**
@@ -127,6 +125,7 @@ void TemperatureSensor::setResolution(byte resolution)
     }
 
     // set configuration
+    OneWire *ds = getBus();
     ds->reset();
     ds->select(address.byte);
     ds->write(0x4E);			// write scratchpad
@@ -141,6 +140,7 @@ void TemperatureSensor::setResolution(byte resolution)
  */
 void TemperatureSensor::prepareData()
 {
+    OneWire *ds = getBus();
     ds->reset();
     ds->skip(); // skip ROM - send to all devices
     ds->write(0x44); // start conversion
@@ -151,12 +151,20 @@ void TemperatureSensor::prepareData()
  */
 void TemperatureSensor::retrieveData()
 {
+    OneWire *ds = getBus();
     byte data[9];
 
     ds->reset();
     ds->select(address.byte);
     ds->write(0xBE); // read scratchpad
     ds->read_bytes(data, 9); // 9 bytes are required
+    SENSOR_TRACE(scratchpad(address.byte, data));
+
+    if (OneWire::crc8(data, 8) != data[8]) { // keep the last valid temperature
+        Status::getInstance()->sensorErrorsTemperature++;
+        LOG_WARN(Logger::moduleOneWire, F("invalid CRC reading temperature sensor %#08lx%08lx"), address.high, address.low);
+        return;
+    }
 
     temperature = (data[1] << 8) | data[0];
 
@@ -198,10 +206,7 @@ int16_t TemperatureSensor::getTemperatureFahrenheit()
  */
 void TemperatureSensor::resetSearch()
 {
-    if (ds == NULL) {
-        ds = new OneWire(Configuration::getIO()->temperatureSensor);
-    }
-    ds->reset_search();
+    getBus()->reset_search();
 }
 
 /**
@@ -210,14 +215,29 @@ void TemperatureSensor::resetSearch()
  */
 SensorAddress TemperatureSensor::search()
 {
+    OneWire *ds = getBus();
     SensorAddress addr;
 
     addr.value = 0;
     if (ds->search(addr.byte)) {
         if (OneWire::crc8(addr.byte, 7) != addr.byte[7]) {
-            Logger::error(F("temperature sensor: invalid CRC!\n"));
+            LOG_ERROR(Logger::moduleOneWire, F("temperature sensor: invalid CRC!\n"));
             addr.value = 0;
+        } else {
+            SENSOR_TRACE(sensorFound(addr.byte));
         }
     }
     return addr;
 }
+
+/**
+ * Return the bus of the current sauna's temperature sensors, it's created on first use.
+ */
+OneWire *TemperatureSensor::getBus()
+{
+    Sauna *sauna = Sauna::getCurrent();
+    if (sauna->oneWire == NULL) {
+        sauna->oneWire = new OneWire(Configuration::getIO()->temperatureSensor);
+    }
+    return sauna->oneWire;
+}
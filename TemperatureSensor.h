@@ -59,11 +59,11 @@ public:
 protected:
 
 private:
+    static OneWire *getBus();
     uint8_t index;
     SensorAddress address;
     DeviceType type;
     int16_t temperature; // integer representation of temperature
-    static OneWire *ds;
 };
 
 #endif /* TEMPERATURESENSOR_H_ */
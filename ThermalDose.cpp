@@ -0,0 +1,147 @@
+/*
+ * ThermalDose.cpp
+ *
+ * Accumulates the thermal dose which the hive received at each sensor, so a
+ * treatment can end as soon as the coldest spot of the hive is treated.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "ThermalDose.h"
+#include "Sauna.h"
+#include "Configuration.h"
+
+#define DOSE_MAX_INTERVAL 5000 // a longer time between two calls (e.g. before a finished program is extended) doesn't count (in ms)
+
+/**
+ * Constructor
+ */
+ThermalDose::ThermalDose()
+{
+    reset();
+}
+
+/**
+ * Destructor
+ */
+ThermalDose::~ThermalDose()
+{
+
+}
+
+/**
+ * Return the instance of the current sauna
+ */
+ThermalDose *ThermalDose::getInstance()
+{
+    return &Sauna::getCurrent()->thermalDose;
+}
+
+/**
+ * Clear the dose of all sensors (when a program starts).
+ */
+void ThermalDose::reset()
+{
+    memset(dose, 0, sizeof(dose));
+    lastUpdate = millis();
+}
+
+/**
+ * Called about once per second while a program is active, the dose is integrated over
+ * the time measured since the previous call. Sensors with a read error don't
+ * accumulate a dose. The rate is calculated in fixed point (256 = 1s per s), the
+ * fraction of a doubling step is interpolated linearly.
+ */
+void ThermalDose::process()
+{
+    Status *status = Status::getInstance();
+    uint8_t sensors = getNumberOfSensors();
+    uint32_t now = millis();
+    uint32_t elapsed = now - lastUpdate;
+
+    lastUpdate = now;
+    if (elapsed > DOSE_MAX_INTERVAL) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < sensors; i++) {
+        int16_t excess = status->temperatureHive[i] - CFG_DOSE_TEMPERATURE;
+        if (status->temperatureHive[i] == -999 || excess < 0) {
+            continue;
+        }
+        uint8_t doublings = min(excess / CFG_DOSE_DOUBLING, CFG_DOSE_MAX_DOUBLINGS);
+        uint32_t rate = 256UL << doublings;
+        if (doublings < CFG_DOSE_MAX_DOUBLINGS) {
+            rate += rate * (excess % CFG_DOSE_DOUBLING) / CFG_DOSE_DOUBLING;
+        }
+        dose[i] += (rate * elapsed + 500) / 1000;
+    }
+}
+
+/**
+ * Returns the dose of a hive sensor (in min at CFG_DOSE_TEMPERATURE)
+ */
+uint16_t ThermalDose::getDose(uint8_t sensor)
+{
+    if (sensor >= CFG_MAX_NUMBER_PLATES) {
+        return 0;
+    }
+    return min(dose[sensor] / (256UL * 60), 0xffffUL);
+}
+
+/**
+ * Returns the dose of the coldest spot of the hive (in min at CFG_DOSE_TEMPERATURE)
+ */
+uint16_t ThermalDose::getMinimumDose()
+{
+    uint8_t sensors = getNumberOfSensors();
+    uint16_t minimum = 0xffff;
+
+    for (uint8_t i = 0; i < sensors; i++) {
+        minimum = min(minimum, getDose(i));
+    }
+    return (sensors == 0 ? 0 : minimum);
+}
+
+/**
+ * Set the dose of a hive sensor, e.g. when resuming after a power loss (in min at CFG_DOSE_TEMPERATURE)
+ */
+void ThermalDose::setDose(uint8_t sensor, uint16_t dose)
+{
+    if (sensor < CFG_MAX_NUMBER_PLATES) {
+        this->dose[sensor] = dose * 256UL * 60;
+    }
+    lastUpdate = millis();
+}
+
+/**
+ * Get the number of configured hive sensors.
+ */
+uint8_t ThermalDose::getNumberOfSensors()
+{
+    uint8_t count = 0;
+    while (count < CFG_MAX_NUMBER_PLATES && Configuration::getSensor()->addressHive[count].value != 0) {
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,61 @@
+/*
+ * ThermalDose.h
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef THERMALDOSE_H_
+#define THERMALDOSE_H_
+
+#include "config.h"
+#include "Logger.h"
+#include "Status.h"
+
+/*
+ * Integrates the thermal dose of each hive sensor during a program. A second at
+ * CFG_DOSE_TEMPERATURE counts as one second of dose, each CFG_DOSE_DOUBLING above it
+ * doubles the rate (Arrhenius-like), below it nothing is accumulated.
+ */
+class ThermalDose
+{
+public:
+    static ThermalDose *getInstance();
+    virtual ~ThermalDose();
+    void reset();
+    void process();
+    uint16_t getDose(uint8_t sensor);
+    uint16_t getMinimumDose();
+    void setDose(uint8_t sensor, uint16_t dose);
+
+private:
+    friend class Sauna; // owns the instance
+    ThermalDose();
+    ThermalDose(ThermalDose const&); // copy disabled
+    void operator=(ThermalDose const&); // assigment disabled
+    uint8_t getNumberOfSensors();
+
+    uint32_t dose[CFG_MAX_NUMBER_PLATES]; // accumulated dose per hive sensor (in s / 256)
+    uint32_t lastUpdate; // time of the previous integration step (in ms)
+};
+
+#endif /* THERMALDOSE_H_ */
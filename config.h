@@ -35,12 +35,52 @@
 
 #define CFG_VERSION                 "ApiSauna v1.2"
 #define CFG_DEFAULT_LOGLEVEL        Logger::Info
+#define CFG_LOG_MIN_LEVEL           Logger::Debug // messages below this level are not compiled into the firmware (e.g. Logger::Info to save flash)
+
+// state of the board's hardware (serial port, EEPROM, buttons, timers): a single instance on the board, one per thread
+// in host simulations. The state of a sauna is kept in a Sauna object, host simulations may create several of them.
+#ifdef ARDUINO_HOST
+#define CFG_INSTANCE_LOCAL thread_local
+#define CFG_MULTIPLE_SAUNAS
+#define CFG_SENSOR_TRACE // the host tools record and replay traces
+#else
+#define CFG_INSTANCE_LOCAL
+//#define CFG_SENSOR_TRACE // send a trace of all inputs and outputs to the serial port, see SensorTrace.h (approx. 700 bytes RAM)
+#endif
 
 #define CFG_SERIAL_SPEED 115200
 #define CFG_LOOP_DELAY   100
 
-#define CFG_LOG_BUFFER_SIZE         120 // size of log output messages
-#define CFG_SERIAL_BUFFER_SIZE      80 // size of the serial input buffer
+#define CFG_LOG_BUFFER_SIZE         150 // size of log output messages (including time stamp and level)
+#define CFG_SERIAL_BUFFER_SIZE      160 // size of the serial input buffer (limits the length of batch requests)
+#define CFG_BATCH_MAX_ITEMS         12 // maximum number of items in a batch request
+#define CFG_BATCH_REPLY_SIZE        200 // maximum length of the reply to a batch request
+#define CFG_BATCH_ACTION_OUTPUT     64 // room in the output buffer for the console line of an action in a batch request
+#define CFG_LCD_BYTES_PER_TICK      24 // maximum number of bytes transferred to the LCD per loop (approx. 0.25ms each)
+#define CFG_BUTTON_DEBOUNCE         20 // time a button must be stable to register a press or release (in ms)
+#define CFG_BUTTON_DOUBLE_PRESS     400 // maximum time between release and press of a double-press (in ms)
+#define CFG_BUTTON_LONG_PRESS       1000 // time the buttons must be held for a long-press (in ms)
+#define CFG_BUTTON_HOLD             3000 // time the buttons must be held for a hold, e.g. both for a reset (in ms)
+#define CFG_BUTTON_QUEUE_SIZE       8 // number of button events which can be queued
+#define CFG_SERIAL_TX_BUFFER_SIZE_HIGH 768 // size of the serial output buffer for console output, warnings and errors (must hold the menu header or a batch reply plus 128 bytes)
+#define CFG_SERIAL_TX_BUFFER_SIZE_LOW  512 // size of the serial output buffer for debug and info messages
+#define CFG_TELEMETRY_KEYFRAME_INTERVAL 50 // number of delta frames between two telemetry key frames
+#define CFG_SENSOR_TRACE_FRAME_SIZE 128 // maximum size of a sensor trace frame (max 255)
+#define CFG_SENSOR_TRACE_INTERVAL   10 // number of loop cycles after which the recorded sensor trace is sent at the latest
+
+#define CFG_EEPROM_QUEUE_SIZE       9 // number of blocks which can be queued for writing to the EEPROM
+#define CFG_EEPROM_STAGING_SIZE     256 // maximum size of a block written to the EEPROM
+
+#define CFG_HEATER_POWER_WATTS      150 // electrical power of a single heater plate at full power (in W)
+#define CFG_STATISTICS_SAVE_INTERVAL 900 // interval to save the statistics while a program is active (in s)
+#define CFG_MAX_PROGRAM_SEGMENTS    6 // maximum number of segments of a program
+#define CFG_DOSE_TEMPERATURE        400 // temperature at which one second counts as one second of thermal dose (in 0.1 deg C)
+#define CFG_DOSE_DOUBLING           10 // temperature increase which doubles the rate of the thermal dose (in 0.1 deg C)
+#define CFG_DOSE_MAX_DOUBLINGS      6 // the rate of the thermal dose is limited to 2^x
+#define CFG_DOSE_MAX_EXTENSION      50 // extension of a soak segment if the thermal dose isn't reached in time (in % of its duration)
+#define CFG_PROGRAM_QUEUE_SIZE      6 // number of programs which can be queued to run after the current one
+#define CFG_CHECKPOINT_INTERVAL     60 // interval to save the state of a running program for a resume after power loss (in s)
+#define CFG_HISTORY_TARGET_TOLERANCE 5 // max deviation from the target hive temperature to count as 'at target' in the history (in 0.1 deg C)
 
 #define CFG_MAX_NUMBER_PLATES       15 // defines the maximum number of heater plates (limited by 2*x*8 bytes + checksum < 256 bytes)
 
@@ -0,0 +1,227 @@
+/*
+ * BatchCheck.cpp
+ *
+ * Round trip check of the batch protocol of the serial console on the host: the
+ * requests are encoded by SaunaClient and fed to the console of an emulated board,
+ * the replies are decoded again. Besides the replies, it checks that a batch which
+ * edits the running program is taken over by the control (target temperature and
+ * remaining time), in pre-heat and while running. The exit code is 2 if a check fails.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -Itools/host -I. tools/BatchCheck.cpp tools/SaunaClient.cpp tools/Simulation.cpp tools/SaunaModel.cpp \
+ *       tools/SeriesWriter.cpp Sauna.cpp Controller.cpp Plate.cpp Fan.cpp Heater.cpp Humidifier.cpp HumiditySensor.cpp \
+ *       TemperatureSensor.cpp SerialConsole.cpp Checkpoint.cpp History.cpp HID.cpp Beeper.cpp Device.cpp ButtonInput.cpp \
+ *       LcdFrameBuffer.cpp ProgramHandler.cpp ProgramStore.cpp ThermalDose.cpp Telemetry.cpp SensorTrace.cpp Configuration.cpp \
+ *       Statistics.cpp Status.cpp Logger.cpp SerialBuffer.cpp EepromWriter.cpp Crc.cpp tools/host/Arduino.cpp tools/host/DHT.cpp \
+ *       tools/host/EEPROM.cpp tools/host/LiquidCrystal.cpp tools/host/OneWire.cpp tools/host/PID_v1.cpp -o batchCheck
+ *   ./batchCheck
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "SaunaClient.h"
+#include "Simulation.h"
+#include "Sauna.h"
+
+#define CHECK_PROGRAM           1 // the built-in "Varroa Killer" (60min pre-heat to 40.0 C, 210min at 41.0 C)
+#define CHECK_NUMBER_OF_PLATES  4
+#define CHECK_HIVE_TEMPERATURE  300 // temperature of the emulated hive sensors (in 0.1 deg C, never reaches the target)
+#define CHECK_PLATE_TEMPERATURE 450 // temperature of the emulated plate sensors (in 0.1 deg C)
+
+/*
+ * The emulated board and the console output it produced since the last request.
+ */
+class Board
+{
+public:
+    Board()
+    {
+        sequence = 0;
+        outputBuffer = NULL;
+        outputSize = 0;
+        outputRead = 0;
+        Simulation::resetBoard();
+        sauna = new Sauna();
+        sauna->select();
+        output = open_memstream(&outputBuffer, &outputSize);
+    }
+
+    ~Board()
+    {
+        Serial.setCapture(NULL);
+        EepromWriter::flush(); // pending jobs refer to the sauna's data
+        delete sauna;
+        fclose(output);
+        free(outputBuffer);
+    }
+
+    /*
+     * Configure the plates and sensors like Simulation does and initialize the controller.
+     */
+    void initialize()
+    {
+        Configuration::getInstance()->reset();
+        ConfigurationParams *params = Configuration::getParams();
+        ConfigurationSensor *sensor = Configuration::getSensor();
+
+        params->numberOfPlates = CHECK_NUMBER_OF_PLATES;
+        params->loglevel = Logger::Error;
+        Simulation::connectPlates(CHECK_NUMBER_OF_PLATES);
+        for (uint8_t i = 0; i < CHECK_NUMBER_OF_PLATES; i++) {
+            int8_t plate = OneWire::attach(0x100 + i);
+            int8_t hive = OneWire::attach(0x200 + i);
+            OneWire::setTemperature(plate, CHECK_PLATE_TEMPERATURE);
+            OneWire::setTemperature(hive, CHECK_HIVE_TEMPERATURE);
+            OneWire::getAddress(plate, sensor->addressPlate[i].byte);
+            OneWire::getAddress(hive, sensor->addressHive[i].byte);
+        }
+        Configuration::getInstance()->save();
+        EepromWriter::flush();
+
+        Serial.setEcho(false);
+        Serial.setCapture(output);
+        Controller::getInstance()->initialize();
+        run(10); // until the menu is printed, before there is no room for a reply in the output buffer
+
+    }
+
+    /*
+     * Run the main loop for the given time (in s).
+     */
+    void run(uint32_t seconds)
+    {
+        uint32_t start = millis();
+        while (millis() - start < seconds * 1000) {
+            Controller::getInstance()->process();
+            EepromWriter::process();
+            SerialBuffer::drain();
+            HostClock::advance(CFG_LOOP_DELAY);
+        }
+    }
+
+    /*
+     * Send a batch request to the console and return the decoded reply (false if there was none).
+     */
+    bool request(const std::vector<std::string> &items, SaunaClient::Reply *reply)
+    {
+        std::string frame = SaunaClient::encode(++sequence, items) + "\n";
+        Serial.inject(frame.c_str());
+        run(1);
+
+        fflush(output);
+        std::string text(outputBuffer + outputRead, outputSize - outputRead);
+        outputRead = outputSize;
+        size_t start = 0, end;
+        while ((end = text.find('\n', start)) != std::string::npos) {
+            if (SaunaClient::decode(text.substr(start, end - start), reply) && reply->sequence == sequence) {
+                return true;
+            }
+            start = end + 1;
+        }
+        return false;
+    }
+
+private:
+    Sauna *sauna;
+    uint32_t sequence;
+    FILE *output; // receives the console output
+    char *outputBuffer;
+    size_t outputSize;
+    size_t outputRead; // the part of the output which was already searched for replies
+};
+
+static int failures = 0;
+
+static void check(bool condition, const char *description)
+{
+    printf("%-60s %s\n", description, (condition ? "ok" : "FAILED"));
+    if (!condition) {
+        failures++;
+    }
+}
+
+/*
+ * Send a request which is expected to succeed, the values of the read items are printed.
+ */
+static bool request(Board *board, const std::vector<std::string> &items, SaunaClient::Reply *reply)
+{
+    if (!board->request(items, reply)) {
+        printf("  no reply\n");
+        return false;
+    }
+    if (reply->error != SaunaClient::resultOk) {
+        printf("  %s (item %d)\n", SaunaClient::errorToStr(reply->error), reply->item);
+        return false;
+    }
+    for (size_t i = 0; i < reply->values.size(); i++) {
+        printf("  %s=%s\n", reply->values[i].first.c_str(), reply->values[i].second.c_str());
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    Board board;
+    SaunaClient::Reply reply;
+    Status *status = Status::getInstance();
+    ProgramHandler *programHandler = ProgramHandler::getInstance();
+    char start[16];
+
+    board.initialize();
+    check(status->getSystemState() == Status::ready, "the board is ready");
+
+    snprintf(start, sizeof(start), "START=%d", CHECK_PROGRAM);
+    check(request(&board, { start, "TEMP-PREHEAT", "TEMP" }, &reply), "start the program");
+    board.run(10);
+    check(status->getSystemState() == Status::preHeat && status->temperatureTargetHive == 400, "pre-heat to 40.0 C");
+    board.run(290);
+
+    // an edit of the pre-heat is taken over in pre-heat
+    check(request(&board, { "TEMP-PREHEAT=380", "DURATION-PREHEAT=10", "TEMP-PREHEAT" }, &reply), "change the pre-heat");
+    board.run(10);
+    check(status->temperatureTargetHive == 380, "pre-heat to 38.0 C");
+    check(programHandler->calculateTimeRemaining() <= 300, "pre-heat ends after 10min");
+    board.run(300);
+    check(status->getSystemState() == Status::running && status->temperatureTargetHive == 410, "running at 41.0 C");
+
+    // an edit of the program is taken over while running
+    check(request(&board, { "TEMP=395", "DURATION=30", "TEMP", "DURATION" }, &reply), "change the program while running");
+    check(reply.values.size() == 2 && reply.values[0].second == "395" && reply.values[1].second == "30", "the reply reads the new values");
+    board.run(10);
+    check(status->temperatureTargetHive == 395, "running at 39.5 C");
+    check(programHandler->calculateTimeRemaining() <= 30 * 60, "the program ends after 30min");
+
+    // a rejected batch changes nothing
+    check(board.request({ "TEMP=380", "PROGRAM_EDIT=2" }, &reply) && reply.error == consoleErrorState && reply.item == 2,
+            "a program can't be loaded while running");
+    board.run(10);
+    check(status->temperatureTargetHive == 395, "still running at 39.5 C");
+
+    board.run(30 * 60);
+    check(status->getSystemState() == Status::shutdown && programHandler->getStopReason() == programCompleted, "the program completed");
+
+    printf("%d check(s) failed\n", failures);
+    return (failures > 0 ? 2 : 0);
+}
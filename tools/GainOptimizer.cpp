@@ -0,0 +1,428 @@
+/*
+ * GainOptimizer.cpp
+ *
+ * Tunes the PID gains of a program on the simulated sauna with the Nelder-Mead
+ * method. The cost of a set of gains combines the pre-heat time, the overshoot
+ * above the program's hive temperature, the excursion of the plates above their
+ * target temperature and the energy, averaged over the given ambient temperatures.
+ * All candidates of a step (reflection, expansion and both contractions, or the
+ * points of a shrink) are simulated in parallel on a WorkStealingPool. The tuned
+ * program is printed as a row of the presets table in ProgramStore.cpp.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -pthread -Itools/host -I. tools/GainOptimizer.cpp tools/Simulation.cpp tools/SaunaModel.cpp tools/SeriesWriter.cpp \
+ *       tools/WorkStealingPool.cpp Sauna.cpp Controller.cpp Plate.cpp Fan.cpp Heater.cpp Humidifier.cpp HumiditySensor.cpp \
+ *       TemperatureSensor.cpp SerialConsole.cpp Checkpoint.cpp History.cpp HID.cpp Beeper.cpp Device.cpp ButtonInput.cpp \
+ *       LcdFrameBuffer.cpp ProgramHandler.cpp ProgramStore.cpp ThermalDose.cpp Telemetry.cpp SensorTrace.cpp Configuration.cpp \
+ *       Statistics.cpp Status.cpp Logger.cpp SerialBuffer.cpp EepromWriter.cpp Crc.cpp tools/host/Arduino.cpp tools/host/DHT.cpp \
+ *       tools/host/EEPROM.cpp tools/host/LiquidCrystal.cpp tools/host/OneWire.cpp tools/host/PID_v1.cpp -o gainOptimizer
+ *   ./gainOptimizer -p 1 -a 10,20,30
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "WorkStealingPool.h"
+#include "Simulation.h"
+#include "ProgramStore.h"
+
+#define NUMBER_OF_GAINS 6
+#define MIN_GAIN        0.01 // the presets store the gains multiplied by 100 in an uint16_t
+#define MAX_GAIN        655.35
+#define INITIAL_STEP    0.5 // size of the initial simplex (in ln of the gains, i.e. a factor of 1.65)
+#define FAILURE_COST    1000 // cost of a run which failed or ran into over-temperature
+
+// the optimized fields of the program and their names in the serial console
+static double Program::* const gains[NUMBER_OF_GAINS] = { &Program::hiveKp, &Program::hiveKi, &Program::hiveKd, &Program::plateKp,
+        &Program::plateKi, &Program::plateKd };
+static const char * const gainNames[NUMBER_OF_GAINS] = { "HIVE-KP", "HIVE-KI", "HIVE-KD", "PLATE-KP", "PLATE-KI", "PLATE-KD" };
+
+typedef std::vector<double> Point; // the natural logarithm of the gains, keeps them positive and scales all of them alike
+
+struct Vertex
+{
+    Point point;
+    double cost;
+};
+
+struct CostWeights
+{
+    double preHeat; // per hour until the hive is at the target temperature
+    double overshoot; // per deg C above the program's hive temperature
+    double plate; // per deg C of the hottest plate above the program's plate temperature
+    double energy; // per kWh
+};
+
+/*
+ * Evaluates sets of gains on the simulator, each in all scenarios (ambient temperatures).
+ */
+class Evaluator
+{
+public:
+    Evaluator(const Program &program, const std::vector<SaunaModelParameters> &scenarios, const CostWeights &weights,
+            uint32_t timeLimit, bool usePWM, unsigned threads) :
+            program(program), scenarios(scenarios), weights(weights), timeLimit(timeLimit), usePWM(usePWM), pool(threads), evaluations(0)
+    {
+    }
+
+    /**
+     * Apply a point to the program, the gains are rounded to what a preset is able to store.
+     */
+    Program toProgram(const Point &point)
+    {
+        Program variant = program;
+        for (int i = 0; i < NUMBER_OF_GAINS; i++) {
+            variant.*gains[i] = round(constrain(exp(point[i]), MIN_GAIN, MAX_GAIN) * 100) / 100;
+        }
+        return variant;
+    }
+
+    /**
+     * Simulate all points in all scenarios in parallel, the results are indexed by point and scenario.
+     */
+    std::vector<std::vector<SimulationResult> > simulate(const std::vector<Point> &points)
+    {
+        std::vector<std::vector<SimulationResult> > results(points.size(), std::vector<SimulationResult>(scenarios.size()));
+        for (size_t i = 0; i < points.size(); i++) {
+            for (size_t j = 0; j < scenarios.size(); j++) {
+                pool.submit([&, i, j] {
+                    Simulation simulation(toProgram(points[i]), scenarios[j]);
+                    simulation.setUsePWM(usePWM);
+                    if (timeLimit > 0) {
+                        simulation.setTimeLimit(timeLimit);
+                    }
+                    results[i][j] = simulation.run();
+                });
+            }
+        }
+        pool.wait();
+        evaluations += points.size();
+        return results;
+    }
+
+    /**
+     * Return the mean cost of each point over all scenarios.
+     */
+    std::vector<double> evaluate(const std::vector<Point> &points)
+    {
+        std::vector<std::vector<SimulationResult> > results = simulate(points);
+        std::vector<double> costs(points.size());
+        for (size_t i = 0; i < points.size(); i++) {
+            double sum = 0;
+            for (size_t j = 0; j < scenarios.size(); j++) {
+                sum += cost(results[i][j]);
+            }
+            costs[i] = sum / scenarios.size();
+        }
+        return costs;
+    }
+
+    double cost(const SimulationResult &result)
+    {
+        if (!result.started || result.overtemp) {
+            return FAILURE_COST;
+        }
+        // a pre-heat which never ends costs twice the simulated time
+        double preHeat = (result.preHeatTime ? result.preHeatTime : 2.0 * result.duration) / 3600.0;
+        double overshoot = max(result.overshoot, 0) / 10.0;
+        double plate = max(result.maxPlateTemperature - program.temperaturePlate, 0) / 10.0;
+        return weights.preHeat * preHeat + weights.overshoot * overshoot + weights.plate * plate + weights.energy * result.energy / 1000;
+    }
+
+    unsigned getNumberOfThreads()
+    {
+        return pool.getNumberOfThreads();
+    }
+
+    size_t getEvaluations()
+    {
+        return evaluations;
+    }
+
+private:
+    Program program;
+    std::vector<SaunaModelParameters> scenarios;
+    CostWeights weights;
+    uint32_t timeLimit;
+    bool usePWM;
+    WorkStealingPool pool;
+    size_t evaluations; // number of evaluated points
+};
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-p program] [-t minutes] [-a ambient] [-c weights] [-e evaluations] [-j threads] [-w]\n", name);
+    fprintf(stderr, "  -p       the program to tune (default: 1)\n");
+    fprintf(stderr, "  -t       simulated time per run (in min, default: until the program ends)\n");
+    fprintf(stderr, "  -a       ambient temperatures, the cost is averaged over them (in deg C, default: 20)\n");
+    fprintf(stderr, "  -c       weights of pre-heat time (per h), overshoot (per deg C), plate excursion (per deg C)\n");
+    fprintf(stderr, "           and energy (per kWh), default: 1,2,0.1,0.5\n");
+    fprintf(stderr, "  -e       maximum number of evaluated gain sets (default: 300)\n");
+    fprintf(stderr, "  -j       number of threads (default: one per core)\n");
+    fprintf(stderr, "  -w       drive the heaters with PWM instead of on/off\n");
+}
+
+/**
+ * Parse a comma separated list of numbers.
+ */
+static bool parseList(const char *text, std::vector<double> *values)
+{
+    char *end;
+    while (*text) {
+        values->push_back(strtod(text, &end));
+        if (end == text || (*end != ',' && *end != 0)) {
+            return false;
+        }
+        text = (*end == ',' ? end + 1 : end);
+    }
+    return !values->empty();
+}
+
+static void printGains(FILE *file, const char *label, const Program &program)
+{
+    fprintf(file, "%-8s", label);
+    for (int i = 0; i < NUMBER_OF_GAINS; i++) {
+        fprintf(file, " %8.2f", program.*gains[i]);
+    }
+}
+
+static std::string formatTime(uint32_t seconds)
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%u:%02u", seconds / 3600, (seconds / 60) % 60);
+    return text;
+}
+
+static const char *resultToStr(const SimulationResult &result)
+{
+    if (!result.started) {
+        return "failed";
+    }
+    if (result.overtemp) {
+        return "overtemp";
+    }
+    return (result.completed ? "ok" : "time limit");
+}
+
+/**
+ * Print the program in the format of the presets table in ProgramStore.cpp.
+ */
+static void printPreset(const Program &program)
+{
+    printf("    // name, temperature pre-heat/hive/plate, hive Kp/Ki/Kd, plate Kp/Ki/Kd, duration pre-heat/program,\n");
+    printf("    // fan speed pre-heat/program/humidifier, humidity min/max\n");
+    printf("    { \"%.16s\", %d, %d, %d", program.name, program.temperaturePreHeat, program.temperatureHive, program.temperaturePlate);
+    for (int i = 0; i < NUMBER_OF_GAINS; i++) {
+        printf(", %d", (int) constrain(program.*gains[i] * 100.0 + 0.5, 0, 0xffff));
+    }
+    printf(", %d, %d, %d, %d, %d, %d, %d, 0, %d, {", program.durationPreHeat, program.duration, program.fanSpeedPreHeat, program.fanSpeed,
+            program.fanSpeedHumidifier, program.humidityMinimum, program.humidityMaximum, program.dose);
+    for (int i = 0; i < CFG_MAX_PROGRAM_SEGMENTS && program.segments[i].type != segmentEnd; i++) {
+        const ProgramSegment &segment = program.segments[i];
+        printf("%s { %d, %d, %d, %d, %d, %d }", (i == 0 ? "" : ","), segment.type, segment.fanSpeed, segment.temperature, segment.parameter,
+                segment.humidity, segment.pidScale);
+    }
+    printf(" }, 0 },\n");
+}
+
+int main(int argc, char **argv)
+{
+    int programNumber = 1, threads = 0, maxEvaluations = 300, option;
+    uint32_t timeLimit = 0;
+    bool usePWM = false;
+    std::vector<double> ambient, weightList;
+
+    while ((option = getopt(argc, argv, "p:t:a:c:e:j:w")) != -1) {
+        switch (option) {
+        case 'p':
+            programNumber = atoi(optarg);
+            break;
+        case 't':
+            timeLimit = atoi(optarg) * 60;
+            break;
+        case 'a':
+            if (!parseList(optarg, &ambient)) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'c':
+            if (!parseList(optarg, &weightList) || weightList.size() != 4) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'e':
+            maxEvaluations = atoi(optarg);
+            break;
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 'w':
+            usePWM = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    CostWeights weights = { 1, 2, 0.1, 0.5 };
+    if (!weightList.empty()) {
+        weights.preHeat = weightList[0];
+        weights.overshoot = weightList[1];
+        weights.plate = weightList[2];
+        weights.energy = weightList[3];
+    }
+    std::vector<SaunaModelParameters> scenarios;
+    if (ambient.empty()) {
+        ambient.push_back(SaunaModelParameters().ambientTemperature);
+    }
+    for (size_t i = 0; i < ambient.size(); i++) {
+        SaunaModelParameters parameters;
+        parameters.ambientTemperature = ambient[i];
+        scenarios.push_back(parameters);
+    }
+
+    Program program;
+    memset(&program, 0, sizeof(Program));
+    if (!ProgramStore::getInstance()->load(programNumber, &program)) {
+        fprintf(stderr, "program #%d not found\n", programNumber);
+        return 1;
+    }
+
+    Evaluator evaluator(program, scenarios, weights, timeLimit, usePWM, threads);
+    fprintf(stderr, "tuning the gains of '%s' in %zu scenarios on %u threads\n", program.name, scenarios.size(), evaluator.getNumberOfThreads());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // the initial simplex: the program's gains and one step along each axis
+    std::vector<Point> points(NUMBER_OF_GAINS + 1, Point(NUMBER_OF_GAINS));
+    for (int i = 0; i < NUMBER_OF_GAINS; i++) {
+        points[0][i] = log(constrain(program.*gains[i], MIN_GAIN, MAX_GAIN));
+    }
+    for (int i = 0; i < NUMBER_OF_GAINS; i++) {
+        points[i + 1] = points[0];
+        points[i + 1][i] += INITIAL_STEP;
+    }
+    Point origin = points[0];
+    std::vector<double> costs = evaluator.evaluate(points);
+    std::vector<Vertex> simplex(NUMBER_OF_GAINS + 1);
+    for (size_t i = 0; i < simplex.size(); i++) {
+        simplex[i].point = points[i];
+        simplex[i].cost = costs[i];
+    }
+    double startCost = costs[0];
+
+    for (int iteration = 1; evaluator.getEvaluations() < (size_t) maxEvaluations; iteration++) {
+        std::stable_sort(simplex.begin(), simplex.end(), [](const Vertex &a, const Vertex &b) {return a.cost < b.cost;});
+        printGains(stderr, "", evaluator.toProgram(simplex[0].point));
+        fprintf(stderr, "  cost %.3f (iteration %d, %zu evaluations)\n", simplex[0].cost, iteration, evaluator.getEvaluations());
+        if (simplex[NUMBER_OF_GAINS].cost - simplex[0].cost < 1e-3) {
+            break; // all vertices are equally good, the simplex collapsed
+        }
+
+        Point centroid(NUMBER_OF_GAINS, 0), direction(NUMBER_OF_GAINS);
+        for (int i = 0; i < NUMBER_OF_GAINS; i++) {
+            for (int j = 0; j < NUMBER_OF_GAINS; j++) {
+                centroid[j] += simplex[i].point[j] / NUMBER_OF_GAINS;
+            }
+        }
+        Vertex &worst = simplex[NUMBER_OF_GAINS];
+        for (int j = 0; j < NUMBER_OF_GAINS; j++) {
+            direction[j] = centroid[j] - worst.point[j];
+        }
+
+        // evaluate reflection, expansion, outside and inside contraction at once
+        const double factors[] = { 1, 2, 0.5, -0.5 };
+        std::vector<Point> candidates(4, centroid);
+        for (int k = 0; k < 4; k++) {
+            for (int j = 0; j < NUMBER_OF_GAINS; j++) {
+                candidates[k][j] += factors[k] * direction[j];
+            }
+        }
+        costs = evaluator.evaluate(candidates);
+        double reflected = costs[0], expanded = costs[1], outside = costs[2], inside = costs[3];
+
+        int accepted = -1;
+        if (reflected < simplex[0].cost) {
+            accepted = (expanded < reflected ? 1 : 0);
+        } else if (reflected < simplex[NUMBER_OF_GAINS - 1].cost) {
+            accepted = 0;
+        } else if (reflected < worst.cost) {
+            accepted = (outside <= reflected ? 2 : -1);
+        } else {
+            accepted = (inside < worst.cost ? 3 : -1);
+        }
+
+        if (accepted >= 0) {
+            worst.point = candidates[accepted];
+            worst.cost = costs[accepted];
+        } else { // shrink towards the best vertex
+            points.clear();
+            for (int i = 1; i <= NUMBER_OF_GAINS; i++) {
+                for (int j = 0; j < NUMBER_OF_GAINS; j++) {
+                    simplex[i].point[j] = simplex[0].point[j] + 0.5 * (simplex[i].point[j] - simplex[0].point[j]);
+                }
+                points.push_back(simplex[i].point);
+            }
+            costs = evaluator.evaluate(points);
+            for (int i = 1; i <= NUMBER_OF_GAINS; i++) {
+                simplex[i].cost = costs[i - 1];
+            }
+        }
+    }
+    std::stable_sort(simplex.begin(), simplex.end(), [](const Vertex &a, const Vertex &b) {return a.cost < b.cost;});
+    fprintf(stderr, "done in %.1fs\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    // compare the original and the tuned gains in every scenario
+    Program tuned = evaluator.toProgram(simplex[0].point);
+    printf("        ");
+    for (int i = 0; i < NUMBER_OF_GAINS; i++) {
+        printf(" %8s", gainNames[i]);
+    }
+    printf("     cost\n");
+    printGains(stdout, "original", program);
+    printf(" %8.3f\n", startCost);
+    printGains(stdout, "tuned", tuned);
+    printf(" %8.3f\n\n", simplex[0].cost);
+
+    std::vector<Point> compared = { origin, simplex[0].point };
+    std::vector<std::vector<SimulationResult> > results = evaluator.simulate(compared);
+    printf("gains     ambient   preheat  overshoot  plate above   energy  result\n");
+    for (size_t i = 0; i < compared.size(); i++) {
+        for (size_t j = 0; j < scenarios.size(); j++) {
+            SimulationResult &result = results[i][j];
+            printf("%-8s  %5.1f C  %8s  %7.1f C  %9.1f C  %5.0fWh  %s\n", (i == 0 ? "original" : "tuned"), scenarios[j].ambientTemperature,
+                    (result.preHeatTime ? formatTime(result.preHeatTime).c_str() : "-"), result.overshoot / 10.0,
+                    max(result.maxPlateTemperature - program.temperaturePlate, 0) / 10.0, result.energy, resultToStr(result));
+        }
+    }
+    printf("\n");
+    printPreset(tuned);
+    return 0;
+}
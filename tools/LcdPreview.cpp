@@ -0,0 +1,110 @@
+/*
+ * LcdPreview.cpp
+ *
+ * Host tool which runs the HID against the HD44780 emulator in every system
+ * state. It prints the resulting screens and the LCD traffic per frame (one
+ * call of HID::process()), to see how much bus time each screen costs.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -Itools/host -I. tools/LcdPreview.cpp Sauna.cpp Controller.cpp Plate.cpp Fan.cpp Heater.cpp Humidifier.cpp \
+ *       HumiditySensor.cpp TemperatureSensor.cpp SerialConsole.cpp Checkpoint.cpp History.cpp HID.cpp Beeper.cpp Device.cpp \
+ *       ButtonInput.cpp LcdFrameBuffer.cpp ProgramHandler.cpp ProgramStore.cpp ThermalDose.cpp Telemetry.cpp SensorTrace.cpp \
+ *       Configuration.cpp Statistics.cpp Status.cpp Logger.cpp SerialBuffer.cpp EepromWriter.cpp Crc.cpp \
+ *       tools/host/Arduino.cpp tools/host/DHT.cpp tools/host/EEPROM.cpp tools/host/LiquidCrystal.cpp tools/host/OneWire.cpp \
+ *       tools/host/PID_v1.cpp -o lcdPreview
+ *   ./lcdPreview [frames per state, default: 20]
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "HID.h"
+#include "Configuration.h"
+
+/*
+ * Run the HID for a number of frames and print the screen with the traffic statistics.
+ */
+static void preview(HID *hid, const char *name, int frames)
+{
+    LiquidCrystal *lcd = LiquidCrystal::getActive();
+    uint32_t totalBytes = 0, totalCommands = 0, totalTime = 0, maxTime = 0;
+
+    for (int i = 0; i < frames; i++) {
+        lcd->resetCounters();
+        hid->process();
+        HostClock::advance(CFG_LOOP_DELAY);
+
+        totalBytes += lcd->getBytes();
+        totalCommands += lcd->getCommands();
+        totalTime += lcd->getBusTime();
+        maxTime = max(maxTime, lcd->getBusTime());
+    }
+
+    printf("\n%s\n", name);
+    lcd->render(stdout);
+    printf("per frame: %.1f bytes, %.1f commands, %.0fus bus time (max. %uus)\n", (double) totalBytes / frames,
+            (double) totalCommands / frames, (double) totalTime / frames, maxTime);
+}
+
+int main(int argc, char **argv)
+{
+    Status *status = Status::getInstance();
+    int frames = (argc > 1 ? atoi(argv[1]) : 20);
+    if (frames < 1) {
+        frames = 1;
+    }
+
+    Configuration::getInstance()->reset();
+    for (uint8_t i = 0; i < 4; i++) {
+        Configuration::getSensor()->addressHive[i].value = i + 1;
+        Configuration::getSensor()->addressPlate[i].value = i + 11;
+        status->temperatureHive[i] = 395 + i * 7;
+        status->temperaturePlate[i] = 640 + i * 15;
+        status->powerPlate[i] = (i % 2 ? 120 : 0);
+        status->fanSpeedPlate[i] = 200;
+    }
+    status->temperatureActualHive = 409;
+    status->temperatureTargetHive = 410;
+    status->temperatureTargetPlate = 700;
+    status->temperatureHumidifier = 352;
+    status->humidity = 42;
+    ProgramHandler::getInstance()->initPrograms();
+
+    HID hid;
+    hid.initialize();
+
+    preview(&hid, "initializing", frames);
+    status->setSystemState(Status::ready);
+    preview(&hid, "ready", frames);
+    ProgramHandler::getInstance()->start(1);
+    preview(&hid, "pre-heating", frames);
+    ProgramHandler::getInstance()->nextSegment();
+    preview(&hid, "running", frames);
+    status->setSystemState(Status::overtemp);
+    preview(&hid, "over-temperature", frames);
+    status->setSystemState(Status::shutdown);
+    preview(&hid, "shut-down", frames);
+    status->errorCode = Status::hiveSensorsNotFound;
+    status->setSystemState(Status::error);
+    preview(&hid, "error", frames);
+    return 0;
+}
@@ -0,0 +1,846 @@
+/*
+ * LogImport.cpp
+ *
+ * Imports the serial text output of field runs (the data printed every second by
+ * HID::logData() and the messages of the Logger) as a time series. The logs are
+ * memory-mapped and parsed line by line without allocations. For each run of the
+ * board (the log's time restarts with every power-up) the tool prints a summary:
+ * time per state, how well the hive followed its target, heater power and energy,
+ * humidity and sensor errors.
+ *
+ * With -o the temperatures and humidity of a run are converted into a sensor trace
+ * which TraceReplay replays against the current firmware, the logged outputs serve
+ * as the recorded ones. The log has a resolution of one second and doesn't contain
+ * the raw sensor reads, button events or the board's configuration, so the trace
+ * uses the configuration of a simulation (see Simulation) with the number of plates
+ * and hive sensors of the log and starts the logged program from the program store
+ * when the log shows it being started. The hive sensors get the hive temperature
+ * unless the log contains the debug messages with the temperature of each sensor.
+ * Because of the resolution, a replay differs from the logged outputs around most
+ * of their changes. To check a change of the firmware against a field run, record
+ * a golden trace from the imported one first (TraceReplay -o).
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -Itools/host -I. tools/LogImport.cpp tools/SensorTraceWriter.cpp tools/Simulation.cpp \
+ *       tools/SaunaModel.cpp tools/SeriesWriter.cpp Sauna.cpp Controller.cpp Plate.cpp Fan.cpp Heater.cpp \
+ *       Humidifier.cpp HumiditySensor.cpp TemperatureSensor.cpp SerialConsole.cpp Checkpoint.cpp History.cpp HID.cpp \
+ *       Beeper.cpp Device.cpp ButtonInput.cpp LcdFrameBuffer.cpp ProgramHandler.cpp ProgramStore.cpp ThermalDose.cpp \
+ *       Telemetry.cpp SensorTrace.cpp Configuration.cpp Statistics.cpp Status.cpp Logger.cpp SerialBuffer.cpp \
+ *       EepromWriter.cpp Crc.cpp tools/host/Arduino.cpp tools/host/DHT.cpp tools/host/EEPROM.cpp \
+ *       tools/host/LiquidCrystal.cpp tools/host/OneWire.cpp tools/host/PID_v1.cpp -o logImport
+ *   ./logImport field-*.log
+ *   ./logImport -o field.trace -c field.csv field.log
+ *   ./traceReplay field.trace
+ *
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Simulation.h"
+#include "SensorTraceWriter.h"
+#include "Sauna.h"
+#include "SensorTrace.h"
+#include <OneWire.h>
+
+#define LOG_RESTART_TOLERANCE   2000 // the time may go back this much (in ms) without a restart, warnings overtake queued messages
+#define LOG_MAX_GAP             5000 // longer gaps between the samples (in ms) aren't counted in the statistics
+#define LOG_TARGET_TOLERANCE    5 // the hive is at its target within this range (in 0.1 deg C)
+
+/*
+ * The states as printed by Status::systemStateToStr().
+ */
+static const struct
+{
+    const char *name;
+    uint8_t state;
+} logStates[] = { { "initializing", Status::init }, { "ready", Status::ready }, { "pre-heating", Status::preHeat }, { "running", Status::running },
+        { "over-temperature", Status::overtemp }, { "shut-down", Status::shutdown }, { "error", Status::error } };
+#define LOG_STATES (sizeof(logStates) / sizeof(logStates[0]))
+
+/*
+ * The data of one call of HID::logData(), the values which weren't logged are carried forward from the previous one.
+ */
+class LogSample
+{
+public:
+    uint32_t time; // since power-up of the board (in ms)
+    uint32_t timeRunning; // of the program (in s)
+    uint8_t state; // Status::SystemState
+    int16_t temperatureHive[CFG_MAX_NUMBER_PLATES]; // of each hive sensor (in 0.1 deg C), only logged at debug level
+    int16_t temperatureActualHive; // in 0.1 deg C
+    int16_t temperatureTargetHive; // in 0.1 deg C
+    int16_t temperaturePlate[CFG_MAX_NUMBER_PLATES]; // in 0.1 deg C
+    int16_t temperatureTargetPlate; // in 0.1 deg C
+    uint8_t powerPlate[CFG_MAX_NUMBER_PLATES];
+    uint8_t fanSpeedPlate[CFG_MAX_NUMBER_PLATES];
+    uint8_t maxHeaterPower;
+    uint8_t humidity; // in %
+    bool vaporizerEnabled;
+    uint8_t fanSpeedHumidifier;
+    int16_t temperatureHumidifier; // in 0.1 deg C
+};
+
+/*
+ * The samples between two restarts of the board.
+ */
+class LogSegment
+{
+public:
+    uint32_t line; // where the segment starts
+    int programNumber; // the first program started, -1 if unknown
+    uint8_t numberOfPlates;
+    uint8_t numberOfHiveSensors; // 0 if unknown
+    bool hiveSensorsLogged; // the temperature of each hive sensor is logged
+    uint32_t sensorErrors; // CRC errors reported
+    std::vector<LogSample> samples;
+};
+
+/*
+ * A position in a line of the log, the parse functions only advance it if they succeed.
+ */
+class LineCursor
+{
+public:
+    LineCursor(const char *begin, const char *end) :
+            position(begin), end(end)
+    {
+    }
+
+    /*
+     * Skip the text if the line continues with it.
+     */
+    bool skip(const char *text)
+    {
+        const char *current = position;
+        for (; *text; text++, current++) {
+            if (current == end || *current != *text) {
+                return false;
+            }
+        }
+        position = current;
+        return true;
+    }
+
+    /*
+     * Skip up to and including the next occurrence of the text.
+     */
+    bool find(const char *text)
+    {
+        size_t length = strlen(text);
+        const char *found = (const char *) memmem(position, end - position, text, length);
+        if (found == NULL) {
+            return false;
+        }
+        position = found + length;
+        return true;
+    }
+
+    bool number(uint32_t *value)
+    {
+        const char *current = position;
+        uint32_t result = 0;
+        while (current < end && *current >= '0' && *current <= '9') {
+            result = result * 10 + (*current++ - '0');
+        }
+        if (current == position) {
+            return false;
+        }
+        position = current;
+        *value = result;
+        return true;
+    }
+
+    /*
+     * A number with one decimal printed by HID::toDecimal(), e.g. "-12.3" (returned as -123).
+     */
+    bool decimal(int16_t *value)
+    {
+        LineCursor cursor(position, end);
+        bool negative = cursor.skip("-");
+        uint32_t integer, fraction = 0;
+        if (!cursor.number(&integer) || !cursor.skip(".") || cursor.position == end || *cursor.position < '0' || *cursor.position > '9') {
+            return false;
+        }
+        cursor.number(&fraction);
+        if (fraction > 9) {
+            return false;
+        }
+        position = cursor.position;
+        *value = (negative ? -1 : 1) * (int16_t) (integer * 10 + fraction);
+        return true;
+    }
+
+    /*
+     * A duration printed by HID::convertTime() (h:mm:ss).
+     */
+    bool duration(uint32_t *seconds)
+    {
+        LineCursor cursor(position, end);
+        uint32_t hours, minutes, secs;
+        if (!cursor.number(&hours) || !cursor.skip(":") || !cursor.number(&minutes) || !cursor.skip(":") || !cursor.number(&secs)) {
+            return false;
+        }
+        position = cursor.position;
+        *seconds = hours * 3600 + minutes * 60 + secs;
+        return true;
+    }
+
+    /*
+     * Check if the rest of the line is the text.
+     */
+    bool rest(const char *text)
+    {
+        return (size_t) (end - position) == strlen(text) && memcmp(position, text, end - position) == 0;
+    }
+
+    const char *position;
+    const char *end;
+};
+
+/*
+ * Splits a log into segments of samples.
+ */
+class LogParser
+{
+public:
+    LogParser() :
+            lines(0), recognized(0), incomplete(0), lastTime(0), pending(false), hiveLogged(false)
+    {
+        memset(&sample, 0, sizeof(sample));
+    }
+
+    void parse(const char *data, size_t size)
+    {
+        const char *end = data + size;
+        while (data < end) {
+            const char *lineEnd = (const char *) memchr(data, '\n', end - data);
+            if (lineEnd == NULL) {
+                lineEnd = end;
+            }
+            lines++;
+            parseLine(data, (lineEnd > data && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd));
+            data = lineEnd + 1;
+        }
+        commit();
+    }
+
+    std::vector<LogSegment> segments;
+    uint32_t lines;
+    uint32_t recognized; // log messages
+    uint32_t incomplete; // calls of HID::logData() with missing lines
+
+private:
+    /*
+     * A line of the Logger is "<millis> - <LEVEL>: <message>", the binary frames of the telemetry or a
+     * sensor trace may precede it.
+     */
+    void parseLine(const char *begin, const char *end)
+    {
+        LineCursor cursor(begin, end);
+        if (!cursor.find(" - ")) {
+            return;
+        }
+        const char *digits = cursor.position - 3;
+        while (digits > begin && digits[-1] >= '0' && digits[-1] <= '9') {
+            digits--;
+        }
+        LineCursor timestamp(digits, cursor.position - 3);
+        uint32_t time;
+        if (!timestamp.number(&time) || timestamp.position != timestamp.end) {
+            return;
+        }
+        const char *level = cursor.position;
+        while (cursor.position < end && *cursor.position >= 'A' && *cursor.position <= 'Z') {
+            cursor.position++;
+        }
+        if (cursor.position == level || !cursor.skip(": ")) {
+            return;
+        }
+        recognized++;
+
+        if (segments.empty() || time + LOG_RESTART_TOLERANCE < lastTime) {
+            commit();
+            segments.push_back(LogSegment());
+            LogSegment &segment = segments.back();
+            segment.line = lines;
+            segment.programNumber = -1;
+            segment.numberOfPlates = 0;
+            segment.numberOfHiveSensors = 0;
+            segment.hiveSensorsLogged = false;
+            segment.sensorErrors = 0;
+            memset(&sample, 0, sizeof(sample));
+            pending = false;
+        }
+        lastTime = time;
+        parseMessage(cursor, time, segments.back());
+    }
+
+    void parseMessage(LineCursor &cursor, uint32_t time, LogSegment &segment)
+    {
+        uint32_t number, value1, value2, value3;
+
+        if (cursor.skip("time: ")) {
+            commit();
+            sample.time = time;
+            uint8_t state;
+            if (cursor.duration(&sample.timeRunning) && cursor.skip(", remaining: ") && cursor.duration(&value1) && cursor.skip(", status: ")
+                    && (state = parseState(cursor)) != 0) {
+                sample.state = state;
+                pending = true;
+                hiveLogged = false;
+            }
+        } else if (cursor.skip("sensor ")) {
+            int16_t temperature;
+            if (pending && cursor.number(&number) && number >= 1 && number <= CFG_MAX_NUMBER_PLATES && cursor.skip(": ")
+                    && cursor.decimal(&temperature)) {
+                sample.temperatureHive[number - 1] = temperature;
+                segment.hiveSensorsLogged = true;
+                segment.numberOfHiveSensors = max(segment.numberOfHiveSensors, number);
+            }
+        } else if (cursor.skip("hive: ")) {
+            if (pending && cursor.decimal(&sample.temperatureActualHive) && cursor.skip("C -> ") && cursor.decimal(&sample.temperatureTargetHive)) {
+                hiveLogged = true;
+            }
+        } else if (cursor.skip("plate ")) {
+            int16_t temperature, target;
+            if (pending && cursor.number(&number) && number >= 1 && number <= CFG_MAX_NUMBER_PLATES && cursor.skip(": ") && cursor.decimal(&temperature)
+                    && cursor.skip("C -> ") && cursor.decimal(&target) && cursor.skip("C, power=") && cursor.number(&value1) && cursor.skip("/")
+                    && cursor.number(&value2) && cursor.skip(", fan=") && cursor.number(&value3)) {
+                sample.temperaturePlate[number - 1] = temperature;
+                sample.temperatureTargetPlate = target;
+                sample.powerPlate[number - 1] = value1;
+                sample.maxHeaterPower = value2;
+                sample.fanSpeedPlate[number - 1] = value3;
+                segment.numberOfPlates = max(segment.numberOfPlates, number);
+            }
+        } else if (cursor.skip("humidity: relHumidity=")) {
+            if (pending && cursor.number(&value1) && cursor.find("), vapor=") && cursor.number(&value2) && cursor.skip(", fan=") && cursor.number(&value3)
+                    && cursor.skip(", temp=") && cursor.decimal(&sample.temperatureHumidifier)) {
+                sample.humidity = value1;
+                sample.vaporizerEnabled = value2;
+                sample.fanSpeedHumidifier = value3;
+            }
+            commit(); // the last line of HID::logData()
+        } else if (cursor.skip("invalid CRC reading temperature sensor")) {
+            segment.sensorErrors++;
+        } else if (cursor.skip("Starting program #") || cursor.skip("starting program #") || cursor.skip("starting queued program #")
+                || cursor.skip("Resuming program #")) {
+            if (segment.programNumber < 0 && cursor.number(&number)) {
+                segment.programNumber = number;
+            }
+        } else if (cursor.skip("attaching sensor ")) {
+            if (cursor.find(" as hive sensor #") && cursor.number(&number) && number <= CFG_MAX_NUMBER_PLATES) {
+                segment.numberOfHiveSensors = max(segment.numberOfHiveSensors, number);
+            } else if (cursor.find(" to plate #") && cursor.number(&number) && number <= CFG_MAX_NUMBER_PLATES) {
+                segment.numberOfPlates = max(segment.numberOfPlates, number);
+            }
+        }
+    }
+
+    /*
+     * The state as printed by Status::systemStateToStr(), returns 0 if it's unknown.
+     */
+    uint8_t parseState(LineCursor &cursor)
+    {
+        for (size_t i = 0; i < LOG_STATES; i++) {
+            if (cursor.rest(logStates[i].name)) {
+                return logStates[i].state;
+            }
+        }
+        return 0;
+    }
+
+    /*
+     * Add the pending sample to the segment if its hive temperature was logged. The next one starts as a copy.
+     */
+    void commit()
+    {
+        if (!pending) {
+            return;
+        }
+        if (hiveLogged) {
+            segments.back().samples.push_back(sample);
+        } else {
+            incomplete++;
+        }
+        pending = false;
+    }
+
+    uint32_t lastTime; // of the last log message (in ms)
+    LogSample sample; // the sample being parsed
+    bool pending; // a sample is being parsed
+    bool hiveLogged; // the hive temperature of the pending sample was parsed
+};
+
+/**
+ * Format a duration (in s) as h:mm:ss
+ */
+static std::string formatDuration(uint32_t seconds)
+{
+    char text[20];
+    snprintf(text, sizeof(text), "%u:%02u:%02u", seconds / 3600, (seconds / 60) % 60, seconds % 60);
+    return text;
+}
+
+static bool isActive(uint8_t state)
+{
+    return state == Status::preHeat || state == Status::running;
+}
+
+/**
+ * Print the summary of a segment.
+ */
+static void printSummary(const char *name, size_t index, const LogSegment &segment)
+{
+    const std::vector<LogSample> &samples = segment.samples;
+    double stateTime[LOG_STATES] = { 0 }, activeTime = 0, runningTime = 0, atTarget = 0, errorSum = 0, dutySum = 0, energy = 0, humiditySum = 0,
+            vaporizerTime = 0;
+    int16_t maxHive = INT16_MIN, maxPlate = INT16_MIN, maxOvershoot = INT16_MIN;
+    uint8_t minHumidity = 255, maxHumidity = 0;
+    uint32_t gaps = 0, activeStart = 0, targetReached = 0;
+
+    for (size_t i = 0; i < samples.size(); i++) {
+        const LogSample &sample = samples[i];
+        double seconds = (i + 1 < samples.size() ? (samples[i + 1].time - sample.time) / 1000.0 : 0);
+        if (seconds * 1000 > LOG_MAX_GAP) {
+            gaps++;
+            seconds = 0;
+        }
+        for (size_t j = 0; j < LOG_STATES; j++) {
+            stateTime[j] += (sample.state == logStates[j].state ? seconds : 0);
+        }
+        maxHive = max(maxHive, sample.temperatureActualHive);
+        for (uint8_t j = 0; j < segment.numberOfPlates; j++) {
+            maxPlate = max(maxPlate, sample.temperaturePlate[j]);
+        }
+        minHumidity = min(minHumidity, sample.humidity);
+        maxHumidity = max(maxHumidity, sample.humidity);
+        humiditySum += sample.humidity * seconds;
+        vaporizerTime += (sample.vaporizerEnabled ? seconds : 0);
+
+        if (!isActive(sample.state)) {
+            continue;
+        }
+        if (activeStart == 0) {
+            activeStart = sample.time;
+        }
+        if (targetReached == 0 && sample.temperatureTargetHive > 0 && sample.temperatureActualHive >= sample.temperatureTargetHive - LOG_TARGET_TOLERANCE) {
+            targetReached = sample.time;
+        }
+        activeTime += seconds;
+        for (uint8_t j = 0; j < segment.numberOfPlates; j++) {
+            dutySum += sample.powerPlate[j] / 255.0 * seconds;
+            energy += sample.powerPlate[j] / 255.0 * CFG_HEATER_POWER_WATTS * seconds / 3600;
+        }
+        if (sample.state == Status::running) {
+            int16_t error = sample.temperatureActualHive - sample.temperatureTargetHive;
+            runningTime += seconds;
+            atTarget += (abs(error) <= LOG_TARGET_TOLERANCE ? seconds : 0);
+            errorSum += abs(error) * seconds;
+            maxOvershoot = max(maxOvershoot, error);
+        }
+    }
+
+    double duration = (samples.back().time - samples.front().time) / 1000.0;
+    printf("%s run %zu (line %u): %s logged, %zu samples, %d plates", name, index + 1, segment.line, formatDuration(duration).c_str(), samples.size(),
+            segment.numberOfPlates);
+    if (segment.numberOfHiveSensors > 0) {
+        printf(", %d hive sensors", segment.numberOfHiveSensors);
+    }
+    if (segment.programNumber > 0) {
+        printf(", program #%d", segment.programNumber);
+    }
+    printf("\n");
+
+    printf("  states:");
+    for (size_t j = 0; j < LOG_STATES; j++) {
+        if (stateTime[j] > 0) {
+            printf(" %s %s", logStates[j].name, formatDuration(stateTime[j]).c_str());
+        }
+    }
+    printf("\n  hive: max %.1fC", maxHive / 10.0);
+    if (activeStart != 0) {
+        if (targetReached != 0) {
+            printf(", target reached after %s", formatDuration((targetReached - activeStart) / 1000).c_str());
+        } else {
+            printf(", target not reached");
+        }
+    }
+    if (runningTime > 0) {
+        printf(", at target (+-%.1fC) %.1f%% of the running time, mean error %.2fC, max overshoot %.1fC", LOG_TARGET_TOLERANCE / 10.0,
+                atTarget * 100 / runningTime, errorSum / runningTime / 10, max(maxOvershoot, 0) / 10.0);
+    }
+    printf("\n  plates: max %.1fC", maxPlate / 10.0);
+    if (activeTime > 0 && segment.numberOfPlates > 0) {
+        printf(", mean power %.1f%% while heating, energy %.0fWh", dutySum * 100 / activeTime / segment.numberOfPlates, energy);
+    }
+    printf("\n  humidity: %d-%d%%", minHumidity, maxHumidity);
+    if (duration > 0) {
+        printf(", mean %.0f%%, vaporizer on %s", humiditySum / duration, formatDuration(vaporizerTime).c_str());
+    }
+    printf("\n");
+    if (gaps > 0 || segment.sensorErrors > 0) {
+        printf("  %u gaps longer than %ds, %u sensor errors\n", gaps, LOG_MAX_GAP / 1000, segment.sensorErrors);
+    }
+}
+
+/**
+ * Create the scratchpad of a DS18B20 (12 bit resolution) which reads as the temperature (in 0.1 deg C).
+ */
+static void createScratchpad(int16_t temperature, uint8_t scratchpad[9])
+{
+    int16_t raw = (temperature < 0 ? -1 : 1) * ((abs(temperature) * 8 + 4) / 5); // TemperatureSensor truncates raw * 5 / 8
+    uint8_t template_[9] = { (uint8_t) (raw & 0xff), (uint8_t) (raw >> 8), 0, 0, 0x7f, 0xff, 0, 0x10, 0 };
+    template_[8] = OneWire::crc8(template_, 8);
+    memcpy(scratchpad, template_, 9);
+}
+
+/**
+ * Add the inputs of a sample which changed to the trace.
+ */
+static void writeInputs(SensorTraceWriter &writer, uint32_t time, const LogSegment &segment, const LogSample &sample, const LogSample *previous)
+{
+    uint8_t hiveSensors = (segment.numberOfHiveSensors > 0 ? segment.numberOfHiveSensors : segment.numberOfPlates);
+    uint8_t record[10], data[4];
+
+    for (uint8_t i = 0; i < segment.numberOfPlates + hiveSensors; i++) {
+        bool plate = (i < segment.numberOfPlates);
+        uint8_t hive = i - segment.numberOfPlates;
+        int16_t temperature = (plate ? sample.temperaturePlate[i] : (segment.hiveSensorsLogged ? sample.temperatureHive[hive] : sample.temperatureActualHive));
+        int16_t last = (previous == NULL ? INT16_MIN :
+                (plate ? previous->temperaturePlate[i] : (segment.hiveSensorsLogged ? previous->temperatureHive[hive] : previous->temperatureActualHive)));
+        if (temperature == last) {
+            continue;
+        }
+        record[0] = i;
+        createScratchpad(temperature, record + 1);
+        if (previous == NULL) {
+            writer.write(traceScratchpad, time, record, 10);
+        } else {
+            writer.write(traceTemperature, time, record, 3);
+        }
+    }
+    if (previous == NULL || sample.humidity != previous->humidity) {
+        writer.write(traceHumidity, time, data, sensorTracePutFloat(data, sample.humidity));
+    }
+    if (previous == NULL || sample.temperatureHumidifier != previous->temperatureHumidifier) {
+        writer.write(traceHumidityTemperature, time, data, sensorTracePutFloat(data, sample.temperatureHumidifier / 10.0));
+    }
+}
+
+/**
+ * Add a console command to the trace.
+ */
+static void writeConsole(SensorTraceWriter &writer, uint32_t time, const char *command)
+{
+    uint8_t record[32];
+    record[0] = strlen(command);
+    memcpy(record + 1, command, record[0]);
+    writer.write(traceConsole, time, record, record[0] + 1);
+}
+
+/**
+ * Convert a segment into a sensor trace: the configuration and program store of a simulation, the
+ * sensors and a cycle every CFG_LOOP_DELAY with the logged inputs and outputs. Returns the number of
+ * cycles, 0 if the program isn't found.
+ */
+static uint32_t writeTrace(const LogSegment &segment, int programNumber, FILE *output)
+{
+    const std::vector<LogSample> &samples = segment.samples;
+    uint8_t hiveSensors = (segment.numberOfHiveSensors > 0 ? segment.numberOfHiveSensors : segment.numberOfPlates);
+    bool usePWM = false;
+    for (const LogSample &sample : samples) {
+        for (uint8_t i = 0; i < segment.numberOfPlates; i++) {
+            usePWM |= (sample.powerPlate[i] != 0 && sample.powerPlate[i] != 255); // without PWM the heaters are on or off
+        }
+    }
+
+    Simulation::resetBoard();
+    Sauna *sauna = new Sauna();
+    sauna->select();
+    Configuration::getInstance()->reset();
+    ConfigurationParams *params = Configuration::getParams();
+    ConfigurationSensor *sensor = Configuration::getSensor();
+    params->numberOfPlates = segment.numberOfPlates;
+    params->usePWM = usePWM;
+    params->maxHeaterPower = (samples.front().maxHeaterPower > 0 ? samples.front().maxHeaterPower : params->maxHeaterPower);
+    Simulation::connectPlates(segment.numberOfPlates);
+    for (uint8_t i = 0; i < segment.numberOfPlates; i++) {
+        OneWire::getAddress(OneWire::attach(0x100 + i), sensor->addressPlate[i].byte);
+    }
+    for (uint8_t i = 0; i < hiveSensors; i++) {
+        OneWire::getAddress(OneWire::attach(0x200 + i), sensor->addressHive[i].byte);
+    }
+    Program program;
+    memset(&program, 0, sizeof(Program));
+    bool found = ProgramStore::getInstance()->load(programNumber, &program);
+    if (found) {
+        ProgramStore::getInstance()->save(programNumber, &program);
+        Configuration::getInstance()->save();
+    }
+    EepromWriter::flush();
+    delete sauna;
+    if (!found) {
+        fprintf(stderr, "program #%d not found\n", programNumber);
+        return 0;
+    }
+
+    SensorTraceWriter writer(output);
+    uint32_t time = samples.front().time, cycles = 0;
+    uint8_t layout[SENSOR_TRACE_LAYOUT_SIZE];
+    SensorTrace::getLayout(layout);
+    writer.write(traceStart, time, layout, sizeof(layout));
+    for (uint16_t address = 0; address < HOST_EEPROM_SIZE; address += SENSOR_TRACE_EEPROM_CHUNK) {
+        uint8_t record[3 + SENSOR_TRACE_EEPROM_CHUNK] = { (uint8_t) (address & 0xff), (uint8_t) (address >> 8), SENSOR_TRACE_EEPROM_CHUNK };
+        memcpy(record + 3, EEPROM.memory + address, SENSOR_TRACE_EEPROM_CHUNK);
+        bool erased = true;
+        for (uint8_t i = 0; i < SENSOR_TRACE_EEPROM_CHUNK; i++) {
+            erased &= (record[3 + i] == 0xff);
+        }
+        if (!erased) {
+            writer.write(traceEeprom, time, record, sizeof(record));
+        }
+    }
+    for (uint8_t i = 0; i < segment.numberOfPlates + hiveSensors; i++) {
+        uint8_t rom[8];
+        OneWire::getAddress(i, rom);
+        writer.write(traceSensorFound, time, rom, 8);
+    }
+
+    // the outputs of a sample were calculated from inputs which were read up to a second before they were
+    // logged, so the inputs of the next sample are fed together with the outputs of the current one
+    size_t current = 0, input = min(1, samples.size() - 1);
+    writeInputs(writer, time, segment, samples[input], NULL);
+
+    // the board is ready after the initialization, the program is started or stopped when the log shows it
+    uint8_t state = Status::ready, values[traceFixedOutputs + 2 * CFG_MAX_NUMBER_PLATES];
+    char command[16];
+    for (; time <= samples.back().time; time += CFG_LOOP_DELAY, cycles++) {
+        writer.write(traceCycle, time);
+        while (current + 1 < samples.size() && samples[current + 1].time <= time) {
+            current++;
+        }
+        if (min(current + 1, samples.size() - 1) != input) {
+            writeInputs(writer, time, segment, samples[min(current + 1, samples.size() - 1)], &samples[input]);
+            input = min(current + 1, samples.size() - 1);
+        }
+        const LogSample &sample = samples[current];
+        if (isActive(sample.state) && !isActive(state) && state != Status::overtemp) {
+            snprintf(command, sizeof(command), "START=%d\n", programNumber);
+            writeConsole(writer, time, command);
+        } else if (sample.state == Status::ready && isActive(state)) {
+            writeConsole(writer, time, "x\n");
+        }
+        state = sample.state;
+
+        values[traceOutputState] = sample.state;
+        values[traceOutputRelay] = isActive(sample.state);
+        values[traceOutputVaporizer] = sample.vaporizerEnabled;
+        values[traceOutputHumidifierFan] = sample.fanSpeedHumidifier;
+        for (uint8_t i = 0; i < segment.numberOfPlates; i++) {
+            values[traceFixedOutputs + 2 * i] = sample.powerPlate[i];
+            values[traceFixedOutputs + 2 * i + 1] = sample.fanSpeedPlate[i];
+        }
+        writer.writeOutputs(time, values, sensorTraceOutputs(segment.numberOfPlates));
+    }
+    writer.flush();
+    return cycles;
+}
+
+/**
+ * Write the samples of a segment as comma-separated values.
+ */
+static void writeValues(const LogSegment &segment, FILE *output)
+{
+    fprintf(output, "time,running,state,hive,hiveTarget");
+    for (uint8_t i = 0; segment.hiveSensorsLogged && i < segment.numberOfHiveSensors; i++) {
+        fprintf(output, ",hive%d", i + 1);
+    }
+    for (uint8_t i = 0; i < segment.numberOfPlates; i++) {
+        fprintf(output, ",plate%d,power%d,fan%d", i + 1, i + 1, i + 1);
+    }
+    fprintf(output, ",plateTarget,humidity,vaporizer,humidifierFan,humidifierTemperature\n");
+
+    for (const LogSample &sample : segment.samples) {
+        fprintf(output, "%.3f,%u,%d,%.1f,%.1f", (sample.time - segment.samples.front().time) / 1000.0, sample.timeRunning, sample.state,
+                sample.temperatureActualHive / 10.0, sample.temperatureTargetHive / 10.0);
+        for (uint8_t i = 0; segment.hiveSensorsLogged && i < segment.numberOfHiveSensors; i++) {
+            fprintf(output, ",%.1f", sample.temperatureHive[i] / 10.0);
+        }
+        for (uint8_t i = 0; i < segment.numberOfPlates; i++) {
+            fprintf(output, ",%.1f,%d,%d", sample.temperaturePlate[i] / 10.0, sample.powerPlate[i], sample.fanSpeedPlate[i]);
+        }
+        fprintf(output, ",%.1f,%d,%d,%d,%.1f\n", sample.temperatureTargetPlate / 10.0, sample.humidity, sample.vaporizerEnabled,
+                sample.fanSpeedHumidifier, sample.temperatureHumidifier / 10.0);
+    }
+}
+
+/**
+ * Memory-map a log and parse it.
+ */
+static bool parseLog(const char *name, LogParser *parser, size_t *size)
+{
+    int file = open(name, O_RDONLY);
+    struct stat info;
+    if (file < 0 || fstat(file, &info) != 0) {
+        perror(name);
+        if (file >= 0) {
+            close(file);
+        }
+        return false;
+    }
+    *size = info.st_size;
+    if (*size > 0) {
+        void *data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED) {
+            perror(name);
+            close(file);
+            return false;
+        }
+        madvise(data, *size, MADV_SEQUENTIAL);
+        parser->parse((const char *) data, *size);
+        munmap(data, *size);
+    }
+    close(file);
+    return true;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-s run] [-p program] [-o trace] [-c values] log...\n", name);
+    fprintf(stderr, "  -s       the run to export (default: the longest in which a program was started)\n");
+    fprintf(stderr, "  -p       the program started in the trace (default: the logged one or 1)\n");
+    fprintf(stderr, "  -o       write the run as a sensor trace for TraceReplay\n");
+    fprintf(stderr, "  -c       write the run as comma-separated values\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *traceName = NULL, *valuesName = NULL;
+    int runNumber = 0, programNumber = 0, option;
+
+    while ((option = getopt(argc, argv, "s:p:o:c:")) != -1) {
+        bool valid = true;
+        switch (option) {
+        case 's':
+            runNumber = atoi(optarg);
+            break;
+        case 'p':
+            programNumber = atoi(optarg);
+            break;
+        case 'o':
+            traceName = optarg;
+            break;
+        case 'c':
+            valuesName = optarg;
+            break;
+        default:
+            valid = false;
+        }
+        if (!valid) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    bool exporting = (traceName != NULL || valuesName != NULL);
+    if (optind == argc || (exporting && optind != argc - 1)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    LogParser parser;
+    for (int i = optind; i < argc; i++) {
+        parser = LogParser();
+        size_t size;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (!parseLog(argv[i], &parser, &size)) {
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%s: %.1fMB, %u lines, %u log messages, %u incomplete samples, parsed in %.3fs (%.0fMB/s)\n", argv[i], size / 1e6, parser.lines,
+                parser.recognized, parser.incomplete, seconds, (seconds > 0 ? size / 1e6 / seconds : 0.0));
+        for (size_t j = 0; j < parser.segments.size(); j++) {
+            if (!parser.segments[j].samples.empty()) {
+                printSummary(argv[i], j, parser.segments[j]);
+            }
+        }
+    }
+    if (!exporting) {
+        return 0;
+    }
+
+    const std::vector<LogSegment> &segments = parser.segments;
+    const LogSegment *segment = NULL;
+    if (runNumber > 0) {
+        segment = ((size_t) runNumber <= segments.size() ? &segments[runNumber - 1] : NULL);
+    } else {
+        for (const LogSegment &candidate : segments) {
+            bool active = false;
+            for (const LogSample &sample : candidate.samples) {
+                active |= isActive(sample.state);
+            }
+            if (active && (segment == NULL || candidate.samples.size() > segment->samples.size())) {
+                segment = &candidate;
+            }
+        }
+    }
+    if (segment == NULL || segment->samples.empty() || segment->numberOfPlates == 0) {
+        fprintf(stderr, "%s: no run with samples found\n", argv[optind]);
+        return 1;
+    }
+
+    if (valuesName != NULL) {
+        FILE *output = fopen(valuesName, "w");
+        if (output == NULL) {
+            perror(valuesName);
+            return 1;
+        }
+        writeValues(*segment, output);
+        fclose(output);
+    }
+    if (traceName != NULL) {
+        FILE *output = fopen(traceName, "wb");
+        if (output == NULL) {
+            perror(traceName);
+            return 1;
+        }
+        if (programNumber == 0) {
+            programNumber = (segment->programNumber > 0 ? segment->programNumber : 1);
+        }
+        uint32_t cycles = writeTrace(*segment, programNumber, output);
+        long size = ftell(output);
+        fclose(output);
+        if (cycles == 0) {
+            return 1;
+        }
+        printf("%s: run %zu with program #%d, %u cycles, %ld bytes\n", traceName, segment - segments.data() + 1, programNumber, cycles, size);
+    }
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*
+ * LoggerBenchmark.cpp
+ *
+ * Host benchmark comparing the former String based logger with the flash
+ * resident Logger. It counts heap allocations and measures the time per log
+ * call for a typical line of HID::logData(). The "disabled" variant shows the
+ * cost of a debug message while the module's log level is set to info.
+ * The time of the current logger includes copying the message through the
+ * SerialBuffer to the serial port.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -Itools/host -I. tools/LoggerBenchmark.cpp Logger.cpp SerialBuffer.cpp tools/host/Arduino.cpp -o loggerBenchmark
+ *   ./loggerBenchmark
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <new>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC
+#endif
+#include "Logger.h"
+
+static uint32_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+
+/*
+ * The logger as it was before, taking the format as String by value.
+ */
+class LegacyLogger
+{
+public:
+    static void info(String message, ...)
+    {
+        va_list args;
+        va_start(args, message);
+        log(Logger::Info, message, args);
+        va_end(args);
+    }
+
+private:
+    static void log(Logger::LogLevel level, String format, va_list args)
+    {
+        String logLevel = F("DEBUG");
+        uint32_t lastLogTime = millis();
+
+        switch (level) {
+        case Logger::Info:
+            logLevel = F("INFO");
+            break;
+        case Logger::Warn:
+            logLevel = F("WARNING");
+            break;
+        case Logger::Error:
+            logLevel = F("ERROR");
+            break;
+        default:
+            break;
+        }
+        vsnprintf(msgBuffer, CFG_LOG_BUFFER_SIZE, format.c_str(), args);
+
+        Serial.print(lastLogTime);
+        Serial.print(F(" - "));
+        Serial.print(logLevel);
+        Serial.print(F(": "));
+        Serial.println(msgBuffer);
+    }
+    static char msgBuffer[CFG_LOG_BUFFER_SIZE];
+};
+
+char LegacyLogger::msgBuffer[CFG_LOG_BUFFER_SIZE];
+
+/*
+ * The former HID::toDecimal() which returned a temporary String.
+ */
+static String legacyToDecimal(int16_t number, uint8_t divisor)
+{
+    char buffer[10];
+    snprintf(buffer, 9, "%d.%d", number / divisor, abs(number % divisor));
+    return String(buffer);
+}
+
+/*
+ * The current HID::toDecimal() which formats into a caller supplied buffer.
+ */
+static char *toDecimal(int16_t number, uint8_t divisor, char *buffer)
+{
+    snprintf_P(buffer, 10, PSTR("%d.%d"), number / divisor, abs(number % divisor));
+    return buffer;
+}
+
+static uint64_t cycles()
+{
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct Result
+{
+    double allocationsPerCall;
+    double nanosPerCall;
+    double cyclesPerCall;
+};
+
+template<typename Function>
+static Result measure(uint32_t iterations, Function function)
+{
+    uint32_t startAllocations = allocations;
+    uint64_t startCycles = cycles();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        function(i);
+    }
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    Result result;
+    result.cyclesPerCall = (double) (cycles() - startCycles) / iterations;
+    result.nanosPerCall = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    result.allocationsPerCall = (double) (allocations - startAllocations) / iterations;
+    return result;
+}
+
+static void printResult(const char *name, Result result)
+{
+    printf("%-10s %12.2f %12.1f %12.0f\n", name, result.allocationsPerCall, result.nanosPerCall, result.cyclesPerCall);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = (argc > 1 ? atol(argv[1]) : 200000);
+
+    Serial.setEcho(false);
+    Logger::setLoglevel(Logger::Info);
+
+    Result legacy = measure(iterations, [](uint32_t i) {
+        LegacyLogger::info(F("plate %d: %sC -> %sC, power=%d/%d, fan=%d"), 1, legacyToDecimal(i % 900, 10).c_str(),
+                legacyToDecimal(700, 10).c_str(), i % 170, 170, 200);
+    });
+    Result current = measure(iterations, [](uint32_t i) {
+        char value1[10], value2[10];
+        LOG_INFO(Logger::moduleHID, F("plate %d: %sC -> %sC, power=%d/%d, fan=%d"), 1, toDecimal(i % 900, 10, value1),
+                toDecimal(700, 10, value2), i % 170, 170, 200);
+        SerialBuffer::flush();
+    });
+    Result disabled = measure(iterations, [](uint32_t i) {
+        char value1[10], value2[10];
+        LOG_DEBUG(Logger::moduleHID, F("plate %d: %sC -> %sC, power=%d/%d, fan=%d"), 1, toDecimal(i % 900, 10, value1),
+                toDecimal(700, 10, value2), i % 170, 170, 200);
+    });
+
+    printf("%u log calls per variant, %u bytes written\n", iterations, Serial.getBytesWritten());
+    printf("%-10s %12s %12s %12s\n", "variant", "allocs/call", "ns/call", "cycles/call");
+    printResult("legacy", legacy);
+    printResult("current", current);
+    printResult("disabled", disabled);
+    return 0;
+}
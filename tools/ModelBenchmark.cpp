@@ -0,0 +1,220 @@
+/*
+ * ModelBenchmark.cpp
+ *
+ * Benchmark of the batch thermal model against the scalar one: a number of units
+ * with slightly different parameters (ambient temperature, heater power and colony)
+ * are simulated once with one SaunaModel per unit and once with SaunaBatchModel,
+ * both split into chunks of units which run in parallel. Each plate is driven by a
+ * simple thermostat which switches the heater and fan on as long as its zone is
+ * below the target temperature. The tool prints the time per plate and step of both
+ * models, the speed-up and the largest difference of the final temperatures and
+ * energies, which should be 0 because both models do the same operations.
+ *
+ * Build and run from the repository root (add -march=native to use the widest vectors of the CPU):
+ *   g++ -O3 -pthread -Itools/host -I. tools/ModelBenchmark.cpp tools/SaunaBatchModel.cpp tools/SaunaModel.cpp \
+ *       tools/WorkStealingPool.cpp -o modelBenchmark
+ *   ./modelBenchmark -n 4096 -t 60
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <unistd.h>
+#include "WorkStealingPool.h"
+#include "SaunaBatchModel.h"
+
+#define BENCHMARK_STEP 0.1 // time step (in s), the loop delay of the firmware
+#define BENCHMARK_TARGET 40 // temperature the thermostats keep the zones at (in deg C)
+
+/*
+ * The parameters of a unit, varied deterministically so the results are reproducible.
+ */
+static SaunaModelParameters unitParameters(size_t unit, uint8_t plates)
+{
+    SaunaModelParameters parameters;
+    parameters.numberOfPlates = plates;
+    parameters.ambientTemperature = 5 + unit % 26;
+    parameters.heaterPower *= 0.9 + (unit % 5) * 0.05;
+    parameters.colonyHeat = 0.5 + (unit % 8) * 0.5;
+    return parameters;
+}
+
+/*
+ * The final state of a unit, to compare the two models.
+ */
+struct UnitResult
+{
+    std::vector<double> temperatures; // of the plates and zones
+    double energy; // in Wh
+};
+
+static void runScalar(size_t first, size_t count, uint8_t plates, uint32_t steps, std::vector<UnitResult> &results)
+{
+    std::vector<SaunaModel> models;
+    for (size_t unit = first; unit < first + count; unit++) {
+        models.push_back(SaunaModel(unitParameters(unit, plates)));
+    }
+    for (uint32_t step = 0; step < steps; step++) {
+        for (SaunaModel &model : models) {
+            for (uint8_t plate = 0; plate < plates; plate++) {
+                double on = (model.getZoneTemperature(plate) < BENCHMARK_TARGET ? 1 : 0);
+                model.setHeater(plate, on);
+                model.setFan(plate, on);
+            }
+            model.step(BENCHMARK_STEP);
+        }
+    }
+    for (size_t index = 0; index < count; index++) {
+        UnitResult &result = results[first + index];
+        for (uint8_t plate = 0; plate < plates; plate++) {
+            result.temperatures.push_back(models[index].getPlateTemperature(plate));
+            result.temperatures.push_back(models[index].getZoneTemperature(plate));
+        }
+        result.energy = models[index].getEnergy();
+    }
+}
+
+static void runBatch(size_t first, size_t count, uint8_t plates, uint32_t steps, std::vector<UnitResult> &results)
+{
+    std::vector<SaunaModelParameters> parameters;
+    for (size_t unit = first; unit < first + count; unit++) {
+        parameters.push_back(unitParameters(unit, plates));
+    }
+    SaunaBatchModel model(parameters);
+
+    for (uint32_t step = 0; step < steps; step++) {
+        for (uint8_t plate = 0; plate < plates; plate++) {
+            const double *zone = model.getZoneTemperatures(plate);
+            double *heater = model.getHeaters(plate);
+            double *fan = model.getFans(plate);
+            for (size_t unit = 0; unit < count; unit++) {
+                double on = (zone[unit] < BENCHMARK_TARGET ? 1 : 0);
+                heater[unit] = on;
+                fan[unit] = on;
+            }
+        }
+        model.step(BENCHMARK_STEP);
+    }
+    for (size_t index = 0; index < count; index++) {
+        UnitResult &result = results[first + index];
+        for (uint8_t plate = 0; plate < plates; plate++) {
+            result.temperatures.push_back(model.getPlateTemperature(index, plate));
+            result.temperatures.push_back(model.getZoneTemperature(index, plate));
+        }
+        result.energy = model.getEnergy(index);
+    }
+}
+
+/*
+ * Simulate all units in chunks on the pool and return the time it took (in s).
+ */
+static double run(WorkStealingPool &pool, bool batch, size_t units, size_t chunk, uint8_t plates, uint32_t steps,
+        std::vector<UnitResult> &results)
+{
+    results.assign(units, UnitResult());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t first = 0; first < units; first += chunk) {
+        size_t count = (units - first < chunk ? units - first : chunk);
+        pool.submit([&, first, count] {
+            if (batch) {
+                runBatch(first, count, plates, steps, results);
+            } else {
+                runScalar(first, count, plates, steps, results);
+            }
+        });
+    }
+    pool.wait();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-n units] [-p plates] [-t minutes] [-c chunk] [-j threads]\n", name);
+    fprintf(stderr, "  -n       number of simulated units (default: 1024)\n");
+    fprintf(stderr, "  -p       number of plates per unit (default: 4)\n");
+    fprintf(stderr, "  -t       simulated time (in min, default: 30)\n");
+    fprintf(stderr, "  -c       number of units simulated by one task (default: 256)\n");
+    fprintf(stderr, "  -j       number of threads (default: one per core)\n");
+}
+
+int main(int argc, char **argv)
+{
+    int units = 1024, plates = 4, minutes = 30, chunk = 256, threads = 0, option;
+
+    while ((option = getopt(argc, argv, "n:p:t:c:j:")) != -1) {
+        bool valid = true;
+        switch (option) {
+        case 'n':
+            units = atoi(optarg);
+            valid = units > 0;
+            break;
+        case 'p':
+            plates = atoi(optarg);
+            valid = plates > 0 && plates < 256;
+            break;
+        case 't':
+            minutes = atoi(optarg);
+            valid = minutes > 0;
+            break;
+        case 'c':
+            chunk = atoi(optarg);
+            valid = chunk > 0;
+            break;
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        default:
+            valid = false;
+        }
+        if (!valid) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    WorkStealingPool pool(threads);
+    uint32_t steps = minutes * 60 / BENCHMARK_STEP + 0.5;
+    double plateSteps = (double) units * plates * steps;
+    std::vector<UnitResult> scalar, batch;
+
+    fprintf(stderr, "simulating %d units with %d plates for %d min on %u threads\n", units, plates, minutes, pool.getNumberOfThreads());
+    double scalarTime = run(pool, false, units, chunk, plates, steps, scalar);
+    double batchTime = run(pool, true, units, chunk, plates, steps, batch);
+
+    double maxTemperature = 0, maxEnergy = 0;
+    for (int unit = 0; unit < units; unit++) {
+        for (size_t index = 0; index < scalar[unit].temperatures.size(); index++) {
+            maxTemperature = fmax(maxTemperature, fabs(scalar[unit].temperatures[index] - batch[unit].temperatures[index]));
+        }
+        maxEnergy = fmax(maxEnergy, fabs(scalar[unit].energy - batch[unit].energy));
+    }
+
+    printf("scalar model: %8.2fs %8.2f ns per plate and step\n", scalarTime, scalarTime * 1e9 / plateSteps);
+    printf("batch model:  %8.2fs %8.2f ns per plate and step\n", batchTime, batchTime * 1e9 / plateSteps);
+    printf("speed-up:     %8.2f\n", scalarTime / batchTime);
+    printf("max difference: %g C, %g Wh\n", maxTemperature, maxEnergy);
+    return (maxTemperature == 0 && maxEnergy == 0 ? 0 : 2);
+}
@@ -0,0 +1,366 @@
+/*
+ * ParameterSweep.cpp
+ *
+ * Sweeps program parameters over the simulated sauna: every combination of the
+ * given values runs as an independent Simulation on a WorkStealingPool. The
+ * parameter sets are printed ranked by their time at the target temperature (or
+ * the chosen column) together with the pre-heat time, overshoot and energy.
+ * With -o the time series of every run is written to a column-oriented file
+ * (see SeriesFormat.h) which tools/SeriesQuery.cpp evaluates.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -pthread -Itools/host -I. tools/ParameterSweep.cpp tools/Simulation.cpp tools/SaunaModel.cpp tools/SeriesWriter.cpp \
+ *       tools/WorkStealingPool.cpp Sauna.cpp Controller.cpp Plate.cpp Fan.cpp Heater.cpp Humidifier.cpp HumiditySensor.cpp \
+ *       TemperatureSensor.cpp SerialConsole.cpp Checkpoint.cpp History.cpp HID.cpp Beeper.cpp Device.cpp ButtonInput.cpp \
+ *       LcdFrameBuffer.cpp ProgramHandler.cpp ProgramStore.cpp ThermalDose.cpp Telemetry.cpp SensorTrace.cpp Configuration.cpp \
+ *       Statistics.cpp Status.cpp Logger.cpp SerialBuffer.cpp EepromWriter.cpp Crc.cpp tools/host/Arduino.cpp tools/host/DHT.cpp \
+ *       tools/host/EEPROM.cpp tools/host/LiquidCrystal.cpp tools/host/OneWire.cpp tools/host/PID_v1.cpp -o parameterSweep
+ *   ./parameterSweep -p 1 HIVE-KP=2:8:2 HIVE-KI=0.1,0.2,0.4 TEMP-PLATE=600,700
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "WorkStealingPool.h"
+#include "SeriesWriter.h"
+#include "Simulation.h"
+#include "ProgramStore.h"
+
+/*
+ * A field of the program which can be swept, the names are the ones of the serial console.
+ */
+struct SweepField
+{
+    const char *name;
+    enum Type
+    {
+        typeUint8,
+        typeInt16,
+        typeDouble
+    } type;
+    size_t offset;
+};
+
+static const SweepField fields[] = {
+    { "FANSPEED", SweepField::typeUint8, offsetof(Program, fanSpeed) },
+    { "FANSPEED-PREHEAT", SweepField::typeUint8, offsetof(Program, fanSpeedPreHeat) },
+    { "HIVE-KD", SweepField::typeDouble, offsetof(Program, hiveKd) },
+    { "HIVE-KI", SweepField::typeDouble, offsetof(Program, hiveKi) },
+    { "HIVE-KP", SweepField::typeDouble, offsetof(Program, hiveKp) },
+    { "PLATE-KD", SweepField::typeDouble, offsetof(Program, plateKd) },
+    { "PLATE-KI", SweepField::typeDouble, offsetof(Program, plateKi) },
+    { "PLATE-KP", SweepField::typeDouble, offsetof(Program, plateKp) },
+    { "TEMP-PLATE", SweepField::typeInt16, offsetof(Program, temperaturePlate) }
+};
+
+/*
+ * A swept field and the values it takes.
+ */
+struct SweepAxis
+{
+    const SweepField *field;
+    std::vector<double> values;
+};
+
+enum SortColumn
+{
+    sortTarget,
+    sortPreHeat,
+    sortOvershoot,
+    sortEnergy
+};
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-p program] [-t minutes] [-a ambient] [-j threads] [-n rows] [-s column] [-w] [-o series] [-i interval]\n", name);
+    fprintf(stderr, "       NAME=values...\n");
+    fprintf(stderr, "  NAME     FANSPEED, FANSPEED-PREHEAT (0-255), HIVE-KP, HIVE-KI, HIVE-KD, PLATE-KP, PLATE-KI, PLATE-KD\n");
+    fprintf(stderr, "           (gains as used by the PID, not multiplied by 100), TEMP-PLATE (in 0.1 deg C)\n");
+    fprintf(stderr, "  values   a list (1,2,4) or a range (from:to:step)\n");
+    fprintf(stderr, "  -p       the program to sweep (default: 1)\n");
+    fprintf(stderr, "  -t       simulated time per run (in min, default: until the program ends)\n");
+    fprintf(stderr, "  -a       ambient temperature (in deg C, default: 20)\n");
+    fprintf(stderr, "  -j       number of threads (default: one per core)\n");
+    fprintf(stderr, "  -n       number of rows to print (default: 20, 0 = all)\n");
+    fprintf(stderr, "  -s       sort by target (longest time at target, default), preheat, overshoot or energy\n");
+    fprintf(stderr, "  -w       drive the heaters with PWM instead of on/off\n");
+    fprintf(stderr, "  -o       write the time series of all runs to a file\n");
+    fprintf(stderr, "  -i       interval of the time series (in ms, default: %d = every loop)\n", CFG_LOOP_DELAY);
+}
+
+/**
+ * Parse "NAME=1,2,4" or "NAME=from:to:step" into an axis of the sweep.
+ */
+static bool parseAxis(const char *argument, SweepAxis *axis)
+{
+    std::string text(argument);
+    size_t equals = text.find('=');
+    if (equals == std::string::npos) {
+        return false;
+    }
+    std::string name = text.substr(0, equals), values = text.substr(equals + 1);
+
+    axis->field = NULL;
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        if (strcasecmp(fields[i].name, name.c_str()) == 0) {
+            axis->field = &fields[i];
+        }
+    }
+    if (axis->field == NULL) {
+        fprintf(stderr, "unknown parameter: %s\n", name.c_str());
+        return false;
+    }
+
+    double from, to, step;
+    if (sscanf(values.c_str(), "%lf:%lf:%lf", &from, &to, &step) == 3) {
+        if (step <= 0 || to < from) {
+            return false;
+        }
+        for (double value = from; value <= to + step / 1000; value += step) {
+            axis->values.push_back(value);
+        }
+    } else {
+        char *position = &values[0], *end;
+        while (*position) {
+            axis->values.push_back(strtod(position, &end));
+            if (end == position || (*end != ',' && *end != 0)) {
+                return false;
+            }
+            position = (*end == ',' ? end + 1 : end);
+        }
+    }
+    return !axis->values.empty();
+}
+
+static void setField(Program *program, const SweepField *field, double value)
+{
+    uint8_t *address = (uint8_t *) program + field->offset;
+
+    switch (field->type) {
+    case SweepField::typeUint8:
+        *address = constrain(value, 0, 255);
+        break;
+    case SweepField::typeInt16:
+        *(int16_t *) address = value;
+        break;
+    case SweepField::typeDouble:
+        *(double *) address = value;
+        break;
+    }
+}
+
+/**
+ * Unsuccessful runs are ranked last, the others by the chosen column.
+ */
+static bool isBetter(const SimulationResult &a, const SimulationResult &b, SortColumn column)
+{
+    bool failedA = !a.started || a.overtemp, failedB = !b.started || b.overtemp;
+    if (failedA != failedB) {
+        return failedB;
+    }
+
+    switch (column) {
+    case sortPreHeat:
+        if (a.preHeatTime == 0 || b.preHeatTime == 0) {
+            return a.preHeatTime != 0;
+        }
+        return a.preHeatTime < b.preHeatTime;
+    case sortOvershoot:
+        return a.overshoot < b.overshoot;
+    case sortEnergy:
+        return a.energy < b.energy;
+    default:
+        return a.timeAtTarget > b.timeAtTarget;
+    }
+}
+
+static std::string formatTime(uint32_t seconds)
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%u:%02u", seconds / 3600, (seconds / 60) % 60);
+    return text;
+}
+
+static const char *resultToStr(const SimulationResult &result)
+{
+    if (!result.started) {
+        return "failed";
+    }
+    if (result.overtemp) {
+        return "overtemp";
+    }
+    return (result.completed ? "ok" : "time limit");
+}
+
+int main(int argc, char **argv)
+{
+    int programNumber = 1, threads = 0, rows = 20, option;
+    uint32_t timeLimit = 0, interval = CFG_LOOP_DELAY;
+    const char *seriesName = NULL;
+    bool usePWM = false;
+    SortColumn column = sortTarget;
+    SaunaModelParameters modelParameters;
+
+    while ((option = getopt(argc, argv, "p:t:a:j:n:s:wo:i:")) != -1) {
+        switch (option) {
+        case 'p':
+            programNumber = atoi(optarg);
+            break;
+        case 't':
+            timeLimit = atoi(optarg) * 60;
+            break;
+        case 'a':
+            modelParameters.ambientTemperature = atof(optarg);
+            break;
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 'n':
+            rows = atoi(optarg);
+            break;
+        case 's':
+            column = (strcmp(optarg, "preheat") == 0 ? sortPreHeat :
+                        strcmp(optarg, "overshoot") == 0 ? sortOvershoot : strcmp(optarg, "energy") == 0 ? sortEnergy : sortTarget);
+            break;
+        case 'w':
+            usePWM = true;
+            break;
+        case 'o':
+            seriesName = optarg;
+            break;
+        case 'i':
+            interval = max(atoi(optarg) / CFG_LOOP_DELAY, 1) * CFG_LOOP_DELAY; // the simulation samples once per loop
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<SweepAxis> axes;
+    size_t numberOfRuns = 1;
+    for (int i = optind; i < argc; i++) {
+        SweepAxis axis;
+        if (!parseAxis(argv[i], &axis)) {
+            fprintf(stderr, "invalid sweep: %s\n", argv[i]);
+            usage(argv[0]);
+            return 1;
+        }
+        axes.push_back(axis);
+        numberOfRuns *= axis.values.size();
+    }
+
+    Program program;
+    memset(&program, 0, sizeof(Program));
+    if (!ProgramStore::getInstance()->load(programNumber, &program)) {
+        fprintf(stderr, "program #%d not found\n", programNumber);
+        return 1;
+    }
+
+    // one parameter set per run, the first axis changes slowest
+    std::vector<std::vector<double> > sets(numberOfRuns);
+    for (size_t run = 0; run < numberOfRuns; run++) {
+        size_t index = run;
+        sets[run].resize(axes.size());
+        for (size_t i = axes.size(); i-- > 0;) {
+            sets[run][i] = axes[i].values[index % axes[i].values.size()];
+            index /= axes[i].values.size();
+        }
+    }
+
+    SeriesWriter seriesWriter;
+    if (seriesName != NULL && !seriesWriter.open(seriesName)) {
+        perror(seriesName);
+        return 1;
+    }
+
+    std::vector<SimulationResult> results(numberOfRuns);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(threads);
+        fprintf(stderr, "simulating %zu parameter sets of '%s' on %u threads\n", numberOfRuns, program.name, pool.getNumberOfThreads());
+
+        for (size_t run = 0; run < numberOfRuns; run++) {
+            pool.submit([&, run] {
+                Program variant = program;
+                for (size_t i = 0; i < axes.size(); i++) {
+                    setField(&variant, axes[i].field, sets[run][i]);
+                }
+                Simulation simulation(variant, modelParameters);
+                simulation.setUsePWM(usePWM);
+                if (timeLimit > 0) {
+                    simulation.setTimeLimit(timeLimit);
+                }
+                if (seriesName == NULL) {
+                    results[run] = simulation.run();
+                    return;
+                }
+                std::string label;
+                for (size_t i = 0; i < axes.size(); i++) {
+                    char value[48];
+                    snprintf(value, sizeof(value), "%s%s=%g", (i > 0 ? " " : ""), axes[i].field->name, sets[run][i]);
+                    label += value;
+                }
+                SeriesRun series(run + 1, interval, label);
+                simulation.setSeries(&series);
+                results[run] = simulation.run();
+                seriesWriter.write(series);
+            });
+        }
+        pool.wait();
+    }
+    if (seriesName != NULL && !seriesWriter.close()) {
+        perror(seriesName);
+        return 1;
+    }
+    fprintf(stderr, "done in %.1fs\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    std::vector<size_t> ranking(numberOfRuns);
+    for (size_t run = 0; run < numberOfRuns; run++) {
+        ranking[run] = run;
+    }
+    std::stable_sort(ranking.begin(), ranking.end(), [&](size_t a, size_t b) {return isBetter(results[a], results[b], column);});
+
+    printf("rank");
+    for (size_t i = 0; i < axes.size(); i++) {
+        printf(" %16s", axes[i].field->name);
+    }
+    printf("   preheat  overshoot  at target   energy  result\n");
+
+    for (size_t rank = 0; rank < numberOfRuns && (rows == 0 || rank < (size_t) rows); rank++) {
+        size_t run = ranking[rank];
+        SimulationResult &result = results[run];
+
+        printf("%4zu", rank + 1);
+        for (size_t i = 0; i < axes.size(); i++) {
+            printf(" %16g", sets[run][i]);
+        }
+        printf("  %8s  %7.1f C  %9s  %5.0fWh  %s\n", (result.preHeatTime ? formatTime(result.preHeatTime).c_str() : "-"),
+                result.overshoot / 10.0, formatTime(result.timeAtTarget).c_str(), result.energy, resultToStr(result));
+    }
+    return 0;
+}
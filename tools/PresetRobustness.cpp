@@ -0,0 +1,363 @@
+/*
+ * PresetRobustness.cpp
+ *
+ * Monte-Carlo check of the program presets against the variety of hives: every
+ * run draws the number of brood boxes, the colony size, the ambient temperature,
+ * the number of plates, the heater power and the fans' effect as well as the
+ * errors of the temperature sensors (bias, noise, failed reads and a sensor which
+ * stops responding). The runs of each preset are simulated in parallel and
+ * summarized as percentiles of the time to target and of the actual maximum hive
+ * temperature compared to hiveOverTemp, together with the fraction of runs which
+ * ran into over-temperature. The exit code is 2 if a preset isn't safe, i.e. a
+ * run tripped over-temperature or the hive got hotter than hiveOverTemp.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -pthread -Itools/host -I. tools/PresetRobustness.cpp tools/Simulation.cpp tools/SaunaModel.cpp tools/SeriesWriter.cpp \
+ *       tools/WorkStealingPool.cpp Sauna.cpp Controller.cpp Plate.cpp Fan.cpp Heater.cpp Humidifier.cpp HumiditySensor.cpp \
+ *       TemperatureSensor.cpp SerialConsole.cpp Checkpoint.cpp History.cpp HID.cpp Beeper.cpp Device.cpp ButtonInput.cpp \
+ *       LcdFrameBuffer.cpp ProgramHandler.cpp ProgramStore.cpp ThermalDose.cpp Telemetry.cpp SensorTrace.cpp Configuration.cpp \
+ *       Statistics.cpp Status.cpp Logger.cpp SerialBuffer.cpp EepromWriter.cpp Crc.cpp tools/host/Arduino.cpp tools/host/DHT.cpp \
+ *       tools/host/EEPROM.cpp tools/host/LiquidCrystal.cpp tools/host/OneWire.cpp tools/host/PID_v1.cpp -o presetRobustness
+ *   ./presetRobustness -n 200 -a 5:30
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "WorkStealingPool.h"
+#include "Simulation.h"
+#include "ProgramStore.h"
+
+#define DEFAULT_NUMBER_OF_PLATES 4 // SaunaModelParameters describe a box heated by four plates
+
+/*
+ * A range of values from which a run draws uniformly.
+ */
+struct Range
+{
+    double from;
+    double to;
+
+    double draw(std::mt19937 &random) const
+    {
+        return std::uniform_real_distribution<double>(from, to)(random);
+    }
+
+    int drawInteger(std::mt19937 &random) const
+    {
+        return std::uniform_int_distribution<int>(from, to)(random);
+    }
+};
+
+/*
+ * The variations of the hives and sensors.
+ */
+struct Variations
+{
+    Range boxes; // number of brood boxes
+    Range colony; // heat of the colony per box and plate (in W)
+    Range ambient; // in deg C
+    Range plates; // number of heater plates
+    Range heater; // factor of the heater power (e.g. mains voltage)
+    Range fan; // factor of the heat transfer by the fans (e.g. airflow through the combs)
+    double bias; // standard deviation of the constant sensor errors (in deg C)
+    double noise; // standard deviation of the sensor noise (in deg C)
+    double dropout; // fraction of failed sensor reads
+    double dead; // probability that a hive sensor stops responding during the run
+};
+
+/*
+ * The drawn parameters of a run.
+ */
+struct Scenario
+{
+    int boxes;
+    SaunaModelParameters model;
+    SensorFaults faults;
+};
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-p programs] [-n runs] [-t minutes] [-b boxes] [-c colony] [-a ambient] [-P plates]\n", name);
+    fprintf(stderr, "          [-B bias] [-N noise] [-D dropout] [-x dead] [-s seed] [-j threads] [-w]\n");
+    fprintf(stderr, "  -p       the programs to check, e.g. 1,2 (default: all)\n");
+    fprintf(stderr, "  -n       number of runs per program (default: 100)\n");
+    fprintf(stderr, "  -t       simulated time per run (in min, default: until the program ends)\n");
+    fprintf(stderr, "  -b       range of brood boxes (default: 1:3)\n");
+    fprintf(stderr, "  -c       range of the colony's heat per box and plate (in W, default: 0.5:4)\n");
+    fprintf(stderr, "  -a       range of the ambient temperature (in deg C, default: 5:30)\n");
+    fprintf(stderr, "  -P       range of the number of plates (default: 2:6)\n");
+    fprintf(stderr, "  -B       standard deviation of the sensors' bias (in deg C, default: 0.3)\n");
+    fprintf(stderr, "  -N       standard deviation of the sensors' noise (in deg C, default: 0.1)\n");
+    fprintf(stderr, "  -D       fraction of failed sensor reads (default: 0.02)\n");
+    fprintf(stderr, "  -x       probability of a hive sensor to stop responding (default: 0.1)\n");
+    fprintf(stderr, "  -s       seed of the random variations (default: 1)\n");
+    fprintf(stderr, "  -j       number of threads (default: one per core)\n");
+    fprintf(stderr, "  -w       drive the heaters with PWM instead of on/off\n");
+}
+
+static bool parseRange(const char *text, Range *range)
+{
+    int count = sscanf(text, "%lf:%lf", &range->from, &range->to);
+    if (count == 1) {
+        range->to = range->from;
+    }
+    return count > 0 && range->from <= range->to;
+}
+
+static bool parseList(const char *text, std::vector<int> *values)
+{
+    char *end;
+    while (*text) {
+        values->push_back(strtol(text, &end, 10));
+        if (end == text || (*end != ',' && *end != 0)) {
+            return false;
+        }
+        text = (*end == ',' ? end + 1 : end);
+    }
+    return !values->empty();
+}
+
+/**
+ * Draw the hive and sensors of a run. Each run has its own generator, so the scenarios don't depend on the threads.
+ * The zones of the model share the boxes, more plates divide them into smaller zones.
+ */
+static Scenario drawScenario(const Variations &variations, uint32_t seed, uint32_t run, uint32_t duration)
+{
+    std::mt19937 random(seed * 1000003u + run);
+    Scenario scenario;
+    SaunaModelParameters &model = scenario.model;
+
+    scenario.boxes = variations.boxes.drawInteger(random);
+    model.numberOfPlates = constrain(variations.plates.drawInteger(random), 1, CFG_MAX_NUMBER_PLATES);
+    double share = (double) DEFAULT_NUMBER_OF_PLATES / model.numberOfPlates;
+    model.ambientTemperature = variations.ambient.draw(random);
+    model.zoneCapacity *= scenario.boxes * share;
+    model.zoneToAmbient *= (1 + 0.7 * (scenario.boxes - 1)) * share; // the cover stays, the walls grow
+    model.colonyHeat = variations.colony.draw(random) * scenario.boxes * share;
+    model.heaterPower *= variations.heater.draw(random);
+    model.plateToZoneFan *= variations.fan.draw(random);
+
+    scenario.faults.bias = variations.bias;
+    scenario.faults.noise = variations.noise;
+    scenario.faults.dropout = variations.dropout;
+    if (std::uniform_real_distribution<double>(0, 1)(random) < variations.dead) {
+        scenario.faults.deadSensor = std::uniform_int_distribution<int>(0, model.numberOfPlates - 1)(random);
+        scenario.faults.deadTime = std::uniform_int_distribution<uint32_t>(0, duration)(random);
+    }
+    scenario.faults.seed = random();
+    return scenario;
+}
+
+static std::string formatTime(uint32_t seconds)
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%u:%02u", seconds / 3600, (seconds / 60) % 60);
+    return text;
+}
+
+/**
+ * The nearest-rank percentile of sorted values.
+ */
+template<typename T> static T percentile(const std::vector<T> &sorted, double percent)
+{
+    size_t rank = ceil(percent / 100 * sorted.size());
+    return sorted[constrain(rank, 1, sorted.size()) - 1];
+}
+
+static std::string describe(const Scenario &scenario)
+{
+    char text[160];
+    int length = snprintf(text, sizeof(text), "%d box%s, %d plates, colony %.0fW, ambient %.1f C", scenario.boxes, (scenario.boxes == 1 ? "" : "es"),
+            scenario.model.numberOfPlates, scenario.model.colonyHeat * scenario.model.numberOfPlates, scenario.model.ambientTemperature);
+    if (scenario.faults.deadSensor >= 0) {
+        snprintf(text + length, sizeof(text) - length, ", hive sensor %d dead after %s", scenario.faults.deadSensor + 1,
+                formatTime(scenario.faults.deadTime).c_str());
+    }
+    return text;
+}
+
+/**
+ * Print the statistics of a program's runs, returns false if the program isn't safe.
+ */
+static bool report(const Program &program, const std::vector<Scenario> &scenarios, const std::vector<SimulationResult> &results,
+        int16_t hiveOverTemp)
+{
+    const uint32_t never = UINT32_MAX;
+    std::vector<uint32_t> timeToTarget;
+    std::vector<int16_t> maxHive;
+    size_t overtemp = 0, failed = 0, hottest = 0;
+
+    for (size_t run = 0; run < results.size(); run++) {
+        const SimulationResult &result = results[run];
+        if (!result.started) {
+            failed++;
+            continue;
+        }
+        overtemp += result.overtemp;
+        timeToTarget.push_back(result.preHeatTime ? result.preHeatTime : never);
+        maxHive.push_back(result.maxZoneTemperature);
+        if (result.maxZoneTemperature > results[hottest].maxZoneTemperature) {
+            hottest = run;
+        }
+    }
+
+    printf("%s: %zu runs, target %.1f C, over-temperature at %.1f C\n", program.name, results.size(), program.temperatureHive / 10.0,
+            hiveOverTemp / 10.0);
+    if (timeToTarget.empty()) {
+        printf("  no run started\n\n");
+        return false;
+    }
+    std::sort(timeToTarget.begin(), timeToTarget.end());
+    std::sort(maxHive.begin(), maxHive.end());
+
+    printf("                         p5        p50        p95        max\n");
+    printf("  time to target");
+    for (double percent : { 5.0, 50.0, 95.0, 100.0 }) {
+        uint32_t time = percentile(timeToTarget, percent);
+        printf(" %10s", (time == never ? "-" : formatTime(time).c_str()));
+    }
+    size_t notReached = std::count(timeToTarget.begin(), timeToTarget.end(), never);
+    printf("   (not reached: %.1f%%)\n", 100.0 * notReached / timeToTarget.size());
+    printf("  max hive temp ");
+    for (double percent : { 5.0, 50.0, 95.0, 100.0 }) {
+        printf(" %8.1f C", percentile(maxHive, percent) / 10.0);
+    }
+    printf("   (margin: %.1f C)\n", (hiveOverTemp - maxHive.back()) / 10.0);
+    printf("  over-temperature in %.1f%% of the runs, %.1f%% failed to start\n", 100.0 * overtemp / results.size(), 100.0 * failed / results.size());
+    printf("  hottest run #%zu: %s\n\n", hottest + 1, describe(scenarios[hottest]).c_str());
+
+    return overtemp == 0 && failed == 0 && maxHive.back() < hiveOverTemp;
+}
+
+int main(int argc, char **argv)
+{
+    int runs = 100, threads = 0, option;
+    uint32_t timeLimit = 0, seed = 1;
+    bool usePWM = false;
+    std::vector<int> programNumbers;
+    Variations variations = { { 1, 3 }, { 0.5, 4 }, { 5, 30 }, { 2, 6 }, { 0.9, 1.1 }, { 0.8, 1.2 }, 0.3, 0.1, 0.02, 0.1 };
+
+    while ((option = getopt(argc, argv, "p:n:t:b:c:a:P:B:N:D:x:s:j:w")) != -1) {
+        bool valid = true;
+        switch (option) {
+        case 'p':
+            valid = parseList(optarg, &programNumbers);
+            break;
+        case 'n':
+            runs = atoi(optarg);
+            valid = runs > 0;
+            break;
+        case 't':
+            timeLimit = atoi(optarg) * 60;
+            break;
+        case 'b':
+            valid = parseRange(optarg, &variations.boxes) && variations.boxes.from >= 1;
+            break;
+        case 'c':
+            valid = parseRange(optarg, &variations.colony);
+            break;
+        case 'a':
+            valid = parseRange(optarg, &variations.ambient);
+            break;
+        case 'P':
+            valid = parseRange(optarg, &variations.plates) && variations.plates.from >= 1;
+            break;
+        case 'B':
+            variations.bias = atof(optarg);
+            break;
+        case 'N':
+            variations.noise = atof(optarg);
+            break;
+        case 'D':
+            variations.dropout = atof(optarg);
+            break;
+        case 'x':
+            variations.dead = atof(optarg);
+            break;
+        case 's':
+            seed = strtoul(optarg, NULL, 10);
+            break;
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 'w':
+            usePWM = true;
+            break;
+        default:
+            valid = false;
+        }
+        if (!valid) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Configuration::getInstance()->reset();
+    int16_t hiveOverTemp = Configuration::getParams()->hiveOverTemp;
+    if (programNumbers.empty()) {
+        for (uint8_t number = ProgramStore::getInstance()->getNext(0); number > programNumbers.size();
+                number = ProgramStore::getInstance()->getNext(number)) {
+            programNumbers.push_back(number);
+        }
+    }
+
+    WorkStealingPool pool(threads);
+    bool safe = true;
+    for (int programNumber : programNumbers) {
+        Program program;
+        memset(&program, 0, sizeof(Program));
+        if (!ProgramStore::getInstance()->load(programNumber, &program)) {
+            fprintf(stderr, "program #%d not found\n", programNumber);
+            return 1;
+        }
+        uint32_t duration = (timeLimit ? timeLimit : (program.durationPreHeat + program.duration) * 60);
+
+        std::vector<Scenario> scenarios(runs);
+        std::vector<SimulationResult> results(runs);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        fprintf(stderr, "simulating %d variations of '%s' on %u threads\n", runs, program.name, pool.getNumberOfThreads());
+        for (int run = 0; run < runs; run++) {
+            scenarios[run] = drawScenario(variations, seed, run, duration);
+            pool.submit([&, run] {
+                Simulation simulation(program, scenarios[run].model);
+                simulation.setUsePWM(usePWM);
+                simulation.setSensorFaults(scenarios[run].faults);
+                if (timeLimit > 0) {
+                    simulation.setTimeLimit(timeLimit);
+                }
+                results[run] = simulation.run();
+            });
+        }
+        pool.wait();
+        fprintf(stderr, "done in %.1fs\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+        safe &= report(program, scenarios, results, hiveOverTemp);
+    }
+    return (safe ? 0 : 2);
+}
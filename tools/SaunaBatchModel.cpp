@@ -0,0 +1,223 @@
+/*
+ * SaunaBatchModel.cpp
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "SaunaBatchModel.h"
+
+#define SAUNA_MODEL_MAX_STEP 1.0 // longest time step of the integration (in s), the same as SaunaModel's
+
+/**
+ * Integrate one plate and its zone of all units, see PlateModel::step(). It's a separate function because
+ * the compiler only vectorises the loop if it knows that none of the rows overlap.
+ */
+static void integrateRow(size_t units, double seconds, double *__restrict temperature, double *__restrict zone,
+        const double *__restrict heater, const double *__restrict fan, const double *__restrict exchange,
+        const double *__restrict ambient, const double *__restrict heaterPower, const double *__restrict plateCapacity,
+        const double *__restrict plateToZone, const double *__restrict plateToZoneFan,
+        const double *__restrict plateToAmbient, const double *__restrict zoneCapacity,
+        const double *__restrict zoneToAmbient, const double *__restrict colonyHeat)
+{
+    for (size_t unit = 0; unit < units; unit++) {
+        double toZone = (plateToZone[unit] + plateToZoneFan[unit] * fan[unit]) * (temperature[unit] - zone[unit]);
+        double toAmbient = plateToAmbient[unit] * (temperature[unit] - ambient[unit]);
+        double zoneLoss = zoneToAmbient[unit] * (zone[unit] - ambient[unit]);
+
+        temperature[unit] += (heater[unit] * heaterPower[unit] - toZone - toAmbient) * seconds / plateCapacity[unit];
+        zone[unit] += (toZone + exchange[unit] + colonyHeat[unit] - zoneLoss) * seconds / zoneCapacity[unit];
+    }
+}
+
+/**
+ * Create the units at their ambient temperature, all of them must have the same number of plates.
+ */
+SaunaBatchModel::SaunaBatchModel(const std::vector<SaunaModelParameters> &parameters)
+{
+    units = parameters.size();
+    plates = (units > 0 ? parameters[0].numberOfPlates : 0);
+
+    for (const SaunaModelParameters &unit : parameters) {
+        ambientTemperature.push_back(unit.ambientTemperature);
+        heaterPower.push_back(unit.heaterPower);
+        plateCapacity.push_back(unit.plateCapacity);
+        plateToZone.push_back(unit.plateToZone);
+        plateToZoneFan.push_back(unit.plateToZoneFan);
+        plateToAmbient.push_back(unit.plateToAmbient);
+        zoneCapacity.push_back(unit.zoneCapacity);
+        zoneToZone.push_back(unit.zoneToZone);
+        zoneToAmbient.push_back(unit.zoneToAmbient);
+        colonyHeat.push_back(unit.colonyHeat);
+    }
+    for (uint8_t plate = 0; plate < plates; plate++) {
+        temperature.insert(temperature.end(), ambientTemperature.begin(), ambientTemperature.end());
+    }
+    zoneTemperature = temperature;
+    heater.assign(temperature.size(), 0);
+    fan.assign(temperature.size(), 0);
+    exchange.assign(temperature.size(), 0);
+    power.assign(units, 0);
+    energy.assign(units, 0);
+}
+
+/**
+ * Set the power of a heater (0-1 of the full power).
+ */
+void SaunaBatchModel::setHeater(size_t unit, uint8_t plate, double power)
+{
+    heater[plate * units + unit] = power;
+}
+
+/**
+ * Set the speed of a plate's fan (0-1 of the full speed).
+ */
+void SaunaBatchModel::setFan(size_t unit, uint8_t plate, double speed)
+{
+    fan[plate * units + unit] = speed;
+}
+
+/**
+ * Get the heater powers of a plate of all units, e.g. to set them by a vectorised controller.
+ */
+double *SaunaBatchModel::getHeaters(uint8_t plate)
+{
+    return heater.data() + plate * units;
+}
+
+/**
+ * Get the fan speeds of a plate of all units.
+ */
+double *SaunaBatchModel::getFans(uint8_t plate)
+{
+    return fan.data() + plate * units;
+}
+
+/**
+ * Advance all units by the given time, see SaunaModel::step().
+ */
+void SaunaBatchModel::step(double seconds)
+{
+    double *__restrict unitPower = power.data();
+    const double *__restrict unitHeaterPower = heaterPower.data();
+
+    for (size_t unit = 0; unit < units; unit++) {
+        unitPower[unit] = 0;
+    }
+    for (uint8_t plate = 0; plate < plates; plate++) {
+        const double *__restrict plateHeater = heater.data() + plate * units;
+        for (size_t unit = 0; unit < units; unit++) {
+            unitPower[unit] += plateHeater[unit] * unitHeaterPower[unit];
+        }
+    }
+    for (size_t unit = 0; unit < units; unit++) {
+        energy[unit] += unitPower[unit] * seconds;
+    }
+
+    while (seconds > 0) {
+        double step = (seconds > SAUNA_MODEL_MAX_STEP ? SAUNA_MODEL_MAX_STEP : seconds);
+        seconds -= step;
+        integrate(step);
+    }
+}
+
+/**
+ * One step of the explicit Euler integration. The operations are the ones of SaunaModel in the same order,
+ * but each one is applied to a whole row of units.
+ */
+void SaunaBatchModel::integrate(double seconds)
+{
+    const double *__restrict zone = zoneTemperature.data();
+    double *__restrict flow = exchange.data();
+    const double *__restrict unitZoneToZone = zoneToZone.data();
+
+    // the zones are arranged in a row, each one exchanges heat with its neighbours
+    for (uint8_t plate = 0; plate < plates; plate++) {
+        const double *__restrict current = zone + plate * units;
+        const double *__restrict previous = (plate > 0 ? current - units : NULL);
+        const double *__restrict next = (plate + 1 < plates ? current + units : NULL);
+        double *__restrict row = flow + plate * units;
+
+        for (size_t unit = 0; unit < units; unit++) {
+            double sum = 0;
+            if (previous != NULL) {
+                sum += previous[unit] - current[unit];
+            }
+            if (next != NULL) {
+                sum += next[unit] - current[unit];
+            }
+            row[unit] = sum * unitZoneToZone[unit];
+        }
+    }
+
+    for (uint8_t plate = 0; plate < plates; plate++) {
+        size_t offset = plate * units;
+        integrateRow(units, seconds, temperature.data() + offset, zoneTemperature.data() + offset, heater.data() + offset,
+                fan.data() + offset, exchange.data() + offset, ambientTemperature.data(), heaterPower.data(),
+                plateCapacity.data(), plateToZone.data(), plateToZoneFan.data(), plateToAmbient.data(),
+                zoneCapacity.data(), zoneToAmbient.data(), colonyHeat.data());
+    }
+}
+
+size_t SaunaBatchModel::getNumberOfUnits()
+{
+    return units;
+}
+
+uint8_t SaunaBatchModel::getNumberOfPlates()
+{
+    return plates;
+}
+
+double SaunaBatchModel::getPlateTemperature(size_t unit, uint8_t plate)
+{
+    return temperature[plate * units + unit];
+}
+
+double SaunaBatchModel::getZoneTemperature(size_t unit, uint8_t zone)
+{
+    return zoneTemperature[zone * units + unit];
+}
+
+/**
+ * Get the plate temperatures of a plate of all units.
+ */
+const double *SaunaBatchModel::getPlateTemperatures(uint8_t plate)
+{
+    return temperature.data() + plate * units;
+}
+
+/**
+ * Get the zone temperatures of a zone of all units.
+ */
+const double *SaunaBatchModel::getZoneTemperatures(uint8_t zone)
+{
+    return zoneTemperature.data() + zone * units;
+}
+
+/**
+ * Get the electrical energy used by the heaters of a unit (in Wh).
+ */
+double SaunaBatchModel::getEnergy(size_t unit)
+{
+    return energy[unit] / 3600;
+}
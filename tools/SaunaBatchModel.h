@@ -0,0 +1,76 @@
+/*
+ * SaunaBatchModel.h
+ *
+ * The thermal model of SaunaModel for a batch of simulated units (hives) with
+ * the same number of plates. The state is kept as a structure of arrays: one
+ * row per plate with the values of all units side by side, so every step of
+ * the integration is a loop over contiguous rows which the compiler turns into
+ * SIMD instructions (build with -O3, and -march=native for the widest vectors).
+ * The results are identical to the ones of SaunaModel with the same parameters.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SAUNABATCHMODEL_H_
+#define SAUNABATCHMODEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "SaunaModel.h"
+
+class SaunaBatchModel
+{
+public:
+    SaunaBatchModel(const std::vector<SaunaModelParameters> &units);
+    void setHeater(size_t unit, uint8_t plate, double power);
+    void setFan(size_t unit, uint8_t plate, double speed);
+    double *getHeaters(uint8_t plate);
+    double *getFans(uint8_t plate);
+    void step(double seconds);
+    size_t getNumberOfUnits();
+    uint8_t getNumberOfPlates();
+    double getPlateTemperature(size_t unit, uint8_t plate);
+    double getZoneTemperature(size_t unit, uint8_t zone);
+    const double *getPlateTemperatures(uint8_t plate);
+    const double *getZoneTemperatures(uint8_t zone);
+    double getEnergy(size_t unit);
+
+private:
+    void integrate(double seconds);
+
+    size_t units;
+    uint8_t plates;
+
+    // the parameters of each unit (see SaunaModelParameters)
+    std::vector<double> ambientTemperature, heaterPower, plateCapacity, plateToZone, plateToZoneFan, plateToAmbient, zoneCapacity, zoneToZone,
+            zoneToAmbient, colonyHeat;
+
+    // the state of each plate and unit, indexed by plate * units + unit
+    std::vector<double> temperature, zoneTemperature, heater, fan, exchange;
+
+    std::vector<double> power; // electrical power of each unit's heaters during a step (in W)
+    std::vector<double> energy; // electrical energy used by each unit's heaters (in J)
+};
+
+#endif /* SAUNABATCHMODEL_H_ */
@@ -0,0 +1,256 @@
+/*
+ * SaunaClient.cpp
+ *
+ * Host client for the batch requests of the serial console, see SaunaClient.h.
+ * It is compiled together with the firmware's Crc.cpp, e.g. for the command line tool:
+ *   g++ -O2 -Itools/host -I. tools/SaunaCtl.cpp tools/SaunaClient.cpp Crc.cpp tools/host/Arduino.cpp -o saunactl
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "SaunaClient.h"
+#include "Crc.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+
+SaunaClient::SaunaClient() :
+        fd(-1), sequence(0), outputHandler(NULL)
+{
+    sequence = (uint32_t) time(NULL) % 100000; // avoid matching stale replies of a previous session
+}
+
+SaunaClient::~SaunaClient()
+{
+    close();
+}
+
+/*
+ * Open a serial device (raw mode, 8N1). Note that opening the port resets most
+ * Arduino boards, the firmware needs a few seconds before it answers requests.
+ */
+bool SaunaClient::open(const char *device, uint32_t baud)
+{
+    close();
+    fd = ::open(device, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0) {
+        close();
+        return false;
+    }
+    cfmakeraw(&tty);
+    speed_t speed = (baud == 9600 ? B9600 : baud == 57600 ? B57600 : B115200);
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        close();
+        return false;
+    }
+    input.clear();
+    return true;
+}
+
+void SaunaClient::close()
+{
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+/*
+ * Set a function which receives all lines which are not a reply (e.g. log messages).
+ */
+void SaunaClient::setOutputHandler(void (*handler)(const std::string &line))
+{
+    outputHandler = handler;
+}
+
+/*
+ * Send the items (either "NAME=value" or "NAME") in one request and wait for the reply.
+ * Returns resultOk, a negative Result or the ConsoleError reported by the device.
+ */
+int SaunaClient::request(const std::vector<std::string> &items, Reply *reply, int timeout)
+{
+    if (fd < 0) {
+        return resultIoError;
+    }
+
+    std::string frame = encode(++sequence, items) + "\n";
+    if (frame.size() > CFG_SERIAL_BUFFER_SIZE + 1) {
+        return consoleErrorSize;
+    }
+    if (write(fd, frame.data(), frame.size()) != (ssize_t) frame.size()) {
+        return resultIoError;
+    }
+
+    std::string line;
+    while (readLine(&line, timeout)) {
+        if (decode(line, reply) && reply->sequence == sequence) {
+            return reply->error;
+        }
+        if (outputHandler) {
+            outputHandler(line);
+        }
+    }
+    return (fd < 0 ? resultIoError : resultTimeout);
+}
+
+/*
+ * Read a line from the device (without line ending).
+ */
+bool SaunaClient::readLine(std::string *line, int timeout)
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    char buffer[256];
+
+    while (true) {
+        size_t end = input.find_first_of("\r\n");
+        if (end != std::string::npos) {
+            *line = input.substr(0, end);
+            input.erase(0, end + 1);
+            if (line->empty()) {
+                continue;
+            }
+            return true;
+        }
+        if (poll(&pfd, 1, timeout) <= 0) {
+            return false;
+        }
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count <= 0) {
+            close();
+            return false;
+        }
+        input.append(buffer, count);
+    }
+}
+
+/*
+ * Create a request line (without line ending).
+ */
+std::string SaunaClient::encode(uint32_t sequence, const std::vector<std::string> &items)
+{
+    char buffer[16];
+    std::string frame;
+
+    snprintf(buffer, sizeof(buffer), "%u", sequence);
+    frame = buffer;
+    for (size_t i = 0; i < items.size(); i++) {
+        frame += CONSOLE_BATCH_SEPARATOR + items[i];
+    }
+    snprintf(buffer, sizeof(buffer), "%c%08x", CONSOLE_BATCH_CHECKSUM, Crc::calculate((uint8_t *) frame.data(), frame.size()));
+    return CONSOLE_BATCH_START + frame + buffer;
+}
+
+/*
+ * Parse a reply line. Returns false if the line is no (valid) reply.
+ */
+bool SaunaClient::decode(const std::string &line, Reply *reply)
+{
+    size_t start = line.find(CONSOLE_BATCH_START);
+    size_t checksum = line.rfind(CONSOLE_BATCH_CHECKSUM);
+    if (start == std::string::npos || checksum == std::string::npos || checksum < start || line.size() < checksum + 9) {
+        return false;
+    }
+    std::string body = line.substr(start + 1, checksum - start - 1);
+    if (strtoul(line.substr(checksum + 1, 8).c_str(), NULL, 16) != Crc::calculate((uint8_t *) body.data(), body.size())) {
+        return false;
+    }
+
+    std::vector<std::string> fields;
+    size_t position = 0, next;
+    while ((next = body.find(CONSOLE_BATCH_SEPARATOR, position)) != std::string::npos) {
+        fields.push_back(body.substr(position, next - position));
+        position = next + 1;
+    }
+    fields.push_back(body.substr(position));
+    if (fields.size() < 2) {
+        return false;
+    }
+
+    reply->sequence = strtoul(fields[0].c_str(), NULL, 10);
+    reply->error = consoleOk;
+    reply->item = 0;
+    reply->values.clear();
+    if (fields[1].compare(0, 4, "ERR=") == 0) {
+        reply->error = atoi(fields[1].c_str() + 4);
+        reply->item = (fields.size() > 2 ? atoi(fields[2].c_str()) : 0);
+        return true;
+    }
+    if (fields[1] != "OK") {
+        return false;
+    }
+    for (size_t i = 2; i < fields.size(); i++) {
+        size_t equals = fields[i].find('=');
+        if (equals == std::string::npos) {
+            return false;
+        }
+        reply->values.push_back(std::make_pair(fields[i].substr(0, equals), fields[i].substr(equals + 1)));
+    }
+    return true;
+}
+
+const char *SaunaClient::errorToStr(int error)
+{
+    switch (error) {
+    case resultOk:
+        return "ok";
+    case resultIoError:
+        return "i/o error";
+    case resultTimeout:
+        return "timeout";
+    case consoleErrorFrame:
+        return "malformed request";
+    case consoleErrorUnknown:
+        return "unknown command";
+    case consoleErrorIndex:
+        return "invalid index";
+    case consoleErrorNoProgram:
+        return "no program running";
+    case consoleErrorValue:
+        return "invalid value";
+    case consoleErrorSize:
+        return "request too large";
+    case consoleErrorState:
+        return "not possible in the current state";
+    case consoleErrorBusy:
+        return "busy, try again";
+    case consoleErrorAction:
+        return "action failed, the preceding items were applied";
+    }
+    return "unknown error";
+}
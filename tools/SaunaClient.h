@@ -0,0 +1,82 @@
+/*
+ * SaunaClient.h
+ *
+ * Host client for the batch requests of the serial console (see ConsoleProtocol.h).
+ * It sends a set of reads and writes in one request and waits for the matching
+ * reply, all other output of the firmware is passed to an optional handler.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SAUNACLIENT_H_
+#define SAUNACLIENT_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include "ConsoleProtocol.h"
+
+class SaunaClient
+{
+public:
+    enum Result
+    {
+        resultOk = 0, // positive values are a ConsoleError returned by the device
+        resultIoError = -1,
+        resultTimeout = -2
+    };
+
+    /*
+     * The reply to a request. On error, item is the position of the offending item
+     * (1-based, 0 = the whole request).
+     */
+    struct Reply
+    {
+        uint32_t sequence;
+        int error;
+        int item;
+        std::vector<std::pair<std::string, std::string> > values; // name and value of each read item
+    };
+
+    SaunaClient();
+    ~SaunaClient();
+    bool open(const char *device, uint32_t baud = 115200);
+    void close();
+    int request(const std::vector<std::string> &items, Reply *reply, int timeout = 2000);
+    void setOutputHandler(void (*handler)(const std::string &line));
+
+    static std::string encode(uint32_t sequence, const std::vector<std::string> &items);
+    static bool decode(const std::string &line, Reply *reply);
+    static const char *errorToStr(int error);
+
+private:
+    bool readLine(std::string *line, int timeout);
+
+    int fd;
+    uint32_t sequence;
+    std::string input;
+    void (*outputHandler)(const std::string &line);
+};
+
+#endif /* SAUNACLIENT_H_ */
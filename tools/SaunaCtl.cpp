@@ -0,0 +1,78 @@
+/*
+ * SaunaCtl.cpp
+ *
+ * Command line front end of SaunaClient. All items are sent in one batch request,
+ * either all writes are applied or none. The values of read items are printed
+ * as "NAME=value", one per line.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -Itools/host -I. tools/SaunaCtl.cpp tools/SaunaClient.cpp Crc.cpp tools/host/Arduino.cpp -o saunactl
+ *   ./saunactl /dev/ttyACM0 TEMP=400 FANSPEED=120 HIVE-KP TEMP
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include "SaunaClient.h"
+
+static void printOutput(const std::string &line)
+{
+    fprintf(stderr, "%s\n", line.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <device> <NAME[=value]>...\n", argv[0]);
+        return 1;
+    }
+
+    SaunaClient client;
+    if (!client.open(argv[1])) {
+        perror(argv[1]);
+        return 1;
+    }
+    client.setOutputHandler(printOutput);
+
+    std::vector<std::string> items(argv + 2, argv + argc);
+    SaunaClient::Reply reply;
+    int result = client.request(items, &reply);
+    if (result == SaunaClient::resultTimeout) {
+        sleep(3); // the board might have been reset by opening the port
+        result = client.request(items, &reply);
+    }
+
+    if (result != SaunaClient::resultOk) {
+        if (result > 0 && reply.item > 0) {
+            fprintf(stderr, "%s: %s\n", items[reply.item - 1].c_str(), SaunaClient::errorToStr(result));
+        } else {
+            fprintf(stderr, "%s\n", SaunaClient::errorToStr(result));
+        }
+        return 2;
+    }
+    for (size_t i = 0; i < reply.values.size(); i++) {
+        printf("%s=%s\n", reply.values[i].first.c_str(), reply.values[i].second.c_str());
+    }
+    return 0;
+}
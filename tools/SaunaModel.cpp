@@ -0,0 +1,157 @@
+/*
+ * SaunaModel.cpp
+ *
+ *
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "SaunaModel.h"
+#include "config.h"
+
+#define SAUNA_MODEL_MAX_STEP 1.0 // longest time step of the integration (in s), well below the time constant of a plate
+
+/**
+ * The default parameters: a hive of two brood boxes on four plates in a 20 deg C room.
+ * With the default configuration (two heaters at a time) the hive needs a bit over an hour to reach 40 deg C.
+ */
+SaunaModelParameters::SaunaModelParameters()
+{
+    numberOfPlates = 4;
+    ambientTemperature = 20;
+    heaterPower = CFG_HEATER_POWER_WATTS;
+    plateCapacity = 600;
+    plateToZone = 0.8;
+    plateToZoneFan = 5;
+    plateToAmbient = 0.3;
+    zoneCapacity = 8000;
+    zoneToZone = 3;
+    zoneToAmbient = 1.2;
+    colonyHeat = 2;
+}
+
+PlateModel::PlateModel(double temperature)
+{
+    this->temperature = temperature;
+    zoneTemperature = temperature;
+    heater = 0;
+    fan = 0;
+    exchange = 0;
+}
+
+/**
+ * Advance the plate and its zone by a time step (explicit Euler).
+ */
+void PlateModel::step(double seconds, const SaunaModelParameters &parameters)
+{
+    double toZone = (parameters.plateToZone + parameters.plateToZoneFan * fan) * (temperature - zoneTemperature);
+    double toAmbient = parameters.plateToAmbient * (temperature - parameters.ambientTemperature);
+    double zoneLoss = parameters.zoneToAmbient * (zoneTemperature - parameters.ambientTemperature);
+
+    temperature += (heater * parameters.heaterPower - toZone - toAmbient) * seconds / parameters.plateCapacity;
+    zoneTemperature += (toZone + exchange + parameters.colonyHeat - zoneLoss) * seconds / parameters.zoneCapacity;
+}
+
+SaunaModel::SaunaModel(const SaunaModelParameters &parameters) :
+        parameters(parameters), plates(parameters.numberOfPlates, PlateModel(parameters.ambientTemperature))
+{
+    energy = 0;
+}
+
+/**
+ * Set the power of a heater (0-1 of the full power).
+ */
+void SaunaModel::setHeater(uint8_t plate, double power)
+{
+    plates[plate].heater = power;
+}
+
+/**
+ * Set the speed of a plate's fan (0-1 of the full speed).
+ */
+void SaunaModel::setFan(uint8_t plate, double speed)
+{
+    plates[plate].fan = speed;
+}
+
+/**
+ * Advance the model by the given time. The zones are arranged in a row, each one exchanges heat with its neighbours.
+ */
+void SaunaModel::step(double seconds)
+{
+    energy += getHeaterPower() * seconds;
+
+    while (seconds > 0) {
+        double step = (seconds > SAUNA_MODEL_MAX_STEP ? SAUNA_MODEL_MAX_STEP : seconds);
+        seconds -= step;
+
+        for (size_t i = 0; i < plates.size(); i++) {
+            double exchange = 0;
+            if (i > 0) {
+                exchange += plates[i - 1].zoneTemperature - plates[i].zoneTemperature;
+            }
+            if (i + 1 < plates.size()) {
+                exchange += plates[i + 1].zoneTemperature - plates[i].zoneTemperature;
+            }
+            plates[i].exchange = exchange * parameters.zoneToZone;
+        }
+        for (size_t i = 0; i < plates.size(); i++) {
+            plates[i].step(step, parameters);
+        }
+    }
+}
+
+uint8_t SaunaModel::getNumberOfPlates()
+{
+    return plates.size();
+}
+
+double SaunaModel::getPlateTemperature(uint8_t plate)
+{
+    return plates[plate].temperature;
+}
+
+double SaunaModel::getZoneTemperature(uint8_t zone)
+{
+    return plates[zone].zoneTemperature;
+}
+
+/**
+ * Get the electrical power of all heaters (in W).
+ */
+double SaunaModel::getHeaterPower()
+{
+    double power = 0;
+    for (size_t i = 0; i < plates.size(); i++) {
+        power += plates[i].heater * parameters.heaterPower;
+    }
+    return power;
+}
+
+/**
+ * Get the electrical energy used by the heaters (in Wh).
+ */
+double SaunaModel::getEnergy()
+{
+    return energy / 3600;
+}
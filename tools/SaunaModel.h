@@ -0,0 +1,94 @@
+/*
+ * SaunaModel.h
+ *
+ * Thermal model of a bee sauna for host simulations. Every heater plate warms
+ * the zone of the hive above it, the fan of the plate increases the exchange
+ * between plate and zone. Neighbouring zones exchange heat with each other and
+ * all parts lose heat to the ambient air.
+ *
+ * Temperatures are in deg C, powers in W, heat capacities in J/K and
+ * conductances in W/K.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SAUNAMODEL_H_
+#define SAUNAMODEL_H_
+
+#include <stdint.h>
+#include <vector>
+
+class SaunaModelParameters
+{
+public:
+    SaunaModelParameters();
+
+    uint8_t numberOfPlates;
+    double ambientTemperature; // temperature around the hive and at start
+    double heaterPower; // electrical power of a heater at full power
+    double plateCapacity; // heat capacity of a plate with its heater
+    double plateToZone; // conductance between a plate and its zone with the fan stopped
+    double plateToZoneFan; // additional conductance between a plate and its zone at full fan speed
+    double plateToAmbient; // conductance of a plate to the outside (through the bottom)
+    double zoneCapacity; // heat capacity of a zone (wood, combs, honey and bees)
+    double zoneToZone; // conductance between neighbouring zones
+    double zoneToAmbient; // conductance of a zone to the outside (walls and cover)
+    double colonyHeat; // heat produced by the bees in a zone
+};
+
+/*
+ * A heater plate and the zone of the hive above it.
+ */
+class PlateModel
+{
+public:
+    PlateModel(double temperature);
+    void step(double seconds, const SaunaModelParameters &parameters);
+
+    double temperature; // of the plate
+    double zoneTemperature; // of the hive zone above the plate
+    double heater; // power of the heater (0-1)
+    double fan; // speed of the fan (0-1)
+    double exchange; // heat flowing into the zone from the neighbouring zones
+};
+
+class SaunaModel
+{
+public:
+    SaunaModel(const SaunaModelParameters &parameters);
+    void setHeater(uint8_t plate, double power);
+    void setFan(uint8_t plate, double speed);
+    void step(double seconds);
+    uint8_t getNumberOfPlates();
+    double getPlateTemperature(uint8_t plate);
+    double getZoneTemperature(uint8_t zone);
+    double getHeaterPower();
+    double getEnergy();
+
+private:
+    SaunaModelParameters parameters;
+    std::vector<PlateModel> plates;
+    double energy; // electrical energy used by the heaters (in J)
+};
+
+#endif /* SAUNAMODEL_H_ */
@@ -0,0 +1,190 @@
+/*
+ * SensorTraceReader.cpp
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "SensorTraceReader.h"
+#include "TelemetryFormat.h"
+#include "Crc.h"
+
+SensorTraceReader::SensorTraceReader()
+{
+    started = false;
+    expectedSequence = 0;
+    time = 0;
+    bytes = 0;
+    invalidFrames = 0;
+    lostFrames = 0;
+    restarts = 0;
+}
+
+/**
+ * Read a capture of the serial output. If it contains several recordings (the board was reset),
+ * only the last one is kept. Returns false if no start of a recording was found.
+ */
+bool SensorTraceReader::read(FILE *input)
+{
+    std::vector<uint8_t> block;
+    int c;
+
+    // frames are delimited by 0x00 on both sides, everything else is text output of the firmware
+    while ((c = fgetc(input)) != EOF) {
+        if (c != 0) {
+            block.push_back(c);
+            continue;
+        }
+        if (!block.empty()) {
+            processFrame(block);
+        }
+        block.clear();
+    }
+    return started;
+}
+
+const std::vector<SensorTraceEntry> &SensorTraceReader::getRecords() const
+{
+    return records;
+}
+
+/**
+ * Return the outputs at the end of each cycle (see SensorTraceOutput).
+ */
+std::vector<std::vector<uint8_t> > SensorTraceReader::getOutputs() const
+{
+    std::vector<std::vector<uint8_t> > outputs;
+    std::vector<uint8_t> current;
+    bool inCycle = false;
+
+    for (const SensorTraceEntry &record : records) {
+        if (record.type == traceCycle) {
+            if (inCycle) {
+                outputs.push_back(current);
+            }
+            inCycle = true;
+        } else if (record.type == traceOutputs) {
+            uint8_t count = record.payload[0];
+            const uint8_t *value = record.payload.data() + 1 + (count + 7) / 8;
+            current.resize(count, 0);
+            for (uint8_t i = 0; i < count; i++) {
+                if (record.payload[1 + i / 8] & (1 << (i % 8))) {
+                    current[i] = *value++;
+                }
+            }
+        }
+    }
+    if (inCycle) {
+        outputs.push_back(current);
+    }
+    return outputs;
+}
+
+uint32_t SensorTraceReader::getCycles() const
+{
+    uint32_t cycles = 0;
+    for (const SensorTraceEntry &record : records) {
+        cycles += (record.type == traceCycle);
+    }
+    return cycles;
+}
+
+uint32_t SensorTraceReader::getBytes() const
+{
+    return bytes;
+}
+
+uint32_t SensorTraceReader::getInvalidFrames() const
+{
+    return invalidFrames;
+}
+
+uint32_t SensorTraceReader::getLostFrames() const
+{
+    return lostFrames;
+}
+
+uint32_t SensorTraceReader::getRestarts() const
+{
+    return restarts;
+}
+
+/**
+ * Decode the bytes between two delimiters. Returns false if the block is no trace frame.
+ */
+bool SensorTraceReader::processFrame(const std::vector<uint8_t> &block)
+{
+    std::vector<uint8_t> frame(block.size());
+    int32_t length = telemetryCobsDecode(block.data(), block.size(), frame.data());
+
+    if (length <= SENSOR_TRACE_HEADER_SIZE + SENSOR_TRACE_CRC_SIZE || frame[0] != SENSOR_TRACE_MAGIC) {
+        return false;
+    }
+    length -= SENSOR_TRACE_CRC_SIZE;
+    uint32_t crc = 0;
+    for (uint8_t i = 0; i < SENSOR_TRACE_CRC_SIZE; i++) {
+        crc |= (uint32_t) frame[length + i] << (8 * i);
+    }
+    if (crc != Crc::calculate(frame.data(), length) || frame[1] != SENSOR_TRACE_VERSION) {
+        invalidFrames++;
+        return true;
+    }
+
+    bool restart = (frame[SENSOR_TRACE_HEADER_SIZE] == traceStart);
+    if (restart) {
+        restarts += started;
+        started = true;
+        records.clear();
+        time = 0;
+        bytes = 0;
+        lostFrames = 0;
+    } else if (started && frame[2] != expectedSequence) {
+        lostFrames += (uint8_t) (frame[2] - expectedSequence);
+    }
+    expectedSequence = frame[2] + 1;
+    if (!started) {
+        return true;
+    }
+    bytes += block.size() + 1;
+
+    int32_t position = SENSOR_TRACE_HEADER_SIZE;
+    while (position < length) {
+        uint8_t type = frame[position++];
+        uint32_t delta;
+        uint8_t size = sensorTraceGetVarint(frame.data() + position, length - position, &delta);
+        int16_t payloadSize = (size == 0 ? -1 : sensorTracePayloadSize(type, frame.data() + position + size, length - position - size));
+        if (payloadSize < 0) {
+            invalidFrames++;
+            return true;
+        }
+        position += size;
+        time += delta;
+
+        SensorTraceEntry record;
+        record.type = type;
+        record.time = time;
+        record.payload.assign(frame.begin() + position, frame.begin() + position + payloadSize);
+        records.push_back(record);
+        position += payloadSize;
+    }
+    return true;
+}
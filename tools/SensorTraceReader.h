@@ -0,0 +1,73 @@
+/*
+ * SensorTraceReader.h
+ *
+ * Host reader of recorded sensor traces (see SensorTraceFormat.h). It extracts
+ * the trace frames from a capture of the serial output, skips the text and the
+ * telemetry frames between them and decodes the records with absolute times.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SENSORTRACEREADER_H_
+#define SENSORTRACEREADER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "SensorTraceFormat.h"
+
+class SensorTraceEntry
+{
+public:
+    uint8_t type; // SensorTraceRecord
+    uint32_t time; // time since power-up of the recording board (in ms)
+    std::vector<uint8_t> payload;
+};
+
+class SensorTraceReader
+{
+public:
+    SensorTraceReader();
+    bool read(FILE *input);
+    const std::vector<SensorTraceEntry> &getRecords() const;
+    std::vector<std::vector<uint8_t> > getOutputs() const;
+    uint32_t getCycles() const;
+    uint32_t getBytes() const;
+    uint32_t getInvalidFrames() const;
+    uint32_t getLostFrames() const;
+    uint32_t getRestarts() const;
+
+private:
+    bool processFrame(const std::vector<uint8_t> &block);
+
+    std::vector<SensorTraceEntry> records;
+    bool started; // a traceStart record was read
+    uint8_t expectedSequence;
+    uint32_t time; // of the previous record (in ms)
+    uint32_t bytes; // size of the trace frames in the capture
+    uint32_t invalidFrames; // frames with a wrong CRC or invalid records
+    uint32_t lostFrames; // gaps in the sequence of the frames
+    uint32_t restarts; // recordings which were discarded because the board restarted
+};
+
+#endif /* SENSORTRACEREADER_H_ */
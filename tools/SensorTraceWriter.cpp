@@ -0,0 +1,113 @@
+/*
+ * SensorTraceWriter.cpp
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "SensorTraceWriter.h"
+#include "TelemetryFormat.h"
+#include "Crc.h"
+
+SensorTraceWriter::SensorTraceWriter(FILE *output) :
+        output(output)
+{
+    length = SENSOR_TRACE_HEADER_SIZE;
+    sequence = 0;
+    lastTime = 0;
+    bytes = 0;
+}
+
+/**
+ * Add a record to the trace, the time is absolute (in ms) and must not decrease. A trace
+ * starts with a traceStart record.
+ */
+void SensorTraceWriter::write(uint8_t type, uint32_t time, const uint8_t *payload, uint8_t payloadLength)
+{
+    if (length + 6 + payloadLength + SENSOR_TRACE_CRC_SIZE > CFG_SENSOR_TRACE_FRAME_SIZE || type == traceStart) {
+        flush();
+    }
+    frame[length++] = type;
+    length += sensorTracePutVarint(frame + length, time - lastTime);
+    lastTime = time;
+    if (payloadLength > 0) {
+        memcpy(frame + length, payload, payloadLength);
+        length += payloadLength;
+    }
+}
+
+/**
+ * Add a record with the outputs which changed since the last call (see SensorTraceOutput),
+ * nothing is written if none changed.
+ */
+void SensorTraceWriter::writeOutputs(uint32_t time, const uint8_t *values, uint8_t count)
+{
+    uint8_t record[1 + (traceFixedOutputs + 2 * CFG_MAX_NUMBER_PLATES + 7) / 8 + traceFixedOutputs + 2 * CFG_MAX_NUMBER_PLATES];
+    uint8_t size = 1 + (count + 7) / 8;
+    bool anyChanged = false;
+
+    memset(record, 0, size);
+    record[0] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        if (count != outputs.size() || values[i] != outputs[i]) {
+            record[1 + i / 8] |= 1 << (i % 8);
+            record[size++] = values[i];
+            anyChanged = true;
+        }
+    }
+    if (anyChanged) {
+        write(traceOutputs, time, record, size);
+        outputs.assign(values, values + count);
+    }
+}
+
+/**
+ * Complete the frame with the header and CRC and write it COBS encoded and delimited by 0x00.
+ */
+void SensorTraceWriter::flush()
+{
+    if (length <= SENSOR_TRACE_HEADER_SIZE) {
+        return;
+    }
+    frame[0] = SENSOR_TRACE_MAGIC;
+    frame[1] = SENSOR_TRACE_VERSION;
+    frame[2] = sequence++;
+    uint32_t crc = Crc::calculate(frame, length);
+    for (uint8_t i = 0; i < SENSOR_TRACE_CRC_SIZE; i++) {
+        frame[length++] = crc >> (8 * i);
+    }
+
+    uint8_t encoded[CFG_SENSOR_TRACE_FRAME_SIZE + CFG_SENSOR_TRACE_FRAME_SIZE / 254 + 3];
+    encoded[0] = 0;
+    uint16_t encodedLength = telemetryCobsEncode(frame, length, encoded + 1) + 1;
+    encoded[encodedLength++] = 0;
+    bytes += fwrite(encoded, 1, encodedLength, output);
+    length = SENSOR_TRACE_HEADER_SIZE;
+}
+
+/**
+ * Return the number of bytes written so far.
+ */
+uint32_t SensorTraceWriter::getBytes() const
+{
+    return bytes;
+}
@@ -0,0 +1,59 @@
+/*
+ * SensorTraceWriter.h
+ *
+ * Host writer of sensor traces (see SensorTraceFormat.h), e.g. to create traces
+ * from other sources than a recording board. The frames are identical to the ones
+ * of the firmware's recorder (SensorTrace).
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SENSORTRACEWRITER_H_
+#define SENSORTRACEWRITER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "SensorTraceFormat.h"
+#include "config.h"
+
+class SensorTraceWriter
+{
+public:
+    SensorTraceWriter(FILE *output);
+    void write(uint8_t type, uint32_t time, const uint8_t *payload = NULL, uint8_t length = 0);
+    void writeOutputs(uint32_t time, const uint8_t *values, uint8_t count);
+    void flush();
+    uint32_t getBytes() const;
+
+private:
+    FILE *output;
+    uint8_t frame[CFG_SENSOR_TRACE_FRAME_SIZE]; // the raw frame which is being filled
+    uint8_t length; // bytes used in the frame
+    uint8_t sequence;
+    uint32_t lastTime; // of the previous record (in ms)
+    uint32_t bytes; // written to the output
+    std::vector<uint8_t> outputs; // the last outputs written
+};
+
+#endif /* SENSORTRACEWRITER_H_ */
@@ -0,0 +1,112 @@
+/*
+ * SeriesFormat.h
+ *
+ * Definition of the column-oriented files with the time series of simulated
+ * runs (see SeriesWriter and SeriesReader). A file holds any number of runs,
+ * each value of a run is stored as a contiguous column, so an aggregate over
+ * a column only touches the pages of that column when the file is mapped.
+ *
+ * File layout (native byte order and alignment of the host):
+ *   SeriesFileHeader,
+ *   runs, each one aligned to SERIES_ALIGNMENT.
+ *
+ * Run layout (all offsets are from the start of the run):
+ *   SeriesRunHeader,
+ *   SeriesColumn for each column,
+ *   the samples of each column (int16 or uint8, aligned to SERIES_ALIGNMENT),
+ *   SeriesStateRun for each change of the system state.
+ *
+ * Temperatures are stored in 0.1 deg C, heater powers and fan speeds as the
+ * values of their pins (0-255).
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SERIESFORMAT_H_
+#define SERIESFORMAT_H_
+
+#include <stdint.h>
+
+#define SERIES_MAGIC        0x53535041 // "APSS"
+#define SERIES_RUN_MAGIC    0x4e555253 // "SRUN"
+#define SERIES_VERSION      1
+#define SERIES_ALIGNMENT    8
+#define SERIES_LABEL_SIZE   64
+
+enum SeriesColumnType
+{
+    seriesInt16 = 1,
+    seriesUint8 = 2
+};
+
+enum SeriesColumnId
+{
+    seriesHive = 1, // temperature of the hive as seen by the controller (int16)
+    seriesTarget = 2, // target temperature of the hive, 0 if no program is active (int16)
+    seriesZone = 3, // actual temperature of a zone of the model (int16, per plate)
+    seriesPlate = 4, // actual temperature of a plate of the model (int16, per plate)
+    seriesPower = 5, // heater power, 0 while the main relay is off (uint8, per plate)
+    seriesFan = 6 // fan speed (uint8, per plate)
+};
+
+struct SeriesFileHeader
+{
+    uint32_t magic; // SERIES_MAGIC
+    uint16_t version; // SERIES_VERSION
+    uint16_t size; // of the header
+};
+
+struct SeriesRunHeader
+{
+    uint32_t magic; // SERIES_RUN_MAGIC
+    uint32_t size; // of the run including the header, a multiple of SERIES_ALIGNMENT
+    uint32_t run; // number of the run, e.g. of the parameter set
+    uint32_t interval; // between two samples (in ms)
+    uint32_t samples; // in each column
+    uint16_t columns;
+    uint16_t reserved;
+    uint32_t stateOffset; // of the state runs
+    uint32_t stateRuns;
+    char label[SERIES_LABEL_SIZE]; // describes the run, null terminated
+};
+
+struct SeriesColumn
+{
+    uint8_t id; // SeriesColumnId
+    uint8_t type; // SeriesColumnType
+    uint8_t index; // of the plate (or zone)
+    uint8_t reserved;
+    uint32_t offset; // of the samples
+};
+
+/*
+ * The system state from a sample on until the start of the next state run.
+ */
+struct SeriesStateRun
+{
+    uint32_t start; // first sample
+    uint8_t state; // Status::SystemState
+    uint8_t reserved[3];
+};
+
+#endif /* SERIESFORMAT_H_ */
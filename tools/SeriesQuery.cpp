@@ -0,0 +1,291 @@
+/*
+ * SeriesQuery.cpp
+ *
+ * Evaluates aggregates over the time series of simulated runs (see SeriesFormat.h,
+ * written by tools/ParameterSweep.cpp with -o). The file is memory-mapped and each
+ * aggregate streams over one column of a run, so only the queried columns are read
+ * and no run is loaded as a whole.
+ *
+ * A query is aggregate:column[:threshold] or time:state, e.g.
+ *   max:plate1       highest temperature of plate 1 (in deg C)
+ *   above:hive:40.5  time the hive was above 40.5 deg C (in s)
+ *   integral:power2  heater power of plate 2 integrated over time (in pin value * s)
+ *   time:running     time in the running state (in s)
+ * The aggregates are max, min, mean, integral and above, the columns hive, target,
+ * zone<n>, plate<n>, power<n> and fan<n>.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -Itools/host -I. tools/SeriesQuery.cpp tools/SeriesReader.cpp -o seriesQuery
+ *   ./seriesQuery sweep.series max:hive above:hive:40.5 integral:power1 time:running
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SeriesReader.h"
+
+enum Aggregate
+{
+    aggregateMax,
+    aggregateMin,
+    aggregateMean,
+    aggregateIntegral,
+    aggregateAbove,
+    aggregateTime
+};
+
+struct Query
+{
+    const char *text;
+    Aggregate aggregate;
+    uint8_t column; // SeriesColumnId
+    uint8_t index; // of the plate
+    double threshold; // of aggregateAbove
+    uint8_t state; // of aggregateTime
+};
+
+static const struct
+{
+    const char *name;
+    Aggregate aggregate;
+} aggregates[] = { { "max", aggregateMax }, { "min", aggregateMin }, { "mean", aggregateMean }, { "integral", aggregateIntegral },
+        { "above", aggregateAbove }, { "time", aggregateTime } };
+
+static const struct
+{
+    const char *name;
+    SeriesColumnId id;
+    bool perPlate;
+} columns[] = { { "hive", seriesHive, false }, { "target", seriesTarget, false }, { "zone", seriesZone, true }, { "plate", seriesPlate, true },
+        { "power", seriesPower, true }, { "fan", seriesFan, true } };
+
+// the names of Status::systemStateToStr()
+static const struct
+{
+    const char *name;
+    uint8_t state;
+} states[] = { { "initializing", 1 }, { "ready", 2 }, { "pre-heating", 3 }, { "running", 4 }, { "over-temperature", 5 }, { "shut-down", 9 },
+        { "error", 99 } };
+
+static bool parseColumn(const char *name, Query *query)
+{
+    for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++) {
+        size_t length = strlen(columns[i].name);
+        if (strncmp(name, columns[i].name, length) != 0) {
+            continue;
+        }
+        char *end;
+        long plate = (columns[i].perPlate ? strtol(name + length, &end, 10) : 1);
+        if ((columns[i].perPlate && (end == name + length || *end != 0 || plate < 1 || plate > 255)) || (!columns[i].perPlate && name[length] != 0)) {
+            return false;
+        }
+        query->column = columns[i].id;
+        query->index = plate - 1;
+        return true;
+    }
+    return false;
+}
+
+static bool parseQuery(const char *text, Query *query)
+{
+    std::string aggregate(text, strcspn(text, ":"));
+    const char *argument = text + aggregate.size();
+    if (*argument++ != ':') {
+        return false;
+    }
+
+    query->text = text;
+    size_t i = 0;
+    while (i < sizeof(aggregates) / sizeof(aggregates[0]) && aggregate != aggregates[i].name) {
+        i++;
+    }
+    if (i == sizeof(aggregates) / sizeof(aggregates[0])) {
+        return false;
+    }
+    query->aggregate = aggregates[i].aggregate;
+
+    if (query->aggregate == aggregateTime) {
+        for (size_t j = 0; j < sizeof(states) / sizeof(states[0]); j++) {
+            if (strcmp(argument, states[j].name) == 0) {
+                query->state = states[j].state;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string column(argument, strcspn(argument, ":"));
+    const char *threshold = argument + column.size();
+    if (query->aggregate == aggregateAbove) {
+        char *end;
+        if (*threshold++ != ':') {
+            return false;
+        }
+        query->threshold = strtod(threshold, &end);
+        if (end == threshold || *end != 0) {
+            return false;
+        }
+    } else if (*threshold != 0) {
+        return false;
+    }
+    return parseColumn(column.c_str(), query);
+}
+
+/**
+ * Stream over the samples of a column, the temperatures are scaled to deg C.
+ */
+template<typename T> static double aggregate(const T *samples, uint32_t count, const Query &query, double scale, uint32_t interval)
+{
+    double result = 0;
+    int64_t sum = 0;
+    uint32_t above = 0;
+    T extreme = (count > 0 ? samples[0] : 0);
+
+    switch (query.aggregate) {
+    case aggregateMax:
+        for (uint32_t i = 0; i < count; i++) {
+            extreme = (samples[i] > extreme ? samples[i] : extreme);
+        }
+        result = extreme * scale;
+        break;
+    case aggregateMin:
+        for (uint32_t i = 0; i < count; i++) {
+            extreme = (samples[i] < extreme ? samples[i] : extreme);
+        }
+        result = extreme * scale;
+        break;
+    case aggregateMean:
+    case aggregateIntegral:
+        for (uint32_t i = 0; i < count; i++) {
+            sum += samples[i];
+        }
+        result = (query.aggregate == aggregateMean ? (count > 0 ? sum * scale / count : 0) : sum * scale * interval / 1000);
+        break;
+    case aggregateAbove:
+        for (uint32_t i = 0; i < count; i++) {
+            above += (samples[i] * scale > query.threshold);
+        }
+        result = (double) above * interval / 1000;
+        break;
+    default:
+        break;
+    }
+    return result;
+}
+
+/**
+ * Evaluate a query on a run, returns false if the run doesn't have the column.
+ */
+static bool evaluate(const SeriesReader &reader, const SeriesRunHeader *run, const Query &query, double *result)
+{
+    if (query.aggregate == aggregateTime) {
+        const SeriesStateRun *stateRuns = reader.getStateRuns(run);
+        uint32_t samples = 0;
+        for (uint32_t i = 0; i < run->stateRuns; i++) {
+            if (stateRuns[i].state == query.state) {
+                samples += (i + 1 < run->stateRuns ? stateRuns[i + 1].start : run->samples) - stateRuns[i].start;
+            }
+        }
+        *result = (double) samples * run->interval / 1000;
+        return true;
+    }
+
+    const SeriesColumn *column = reader.findColumn(run, query.column, query.index);
+    if (column == NULL) {
+        return false;
+    }
+    const void *samples = reader.getSamples(run, column);
+    if (column->type == seriesInt16) {
+        *result = aggregate((const int16_t *) samples, run->samples, query, 0.1, run->interval);
+    } else {
+        *result = aggregate((const uint8_t *) samples, run->samples, query, 1, run->interval);
+    }
+    return true;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s file query...\n", name);
+    fprintf(stderr, "  query    aggregate:column, above:column:threshold or time:state\n");
+    fprintf(stderr, "  aggregate  max, min, mean, integral (per s), above (time in s above the threshold)\n");
+    fprintf(stderr, "  column   hive, target, zone<n>, plate<n> (in deg C), power<n>, fan<n> (0-255)\n");
+    fprintf(stderr, "  state    initializing, ready, pre-heating, running, over-temperature, shut-down, error\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    std::vector<Query> queries(argc - 2);
+    for (int i = 2; i < argc; i++) {
+        if (!parseQuery(argv[i], &queries[i - 2])) {
+            fprintf(stderr, "invalid query: %s\n", argv[i]);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    SeriesReader reader;
+    if (!reader.open(argv[1])) {
+        fprintf(stderr, "%s: unable to map the file or not a series file\n", argv[1]);
+        return 1;
+    }
+    if (reader.isTruncated()) {
+        fprintf(stderr, "%s: the file is truncated, only the complete runs are evaluated\n", argv[1]);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<const SeriesRunHeader *> runs = reader.getRuns();
+    std::stable_sort(runs.begin(), runs.end(), [](const SeriesRunHeader *a, const SeriesRunHeader *b) {return a->run < b->run;});
+
+    printf(" run  %-32s", "label");
+    for (const Query &query : queries) {
+        printf(" %16s", query.text);
+    }
+    printf("\n");
+    uint64_t samples = 0;
+    for (const SeriesRunHeader *run : runs) {
+        printf("%4u  %-32.*s", run->run, SERIES_LABEL_SIZE, run->label);
+        for (const Query &query : queries) {
+            double result;
+            if (evaluate(reader, run, query, &result)) {
+                printf(" %16.1f", result);
+            } else {
+                printf(" %16s", "-");
+            }
+        }
+        printf("\n");
+        samples += run->samples;
+    }
+    fprintf(stderr, "%zu runs, %llu samples evaluated in %.3fs\n", runs.size(), (unsigned long long) samples,
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * SeriesReader.cpp
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SeriesReader.h"
+
+SeriesReader::SeriesReader()
+{
+    data = NULL;
+    size = 0;
+    truncated = false;
+}
+
+SeriesReader::~SeriesReader()
+{
+    close();
+}
+
+/**
+ * Map the file and locate its runs (only their headers are read). Returns false if it
+ * can't be mapped or isn't a series file.
+ */
+bool SeriesReader::open(const char *name)
+{
+    close();
+    int file = ::open(name, O_RDONLY);
+    struct stat info;
+    if (file < 0 || fstat(file, &info) != 0 || (size_t) info.st_size < sizeof(SeriesFileHeader)) {
+        if (file >= 0) {
+            ::close(file);
+        }
+        return false;
+    }
+    void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    data = (const uint8_t *) mapped;
+    size = info.st_size;
+
+    const SeriesFileHeader *header = (const SeriesFileHeader *) data;
+    if (header->magic != SERIES_MAGIC || header->version != SERIES_VERSION) {
+        close();
+        return false;
+    }
+    size_t position = (header->size + SERIES_ALIGNMENT - 1) & ~(SERIES_ALIGNMENT - 1);
+    while (position < size) {
+        const SeriesRunHeader *run = (const SeriesRunHeader *) (data + position);
+        if (size - position < sizeof(SeriesRunHeader) || run->size > size - position || !isValid(run)) {
+            truncated = true; // e.g. the writer didn't complete
+            break;
+        }
+        runs.push_back(run);
+        position += run->size;
+    }
+    return true;
+}
+
+void SeriesReader::close()
+{
+    if (data != NULL) {
+        munmap((void *) data, size);
+    }
+    data = NULL;
+    size = 0;
+    runs.clear();
+    truncated = false;
+}
+
+/**
+ * Return the runs in the order they were written (which isn't necessarily the order of their numbers).
+ */
+const std::vector<const SeriesRunHeader *> &SeriesReader::getRuns() const
+{
+    return runs;
+}
+
+/**
+ * Find a column of a run, returns NULL if the run doesn't have it.
+ */
+const SeriesColumn *SeriesReader::findColumn(const SeriesRunHeader *run, uint8_t id, uint8_t index) const
+{
+    const SeriesColumn *columns = (const SeriesColumn *) (run + 1);
+    for (uint16_t i = 0; i < run->columns; i++) {
+        if (columns[i].id == id && columns[i].index == index) {
+            return &columns[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Return the samples of a column (int16_t or uint8_t depending on its type).
+ */
+const void *SeriesReader::getSamples(const SeriesRunHeader *run, const SeriesColumn *column) const
+{
+    return (const uint8_t *) run + column->offset;
+}
+
+const SeriesStateRun *SeriesReader::getStateRuns(const SeriesRunHeader *run) const
+{
+    return (const SeriesStateRun *) ((const uint8_t *) run + run->stateOffset);
+}
+
+bool SeriesReader::isTruncated() const
+{
+    return truncated;
+}
+
+/**
+ * Verify that the columns and state runs lie within the run.
+ */
+bool SeriesReader::isValid(const SeriesRunHeader *run) const
+{
+    if (run->magic != SERIES_RUN_MAGIC || run->size % SERIES_ALIGNMENT != 0
+            || run->size < sizeof(SeriesRunHeader) + (uint64_t) run->columns * sizeof(SeriesColumn)) {
+        return false;
+    }
+    const SeriesColumn *columns = (const SeriesColumn *) (run + 1);
+    for (uint16_t i = 0; i < run->columns; i++) {
+        uint64_t width = (columns[i].type == seriesInt16 ? sizeof(int16_t) : columns[i].type == seriesUint8 ? sizeof(uint8_t) : 0);
+        if (width == 0 || columns[i].offset % SERIES_ALIGNMENT != 0 || columns[i].offset + width * run->samples > run->size) {
+            return false;
+        }
+    }
+    return run->stateOffset % SERIES_ALIGNMENT == 0 && run->stateOffset + (uint64_t) run->stateRuns * sizeof(SeriesStateRun) <= run->size;
+}
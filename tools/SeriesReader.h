@@ -0,0 +1,61 @@
+/*
+ * SeriesReader.h
+ *
+ * Maps a file with the time series of simulated runs (see SeriesFormat.h) into
+ * memory. The runs and columns are accessed in place, so only the pages of the
+ * columns which are used are read from the disk.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SERIESREADER_H_
+#define SERIESREADER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "SeriesFormat.h"
+
+class SeriesReader
+{
+public:
+    SeriesReader();
+    ~SeriesReader();
+    bool open(const char *name);
+    void close();
+    const std::vector<const SeriesRunHeader *> &getRuns() const;
+    const SeriesColumn *findColumn(const SeriesRunHeader *run, uint8_t id, uint8_t index) const;
+    const void *getSamples(const SeriesRunHeader *run, const SeriesColumn *column) const;
+    const SeriesStateRun *getStateRuns(const SeriesRunHeader *run) const;
+    bool isTruncated() const;
+
+private:
+    bool isValid(const SeriesRunHeader *run) const;
+
+    const uint8_t *data; // the mapped file
+    size_t size;
+    std::vector<const SeriesRunHeader *> runs;
+    bool truncated; // the file ends with an incomplete or invalid run
+};
+
+#endif /* SERIESREADER_H_ */
@@ -0,0 +1,191 @@
+/*
+ * SeriesWriter.cpp
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <string.h>
+#include "SeriesWriter.h"
+
+#define SERIES_WRITE_BUFFER (1 << 20) // the runs are large, fewer and larger writes are faster
+
+SeriesRun::SeriesRun(uint32_t run, uint32_t interval, const std::string &label)
+{
+    memset(&header, 0, sizeof(header));
+    header.magic = SERIES_RUN_MAGIC;
+    header.run = run;
+    header.interval = interval;
+    strncpy(header.label, label.c_str(), SERIES_LABEL_SIZE - 1);
+}
+
+/**
+ * Add a column, must be called before the first sample. Returns the number of the column.
+ */
+uint16_t SeriesRun::addColumn(SeriesColumnId id, SeriesColumnType type, uint8_t index)
+{
+    SeriesColumn column;
+    memset(&column, 0, sizeof(column));
+    column.id = id;
+    column.type = type;
+    column.index = index;
+    columns.push_back(column);
+    data.push_back(std::vector<uint8_t>());
+    return columns.size() - 1;
+}
+
+/**
+ * Add the value of a column to the current sample.
+ */
+void SeriesRun::add(uint16_t column, int16_t value)
+{
+    std::vector<uint8_t> &samples = data[column];
+    if (columns[column].type == seriesInt16) {
+        const uint8_t *bytes = (const uint8_t *) &value;
+        samples.insert(samples.end(), bytes, bytes + sizeof(int16_t));
+    } else {
+        samples.push_back(value);
+    }
+}
+
+/**
+ * Add the system state of the current sample, only changes are stored.
+ */
+void SeriesRun::addState(uint8_t state)
+{
+    if (states.empty() || states.back().state != state) {
+        SeriesStateRun stateRun;
+        memset(&stateRun, 0, sizeof(stateRun));
+        stateRun.start = header.samples;
+        stateRun.state = state;
+        states.push_back(stateRun);
+    }
+}
+
+/**
+ * Complete the current sample, each column must have received its value.
+ */
+void SeriesRun::endSample()
+{
+    header.samples++;
+}
+
+uint32_t SeriesRun::getInterval() const
+{
+    return header.interval;
+}
+
+uint16_t SeriesRun::getNumberOfColumns() const
+{
+    return columns.size();
+}
+
+SeriesWriter::SeriesWriter()
+{
+    file = NULL;
+    failed = false;
+}
+
+SeriesWriter::~SeriesWriter()
+{
+    close();
+}
+
+/**
+ * Create the file and write its header.
+ */
+bool SeriesWriter::open(const char *name)
+{
+    file = fopen(name, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, SERIES_WRITE_BUFFER);
+
+    SeriesFileHeader fileHeader;
+    memset(&fileHeader, 0, sizeof(fileHeader));
+    fileHeader.magic = SERIES_MAGIC;
+    fileHeader.version = SERIES_VERSION;
+    fileHeader.size = sizeof(fileHeader);
+    failed = (fwrite(&fileHeader, sizeof(fileHeader), 1, file) != 1);
+    return !failed;
+}
+
+/**
+ * Append a run to the file. The columns and the state runs are laid out in the order they are
+ * written, so the file is written sequentially.
+ */
+bool SeriesWriter::write(const SeriesRun &run)
+{
+    static const uint8_t padding[SERIES_ALIGNMENT] = { 0 };
+    SeriesRunHeader header = run.header;
+    std::vector<SeriesColumn> columns = run.columns;
+
+    uint32_t offset = sizeof(SeriesRunHeader) + columns.size() * sizeof(SeriesColumn);
+    for (size_t i = 0; i < columns.size(); i++) {
+        offset = (offset + SERIES_ALIGNMENT - 1) & ~(SERIES_ALIGNMENT - 1);
+        columns[i].offset = offset;
+        offset += run.data[i].size();
+    }
+    offset = (offset + SERIES_ALIGNMENT - 1) & ~(SERIES_ALIGNMENT - 1);
+    header.columns = columns.size();
+    header.stateOffset = offset;
+    header.stateRuns = run.states.size();
+    header.size = (offset + run.states.size() * sizeof(SeriesStateRun) + SERIES_ALIGNMENT - 1) & ~(SERIES_ALIGNMENT - 1);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file == NULL) {
+        return false;
+    }
+    uint32_t position = 0;
+    auto put = [&](const void *data, size_t size) {
+        failed |= (size > 0 && fwrite(data, size, 1, file) != 1);
+        position += size;
+    };
+    auto align = [&]() {
+        put(padding, (SERIES_ALIGNMENT - position % SERIES_ALIGNMENT) % SERIES_ALIGNMENT);
+    };
+
+    put(&header, sizeof(header));
+    put(columns.data(), columns.size() * sizeof(SeriesColumn));
+    for (size_t i = 0; i < columns.size(); i++) {
+        align();
+        put(run.data[i].data(), run.data[i].size());
+    }
+    align();
+    put(run.states.data(), run.states.size() * sizeof(SeriesStateRun));
+    align();
+    return !failed;
+}
+
+/**
+ * Flush and close the file, returns false if any write failed.
+ */
+bool SeriesWriter::close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file != NULL) {
+        failed |= (fclose(file) != 0);
+        file = NULL;
+    }
+    return !failed;
+}
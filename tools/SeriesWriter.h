@@ -0,0 +1,81 @@
+/*
+ * SeriesWriter.h
+ *
+ * Collects the time series of a simulated run column by column and appends the
+ * runs to a file (see SeriesFormat.h).
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SERIESWRITER_H_
+#define SERIESWRITER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "SeriesFormat.h"
+
+/*
+ * The columns of one run in memory, they're filled sample by sample.
+ */
+class SeriesRun
+{
+public:
+    SeriesRun(uint32_t run, uint32_t interval, const std::string &label);
+    uint16_t addColumn(SeriesColumnId id, SeriesColumnType type, uint8_t index = 0);
+    void add(uint16_t column, int16_t value);
+    void addState(uint8_t state);
+    void endSample();
+    uint32_t getInterval() const;
+    uint16_t getNumberOfColumns() const;
+
+private:
+    friend class SeriesWriter;
+
+    SeriesRunHeader header;
+    std::vector<SeriesColumn> columns;
+    std::vector<std::vector<uint8_t> > data; // the samples of each column
+    std::vector<SeriesStateRun> states;
+};
+
+/*
+ * Appends runs to a file with buffered sequential writes, the runs can be written from several threads.
+ */
+class SeriesWriter
+{
+public:
+    SeriesWriter();
+    ~SeriesWriter();
+    bool open(const char *name);
+    bool write(const SeriesRun &run);
+    bool close();
+
+private:
+    std::mutex mutex;
+    FILE *file;
+    bool failed; // a write failed
+};
+
+#endif /* SERIESWRITER_H_ */
@@ -0,0 +1,369 @@
+/*
+ * Simulation.cpp
+ *
+ *
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "SeriesWriter.h"
+#include "Simulation.h"
+#include "Sauna.h"
+#include "SensorTrace.h"
+#include <OneWire.h>
+#include <DHT.h>
+
+#define SIMULATION_DEFAULT_TIME_LIMIT (24 * 3600) // in s
+#define SIMULATION_PROGRAM_SLOT 1 // the slot of the program store which receives the simulated program
+
+SimulationResult::SimulationResult()
+{
+    started = false;
+    completed = false;
+    overtemp = false;
+    duration = 0;
+    preHeatTime = 0;
+    overshoot = 0;
+    timeAtTarget = 0;
+    maxHiveTemperature = -999;
+    maxPlateTemperature = -999;
+    maxZoneTemperature = -999;
+    energy = 0;
+}
+
+SensorFaults::SensorFaults()
+{
+    bias = 0;
+    noise = 0;
+    dropout = 0;
+    deadSensor = -1;
+    deadTime = 0;
+    seed = 1;
+}
+
+Simulation::Simulation(const Program &program, const SaunaModelParameters &modelParameters) :
+        program(program), modelParameters(modelParameters)
+{
+    timeLimit = SIMULATION_DEFAULT_TIME_LIMIT;
+    usePWM = false;
+    trace = NULL;
+    series = NULL;
+    for (uint8_t i = 0; i < CFG_MAX_NUMBER_PLATES; i++) {
+        plateBias[i] = 0;
+        hiveBias[i] = 0;
+    }
+    this->modelParameters.numberOfPlates = constrain(modelParameters.numberOfPlates, 1, CFG_MAX_NUMBER_PLATES);
+}
+
+/**
+ * Limit the simulated time, the run ends earlier if the program completes (in s).
+ */
+void Simulation::setTimeLimit(uint32_t seconds)
+{
+    timeLimit = seconds;
+}
+
+/**
+ * Drive the heaters with PWM instead of the default on/off mode.
+ */
+void Simulation::setUsePWM(bool usePWM)
+{
+    this->usePWM = usePWM;
+}
+
+/**
+ * Let the sensors measure with errors and fail, the random errors are reproducible by the seed.
+ */
+void Simulation::setSensorFaults(const SensorFaults &faults)
+{
+    this->faults = faults;
+    random.seed(faults.seed);
+    for (uint8_t i = 0; i < CFG_MAX_NUMBER_PLATES; i++) {
+        plateBias[i] = (faults.bias > 0 ? std::normal_distribution<double>(0, faults.bias)(random) : 0);
+        hiveBias[i] = (faults.bias > 0 ? std::normal_distribution<double>(0, faults.bias)(random) : 0);
+    }
+}
+
+/**
+ * Record the inputs and outputs of the controller to a file, it can be replayed with tools/TraceReplay.cpp.
+ */
+void Simulation::setTrace(FILE *trace)
+{
+    this->trace = trace;
+}
+
+/**
+ * Record the time series of the run, sampled every interval of the series. The columns are the hive's
+ * actual and target temperature followed by the zone and plate temperatures, power and fan speed of each
+ * plate.
+ */
+void Simulation::setSeries(SeriesRun *series)
+{
+    this->series = series;
+}
+
+/**
+ * Simulate the program from a cold start until it completes or the time limit is reached.
+ */
+SimulationResult Simulation::run()
+{
+    SimulationResult result;
+    resetBoard();
+    Sauna *sauna = new Sauna();
+    sauna->select();
+    execute(&result);
+    EepromWriter::flush(); // pending jobs refer to the sauna's data
+    if (trace != NULL) {
+        SensorTrace::stop();
+        SerialBuffer::flush();
+        Serial.setCapture(NULL);
+    }
+    delete sauna;
+    return result;
+}
+
+/**
+ * Return the emulated hardware of the thread to its power-up state, a previous run may have changed it.
+ */
+void Simulation::resetBoard()
+{
+    HostClock::now = 0;
+    memset(HostPins::mode, 0, sizeof(HostPins::mode));
+    memset(HostPins::value, 0, sizeof(HostPins::value));
+    memset(EEPROM.memory, 0xff, sizeof(EEPROM.memory));
+    OneWire::detachAll();
+    DHT::setHumidity(50);
+    DHT::setTemperature(20);
+}
+
+/**
+ * Connect the heaters and fans of the plates beyond the default four to unused pins of the configuration.
+ */
+void Simulation::connectPlates(uint8_t numberOfPlates)
+{
+    ConfigurationIO *io = Configuration::getIO();
+    uint8_t pin = 28; // pins 28-43 and 46-53 aren't used by the default configuration
+
+    for (uint8_t i = 0; i < numberOfPlates; i++) {
+        if (io->heater[i] == 0) {
+            io->heater[i] = pin++;
+            io->fan[i] = pin++;
+            if (pin == 44) {
+                pin = 46;
+            }
+        }
+    }
+}
+
+/**
+ * Set-up the controller and run the control loop together with the model.
+ */
+void Simulation::execute(SimulationResult *result)
+{
+    SaunaModel model(modelParameters);
+    Serial.setEcho(false);
+    if (!configure(&model)) {
+        return;
+    }
+
+    if (trace != NULL) {
+        SerialBuffer::flush(); // the output of the configuration isn't part of the trace
+        Serial.setCapture(trace);
+        SensorTrace::start();
+    }
+    Controller::getInstance()->initialize();
+    char command[16];
+    snprintf(command, sizeof(command), "START=%d\n", SIMULATION_PROGRAM_SLOT);
+    Serial.inject(command); // like a user on the console, so a recorded trace contains the start
+
+    if (series != NULL) {
+        series->addColumn(seriesHive, seriesInt16);
+        series->addColumn(seriesTarget, seriesInt16);
+        for (uint8_t i = 0; i < model.getNumberOfPlates(); i++) {
+            series->addColumn(seriesZone, seriesInt16, i);
+            series->addColumn(seriesPlate, seriesInt16, i);
+            series->addColumn(seriesPower, seriesUint8, i);
+            series->addColumn(seriesFan, seriesUint8, i);
+        }
+    }
+
+    uint32_t startTime = millis(), lastUpdate = millis(), nextSample = millis(), nextSeriesSample = millis();
+    while (millis() - startTime < timeLimit * 1000) {
+        Controller::getInstance()->process();
+        if (!result->started) {
+            if (!ProgramHandler::getInstance()->isActive()) {
+                return;
+            }
+            result->started = true;
+        }
+        EepromWriter::process();
+        SerialBuffer::drain();
+        HostClock::advance(CFG_LOOP_DELAY);
+
+        updateModel(&model, (millis() - lastUpdate) / 1000.0);
+        lastUpdate = millis();
+        if ((int32_t) (millis() - nextSample) >= 0) {
+            nextSample += 1000;
+            updateResult(result, &model, (millis() - startTime) / 1000);
+        }
+        if (series != NULL && (int32_t) (millis() - nextSeriesSample) >= 0) {
+            nextSeriesSample += series->getInterval();
+            updateSeries(&model);
+        }
+
+        Status::SystemState state = Status::getInstance()->getSystemState();
+        if (state == Status::overtemp) {
+            result->overtemp = true;
+        }
+        if (state == Status::shutdown || state == Status::error) {
+            result->completed = (ProgramHandler::getInstance()->getStopReason() == programCompleted);
+            break;
+        }
+    }
+    result->duration = (millis() - startTime) / 1000;
+    result->energy = model.getEnergy();
+}
+
+/**
+ * Attach the emulated sensors and save a configuration which uses them: one sensor on each plate and one in each zone.
+ * The simulated program is saved to the program store.
+ */
+bool Simulation::configure(SaunaModel *model)
+{
+    Configuration::getInstance()->reset();
+    ConfigurationParams *params = Configuration::getParams();
+    ConfigurationSensor *sensor = Configuration::getSensor();
+
+    params->numberOfPlates = model->getNumberOfPlates();
+    params->usePWM = usePWM;
+    params->loglevel = Logger::Error;
+
+    connectPlates(model->getNumberOfPlates());
+    for (uint8_t i = 0; i < model->getNumberOfPlates(); i++) {
+        plateSensor[i] = OneWire::attach(0x100 + i);
+        hiveSensor[i] = OneWire::attach(0x200 + i);
+        if (plateSensor[i] < 0 || hiveSensor[i] < 0) {
+            return false;
+        }
+        OneWire::getAddress(plateSensor[i], sensor->addressPlate[i].byte);
+        OneWire::getAddress(hiveSensor[i], sensor->addressHive[i].byte);
+    }
+    updateModel(model, 0);
+
+    Configuration::getInstance()->save();
+    ProgramStore::getInstance()->save(SIMULATION_PROGRAM_SLOT, &program);
+    EepromWriter::flush();
+    return true;
+}
+
+/**
+ * Apply the controller's outputs to the model, advance it and report the new temperatures to the sensors.
+ * The main relay cuts the power of all heaters.
+ */
+void Simulation::updateModel(SaunaModel *model, double seconds)
+{
+    ConfigurationIO *io = Configuration::getIO();
+    bool relay = HostPins::get(io->heaterRelay);
+
+    for (uint8_t i = 0; i < model->getNumberOfPlates(); i++) {
+        model->setHeater(i, relay ? HostPins::get(io->heater[i]) / 255.0 : 0);
+        model->setFan(i, HostPins::get(io->fan[i]) / 255.0);
+    }
+    model->step(seconds);
+
+    double hiveTemperature = 0;
+    bool dead = (faults.deadSensor >= 0 && millis() / 1000 >= faults.deadTime);
+    for (uint8_t i = 0; i < model->getNumberOfPlates(); i++) {
+        OneWire::setTemperature(plateSensor[i], readSensor(plateSensor[i], model->getPlateTemperature(i), plateBias[i], false));
+        OneWire::setTemperature(hiveSensor[i], readSensor(hiveSensor[i], model->getZoneTemperature(i), hiveBias[i], dead && i == faults.deadSensor));
+        hiveTemperature += model->getZoneTemperature(i);
+    }
+    DHT::setTemperature(hiveTemperature / model->getNumberOfPlates());
+}
+
+/**
+ * Apply the faults to the temperature at a sensor (in deg C), returns what the sensor measures (in 0.1 deg C).
+ */
+int16_t Simulation::readSensor(uint8_t device, double temperature, double bias, bool dead)
+{
+    if (faults.noise > 0) {
+        temperature += std::normal_distribution<double>(0, faults.noise)(random);
+    }
+    if (faults.dropout > 0 || dead) {
+        OneWire::setResponding(device, !dead && std::uniform_real_distribution<double>(0, 1)(random) >= faults.dropout);
+    }
+    return round((temperature + bias) * 10);
+}
+
+/**
+ * Sample the temperatures once per second (time since the start in s).
+ */
+void Simulation::updateResult(SimulationResult *result, SaunaModel *model, uint32_t time)
+{
+    for (uint8_t i = 0; i < model->getNumberOfPlates(); i++) {
+        result->maxZoneTemperature = max(result->maxZoneTemperature, (int16_t) round(model->getZoneTemperature(i) * 10));
+    }
+
+    ProgramHandler *programHandler = ProgramHandler::getInstance();
+    Status *status = Status::getInstance();
+    if (!programHandler->isActive() || status->temperatureActualHive == -999) {
+        return;
+    }
+    int16_t target = programHandler->getTargetTemperature();
+    int16_t actual = status->temperatureActualHive;
+
+    if (result->preHeatTime == 0 && actual >= target - CFG_HISTORY_TARGET_TOLERANCE) {
+        result->preHeatTime = time;
+    }
+    if (abs(actual - target) <= CFG_HISTORY_TARGET_TOLERANCE) {
+        result->timeAtTarget++;
+    }
+    result->overshoot = max(result->overshoot, actual - target);
+    for (uint8_t i = 0; i < model->getNumberOfPlates(); i++) {
+        result->maxHiveTemperature = max(result->maxHiveTemperature, status->temperatureHive[i]);
+        result->maxPlateTemperature = max(result->maxPlateTemperature, status->temperaturePlate[i]);
+    }
+}
+
+/**
+ * Add a sample to the time series (see setSeries()).
+ */
+void Simulation::updateSeries(SaunaModel *model)
+{
+    ProgramHandler *programHandler = ProgramHandler::getInstance();
+    Status *status = Status::getInstance();
+    ConfigurationIO *io = Configuration::getIO();
+    bool relay = HostPins::get(io->heaterRelay);
+    uint16_t column = 0;
+
+    series->add(column++, status->temperatureActualHive);
+    series->add(column++, (programHandler->isActive() ? programHandler->getTargetTemperature() : 0));
+    for (uint8_t i = 0; i < model->getNumberOfPlates(); i++) {
+        series->add(column++, round(model->getZoneTemperature(i) * 10));
+        series->add(column++, round(model->getPlateTemperature(i) * 10));
+        series->add(column++, (relay ? HostPins::get(io->heater[i]) : 0));
+        series->add(column++, HostPins::get(io->fan[i]));
+    }
+    series->addState(status->getSystemState());
+    series->endSample();
+}
@@ -0,0 +1,113 @@
+/*
+ * Simulation.h
+ *
+ * Runs the firmware's Controller against a SaunaModel on the host: the heater
+ * and fan outputs drive the model, the model's temperatures are fed back through
+ * the emulated temperature sensors. The virtual clock advances by CFG_LOOP_DELAY
+ * per loop, so hours of a program are simulated in about a second.
+ *
+ * Each run creates a Sauna of its own and resets the emulated hardware of the
+ * calling thread, so runs start from scratch and can be executed by any thread.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef SIMULATION_H_
+#define SIMULATION_H_
+
+#include <random>
+#include "SaunaModel.h"
+#include "ProgramHandler.h"
+
+class SeriesRun;
+
+class SimulationResult
+{
+public:
+    SimulationResult();
+
+    bool started; // the controller initialized and started the program
+    bool completed; // the program ran to its end
+    bool overtemp; // the controller declared an over-temperature
+    uint32_t duration; // simulated time since the start of the program (in s)
+    uint32_t preHeatTime; // time until the hive reached the target temperature (in s, 0 = never)
+    int16_t overshoot; // highest hive temperature above the target (in 0.1 deg C)
+    uint32_t timeAtTarget; // time the hive was within CFG_HISTORY_TARGET_TOLERANCE of the target (in s)
+    int16_t maxHiveTemperature; // highest temperature of any hive sensor (in 0.1 deg C)
+    int16_t maxPlateTemperature; // highest temperature of any plate (in 0.1 deg C)
+    int16_t maxZoneTemperature; // highest actual temperature of any hive zone, regardless of the sensors (in 0.1 deg C)
+    double energy; // electrical energy of the heaters (in Wh)
+};
+
+/*
+ * Imperfections of the emulated temperature sensors, by default they are exact and always respond.
+ */
+class SensorFaults
+{
+public:
+    SensorFaults();
+
+    double bias; // standard deviation of the constant error of each sensor (in deg C)
+    double noise; // standard deviation of the error of each reading (in deg C)
+    double dropout; // fraction of the reads which fail (CRC error)
+    int8_t deadSensor; // the hive sensor which stops responding (-1 = none)
+    uint32_t deadTime; // time after which the dead sensor stops responding (in s)
+    uint32_t seed; // of the random errors
+};
+
+class Simulation
+{
+public:
+    Simulation(const Program &program, const SaunaModelParameters &modelParameters);
+    void setTimeLimit(uint32_t seconds);
+    void setUsePWM(bool usePWM);
+    void setSensorFaults(const SensorFaults &faults);
+    void setTrace(FILE *trace);
+    void setSeries(SeriesRun *series);
+    SimulationResult run();
+    static void resetBoard();
+    static void connectPlates(uint8_t numberOfPlates);
+
+private:
+    void execute(SimulationResult *result);
+    bool configure(SaunaModel *model);
+    void updateModel(SaunaModel *model, double seconds);
+    int16_t readSensor(uint8_t device, double temperature, double bias, bool dead);
+    void updateResult(SimulationResult *result, SaunaModel *model, uint32_t time);
+    void updateSeries(SaunaModel *model);
+
+    Program program;
+    SaunaModelParameters modelParameters;
+    uint32_t timeLimit; // maximum simulated time (in s)
+    bool usePWM;
+    SensorFaults faults;
+    FILE *trace; // receives the recorded sensor trace (NULL = not recorded)
+    SeriesRun *series; // receives the time series of the run (NULL = not recorded)
+    std::mt19937 random; // generates the errors of the sensors
+    double plateBias[CFG_MAX_NUMBER_PLATES]; // the constant error of each plate sensor (in deg C)
+    double hiveBias[CFG_MAX_NUMBER_PLATES]; // the constant error of each hive sensor (in deg C)
+    int8_t plateSensor[CFG_MAX_NUMBER_PLATES]; // the emulated sensor of each plate
+    int8_t hiveSensor[CFG_MAX_NUMBER_PLATES]; // the emulated sensor of each zone
+};
+
+#endif /* SIMULATION_H_ */
@@ -0,0 +1,199 @@
+/*
+ * TelemetryDecoder.cpp
+ *
+ * Host decoder for the binary telemetry stream (see TelemetryFormat.h).
+ * Reads the serial output from a file or stdin, writes one CSV line per frame
+ * to stdout and passes the text output of the firmware (log messages) to stderr.
+ * Frames are dropped if their CRC doesn't match. After a lost frame, decoding
+ * resumes with the next key frame.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -Itools/host -I. tools/TelemetryDecoder.cpp Crc.cpp tools/host/Arduino.cpp -o telemetryDecoder
+ *   ./telemetryDecoder capture.bin > telemetry.csv
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "TelemetryFormat.h"
+#include "SensorTraceFormat.h"
+#include "Crc.h"
+
+static const char *fixedChannelNames[telemetryFixedChannels] = { "state", "errorCode", "timeRunning", "timeRemaining", "hiveActual",
+        "hiveTarget", "plateTarget", "humidity", "humidifierTemperature", "humidifierFan", "vaporizer" };
+
+class Decoder
+{
+public:
+    Decoder() :
+            synced(false), expectedSequence(0), plates(0), hiveSensors(0), frames(0), dropped(0), bytesIn(0)
+    {
+    }
+
+    /*
+     * Process the bytes between two delimiters. Returns false if the block is no valid frame.
+     */
+    bool process(const std::vector<uint8_t> &block)
+    {
+        std::vector<uint8_t> frame(block.size());
+        int32_t length = telemetryCobsDecode(block.data(), block.size(), frame.data());
+
+        if (length > 0 && frame[0] == SENSOR_TRACE_MAGIC) {
+            return true; // a sensor trace, see TraceReplay.cpp
+        }
+        if (length < TELEMETRY_HEADER_SIZE + TELEMETRY_CRC_SIZE || frame[0] != TELEMETRY_VERSION) {
+            return false;
+        }
+        length -= TELEMETRY_CRC_SIZE;
+        uint32_t crc = 0;
+        for (uint8_t i = 0; i < TELEMETRY_CRC_SIZE; i++) {
+            crc |= (uint32_t) frame[length + i] << (8 * i);
+        }
+        if (crc != Crc::calculate(frame.data(), length)) {
+            dropped++;
+            synced = false;
+            return true;
+        }
+
+        bytesIn += block.size() + 1;
+        bool keyFrame = frame[1] & TELEMETRY_FLAG_KEYFRAME;
+        if (synced && frame[2] != expectedSequence) {
+            fprintf(stderr, "telemetry: %d frame(s) lost\n", (uint8_t) (frame[2] - expectedSequence));
+            dropped += (uint8_t) (frame[2] - expectedSequence);
+            synced = false;
+        }
+        expectedSequence = frame[2] + 1;
+        if (!synced && !keyFrame) {
+            return true;
+        }
+        if (keyFrame && (frame[3] != plates || frame[4] != hiveSensors || values.empty())) {
+            plates = frame[3];
+            hiveSensors = frame[4];
+            values.assign(telemetryChannels(plates, hiveSensors), 0);
+            printHeader();
+        }
+
+        uint8_t channels = values.size();
+        const uint8_t *mask = frame.data() + TELEMETRY_HEADER_SIZE;
+        uint16_t position = TELEMETRY_HEADER_SIZE + (channels + 7) / 8;
+        for (uint8_t i = 0; i < channels; i++) {
+            if (mask[i / 8] & (1 << (i % 8))) {
+                int32_t value;
+                uint8_t size = telemetryGetVarint(frame.data() + position, length - position, &value);
+                if (size == 0) {
+                    dropped++;
+                    synced = false;
+                    return true;
+                }
+                values[i] = (keyFrame ? value : values[i] + value);
+                position += size;
+            }
+        }
+        synced = true;
+        frames++;
+        printValues();
+        return true;
+    }
+
+    void printStatistics()
+    {
+        fprintf(stderr, "telemetry: %u frames decoded, %u dropped, %.1f bytes per frame\n", frames, dropped,
+                frames ? (double) bytesIn / frames : 0.0);
+    }
+
+private:
+    void printHeader()
+    {
+        printf("sequence");
+        for (uint8_t i = 0; i < telemetryFixedChannels; i++) {
+            printf(",%s", fixedChannelNames[i]);
+        }
+        for (uint8_t i = 0; i < hiveSensors; i++) {
+            printf(",hive%d", i + 1);
+        }
+        for (uint8_t i = 0; i < plates; i++) {
+            printf(",plate%d", i + 1);
+        }
+        for (uint8_t i = 0; i < plates; i++) {
+            printf(",power%d", i + 1);
+        }
+        for (uint8_t i = 0; i < plates; i++) {
+            printf(",fan%d", i + 1);
+        }
+        printf("\n");
+    }
+
+    void printValues()
+    {
+        printf("%d", (uint8_t) (expectedSequence - 1));
+        for (size_t i = 0; i < values.size(); i++) {
+            printf(",%d", values[i]);
+        }
+        printf("\n");
+    }
+
+    std::vector<int32_t> values;
+    bool synced;
+    uint8_t expectedSequence;
+    uint8_t plates;
+    uint8_t hiveSensors;
+    uint32_t frames;
+    uint32_t dropped;
+    uint32_t bytesIn;
+};
+
+int main(int argc, char **argv)
+{
+    FILE *input = stdin;
+    if (argc > 1 && (input = fopen(argv[1], "rb")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    Decoder decoder;
+    std::vector<uint8_t> block;
+    int c;
+
+    // frames are delimited by 0x00 on both sides, text between them is firmware output
+    while ((c = fgetc(input)) != EOF) {
+        if (c != 0) {
+            block.push_back(c);
+            continue;
+        }
+        if (!block.empty() && !decoder.process(block)) {
+            fwrite(block.data(), 1, block.size(), stderr);
+        }
+        block.clear();
+    }
+    if (!block.empty()) {
+        fwrite(block.data(), 1, block.size(), stderr);
+    }
+    decoder.printStatistics();
+
+    if (input != stdin) {
+        fclose(input);
+    }
+    return 0;
+}
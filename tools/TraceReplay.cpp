@@ -0,0 +1,444 @@
+/*
+ * TraceReplay.cpp
+ *
+ * Replays a recorded sensor trace (see SensorTrace.h) on the host: the recorded
+ * sensor reads, button events and console input are fed to the emulated hardware
+ * in the cycle in which the board read them, and the outputs of every cycle
+ * (state, relay, vaporizer, fans and heater power) are compared with the ones in
+ * the trace or in a golden trace. With -o the replay is recorded again, e.g. to
+ * create the golden trace before changing Controller, Plate or Humidifier. The exit
+ * code is 2 if the outputs differ.
+ *
+ * A trace is recorded by a board built with CFG_SENSOR_TRACE (capture its serial
+ * output) or on the host by simulating a program with -r.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -Itools/host -I. tools/TraceReplay.cpp tools/SensorTraceReader.cpp tools/Simulation.cpp \
+ *       tools/SaunaModel.cpp tools/SeriesWriter.cpp Sauna.cpp Controller.cpp Plate.cpp Fan.cpp Heater.cpp \
+ *       Humidifier.cpp HumiditySensor.cpp TemperatureSensor.cpp SerialConsole.cpp Checkpoint.cpp History.cpp HID.cpp \
+ *       Beeper.cpp Device.cpp ButtonInput.cpp LcdFrameBuffer.cpp ProgramHandler.cpp ProgramStore.cpp ThermalDose.cpp \
+ *       Telemetry.cpp SensorTrace.cpp Configuration.cpp Statistics.cpp Status.cpp Logger.cpp SerialBuffer.cpp \
+ *       EepromWriter.cpp Crc.cpp tools/host/Arduino.cpp tools/host/DHT.cpp tools/host/EEPROM.cpp \
+ *       tools/host/LiquidCrystal.cpp tools/host/OneWire.cpp tools/host/PID_v1.cpp -o traceReplay
+ *   ./traceReplay -r -p 2 -t 120 golden.trace
+ *   ./traceReplay golden.trace
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "SensorTraceReader.h"
+#include "Simulation.h"
+#include "Sauna.h"
+#include "SensorTrace.h"
+#include <OneWire.h>
+#include <DHT.h>
+
+/*
+ * Feeds the inputs of a trace to the emulated hardware and runs the controller cycle by cycle.
+ */
+class Replayer
+{
+public:
+    Replayer(const std::vector<SensorTraceEntry> &records) :
+            records(records)
+    {
+    }
+
+    /*
+     * Replay the trace from the start, optionally recording it again. Returns the outputs at the end of each cycle.
+     */
+    std::vector<std::vector<uint8_t> > run(FILE *output)
+    {
+        std::vector<std::vector<uint8_t> > outputs;
+        uint8_t values[traceFixedOutputs + 2 * CFG_MAX_NUMBER_PLATES];
+        size_t next = 0;
+
+        Simulation::resetBoard();
+        Serial.setEcho(false);
+        Sauna *sauna = new Sauna();
+        sauna->select();
+
+        // the EEPROM and the sensors must be in place before the controller is initialized
+        while (next < records.size() && records[next].type != traceCycle) {
+            apply(records[next++]);
+        }
+        if (output != NULL) {
+            Serial.setCapture(output);
+            SensorTrace::start();
+        }
+        Controller::getInstance()->initialize();
+
+        while (next < records.size()) {
+            uint32_t cycleTime = records[next++].time;
+            HostClock::now = max(HostClock::now, cycleTime);
+            while (next < records.size() && records[next].type != traceCycle) {
+                apply(records[next++]);
+            }
+            Controller::getInstance()->process();
+            EepromWriter::process();
+            SerialBuffer::drain();
+
+            uint8_t count = SensorTrace::getOutputs(values);
+            outputs.push_back(std::vector<uint8_t>(values, values + count));
+        }
+
+        if (output != NULL) {
+            SensorTrace::stop();
+            SerialBuffer::flush();
+            Serial.setCapture(NULL);
+        }
+        EepromWriter::flush(); // pending jobs refer to the sauna's data
+        delete sauna;
+        return outputs;
+    }
+
+private:
+    /*
+     * Apply an input to the emulated hardware, it's read in the current cycle. The outputs are ignored.
+     */
+    void apply(const SensorTraceEntry &record)
+    {
+        const uint8_t *payload = record.payload.data();
+
+        switch (record.type) {
+        case traceStart:
+            HostClock::now = record.time;
+            break;
+        case traceEeprom: {
+            uint16_t address = payload[0] | (payload[1] << 8);
+            if (address + payload[2] <= HOST_EEPROM_SIZE) {
+                memcpy(EEPROM.memory + address, payload + 3, payload[2]);
+            }
+            break;
+        }
+        case traceSensorFound:
+            sensors.push_back(OneWire::attach(payload));
+            scratchpads.push_back(std::vector<uint8_t>(9, 0));
+            break;
+        case traceScratchpad:
+        case traceTemperature: {
+            if (payload[0] >= sensors.size() || sensors[payload[0]] < 0) {
+                break;
+            }
+            std::vector<uint8_t> &scratchpad = scratchpads[payload[0]];
+            if (record.type == traceScratchpad) {
+                scratchpad.assign(payload + 1, payload + 10);
+            } else {
+                scratchpad[0] = payload[1];
+                scratchpad[1] = payload[2];
+                scratchpad[8] = OneWire::crc8(scratchpad.data(), 8);
+            }
+            OneWire::setScratchpad(sensors[payload[0]], scratchpad.data());
+            break;
+        }
+        case traceHumidity:
+            DHT::setHumidity(sensorTraceGetFloat(payload));
+            break;
+        case traceHumidityTemperature:
+            DHT::setTemperature(sensorTraceGetFloat(payload));
+            break;
+        case traceButton: {
+            uint32_t age = 0;
+            sensorTraceGetVarint(payload + 2, record.payload.size() - 2, &age);
+            ButtonInput::inject(payload[0], payload[1], record.time - age);
+            break;
+        }
+        case traceConsole:
+            Serial.inject(std::string((const char *) payload + 1, payload[0]).c_str());
+            break;
+        }
+    }
+
+    const std::vector<SensorTraceEntry> &records;
+    std::vector<int8_t> sensors; // the emulated device of each recorded sensor
+    std::vector<std::vector<uint8_t> > scratchpads; // the last scratchpad of each recorded sensor
+};
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-g golden] [-o output] [-m differences] trace\n", name);
+    fprintf(stderr, "       %s -r [-p program] [-t minutes] [-a ambient] [-N noise] [-D dropout] [-s seed] [-w] trace\n", name);
+    fprintf(stderr, "  -g       compare the outputs with a golden trace instead of the recorded ones\n");
+    fprintf(stderr, "  -o       record the replay to a new trace (e.g. a golden trace)\n");
+    fprintf(stderr, "  -m       maximum number of differences printed (default: 10)\n");
+    fprintf(stderr, "  -r       record a trace of a simulated program instead of replaying one\n");
+    fprintf(stderr, "  -p       the program to simulate (default: 1)\n");
+    fprintf(stderr, "  -t       simulated time (in min, default: until the program ends)\n");
+    fprintf(stderr, "  -a       ambient temperature (in deg C, default: 20)\n");
+    fprintf(stderr, "  -N       standard deviation of the sensors' noise (in deg C, default: 0)\n");
+    fprintf(stderr, "  -D       fraction of failed sensor reads (default: 0)\n");
+    fprintf(stderr, "  -s       seed of the sensor errors (default: 1)\n");
+    fprintf(stderr, "  -w       drive the heaters with PWM instead of on/off\n");
+}
+
+/**
+ * Format a time of the trace (in ms) as h:mm:ss.s
+ */
+static std::string formatTime(uint32_t time)
+{
+    char text[20];
+    snprintf(text, sizeof(text), "%u:%02u:%02u.%u", time / 3600000, (time / 60000) % 60, (time / 1000) % 60, (time / 100) % 10);
+    return text;
+}
+
+static std::string outputName(uint8_t output)
+{
+    static const char *names[traceFixedOutputs] = { "state", "relay", "vaporizer", "humidifierFan" };
+    if (output < traceFixedOutputs) {
+        return names[output];
+    }
+    char name[16];
+    snprintf(name, sizeof(name), "%s%d", ((output - traceFixedOutputs) % 2 ? "fan" : "power"), (output - traceFixedOutputs) / 2 + 1);
+    return name;
+}
+
+static bool readTrace(const char *name, SensorTraceReader *reader)
+{
+    FILE *input = fopen(name, "rb");
+    if (input == NULL) {
+        perror(name);
+        return false;
+    }
+    bool found = reader->read(input);
+    fclose(input);
+    if (!found) {
+        fprintf(stderr, "%s: no start of a recording found (%u invalid frames, the trace version must be %d)\n", name, reader->getInvalidFrames(),
+                SENSOR_TRACE_VERSION);
+        return false;
+    }
+    if (reader->getRestarts() > 0) {
+        fprintf(stderr, "%s: the board restarted, only the last of %u recordings is used\n", name, reader->getRestarts() + 1);
+    }
+    if (reader->getInvalidFrames() > 0 || reader->getLostFrames() > 0) {
+        fprintf(stderr, "%s: %u frames invalid, %u lost, the replay will differ\n", name, reader->getInvalidFrames(), reader->getLostFrames());
+    }
+    return true;
+}
+
+/**
+ * Check that the board stored the EEPROM content like the host does, otherwise the replay would
+ * start from misread configuration, programs and statistics.
+ */
+static bool checkLayout(const char *name, const SensorTraceReader &reader)
+{
+    static const char *names[traceLayoutValues] = { "configuration version", "statistics version", "ConfigurationParams", "ConfigurationIO",
+            "ConfigurationSensor", "StatisticValues", "HistoryRecord", "CheckpointRecord", "ProgramRecord" };
+    uint8_t layout[SENSOR_TRACE_LAYOUT_SIZE];
+    const std::vector<uint8_t> &recorded = reader.getRecords().front().payload; // the traceStart record
+
+    SensorTrace::getLayout(layout);
+    if (memcmp(recorded.data(), layout, sizeof(layout)) == 0) {
+        return true;
+    }
+    fprintf(stderr, "%s: the EEPROM image has a different layout than on the host, it can't be replayed:\n", name);
+    for (uint8_t i = 0; i < traceLayoutValues; i++) {
+        uint16_t board = recorded[2 * i] | (recorded[2 * i + 1] << 8), host = layout[2 * i] | (layout[2 * i + 1] << 8);
+        if (board != host) {
+            fprintf(stderr, "  %s: %u on the board, %u on the host\n", names[i], board, host);
+        }
+    }
+    return false;
+}
+
+/**
+ * Simulate a program with the sauna model and record the trace.
+ */
+static int recordTrace(const char *name, int programNumber, uint32_t timeLimit, const SaunaModelParameters &model, const SensorFaults &faults,
+        bool usePWM)
+{
+    Program program;
+    memset(&program, 0, sizeof(Program));
+    Configuration::getInstance()->reset();
+    if (!ProgramStore::getInstance()->load(programNumber, &program)) {
+        fprintf(stderr, "program #%d not found\n", programNumber);
+        return 1;
+    }
+    FILE *output = fopen(name, "wb");
+    if (output == NULL) {
+        perror(name);
+        return 1;
+    }
+
+    Simulation simulation(program, model);
+    simulation.setUsePWM(usePWM);
+    simulation.setSensorFaults(faults);
+    if (timeLimit > 0) {
+        simulation.setTimeLimit(timeLimit);
+    }
+    simulation.setTrace(output);
+    SimulationResult result = simulation.run();
+    long size = ftell(output);
+    fclose(output);
+
+    printf("%s: '%s' %s after %s, %.0fWh, %ld bytes\n", name, program.name,
+            (result.completed ? "completed" : (result.started ? "stopped" : "failed to start")), formatTime(result.duration * 1000).c_str(),
+            result.energy, size);
+    return 0;
+}
+
+/**
+ * Compare the outputs of the replay with the golden ones, returns the number of cycles which differ.
+ */
+static uint32_t compare(const std::vector<std::vector<uint8_t> > &actual, const std::vector<std::vector<uint8_t> > &golden,
+        const std::vector<uint32_t> &cycleTimes, uint32_t maxReported)
+{
+    std::vector<uint32_t> differencesPerOutput;
+    uint32_t differentCycles = 0, reported = 0;
+
+    if (actual.size() != golden.size()) {
+        printf("the replay has %zu cycles, the golden trace %zu\n", actual.size(), golden.size());
+    }
+    for (size_t cycle = 0; cycle < actual.size() && cycle < golden.size(); cycle++) {
+        size_t outputs = max(actual[cycle].size(), golden[cycle].size());
+        bool different = false;
+        differencesPerOutput.resize(max(differencesPerOutput.size(), outputs), 0);
+
+        for (size_t i = 0; i < outputs; i++) {
+            int value = (i < actual[cycle].size() ? actual[cycle][i] : -1);
+            int goldenValue = (i < golden[cycle].size() ? golden[cycle][i] : -1);
+            if (value == goldenValue) {
+                continue;
+            }
+            different = true;
+            differencesPerOutput[i]++;
+            if (reported++ < maxReported) {
+                printf("  cycle %zu (%s): %s %d, golden %d\n", cycle, formatTime(cycleTimes[cycle]).c_str(), outputName(i).c_str(), value, goldenValue);
+            }
+        }
+        differentCycles += different;
+    }
+
+    if (differentCycles > 0) {
+        printf("outputs differ in %u of %zu cycles:", differentCycles, min(actual.size(), golden.size()));
+        for (size_t i = 0; i < differencesPerOutput.size(); i++) {
+            if (differencesPerOutput[i] > 0) {
+                printf(" %s %u", outputName(i).c_str(), differencesPerOutput[i]);
+            }
+        }
+        printf("\n");
+    }
+    return differentCycles;
+}
+
+int main(int argc, char **argv)
+{
+    const char *goldenName = NULL, *outputName = NULL;
+    int programNumber = 1, option;
+    uint32_t timeLimit = 0, maxReported = 10;
+    bool record = false, usePWM = false;
+    SaunaModelParameters model;
+    SensorFaults faults;
+
+    while ((option = getopt(argc, argv, "g:o:m:rp:t:a:N:D:s:w")) != -1) {
+        bool valid = true;
+        switch (option) {
+        case 'g':
+            goldenName = optarg;
+            break;
+        case 'o':
+            outputName = optarg;
+            break;
+        case 'm':
+            maxReported = atoi(optarg);
+            break;
+        case 'r':
+            record = true;
+            break;
+        case 'p':
+            programNumber = atoi(optarg);
+            break;
+        case 't':
+            timeLimit = atoi(optarg) * 60;
+            break;
+        case 'a':
+            model.ambientTemperature = atof(optarg);
+            break;
+        case 'N':
+            faults.noise = atof(optarg);
+            break;
+        case 'D':
+            faults.dropout = atof(optarg);
+            break;
+        case 's':
+            faults.seed = strtoul(optarg, NULL, 10);
+            break;
+        case 'w':
+            usePWM = true;
+            break;
+        default:
+            valid = false;
+        }
+        if (!valid) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *traceName = argv[optind];
+    if (record) {
+        return recordTrace(traceName, programNumber, timeLimit, model, faults, usePWM);
+    }
+
+    SensorTraceReader reader, goldenReader;
+    if (!readTrace(traceName, &reader) || !checkLayout(traceName, reader) || (goldenName != NULL && !readTrace(goldenName, &goldenReader))) {
+        return 1;
+    }
+    const std::vector<SensorTraceEntry> &records = reader.getRecords();
+    std::vector<uint32_t> cycleTimes;
+    uint32_t sensors = 0;
+    for (const SensorTraceEntry &entry : records) {
+        if (entry.type == traceCycle) {
+            cycleTimes.push_back(entry.time - records.front().time);
+        }
+        sensors += (entry.type == traceSensorFound);
+    }
+    uint32_t duration = records.back().time - records.front().time;
+    printf("%s: %s recorded, %zu cycles, %u temperature sensors, %u bytes (%.1f bytes/s)\n", traceName, formatTime(duration).c_str(), cycleTimes.size(),
+            sensors, reader.getBytes(), (duration ? reader.getBytes() * 1000.0 / duration : 0.0));
+
+    FILE *output = NULL;
+    if (outputName != NULL && (output = fopen(outputName, "wb")) == NULL) {
+        perror(outputName);
+        return 1;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Replayer replayer(records);
+    std::vector<std::vector<uint8_t> > outputs = replayer.run(output);
+    if (output != NULL) {
+        fclose(output);
+    }
+    printf("replayed %zu cycles in %.2fs\n", outputs.size(), std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    uint32_t differences = compare(outputs, (goldenName != NULL ? goldenReader : reader).getOutputs(), cycleTimes, maxReported);
+    if (differences == 0) {
+        printf("the outputs are identical to the %s\n", (goldenName != NULL ? "golden trace" : "recorded ones"));
+    }
+    return (differences > 0 ? 2 : 0);
+}
@@ -0,0 +1,150 @@
+/*
+ * WorkStealingPool.cpp
+ *
+ *
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "WorkStealingPool.h"
+
+/**
+ * Start the workers, by default one per core.
+ */
+WorkStealingPool::WorkStealingPool(unsigned numberOfThreads) :
+        nextQueue(0), queued(0), pending(0), stopping(false)
+{
+    if (numberOfThreads == 0) {
+        numberOfThreads = std::thread::hardware_concurrency();
+    }
+    if (numberOfThreads == 0) {
+        numberOfThreads = 1;
+    }
+    for (unsigned i = 0; i < numberOfThreads; i++) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue));
+    }
+    for (unsigned i = 0; i < numberOfThreads; i++) {
+        threads.push_back(std::thread(&WorkStealingPool::work, this, i));
+    }
+}
+
+/**
+ * Finish all submitted tasks and stop the workers.
+ */
+WorkStealingPool::~WorkStealingPool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+void WorkStealingPool::submit(const std::function<void()> &task)
+{
+    Queue &queue = *queues[nextQueue++ % queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued++;
+        pending++;
+    }
+    wakeUp.notify_one();
+}
+
+/**
+ * Block until all submitted tasks are finished.
+ */
+void WorkStealingPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] {return pending == 0;});
+}
+
+unsigned WorkStealingPool::getNumberOfThreads()
+{
+    return threads.size();
+}
+
+/**
+ * The loop of a worker: run tasks until the pool is destroyed, sleep while there's nothing to do.
+ */
+void WorkStealingPool::work(unsigned index)
+{
+    std::function<void()> task;
+
+    while (true) {
+        if (take(index, &task)) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queued--;
+            }
+            task();
+            task = nullptr;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) {
+                finished.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeUp.wait(lock, [this] {return stopping || queued > 0;});
+        if (stopping && queued == 0) {
+            return;
+        }
+    }
+}
+
+/**
+ * Take the newest task of the worker's own queue or steal the oldest one from another queue.
+ */
+bool WorkStealingPool::take(unsigned index, std::function<void()> *task)
+{
+    {
+        Queue &own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            *task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue &victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            *task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
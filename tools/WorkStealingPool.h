@@ -0,0 +1,76 @@
+/*
+ * WorkStealingPool.h
+ *
+ * A pool of worker threads for the host tools. Every worker has a queue of its
+ * own, submitted tasks are distributed round-robin. A worker takes the newest
+ * task of its own queue and steals the oldest task of another queue when its
+ * own is empty, so long and short tasks balance across all cores.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef WORKSTEALINGPOOL_H_
+#define WORKSTEALINGPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool
+{
+public:
+    WorkStealingPool(unsigned numberOfThreads = 0);
+    ~WorkStealingPool();
+    void submit(const std::function<void()> &task);
+    void wait();
+    unsigned getNumberOfThreads();
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()> > tasks;
+    };
+
+    WorkStealingPool(WorkStealingPool const&); // copy disabled
+    void operator=(WorkStealingPool const&); // assigment disabled
+    void work(unsigned index);
+    bool take(unsigned index, std::function<void()> *task);
+
+    std::vector<std::unique_ptr<Queue> > queues;
+    std::vector<std::thread> threads;
+    std::atomic<unsigned> nextQueue; // the queue which receives the next submitted task
+    std::mutex mutex; // protects the counters and stopping, used with the condition variables
+    std::condition_variable wakeUp; // signals new tasks or the end to the workers
+    std::condition_variable finished; // signals that all tasks are done
+    size_t queued; // number of tasks waiting in the queues
+    size_t pending; // number of submitted tasks which aren't finished
+    bool stopping;
+};
+
+#endif /* WORKSTEALINGPOOL_H_ */
@@ -0,0 +1,438 @@
+/*
+ * Arduino.cpp
+ *
+ * Host implementation of the Arduino core subset declared in Arduino.h
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "Arduino.h"
+#include <ctype.h>
+
+thread_local uint32_t HostClock::now = 0;
+
+void HostClock::advance(uint32_t millis)
+{
+    now += millis;
+}
+
+uint32_t millis()
+{
+    return HostClock::now;
+}
+
+uint32_t micros()
+{
+    return HostClock::now * 1000;
+}
+
+void delay(uint32_t ms)
+{
+    HostClock::advance(ms);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+}
+
+thread_local uint8_t HostPins::mode[HOST_NUMBER_OF_PINS];
+thread_local int HostPins::value[HOST_NUMBER_OF_PINS];
+
+void HostPins::set(uint8_t pin, int value)
+{
+    if (pin < HOST_NUMBER_OF_PINS) {
+        HostPins::value[pin] = value;
+    }
+}
+
+int HostPins::get(uint8_t pin)
+{
+    return (pin < HOST_NUMBER_OF_PINS ? value[pin] : 0);
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin < HOST_NUMBER_OF_PINS) {
+        HostPins::mode[pin] = mode;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    HostPins::set(pin, value);
+}
+
+int digitalRead(uint8_t pin)
+{
+    return (HostPins::get(pin) ? HIGH : LOW);
+}
+
+void analogWrite(uint8_t pin, int value)
+{
+    HostPins::set(pin, value);
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+/*
+ * avr-libc's printf treats %S as a string in flash and "long" is 32 bit wide,
+ * the same as "int" on the host. Translate the format accordingly.
+ */
+int vsnprintf_P(char *buffer, size_t size, const char *format, va_list args)
+{
+    char hostFormat[256];
+    size_t j = 0;
+    bool conversion = false;
+
+    for (size_t i = 0; format[i] != 0 && j < sizeof(hostFormat) - 1; i++) {
+        char c = format[i];
+        if (conversion) {
+            if (c == 'l') {
+                continue;
+            }
+            if (c == 'S') {
+                c = 's';
+            }
+            if (isalpha(c) || c == '%') {
+                conversion = false;
+            }
+        } else if (c == '%') {
+            conversion = true;
+        }
+        hostFormat[j++] = c;
+    }
+    hostFormat[j] = 0;
+    return vsnprintf(buffer, size, hostFormat, args);
+}
+
+int snprintf_P(char *buffer, size_t size, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf_P(buffer, size, format, args);
+    va_end(args);
+    return length;
+}
+
+String::String(const char *str)
+{
+    buffer = NULL;
+    assign(str, strlen(str));
+}
+
+String::String(const __FlashStringHelper *str)
+{
+    buffer = NULL;
+    assign((const char *) str, strlen((const char *) str));
+}
+
+String::String(const String &str)
+{
+    buffer = NULL;
+    assign(str.buffer, str.len);
+}
+
+String::String(char c)
+{
+    buffer = NULL;
+    assign(&c, 1);
+}
+
+String::String(int value)
+{
+    char temp[12];
+    buffer = NULL;
+    assign(temp, snprintf(temp, sizeof(temp), "%d", value));
+}
+
+String::String(double value, unsigned char decimalPlaces)
+{
+    char temp[33];
+    buffer = NULL;
+    assign(temp, snprintf(temp, sizeof(temp), "%.*f", decimalPlaces, value));
+}
+
+String::~String()
+{
+    delete[] buffer;
+}
+
+String &String::operator=(const String &rhs)
+{
+    if (this != &rhs) {
+        assign(rhs.buffer, rhs.len);
+    }
+    return *this;
+}
+
+void String::assign(const char *str, size_t length)
+{
+    char *copy = new char[length + 1];
+    memcpy(copy, str, length);
+    copy[length] = 0;
+    delete[] buffer;
+    buffer = copy;
+    len = length;
+}
+
+bool String::operator==(const String &rhs) const
+{
+    return len == rhs.len && memcmp(buffer, rhs.buffer, len) == 0;
+}
+
+bool String::concat(const String &str)
+{
+    char *copy = new char[len + str.len + 1];
+    memcpy(copy, buffer, len);
+    memcpy(copy + len, str.buffer, str.len + 1);
+    delete[] buffer;
+    buffer = copy;
+    len += str.len;
+    return true;
+}
+
+String String::operator+(const String &rhs) const
+{
+    String result(*this);
+    result.concat(rhs);
+    return result;
+}
+
+unsigned int String::length() const
+{
+    return len;
+}
+
+const char *String::c_str() const
+{
+    return buffer;
+}
+
+void String::toUpperCase()
+{
+    for (size_t i = 0; i < len; i++) {
+        buffer[i] = toupper(buffer[i]);
+    }
+}
+
+bool String::startsWith(const String &prefix) const
+{
+    return prefix.len <= len && memcmp(buffer, prefix.buffer, prefix.len) == 0;
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+    String result;
+    if (from < to && from < len) {
+        result.assign(buffer + from, min(to, len) - from);
+    }
+    return result;
+}
+
+int String::indexOf(char c) const
+{
+    const char *pos = strchr(buffer, c);
+    return pos ? pos - buffer : -1;
+}
+
+long String::toInt() const
+{
+    return atol(buffer);
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        write(buffer[i]);
+    }
+    return size;
+}
+
+size_t Print::write(const char *str)
+{
+    return write((const uint8_t *) str, strlen(str));
+}
+
+size_t Print::print(const char *str)
+{
+    return write(str);
+}
+
+size_t Print::print(const String &str)
+{
+    return write(str.c_str());
+}
+
+size_t Print::print(const __FlashStringHelper *str)
+{
+    return write((const char *) str);
+}
+
+size_t Print::print(char c)
+{
+    return write((uint8_t) c);
+}
+
+size_t Print::print(int value)
+{
+    return print((long) value);
+}
+
+size_t Print::print(unsigned int value)
+{
+    return print((unsigned long) value);
+}
+
+size_t Print::print(long value)
+{
+    char temp[24];
+    snprintf(temp, sizeof(temp), "%ld", value);
+    return write(temp);
+}
+
+size_t Print::print(unsigned long value)
+{
+    char temp[24];
+    snprintf(temp, sizeof(temp), "%lu", value);
+    return write(temp);
+}
+
+size_t Print::println()
+{
+    return write("\r\n");
+}
+
+size_t Print::println(const char *str)
+{
+    return print(str) + println();
+}
+
+size_t Print::println(const String &str)
+{
+    return print(str) + println();
+}
+
+size_t Print::println(const __FlashStringHelper *str)
+{
+    return print(str) + println();
+}
+
+size_t Print::println(long value)
+{
+    return print(value) + println();
+}
+
+HardwareSerial::HardwareSerial()
+{
+    inputHead = inputTail = 0;
+    echo = true;
+    capture = NULL;
+    bytesWritten = 0;
+}
+
+void HardwareSerial::begin(uint32_t baud)
+{
+}
+
+int HardwareSerial::available()
+{
+    return (inputHead - inputTail + sizeof(input)) % sizeof(input);
+}
+
+int HardwareSerial::read()
+{
+    if (inputHead == inputTail) {
+        return -1;
+    }
+    char c = input[inputTail];
+    inputTail = (inputTail + 1) % sizeof(input);
+    return c;
+}
+
+/*
+ * The host has an unlimited transmit buffer.
+ */
+int HardwareSerial::availableForWrite()
+{
+    return 64;
+}
+
+void HardwareSerial::flush()
+{
+    fflush(stdout);
+    if (capture != NULL) {
+        fflush(capture);
+    }
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    bytesWritten++;
+    if (echo) {
+        putchar(c);
+    }
+    if (capture != NULL) {
+        fputc(c, capture);
+    }
+    return 1;
+}
+
+/*
+ * Add characters to the receive buffer as if they were sent by a terminal.
+ */
+void HardwareSerial::inject(const char *str)
+{
+    while (*str) {
+        input[inputHead] = *str++;
+        inputHead = (inputHead + 1) % sizeof(input);
+    }
+}
+
+/*
+ * Enable or disable printing of the serial output to stdout.
+ */
+void HardwareSerial::setEcho(bool echo)
+{
+    this->echo = echo;
+}
+
+/*
+ * Also write the serial output to a file (e.g. a recorded trace), NULL stops capturing.
+ */
+void HardwareSerial::setCapture(FILE *capture)
+{
+    this->capture = capture;
+}
+
+/*
+ * Get the total number of bytes written to the serial port.
+ */
+uint32_t HardwareSerial::getBytesWritten()
+{
+    return bytesWritten;
+}
+
+thread_local HardwareSerial Serial;
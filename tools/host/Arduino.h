@@ -0,0 +1,214 @@
+/*
+ * Arduino.h
+ *
+ * Minimal stand-in for the Arduino core which allows to compile parts of the
+ * firmware on a host (PC) for benchmarks and tools. Flash memory macros map to
+ * plain RAM access, the time is taken from a virtual clock which only advances
+ * by calling delay() or HostClock::advance().
+ *
+ * Like the firmware's singletons (see CFG_INSTANCE_LOCAL), the clock, the pins,
+ * the serial port and the EEPROM exist once per thread, so every thread can
+ * simulate its own sauna.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <math.h>
+
+#define ARDUINO 10600
+#define ARDUINO_HOST
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// flash memory access, on the host everything is in RAM
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *) (addr))
+#define pgm_read_word(addr) (*(const uint16_t *) (addr))
+#define pgm_read_dword(addr) (*(const uint32_t *) (addr))
+#define pgm_read_ptr(addr) (*(void * const *) (addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strcasecmp_P strcasecmp
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+int vsnprintf_P(char *buffer, size_t size, const char *format, va_list args);
+int snprintf_P(char *buffer, size_t size, const char *format, ...);
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define A0 54
+#define A1 55
+#define A2 56
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+/*
+ * The virtual clock of the host build.
+ */
+class HostClock
+{
+public:
+    static void advance(uint32_t millis);
+    static thread_local uint32_t now;
+};
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(unsigned int us);
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+#define HOST_NUMBER_OF_PINS 70
+
+/*
+ * The I/O pins of the host build. Outputs written by the firmware can be
+ * inspected and inputs (e.g. buttons) set with set().
+ */
+class HostPins
+{
+public:
+    static void set(uint8_t pin, int value);
+    static int get(uint8_t pin);
+    static thread_local uint8_t mode[HOST_NUMBER_OF_PINS];
+    static thread_local int value[HOST_NUMBER_OF_PINS]; // digital or PWM value of each pin
+};
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+/*
+ * Heap based String as used by the Arduino core (subset).
+ */
+class String
+{
+public:
+    String(const char *str = "");
+    String(const __FlashStringHelper *str);
+    String(const String &str);
+    String(char c);
+    String(int value);
+    String(double value, unsigned char decimalPlaces = 2);
+    ~String();
+    String &operator=(const String &rhs);
+    bool operator==(const String &rhs) const;
+    bool concat(const String &str);
+    String operator+(const String &rhs) const;
+    unsigned int length() const;
+    const char *c_str() const;
+    void toUpperCase();
+    bool startsWith(const String &prefix) const;
+    String substring(unsigned int from, unsigned int to) const;
+    int indexOf(char c) const;
+    long toInt() const;
+
+private:
+    void assign(const char *str, size_t len);
+    char *buffer;
+    size_t len;
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str);
+    size_t print(const char *str);
+    size_t print(const String &str);
+    size_t print(const __FlashStringHelper *str);
+    size_t print(char c);
+    size_t print(int value);
+    size_t print(unsigned int value);
+    size_t print(long value);
+    size_t print(unsigned long value);
+    size_t println();
+    size_t println(const char *str);
+    size_t println(const String &str);
+    size_t println(const __FlashStringHelper *str);
+    size_t println(long value);
+};
+
+/*
+ * Serial port of the host build. Output is written to stdout unless disabled,
+ * input can be injected with inject().
+ */
+class HardwareSerial: public Print
+{
+public:
+    HardwareSerial();
+    void begin(uint32_t baud);
+    int available();
+    int read();
+    int availableForWrite();
+    void flush();
+    size_t write(uint8_t c);
+    using Print::write;
+    void inject(const char *input);
+    void setEcho(bool echo);
+    void setCapture(FILE *capture);
+    uint32_t getBytesWritten();
+
+private:
+    char input[256];
+    uint16_t inputHead, inputTail;
+    bool echo;
+    FILE *capture;
+    uint32_t bytesWritten;
+};
+
+extern thread_local HardwareSerial Serial;
+
+#endif /* HOST_ARDUINO_H_ */
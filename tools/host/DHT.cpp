@@ -0,0 +1,60 @@
+/*
+ * DHT.cpp
+ *
+ *
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "DHT.h"
+
+thread_local float DHT::humidity = 50;
+thread_local float DHT::temperature = 20;
+
+DHT::DHT(uint8_t pin, uint8_t type)
+{
+}
+
+void DHT::begin()
+{
+}
+
+float DHT::readHumidity()
+{
+    return humidity;
+}
+
+float DHT::readTemperature()
+{
+    return temperature;
+}
+
+void DHT::setHumidity(float humidity)
+{
+    DHT::humidity = humidity;
+}
+
+void DHT::setTemperature(float temperature)
+{
+    DHT::temperature = temperature;
+}
@@ -0,0 +1,52 @@
+/*
+ * DHT.h
+ *
+ * Stand-in for the Adafruit DHT library on the host build. The humidity and
+ * temperature reported by all sensors are set by a simulation.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef HOST_DHT_H_
+#define HOST_DHT_H_
+
+#include "Arduino.h"
+
+class DHT
+{
+public:
+    DHT(uint8_t pin, uint8_t type);
+    void begin();
+    float readHumidity();
+    float readTemperature();
+
+    // access to the emulated sensor
+    static void setHumidity(float humidity);
+    static void setTemperature(float temperature);
+
+private:
+    static thread_local float humidity; // relative humidity in % (NAN = sensor not responding)
+    static thread_local float temperature; // in deg C
+};
+
+#endif /* HOST_DHT_H_ */
@@ -0,0 +1,63 @@
+/*
+ * EEPROM.h
+ *
+ * Stand-in for the Arduino EEPROM library on the host build, the 4kB of the
+ * ATmega2560 are kept in RAM (erased to 0xff at start-up).
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef HOST_EEPROM_H_
+#define HOST_EEPROM_H_
+
+#include "Arduino.h"
+
+#define HOST_EEPROM_SIZE 4096
+
+class EEPROMClass
+{
+public:
+    EEPROMClass();
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    void update(int address, uint8_t value);
+    uint16_t length();
+
+    template<typename T> T &get(int address, T &data)
+    {
+        memcpy(&data, memory + address, sizeof(T));
+        return data;
+    }
+
+    template<typename T> const T &put(int address, const T &data)
+    {
+        memcpy(memory + address, &data, sizeof(T));
+        return data;
+    }
+
+    uint8_t memory[HOST_EEPROM_SIZE];
+};
+
+extern thread_local EEPROMClass EEPROM;
+
+#endif /* HOST_EEPROM_H_ */
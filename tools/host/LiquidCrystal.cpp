@@ -0,0 +1,393 @@
+/*
+ * LiquidCrystal.cpp
+ *
+ * HD44780 emulation of the host build (see LiquidCrystal.h).
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "LiquidCrystal.h"
+
+thread_local LiquidCrystal *LiquidCrystal::active = NULL;
+
+static const char *customCharacters[] = { "⓪", "①", "②", "③", "④", "⑤", "⑥", "⑦" };
+
+LiquidCrystal::LiquidCrystal(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3)
+{
+    init(1, rs, 255, enable, d0, d1, d2, d3, 0, 0, 0, 0);
+}
+
+LiquidCrystal::LiquidCrystal(uint8_t rs, uint8_t rw, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3)
+{
+    init(1, rs, rw, enable, d0, d1, d2, d3, 0, 0, 0, 0);
+}
+
+/**
+ * Reset the emulated controller, the pins are ignored.
+ */
+void LiquidCrystal::init(uint8_t fourbitmode, uint8_t rs, uint8_t rw, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3,
+        uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7)
+{
+    memset(ddram, ' ', sizeof(ddram));
+    memset(cgram, 0, sizeof(cgram));
+    address = 0;
+    addressCgram = false;
+    entryMode = LCD_ENTRYLEFT;
+    displayControl = 0;
+    functionSet = LCD_8BITMODE | LCD_1LINE | LCD_5x8DOTS;
+    displayShift = 0;
+    fourBitMode = fourbitmode;
+    columns = 16;
+    rows = 1;
+    setRowOffsets(0x00, 0x40, 0x10, 0x50);
+    resetCounters();
+}
+
+/**
+ * Initialize the display like the library does (function set, display on, clear, entry mode).
+ */
+void LiquidCrystal::begin(uint8_t cols, uint8_t lines, uint8_t charsize)
+{
+    columns = cols;
+    rows = lines;
+    setRowOffsets(0x00, 0x40, 0x00 + cols, 0x40 + cols);
+    active = this;
+
+    command(LCD_FUNCTIONSET | (fourBitMode ? LCD_4BITMODE : LCD_8BITMODE) | (lines > 1 ? LCD_2LINE : LCD_1LINE) | charsize);
+    display();
+    clear();
+    command(LCD_ENTRYMODESET | LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT);
+}
+
+void LiquidCrystal::clear()
+{
+    command(LCD_CLEARDISPLAY);
+}
+
+void LiquidCrystal::home()
+{
+    command(LCD_RETURNHOME);
+}
+
+void LiquidCrystal::noDisplay()
+{
+    command(LCD_DISPLAYCONTROL | (displayControl & ~LCD_DISPLAYON));
+}
+
+void LiquidCrystal::display()
+{
+    command(LCD_DISPLAYCONTROL | displayControl | LCD_DISPLAYON);
+}
+
+void LiquidCrystal::noBlink()
+{
+    command(LCD_DISPLAYCONTROL | (displayControl & ~LCD_BLINKON));
+}
+
+void LiquidCrystal::blink()
+{
+    command(LCD_DISPLAYCONTROL | displayControl | LCD_BLINKON);
+}
+
+void LiquidCrystal::noCursor()
+{
+    command(LCD_DISPLAYCONTROL | (displayControl & ~LCD_CURSORON));
+}
+
+void LiquidCrystal::cursor()
+{
+    command(LCD_DISPLAYCONTROL | displayControl | LCD_CURSORON);
+}
+
+void LiquidCrystal::scrollDisplayLeft()
+{
+    command(LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVELEFT);
+}
+
+void LiquidCrystal::scrollDisplayRight()
+{
+    command(LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVERIGHT);
+}
+
+void LiquidCrystal::leftToRight()
+{
+    command(LCD_ENTRYMODESET | entryMode | LCD_ENTRYLEFT);
+}
+
+void LiquidCrystal::rightToLeft()
+{
+    command(LCD_ENTRYMODESET | (entryMode & ~LCD_ENTRYLEFT));
+}
+
+void LiquidCrystal::autoscroll()
+{
+    command(LCD_ENTRYMODESET | entryMode | LCD_ENTRYSHIFTINCREMENT);
+}
+
+void LiquidCrystal::noAutoscroll()
+{
+    command(LCD_ENTRYMODESET | (entryMode & ~LCD_ENTRYSHIFTINCREMENT));
+}
+
+void LiquidCrystal::setRowOffsets(int row0, int row1, int row2, int row3)
+{
+    rowOffsets[0] = row0;
+    rowOffsets[1] = row1;
+    rowOffsets[2] = row2;
+    rowOffsets[3] = row3;
+}
+
+void LiquidCrystal::createChar(uint8_t location, uint8_t charmap[])
+{
+    location &= 0x7;
+    command(LCD_SETCGRAMADDR | (location << 3));
+    for (int i = 0; i < 8; i++) {
+        write(charmap[i]);
+    }
+}
+
+void LiquidCrystal::setCursor(uint8_t col, uint8_t row)
+{
+    if (row >= 4) {
+        row = 3;
+    }
+    if (row >= rows) {
+        row = rows - 1;
+    }
+    command(LCD_SETDDRAMADDR | (col + rowOffsets[row]));
+}
+
+size_t LiquidCrystal::write(uint8_t value)
+{
+    send(value, true);
+    return 1;
+}
+
+void LiquidCrystal::command(uint8_t value)
+{
+    send(value, false);
+}
+
+/**
+ * Count a transfer and apply it to the emulated controller.
+ */
+void LiquidCrystal::send(uint8_t value, bool data)
+{
+    busTime += (fourBitMode ? 2 : 1) * LCD_TIME_NIBBLE;
+    if (!data) {
+        commands++;
+        execute(value);
+        return;
+    }
+
+    bytes++;
+    if (addressCgram) {
+        cgram[address & 0x3f] = value & 0x1f;
+        address = (address + ((entryMode & LCD_ENTRYLEFT) ? 1 : -1)) & 0x3f;
+        return;
+    }
+    ddram[address] = value;
+    moveAddress(entryMode & LCD_ENTRYLEFT);
+    if (entryMode & LCD_ENTRYSHIFTINCREMENT) {
+        displayShift = (displayShift + ((entryMode & LCD_ENTRYLEFT) ? 1 : 39)) % 40;
+    }
+}
+
+/**
+ * Execute an instruction (the highest set bit selects it).
+ */
+void LiquidCrystal::execute(uint8_t instruction)
+{
+    if (instruction & LCD_SETDDRAMADDR) {
+        address = instruction & 0x7f;
+        addressCgram = false;
+    } else if (instruction & LCD_SETCGRAMADDR) {
+        address = instruction & 0x3f;
+        addressCgram = true;
+    } else if (instruction & LCD_FUNCTIONSET) {
+        functionSet = instruction & (LCD_8BITMODE | LCD_2LINE | LCD_5x10DOTS);
+    } else if (instruction & LCD_CURSORSHIFT) {
+        bool right = instruction & LCD_MOVERIGHT;
+        if (instruction & LCD_DISPLAYMOVE) {
+            displayShift = (displayShift + (right ? 39 : 1)) % 40;
+        } else {
+            moveAddress(right);
+        }
+    } else if (instruction & LCD_DISPLAYCONTROL) {
+        displayControl = instruction & (LCD_DISPLAYON | LCD_CURSORON | LCD_BLINKON);
+    } else if (instruction & LCD_ENTRYMODESET) {
+        entryMode = instruction & (LCD_ENTRYLEFT | LCD_ENTRYSHIFTINCREMENT);
+    } else if (instruction & LCD_RETURNHOME) {
+        address = 0;
+        addressCgram = false;
+        displayShift = 0;
+        busTime += LCD_TIME_CLEAR_HOME;
+    } else if (instruction & LCD_CLEARDISPLAY) {
+        memset(ddram, ' ', sizeof(ddram));
+        address = 0;
+        addressCgram = false;
+        displayShift = 0;
+        entryMode |= LCD_ENTRYLEFT;
+        busTime += LCD_TIME_CLEAR_HOME;
+    }
+}
+
+/**
+ * Move the DDRAM address counter like the controller does: in 2-line mode
+ * 0x27 is followed by 0x40 and 0x67 by 0x00, in 1-line mode 0x4f by 0x00.
+ */
+void LiquidCrystal::moveAddress(bool forward)
+{
+    if (functionSet & LCD_2LINE) {
+        if (forward) {
+            address = (address == 0x27 ? 0x40 : address == 0x67 ? 0x00 : address + 1);
+        } else {
+            address = (address == 0x40 ? 0x27 : address == 0x00 ? 0x67 : address - 1);
+        }
+    } else {
+        address = (forward ? (address + 1) % 0x50 : (address + 0x4f) % 0x50);
+    }
+}
+
+/**
+ * Returns the display which was initialized last (e.g. the private one of the HID)
+ */
+LiquidCrystal *LiquidCrystal::getActive()
+{
+    return active;
+}
+
+/**
+ * Get the character code visible at a position (taking the display shift into account)
+ */
+uint8_t LiquidCrystal::getCharacter(uint8_t column, uint8_t row)
+{
+    if (!(displayControl & LCD_DISPLAYON) || row >= rows || column >= columns) {
+        return ' ';
+    }
+    if (!(functionSet & LCD_2LINE)) {
+        return ddram[(rowOffsets[row] + column + displayShift) % 0x50];
+    }
+    uint8_t line = rowOffsets[row] & 0x40;
+    return ddram[line + ((rowOffsets[row] & 0x3f) + column + displayShift) % 40];
+}
+
+/**
+ * Copy the character codes of a row to a buffer (columns + 1 bytes, terminated)
+ */
+void LiquidCrystal::getRow(uint8_t row, char *buffer)
+{
+    for (uint8_t column = 0; column < columns; column++) {
+        buffer[column] = getCharacter(column, row);
+    }
+    buffer[columns] = 0;
+}
+
+/**
+ * Print the screen in a frame, the glyphs of the character ROM (A00) used by the firmware
+ * are converted to UTF-8, custom characters are shown as circled numbers.
+ */
+void LiquidCrystal::render(FILE *out)
+{
+    fputc('+', out);
+    for (uint8_t column = 0; column < columns; column++) {
+        fputc('-', out);
+    }
+    fputs("+\n", out);
+
+    for (uint8_t row = 0; row < rows; row++) {
+        fputc('|', out);
+        for (uint8_t column = 0; column < columns; column++) {
+            uint8_t c = getCharacter(column, row);
+            switch (c) {
+            case 0x5c:
+                fputs("¥", out); // yen
+                break;
+            case 0x7e:
+                fputs("→", out); // right arrow
+                break;
+            case 0x7f:
+                fputs("←", out); // left arrow
+                break;
+            case 0xdf:
+                fputs("°", out); // degree
+                break;
+            case 0xe4:
+                fputs("µ", out); // micro
+                break;
+            case 0xeb:
+                fputs("ˣ", out); // superscript x
+                break;
+            case 0xf4:
+                fputs("Ω", out); // ohm
+                break;
+            default:
+                if (c < 0x10) {
+                    fputs(customCharacters[c & 7], out);
+                } else if (c < 0x80) {
+                    fputc(c, out);
+                } else {
+                    fputc('?', out);
+                }
+            }
+        }
+        fputs("|\n", out);
+    }
+
+    fputc('+', out);
+    for (uint8_t column = 0; column < columns; column++) {
+        fputc('-', out);
+    }
+    fputs("+\n", out);
+}
+
+void LiquidCrystal::resetCounters()
+{
+    bytes = 0;
+    commands = 0;
+    busTime = 0;
+}
+
+/**
+ * Returns the number of data bytes (characters) since the last reset of the counters
+ */
+uint32_t LiquidCrystal::getBytes()
+{
+    return bytes;
+}
+
+/**
+ * Returns the number of instructions since the last reset of the counters
+ */
+uint32_t LiquidCrystal::getCommands()
+{
+    return commands;
+}
+
+/**
+ * Returns the estimated time the transfers since the last reset of the counters blocked the loop (in us)
+ */
+uint32_t LiquidCrystal::getBusTime()
+{
+    return busTime;
+}
@@ -0,0 +1,145 @@
+/*
+ * LiquidCrystal.h
+ *
+ * Stand-in for the Arduino LiquidCrystal library on the host build. It emulates
+ * the HD44780 instruction set (DDRAM, CGRAM, address counter, entry mode and
+ * display shift) behind the same interface, captures the screen and counts the
+ * bytes sent to the controller with the estimated time they block the bus.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef HOST_LIQUIDCRYSTAL_H_
+#define HOST_LIQUIDCRYSTAL_H_
+
+#include "Arduino.h"
+
+// commands
+#define LCD_CLEARDISPLAY 0x01
+#define LCD_RETURNHOME 0x02
+#define LCD_ENTRYMODESET 0x04
+#define LCD_DISPLAYCONTROL 0x08
+#define LCD_CURSORSHIFT 0x10
+#define LCD_FUNCTIONSET 0x20
+#define LCD_SETCGRAMADDR 0x40
+#define LCD_SETDDRAMADDR 0x80
+
+// flags for display entry mode
+#define LCD_ENTRYRIGHT 0x00
+#define LCD_ENTRYLEFT 0x02
+#define LCD_ENTRYSHIFTINCREMENT 0x01
+#define LCD_ENTRYSHIFTDECREMENT 0x00
+
+// flags for display on/off control
+#define LCD_DISPLAYON 0x04
+#define LCD_DISPLAYOFF 0x00
+#define LCD_CURSORON 0x02
+#define LCD_CURSOROFF 0x00
+#define LCD_BLINKON 0x01
+#define LCD_BLINKOFF 0x00
+
+// flags for display/cursor shift
+#define LCD_DISPLAYMOVE 0x08
+#define LCD_CURSORMOVE 0x00
+#define LCD_MOVERIGHT 0x04
+#define LCD_MOVELEFT 0x00
+
+// flags for function set
+#define LCD_8BITMODE 0x10
+#define LCD_4BITMODE 0x00
+#define LCD_2LINE 0x08
+#define LCD_1LINE 0x00
+#define LCD_5x10DOTS 0x04
+#define LCD_5x8DOTS 0x00
+
+/*
+ * Estimated time the Arduino library needs per transfer: each nibble takes 7 digitalWrite()
+ * calls (~3.5us each) and the delays of pulseEnable() (102us), clear and home wait 2ms more.
+ */
+#define LCD_TIME_NIBBLE     127 // in us
+#define LCD_TIME_CLEAR_HOME 2000 // in us
+
+class LiquidCrystal: public Print
+{
+public:
+    LiquidCrystal(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3);
+    LiquidCrystal(uint8_t rs, uint8_t rw, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3);
+    void init(uint8_t fourbitmode, uint8_t rs, uint8_t rw, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3, uint8_t d4,
+            uint8_t d5, uint8_t d6, uint8_t d7);
+    void begin(uint8_t cols, uint8_t rows, uint8_t charsize = LCD_5x8DOTS);
+
+    void clear();
+    void home();
+    void noDisplay();
+    void display();
+    void noBlink();
+    void blink();
+    void noCursor();
+    void cursor();
+    void scrollDisplayLeft();
+    void scrollDisplayRight();
+    void leftToRight();
+    void rightToLeft();
+    void autoscroll();
+    void noAutoscroll();
+    void setRowOffsets(int row0, int row1, int row2, int row3);
+    void createChar(uint8_t location, uint8_t charmap[]);
+    void setCursor(uint8_t col, uint8_t row);
+    virtual size_t write(uint8_t value);
+    using Print::write;
+    void command(uint8_t value);
+
+    // emulator access
+    static LiquidCrystal *getActive();
+    uint8_t getCharacter(uint8_t column, uint8_t row);
+    void getRow(uint8_t row, char *buffer);
+    void render(FILE *out);
+    void resetCounters();
+    uint32_t getBytes();
+    uint32_t getCommands();
+    uint32_t getBusTime();
+
+private:
+    void send(uint8_t value, bool data);
+    void execute(uint8_t instruction);
+    void moveAddress(bool forward);
+
+    static thread_local LiquidCrystal *active; // the display which was initialized last
+
+    uint8_t ddram[128]; // display data, two lines of 40 characters at 0x00 and 0x40
+    uint8_t cgram[64]; // the 8 custom characters (8 rows of 5 pixels each)
+    uint8_t address; // the address counter
+    bool addressCgram; // the address counter points to the CGRAM
+    uint8_t entryMode; // LCD_ENTRY* flags
+    uint8_t displayControl; // LCD_DISPLAY*, LCD_CURSOR* and LCD_BLINK* flags
+    uint8_t functionSet; // LCD_*BITMODE, LCD_*LINE and LCD_5x*DOTS flags of the controller
+    uint8_t displayShift; // the number of positions the display is shifted left
+    uint8_t columns, rows;
+    uint8_t rowOffsets[4];
+    bool fourBitMode; // the interface mode of the library
+    uint32_t bytes; // number of data bytes since the last reset of the counters
+    uint32_t commands; // number of instructions since the last reset of the counters
+    uint32_t busTime; // estimated time spent in the library since the last reset of the counters (in us)
+};
+
+#endif /* HOST_LIQUIDCRYSTAL_H_ */
@@ -0,0 +1,226 @@
+/*
+ * OneWire.cpp
+ *
+ *
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "OneWire.h"
+
+#define ONE_WIRE_SELECT_NONE -1
+#define ONE_WIRE_SELECT_ALL -2
+
+thread_local OneWire::Device OneWire::devices[HOST_ONE_WIRE_DEVICES];
+thread_local uint8_t OneWire::numberOfDevices = 0;
+thread_local int8_t OneWire::selected = ONE_WIRE_SELECT_NONE;
+thread_local uint8_t OneWire::readPosition = 0;
+thread_local uint8_t OneWire::searchPosition = 0;
+
+OneWire::OneWire(uint8_t pin)
+{
+}
+
+/**
+ * Reset the bus, returns 1 if a device answered with a presence pulse.
+ */
+uint8_t OneWire::reset()
+{
+    selected = ONE_WIRE_SELECT_NONE;
+    readPosition = sizeof(devices[0].scratchpad);
+    return numberOfDevices > 0;
+}
+
+void OneWire::select(const uint8_t rom[8])
+{
+    selected = ONE_WIRE_SELECT_NONE;
+    for (uint8_t i = 0; i < numberOfDevices; i++) {
+        if (memcmp(devices[i].rom, rom, 8) == 0 && devices[i].responding) {
+            selected = i;
+        }
+    }
+}
+
+void OneWire::skip()
+{
+    selected = ONE_WIRE_SELECT_ALL;
+}
+
+/**
+ * Execute the function commands of the DS18B20: convert (0x44) and read scratchpad (0xbe).
+ */
+void OneWire::write(uint8_t value, uint8_t power)
+{
+    if (value == 0x44) {
+        for (uint8_t i = 0; i < numberOfDevices; i++) {
+            if ((selected == ONE_WIRE_SELECT_ALL || selected == i) && devices[i].responding) {
+                convert(devices[i]);
+            }
+        }
+    } else if (value == 0xbe) {
+        readPosition = 0;
+    }
+}
+
+/**
+ * Read the next byte of the selected device's scratchpad, an idle bus reads 0xff.
+ */
+uint8_t OneWire::read()
+{
+    if (selected < 0 || readPosition >= sizeof(devices[0].scratchpad)) {
+        return 0xff;
+    }
+    return devices[selected].scratchpad[readPosition++];
+}
+
+void OneWire::read_bytes(uint8_t *buffer, uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++) {
+        buffer[i] = read();
+    }
+}
+
+void OneWire::reset_search()
+{
+    searchPosition = 0;
+}
+
+/**
+ * Return the address of the next device on the bus (in the order they were attached).
+ */
+bool OneWire::search(uint8_t *address, bool searchMode)
+{
+    if (searchPosition >= numberOfDevices) {
+        return false;
+    }
+    memcpy(address, devices[searchPosition++].rom, 8);
+    return true;
+}
+
+/**
+ * The Dallas/Maxim CRC8 (polynomial x^8 + x^5 + x^4 + 1).
+ */
+uint8_t OneWire::crc8(const uint8_t *address, uint8_t length)
+{
+    uint8_t crc = 0;
+
+    while (length--) {
+        uint8_t data = *address++;
+        for (uint8_t i = 0; i < 8; i++) {
+            uint8_t mix = (crc ^ data) & 0x01;
+            crc >>= 1;
+            if (mix) {
+                crc ^= 0x8c;
+            }
+            data >>= 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * Add a DS18B20 (12 bit resolution, 20 deg C) with the given serial number to the bus.
+ * Returns the number of the device or -1 if the bus is full.
+ */
+int8_t OneWire::attach(uint32_t serial)
+{
+    uint8_t rom[8] = { 0x28 };
+    for (uint8_t i = 1; i < 5; i++) {
+        rom[i] = serial & 0xff;
+        serial >>= 8;
+    }
+    rom[7] = crc8(rom, 7);
+    return attach(rom);
+}
+
+/**
+ * Add a DS18B20 with the given address, e.g. one of a recorded trace.
+ */
+int8_t OneWire::attach(const uint8_t rom[8])
+{
+    if (numberOfDevices >= HOST_ONE_WIRE_DEVICES) {
+        return -1;
+    }
+    Device &device = devices[numberOfDevices];
+    memset(&device, 0, sizeof(Device));
+    memcpy(device.rom, rom, 8);
+    device.scratchpad[4] = 0x7f;
+    device.scratchpad[5] = 0xff;
+    device.scratchpad[7] = 0x10;
+    device.responding = true;
+    setTemperature(numberOfDevices, 200);
+    convert(device); // the sensor contains a valid value after power-up
+    return numberOfDevices++;
+}
+
+void OneWire::getAddress(uint8_t device, uint8_t rom[8])
+{
+    memcpy(rom, devices[device].rom, 8);
+}
+
+/**
+ * Set the temperature measured by a device (in 0.1 deg C), it is reported after the next conversion.
+ */
+void OneWire::setTemperature(uint8_t device, int16_t temperature)
+{
+    devices[device].temperature = (int32_t) temperature * 8 / 5;
+    devices[device].fixed = false;
+}
+
+/**
+ * Let a device ignore the commands on the bus, reading it returns the 0xff of the idle bus and fails the CRC check.
+ * The search still finds it.
+ */
+void OneWire::setResponding(uint8_t device, bool responding)
+{
+    devices[device].responding = responding;
+}
+
+/**
+ * Set the raw content of a device's scratchpad (including the CRC), e.g. a recorded read. It's returned
+ * by all reads until the next setTemperature().
+ */
+void OneWire::setScratchpad(uint8_t device, const uint8_t scratchpad[9])
+{
+    memcpy(devices[device].scratchpad, scratchpad, sizeof(devices[device].scratchpad));
+    devices[device].fixed = true;
+}
+
+/**
+ * Copy the actual temperature of a device into its scratchpad.
+ */
+void OneWire::convert(Device &device)
+{
+    if (device.fixed) {
+        return;
+    }
+    device.scratchpad[0] = device.temperature & 0xff;
+    device.scratchpad[1] = (device.temperature >> 8) & 0xff;
+    device.scratchpad[8] = crc8(device.scratchpad, 8);
+}
+
+void OneWire::detachAll()
+{
+    numberOfDevices = 0;
+    selected = ONE_WIRE_SELECT_NONE;
+}
@@ -0,0 +1,81 @@
+/*
+ * OneWire.h
+ *
+ * Stand-in for the OneWire library on the host build. It emulates a bus of
+ * DS18B20 temperature sensors whose temperature is set by a simulation with
+ * setTemperature(). A conversion (0x44) latches the temperatures into the
+ * scratchpads like on the real sensors.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef HOST_ONEWIRE_H_
+#define HOST_ONEWIRE_H_
+
+#include "Arduino.h"
+
+#define HOST_ONE_WIRE_DEVICES 32
+
+class OneWire
+{
+public:
+    OneWire(uint8_t pin);
+    uint8_t reset();
+    void select(const uint8_t rom[8]);
+    void skip();
+    void write(uint8_t value, uint8_t power = 0);
+    uint8_t read();
+    void read_bytes(uint8_t *buffer, uint16_t count);
+    void reset_search();
+    bool search(uint8_t *address, bool searchMode = true);
+    static uint8_t crc8(const uint8_t *address, uint8_t length);
+
+    // access to the emulated sensors
+    static int8_t attach(uint32_t serial);
+    static int8_t attach(const uint8_t rom[8]);
+    static void getAddress(uint8_t device, uint8_t rom[8]);
+    static void setTemperature(uint8_t device, int16_t temperature);
+    static void setResponding(uint8_t device, bool responding);
+    static void setScratchpad(uint8_t device, const uint8_t scratchpad[9]);
+    static void detachAll();
+
+private:
+    struct Device
+    {
+        uint8_t rom[8]; // family code, serial number and CRC
+        int16_t temperature; // the actual temperature (in 1/16 deg C)
+        uint8_t scratchpad[9]; // the temperature of the last conversion, configuration and CRC
+        bool responding; // false if the device ignores commands, e.g. because of a broken wire
+        bool fixed; // the scratchpad was set directly, conversions don't change it
+    };
+
+    static void convert(Device &device);
+
+    static thread_local Device devices[HOST_ONE_WIRE_DEVICES];
+    static thread_local uint8_t numberOfDevices;
+    static thread_local int8_t selected; // the addressed device (-1 = none, -2 = all)
+    static thread_local uint8_t readPosition; // next byte of the scratchpad to be read
+    static thread_local uint8_t searchPosition; // next device returned by search()
+};
+
+#endif /* HOST_ONEWIRE_H_ */
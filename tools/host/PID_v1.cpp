@@ -0,0 +1,170 @@
+/*
+ * PID_v1.cpp
+ *
+ *
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#include "PID_v1.h"
+
+PID::PID(double *input, double *output, double *setpoint, double kp, double ki, double kd, int direction)
+{
+    this->input = input;
+    this->output = output;
+    this->setpoint = setpoint;
+    inAuto = false;
+    outputSum = 0;
+    lastInput = 0;
+    outMin = 0;
+    outMax = 255;
+    sampleTime = 100;
+    controllerDirection = DIRECT;
+
+    SetOutputLimits(0, 255);
+    SetControllerDirection(direction);
+    SetTunings(kp, ki, kd);
+    lastTime = millis() - sampleTime;
+}
+
+/**
+ * Calculate a new output if the sample time elapsed, returns true if it was calculated.
+ */
+bool PID::Compute()
+{
+    if (!inAuto) {
+        return false;
+    }
+    uint32_t now = millis();
+    if (now - lastTime < sampleTime) {
+        return false;
+    }
+
+    double value = *input;
+    double error = *setpoint - value;
+    outputSum = constrain(outputSum + ki * error, outMin, outMax);
+    *output = constrain(kp * error + outputSum - kd * (value - lastInput), outMin, outMax);
+
+    lastInput = value;
+    lastTime = now;
+    return true;
+}
+
+void PID::SetTunings(double kp, double ki, double kd)
+{
+    if (kp < 0 || ki < 0 || kd < 0) {
+        return;
+    }
+    dispKp = kp;
+    dispKi = ki;
+    dispKd = kd;
+
+    double sampleTimeInSec = sampleTime / 1000.0;
+    this->kp = kp;
+    this->ki = ki * sampleTimeInSec;
+    this->kd = kd / sampleTimeInSec;
+
+    if (controllerDirection == REVERSE) {
+        this->kp = -this->kp;
+        this->ki = -this->ki;
+        this->kd = -this->kd;
+    }
+}
+
+void PID::SetSampleTime(int sampleTime)
+{
+    if (sampleTime > 0) {
+        double ratio = (double) sampleTime / this->sampleTime;
+        ki *= ratio;
+        kd /= ratio;
+        this->sampleTime = sampleTime;
+    }
+}
+
+void PID::SetOutputLimits(double min, double max)
+{
+    if (min >= max) {
+        return;
+    }
+    outMin = min;
+    outMax = max;
+
+    if (inAuto) {
+        *output = constrain(*output, outMin, outMax);
+        outputSum = constrain(outputSum, outMin, outMax);
+    }
+}
+
+/**
+ * Switch between manual (0) and automatic (1) mode. Switching to automatic continues
+ * bumpless from the current output.
+ */
+void PID::SetMode(int mode)
+{
+    bool newAuto = (mode == AUTOMATIC);
+    if (newAuto && !inAuto) {
+        Initialize();
+    }
+    inAuto = newAuto;
+}
+
+void PID::Initialize()
+{
+    outputSum = constrain(*output, outMin, outMax);
+    lastInput = *input;
+}
+
+void PID::SetControllerDirection(int direction)
+{
+    if (inAuto && direction != controllerDirection) {
+        kp = -kp;
+        ki = -ki;
+        kd = -kd;
+    }
+    controllerDirection = direction;
+}
+
+double PID::GetKp()
+{
+    return dispKp;
+}
+
+double PID::GetKi()
+{
+    return dispKi;
+}
+
+double PID::GetKd()
+{
+    return dispKd;
+}
+
+int PID::GetMode()
+{
+    return inAuto ? AUTOMATIC : MANUAL;
+}
+
+int PID::GetDirection()
+{
+    return controllerDirection;
+}
@@ -0,0 +1,72 @@
+/*
+ * PID_v1.h
+ *
+ * Stand-in for the Arduino PID library (v1.1) on the host build. It implements
+ * the same algorithm: integral clamped to the output limits, derivative on
+ * measurement and gains scaled by the sample time, so simulated controllers
+ * behave like the ones on the board.
+ *
+ Copyright (c) 2017 Michael Neuweiler
+
+ Permission is hereby granted, free of charge, to any person obtaining
+ a copy of this software and associated documentation files (the
+ "Software"), to deal in the Software without restriction, including
+ without limitation the rights to use, copy, modify, merge, publish,
+ distribute, sublicense, and/or sell copies of the Software, and to
+ permit persons to whom the Software is furnished to do so, subject to
+ the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef HOST_PID_V1_H_
+#define HOST_PID_V1_H_
+
+#include "Arduino.h"
+
+#define AUTOMATIC 1
+#define MANUAL 0
+#define DIRECT 0
+#define REVERSE 1
+
+class PID
+{
+public:
+    PID(double *input, double *output, double *setpoint, double kp, double ki, double kd, int direction);
+    void SetMode(int mode);
+    bool Compute();
+    void SetOutputLimits(double min, double max);
+    void SetTunings(double kp, double ki, double kd);
+    void SetControllerDirection(int direction);
+    void SetSampleTime(int sampleTime);
+    double GetKp();
+    double GetKi();
+    double GetKd();
+    int GetMode();
+    int GetDirection();
+
+private:
+    void Initialize();
+
+    double dispKp, dispKi, dispKd; // the tunings as entered (per second)
+    double kp, ki, kd; // the tunings scaled by the sample time
+    int controllerDirection;
+    double *input, *output, *setpoint;
+    uint32_t lastTime;
+    double outputSum, lastInput;
+    uint32_t sampleTime; // in ms
+    double outMin, outMax;
+    bool inAuto;
+};
+
+#endif /* HOST_PID_V1_H_ */
@@ -0,0 +1,6 @@
+/*
+ * avr/pgmspace.h
+ *
+ * Host build stand-in, all flash access macros are defined in Arduino.h.
+ */
+#include <Arduino.h>